@@ -12,6 +12,8 @@
 //
 //============================================================================
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <vector>
 
@@ -25,6 +27,7 @@
 #include "lighting_shader_node.h"
 
 #include "TroughSurface.h"
+#include "outline_pass.h"
 
 // Root of the scene graph and scene state
 SceneNode* SceneRoot;
@@ -37,6 +40,16 @@ CameraNode* MyCamera;
 // Lamp light
 LightNode* lamplight1;
 
+// Reflection used for the mirrored pass and the stamp identifying it
+Matrix4x4 MirrorMatrix;
+uint32_t  MirrorStamp;
+
+// Screen space outline pass (toggled with '3')
+OutlinePass* Outlines;
+
+// BVH over the scene triangles (built with '9')
+SceneBVH SceneRays;
+
 // Animated presentation node (global so we can toggle the tv power)
 PresentationNode* Video;
 
@@ -52,7 +65,6 @@ const float FrameRate = 72.0f;
 const float VideoFrameRate = 21.0f;
 
 int useRealistic = 0;
-bool useOutline = 0;
 int useBumpMap = 0;
 
 PresentationNode* floorMaterial;
@@ -70,6 +82,16 @@ PresentationNode* shadeMaterial;
 
 PresentationNode* rugMaterial;
 
+// The room materials (floor, walls, ceiling and rug) share texture arrays
+// so the room draws without texture binds. Layers are 1024x1024: the floor
+// and rug images are resampled down, which is not visible at the window
+// sizes used (and takes less memory than the separate textures).
+const bool UseTextureArrays = true;
+const int  RoomTextureSize = 1024;
+const int  RoomTextureLayers = 4;
+TextureArray* RoomTextures;
+TextureArray* RoomNormalMaps;
+
 // Simple logging function
 void logmsg(const char *message, ...)
 {
@@ -106,6 +128,16 @@ void UpdateView(const int x, const int y, bool forward) {
  * Display callback. Clears the prior scene and draws a new one.
  */
 void display() {
+	PROFILE_BEGIN_FRAME();
+
+	// Bindings made outside the state cache since the last frame (texture
+	// and vertex buffer creation) are not known
+	MySceneState.gl_state.InvalidateBindings();
+	MySceneState.gl_state.ResetStats();
+
+	// Draw to the outline pass framebuffer if outlines are enabled
+	Outlines->Begin(MySceneState.gl_state, RenderWidth, RenderHeight);
+
 	// Clear the framebuffer and the depth buffer
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -120,8 +152,11 @@ void display() {
     glStencilFunc(GL_NEVER, 1, 1);
     glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
 
-    MySceneState.Init();
-    tvNode->Draw(MySceneState);
+    {
+      PROFILE_PASS("stencil");
+      MySceneState.Init();
+      tvNode->Draw(MySceneState);
+    }
 
     glStencilFunc(GL_EQUAL, 1, 1);
     glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
@@ -131,13 +166,15 @@ void display() {
 
     MySceneState.Init();
 
-    MySceneState.model_matrix.Translate(0.0f, 200.0f, 0.0f);
-    MySceneState.model_matrix.Scale(1.0f, -1.0f, 1.0f);
+    MySceneState.SetModelMatrix(MirrorMatrix, MirrorStamp);
 
     HPoint3 lampLightPos = lamplight1->getPosition();
     lamplight1->SetPosition(MySceneState.model_matrix * lampLightPos);
 
-    SceneRoot->Draw(MySceneState);
+    {
+      PROFILE_PASS("reflection");
+      SceneRoot->Draw(MySceneState);
+    }
 
 	// Draw the scene as normal
     glDisable(GL_STENCIL_TEST);
@@ -147,8 +184,29 @@ void display() {
 
     lamplight1->SetPosition(lampLightPos);
 
-    tvNode->Draw(MySceneState);
-	SceneRoot->Draw(MySceneState);
+    {
+      PROFILE_PASS("main");
+      tvNode->Draw(MySceneState);
+      SceneRoot->Draw(MySceneState);
+    }
+
+	// No vertex array stays bound between frames (vertex buffer setup binds
+	// element buffers before binding its own VAO)
+	MySceneState.gl_state.BindVertexArray(0);
+
+	// Draw outlines over the scene
+	{
+		PROFILE_PASS("outlines");
+		Outlines->End(MySceneState.gl_state);
+	}
+	PROFILE_END_FRAME();
+
+#if SCENE_PROFILING
+	// Keep drawing while a trace is captured
+	FrameProfiler::Get().PeriodicPrint();
+	if (FrameProfiler::Get().IsCapturing())
+		glutPostRedisplay();
+#endif
 
 	// Swap buffers
 	glutSwapBuffers();
@@ -231,6 +289,22 @@ void screenTimer(int value)
 	}
 }
 
+/**
+ * Callback to upload textures decoded in the background. Runs until all
+ * textures are loaded.
+ */
+void textureTimer(int value)
+{
+	if (TextureLoader::Get().UploadCompleted() > 0)
+	{
+		glutPostRedisplay();
+	}
+	if (TextureLoader::Get().GetPendingCount() > 0)
+	{
+		glutTimerFunc(1000.0f / FrameRate, textureTimer, 0);
+	}
+}
+
 /**
  * Toggles textures and realistic vs non realistic shading
  */
@@ -255,7 +329,7 @@ void toggleShaderModes()
     rugMaterial->useTextureAndNormal(useRealistic, useBumpMap);
 
 	// Toggle realistic lighting
-	glUniform1i(MySceneState.usereallighting_loc, useRealistic);
+	MySceneState.gl_state.Uniform1i(MySceneState.usereallighting_loc, useRealistic);
 }
 
 void toggleNormalMapModes()
@@ -279,7 +353,7 @@ void toggleNormalMapModes()
 		rugMaterial->useTextureAndNormal(useRealistic, useBumpMap);
 
 		// Toggle realistic lighting
-		glUniform1i(MySceneState.usenormalmap_loc, useBumpMap);
+		MySceneState.gl_state.Uniform1i(MySceneState.usenormalmap_loc, useBumpMap);
 }
 
 /**
@@ -287,8 +361,83 @@ void toggleNormalMapModes()
  */
 void toggleOutlines()
 {
-	useOutline = (useOutline == 0) ? 1 : 0;
-	glUniform1i(MySceneState.outlineEnable_loc, useOutline);
+	Outlines->SetEnabled(!Outlines->IsEnabled());
+}
+
+/**
+ * Bring the scene BVH up to date and cast a grid of rays through the view
+ * (one per pixel) against it, one ray at a time and in packets. Prints the
+ * build time and rays per second.
+ */
+void benchmarkRays() {
+	SceneRays.Update(SceneRoot);
+	printf("Scene BVH: %u instances, %u triangles, %s in %.2f ms\n",
+		SceneRays.GetInstanceCount(), SceneRays.GetTriangleCount(),
+		SceneRays.WasRefit() ? "refit" : "built", SceneRays.GetBuildTime());
+
+	// Ray directions through the pixel centers of the view
+	Point3  eye = MyCamera->GetPosition();
+	Vector3 n = MyCamera->GetViewPlaneNormal();
+	Vector3 u = MyCamera->GetViewRight();
+	Vector3 v = MyCamera->GetViewUp();
+	float h = tanf(DegreesToRadians(MyCamera->GetFieldOfView() * 0.5f));
+	float w = MyCamera->GetAspectRatio() * h;
+	uint32_t width = static_cast<uint32_t>(RenderWidth);
+	uint32_t height = static_cast<uint32_t>(RenderHeight);
+	float far_clip = MyCamera->GetFarClip();
+	std::vector<uint32_t> hits(height, 0);
+	auto start = std::chrono::high_resolution_clock::now();
+	ParallelFor(height, 1, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			float sy = h * (1.0f - 2.0f * (y + 0.5f) / height);
+			for (uint32_t x = 0; x < width; x++) {
+				float sx = w * (2.0f * (x + 0.5f) / width - 1.0f);
+				Ray3 ray(eye, u * sx + v * sy - n);
+				SceneHit hit;
+				if (SceneRays.Intersect(ray, far_clip, hit))
+					hits[y]++;
+			}
+		}
+	});
+	float ms = std::chrono::duration<float, std::milli>(
+		std::chrono::high_resolution_clock::now() - start).count();
+	uint32_t hit_count = 0;
+	for (auto count : hits)
+		hit_count += count;
+	uint32_t rays = width * height;
+	printf("Scene BVH: %u rays (%u hits) in %.2f ms, %.2f Mrays/s\n", rays, hit_count, ms,
+		(ms > 0.0f) ? rays / (ms * 1000.0f) : 0.0f);
+
+	// Same rays traced in packets of adjacent pixels
+	std::fill(hits.begin(), hits.end(), 0);
+	start = std::chrono::high_resolution_clock::now();
+	ParallelFor(height, 1, [&](size_t begin, size_t end) {
+		RayPacket packet;
+		SceneHit packet_hits[kRayPacketSize];
+		for (size_t y = begin; y < end; y++) {
+			float sy = h * (1.0f - 2.0f * (y + 0.5f) / height);
+			for (uint32_t x = 0; x < width; x += kRayPacketSize) {
+				// Lanes past the end of the row repeat the last pixel
+				uint32_t count = std::min(kRayPacketSize, width - x);
+				for (uint32_t lane = 0; lane < kRayPacketSize; lane++) {
+					uint32_t px = x + std::min(lane, count - 1);
+					float sx = w * (2.0f * (px + 0.5f) / width - 1.0f);
+					packet.Set(lane, Ray3(eye, u * sx + v * sy - n));
+				}
+				uint32_t mask = SceneRays.IntersectPacket(packet, (1u << count) - 1, far_clip,
+					packet_hits);
+				for (; mask != 0; mask &= mask - 1)
+					hits[y]++;
+			}
+		}
+	});
+	ms = std::chrono::duration<float, std::milli>(
+		std::chrono::high_resolution_clock::now() - start).count();
+	hit_count = 0;
+	for (auto count : hits)
+		hit_count += count;
+	printf("Scene BVH: %u rays (%u hits) in packets of %u in %.2f ms, %.2f Mrays/s\n", rays,
+		hit_count, kRayPacketSize, ms, (ms > 0.0f) ? rays / (ms * 1000.0f) : 0.0f);
 }
 
 /**
@@ -417,6 +566,40 @@ void keyboard(unsigned char key, int x, int y) {
 	case '4':
 			toggleNormalMapModes();
 			glutPostRedisplay();
+			break;
+
+	// Print the OpenGL state changes made and skipped in the last frame
+	case '5':
+		printf("OpenGL state changes (last frame):\n");
+		MySceneState.gl_state.PrintStats();
+		break;
+
+	// Print the textures with their reference counts and GPU memory
+	case '8':
+		TextureCache::Get().PrintStats();
+		break;
+
+	// Update the scene BVH and time rays cast through each pixel
+	case '9':
+		benchmarkRays();
+		break;
+
+#if SCENE_PROFILING
+	// Print the frame stats now and every 120 frames (toggle)
+	case '6':
+		FrameProfiler::Get().PrintRolling();
+		FrameProfiler::Get().SetPeriodicPrint(!FrameProfiler::Get().GetPeriodicPrint());
+		break;
+
+	// Capture the next 60 frames to a Chrome trace
+	case '7':
+		if (FrameProfiler::Get().StartCapture("FinalProject_trace.json", 60))
+		{
+			printf("Capturing 60 frames to FinalProject_trace.json\n");
+			glutPostRedisplay();
+		}
+		break;
+#endif
 	default:
 		break;
 	}
@@ -453,6 +636,27 @@ void AddSubTree(SceneNode* parent, SceneNode* material, SceneNode* transform, Sc
 	transform->AddChild(geometry);
 }
 
+/**
+ * Set the texture and normal map of a room material: layers of the room
+ * texture arrays, or repeating textures if the arrays are not used.
+ * @param  material    Room material.
+ * @param  texture     Texture image filename (relative to textures).
+ * @param  normal_map  Normal map image filename (relative to textures).
+ */
+void SetRoomTextures(PresentationNode* material, const char* texture, const char* normal_map)
+{
+	if (UseTextureArrays)
+	{
+		material->SetTextureLayer(RoomTextures, texture);
+		material->SetNormalMapLayer(RoomNormalMaps, normal_map);
+	}
+	else
+	{
+		material->SetTexture(texture, GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+		material->setNormalMap(normal_map, GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+	}
+}
+
 /**
  * Construct room as a child of the specified node
  * @param  parent       Parent node
@@ -504,8 +708,7 @@ SceneNode* ConstructRoom(UnitSquareSurface* unit_square, TexturedUnitSquareSurfa
 		Color4(0.2f, 0.2f, 0.2f),
 		Color4(0.0f, 0.0f, 0.0f),
 		5.0f);
-	floorMaterial->SetTexture("wood-floor-texture.jpg", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-	floorMaterial->setNormalMap("wood-floor-normal.jpg", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+	SetRoomTextures(floorMaterial, "wood-floor-texture.jpg", "wood-floor-normal.jpg");
 	floorMaterial->setTextureScale(4.0f);
 
 	// Use a texture for the walls
@@ -514,8 +717,7 @@ SceneNode* ConstructRoom(UnitSquareSurface* unit_square, TexturedUnitSquareSurfa
 		Color4(0.4f, 0.4f, 0.4f),
 		Color4(0.0f, 0.0f, 0.0f),
 		16.0f);
-	wallMaterial->SetTexture("masonry-wall-texture.jpg", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-	wallMaterial->setNormalMap("masonry-wall-normal.jpg", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+	SetRoomTextures(wallMaterial, "masonry-wall-texture.jpg", "masonry-wall-normal.jpg");
 	wallMaterial->setTextureScale(4.0f);
 
 	// Use a texture for the ceiling
@@ -524,8 +726,7 @@ SceneNode* ConstructRoom(UnitSquareSurface* unit_square, TexturedUnitSquareSurfa
 		Color4(0.9f, 0.9f, 0.9f),
 		Color4(0.0f, 0.0f, 0.0f),
 		64.0);
-	ceilMaterial->SetTexture("ceiling-texture.jpg", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-	ceilMaterial->setNormalMap("ceiling-normal.jpg", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+	SetRoomTextures(ceilMaterial, "ceiling-texture.jpg", "ceiling-normal.jpg");
 	ceilMaterial->setTextureScale(8.0f);
 
 	// Walls. We can group these all under a single presentation node.
@@ -553,52 +754,44 @@ SceneNode* ConstructRoom(UnitSquareSurface* unit_square, TexturedUnitSquareSurfa
 * @param  unit_square  Geometry node to use
 */
 SceneNode* ConstructUnitBox(TexturedUnitSquareSurface* textured_square) {
-	// Contruct transform nodes for the sides of the box.
-	// Perform rotations so the sides face outwards
-
-	// Bottom is rotated 180 degrees so it faces outwards
-	TransformNode* bottom_transform = new TransformNode;
-	bottom_transform->Translate(0.0f, 0.0f, -0.5f);
-	bottom_transform->RotateX(180.0f);
+	// The sides of the box are instances of the textured square, drawn with
+	// one instanced call. Perform rotations so the sides face outwards
+	InstancedGeometryNode* box = new InstancedGeometryNode(textured_square);
+	Matrix4x4 side;
 
 	// Back is rotated -90 degrees about x: (z -> y)
-	TransformNode* back_transform = new TransformNode;
-	back_transform->Translate(0.0f, 0.5f, 0.0f);
-	back_transform->RotateX(-90.0f);
-
-	// Front wall is rotated 90 degrees about x: (y -> z)
-	TransformNode* front_transform = new TransformNode;
-	front_transform->Translate(0.0f, -0.5f, 0.0f);
-	front_transform->RotateX(90.0f);
+	side.Translate(0.0f, 0.5f, 0.0f);
+	side.RotateX(-90.0f);
+	box->AddInstance(side);
 
 	// Left wall is rotated -90 about y: (z -> -x)
-	TransformNode* left_transform = new TransformNode;
-	left_transform->Translate(-0.5f, 0.0f, 00.0f);
-	left_transform->RotateY(-90.0f);
+	side.SetIdentity();
+	side.Translate(-0.5f, 0.0f, 00.0f);
+	side.RotateY(-90.0f);
+	box->AddInstance(side);
 
 	// Right wall is rotated 90 degrees about y: (z -> x)
-	TransformNode* right_transform = new TransformNode;
-	right_transform->Translate(0.5f, 0.0f, 0.0f);
-	right_transform->RotateY(90.0f);
+	side.SetIdentity();
+	side.Translate(0.5f, 0.0f, 0.0f);
+	side.RotateY(90.0f);
+	box->AddInstance(side);
+
+	// Front wall is rotated 90 degrees about x: (y -> z)
+	side.SetIdentity();
+	side.Translate(0.0f, -0.5f, 0.0f);
+	side.RotateX(90.0f);
+	box->AddInstance(side);
+
+	// Bottom is rotated 180 degrees so it faces outwards
+	side.SetIdentity();
+	side.Translate(0.0f, 0.0f, -0.5f);
+	side.RotateX(180.0f);
+	box->AddInstance(side);
 
 	// Top 
-	TransformNode* top_transform = new TransformNode;
-	top_transform->Translate(0.0f, 0.0f, 0.50f);
-
-	// Create a SceneNode and add the 6 sides of the box.
-	SceneNode* box = new SceneNode;
-	box->AddChild(back_transform);
-	back_transform->AddChild(textured_square);
-	box->AddChild(left_transform);
-	left_transform->AddChild(textured_square);
-	box->AddChild(right_transform);
-	right_transform->AddChild(textured_square);
-	box->AddChild(front_transform);
-	front_transform->AddChild(textured_square);
-	box->AddChild(bottom_transform);
-	bottom_transform->AddChild(textured_square);
-	box->AddChild(top_transform);
-	top_transform->AddChild(textured_square);
+	side.SetIdentity();
+	side.Translate(0.0f, 0.0f, 0.50f);
+	box->AddInstance(side);
 
 	return box;
 }
@@ -958,6 +1151,15 @@ void ConstructScene() {
 		tangent_loc,
 		bitangent_loc);
 
+	// Texture arrays shared by the room materials
+	if (UseTextureArrays)
+	{
+		RoomTextures = new TextureArray(TEXTURE_COLOR, RoomTextureSize, RoomTextureSize,
+			RoomTextureLayers, GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+		RoomNormalMaps = new TextureArray(TEXTURE_NORMAL_MAP, RoomTextureSize, RoomTextureSize,
+			RoomTextureLayers, GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+	}
+
 	// Construct the room as a child of the root node
 	SceneNode* room = ConstructRoom(unit_square, textured_square);
 
@@ -1001,8 +1203,7 @@ void ConstructScene() {
 		Color4(0.2f, 0.2f, 0.2f),
 		Color4(0.0f, 0.0f, 0.0f),
 		5.0);
-	rugMaterial->SetTexture("rug-texture.jpg", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-	rugMaterial->setNormalMap("rug-normal.jpg", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+	SetRoomTextures(rugMaterial, "rug-texture.jpg", "rug-normal.jpg");
 	rugMaterial->setTextureScale(2.0f);
 
 	// Construct the scene layout
@@ -1012,9 +1213,9 @@ void ConstructScene() {
 
 	// Construct a base node for the rest of the scene, it will be a child
 	// of the last light node (so entire scene is under influence of all 
-	// lights)
+	// lights). The scene is drawn from a render list compiled from this node.
 	SceneNode* myscene = new SceneNode;
-	light->AddChild(myscene);
+	light->AddChild(new RenderListNode(myscene));
 
 	// Add the room (walls, floor, ceiling)
 	myscene->AddChild(room);
@@ -1033,8 +1234,7 @@ void ConstructScene() {
 	rugMaterial->AddChild(rugTransform);
 	rugTransform->AddChild(textured_square);
 
-    tvNode = new SceneNode();
-    tvNode->AddChild(tvTransform);
+    tvNode = new RenderListNode(tvTransform);
     tvTransform->AddChild(tv);
 }
 
@@ -1056,6 +1256,13 @@ int main(int argc, char** argv) {
 	std::cout << "2 - Toggle textures and realistic vs non realistic shading" << std::endl;
 	std::cout << "3 - Toggle outlines" << std::endl;
 	std::cout << "4 - Toggle normal bump map" << std::endl;
+	std::cout << "5 - Print OpenGL state change counts" << std::endl;
+	std::cout << "8 - Print texture memory" << std::endl;
+	std::cout << "9 - Build the scene BVH and time a ray per pixel" << std::endl;
+#if SCENE_PROFILING
+	std::cout << "6 - Print frame stats (toggles printing every 120 frames)" << std::endl;
+	std::cout << "7 - Capture 60 frames to a Chrome trace (FinalProject_trace.json)" << std::endl;
+#endif
 	std::cout << "-----------------------------------------------------------" << std::endl;
 	std::cout << "ESC - Exit Program" << std::endl;
 
@@ -1088,6 +1295,9 @@ int main(int argc, char** argv) {
 	}
 	printf("OpenGL %s, GLSL %s\n", glGetString(GL_VERSION), glGetString(GL_SHADING_LANGUAGE_VERSION));
 
+	// Count OpenGL calls made by the scene (debug builds)
+	PROFILE_INSTALL_GL_HOOKS();
+
 	// Set the clear color to black. Any part of the window outside the
 	// viewport should appear black
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
@@ -1099,6 +1309,22 @@ int main(int argc, char** argv) {
 	ConstructScene();
 	CheckError("After ConstructScene");
 
+	// Textures are decoded in the background - upload them as they arrive
+	glutTimerFunc(0, textureTimer, 0);
+
+	// Outline pass (disabled until toggled)
+	Outlines = new OutlinePass;
+	if (!Outlines->Create("outline.vert", "outline.frag"))
+	{
+		exit(-1);
+	}
+	Outlines->SetClipPlanes(MyCamera->GetNearClip(), MyCamera->GetFarClip());
+
+	// Set up the reflection for the mirrored pass
+	MirrorMatrix.Translate(0.0f, 200.0f, 0.0f);
+	MirrorMatrix.Scale(1.0f, -1.0f, 1.0f);
+	MirrorStamp = SceneState::NewStamp();
+
 	// Enable multi-sample anti-aliasing
 	glEnable(GL_MULTISAMPLE);
 
@@ -106,6 +106,8 @@ public:
         // Construct the face list and create VBOs
         //ConstructRowColFaceList(numRows * 2, numCols);
 
+        // Faces are a strip - keep their order
+        triangle_list = false;
         CreateVertexBuffers(posLoc, normLoc);
     }
 
@@ -114,9 +116,26 @@ public:
     */
     virtual void Draw(SceneState & scene_state)
     {
-        glBindVertexArray(vao);
-        glDrawElements(GL_TRIANGLE_STRIP, (GLsizei)face_count, GL_UNSIGNED_SHORT, (void *)0);
-        glBindVertexArray(0);
+        bool quantized = IsQuantized(GetVertexLayout());
+        if (quantized)
+            SetDequantizeMatrices(scene_state, GetVertexLayout());
+        scene_state.gl_state.BindVertexArray(vao);
+        glDrawElements(GL_TRIANGLE_STRIP, index_buffer.GetCount(), index_buffer.GetType(), (void *)0);
+        if (quantized)
+            SetDequantizeMatrices(scene_state, nullptr);
+    }
+
+    /**
+    * Get the draw call used to draw this geometry node.
+    */
+    virtual bool GetDrawCall(DrawElementsCall& call) const
+    {
+        call.mode = GL_TRIANGLE_STRIP;
+        call.vao = vao;
+        call.index_count = index_buffer.GetCount();
+        call.index_type = index_buffer.GetType();
+        call.layout = GetVertexLayout();
+        return vao != 0;
     }
 
 private:
@@ -238,6 +257,8 @@ public:
 				// Construct the face list and create VBOs
 				//ConstructRowColFaceList(numRows * 2, numCols);
 
+				// Faces are a strip - keep their order
+				triangle_list = false;
 				CreateVertexBuffers(posLoc, normLoc,texture_loc, tangent_loc, bitangent_loc);
 		}
 
@@ -246,9 +267,26 @@ public:
 		*/
 		virtual void Draw(SceneState & scene_state)
 		{
-				glBindVertexArray(vao);
-				glDrawElements(GL_TRIANGLE_STRIP, (GLsizei)face_count, GL_UNSIGNED_SHORT, (void *)0);
-				glBindVertexArray(0);
+				bool quantized = IsQuantized(GetVertexLayout());
+				if (quantized)
+						SetDequantizeMatrices(scene_state, GetVertexLayout());
+				scene_state.gl_state.BindVertexArray(vao);
+				glDrawElements(GL_TRIANGLE_STRIP, index_buffer.GetCount(), index_buffer.GetType(), (void *)0);
+				if (quantized)
+						SetDequantizeMatrices(scene_state, nullptr);
+		}
+
+		/**
+		* Get the draw call used to draw this geometry node.
+		*/
+		virtual bool GetDrawCall(DrawElementsCall& call) const
+		{
+				call.mode = GL_TRIANGLE_STRIP;
+				call.vao = vao;
+				call.index_count = index_buffer.GetCount();
+				call.index_type = index_buffer.GetType();
+				call.layout = GetVertexLayout();
+				return vao != 0;
 		}
 
 private:
@@ -59,8 +59,11 @@ public:
       return false;
     }
 
-		//get the outline toggle
-		outlineEnable_loc = glGetUniformLocation(shader_program.GetProgram(), "outlineEnable");
+    // Instancing (matrices come from a buffer texture when enabled)
+    projectionview_loc = glGetUniformLocation(shader_program.GetProgram(), "projectionView");
+    useinstancing_loc = glGetUniformLocation(shader_program.GetProgram(), "useInstancing");
+    instancebase_loc = glGetUniformLocation(shader_program.GetProgram(), "instanceBase");
+    instancematrices_loc = glGetUniformLocation(shader_program.GetProgram(), "instanceMatrices");
 
     // Populate camera position uniform location in scene state
     cameraposition_loc = glGetUniformLocation(shader_program.GetProgram(), "cameraPosition");
@@ -127,6 +130,13 @@ public:
     usenormalmap_loc = glGetUniformLocation(shader_program.GetProgram(), "useNormalMap");
     normalmap_loc = glGetUniformLocation(shader_program.GetProgram(), "normalMap");
 
+    texturearray_loc = glGetUniformLocation(shader_program.GetProgram(), "texImageArray");
+    texturelayer_loc = glGetUniformLocation(shader_program.GetProgram(), "textureLayer");
+    normalmaparray_loc = glGetUniformLocation(shader_program.GetProgram(), "normalMapArray");
+    normalmaplayer_loc = glGetUniformLocation(shader_program.GetProgram(), "normalMapLayer");
+
+    compactvertices_loc = glGetUniformLocation(shader_program.GetProgram(), "compactVertices");
+
     return true;
    }
 
@@ -137,7 +147,7 @@ public:
 	 */
 	virtual void Draw(SceneState& scene_state) {
     // Enable this program
-    shader_program.Use();
+    scene_state.gl_state.UseProgram(shader_program.GetProgram());
 
     // Set scene state locations to ones needed for this program
     scene_state.position_loc = position_loc;
@@ -151,6 +161,12 @@ public:
     scene_state.normalmatrix_loc = normalmatrix_loc;
     scene_state.cameraposition_loc = cameraposition_loc;
 
+    // Set instancing uniform locations
+    scene_state.projectionview_loc = projectionview_loc;
+    scene_state.useinstancing_loc = useinstancing_loc;
+    scene_state.instancebase_loc = instancebase_loc;
+    scene_state.instancematrices_loc = instancematrices_loc;
+
     // Set material uniform location
     scene_state.materialambient_loc = materialambient_loc;
     scene_state.materialdiffuse_loc = materialdiffuse_loc;
@@ -158,9 +174,6 @@ public:
     scene_state.materialemission_loc = materialemission_loc;
     scene_state.materialshininess_loc = materialshininess_loc;
 
-		// Set outline uniform location
-		scene_state.outlineEnable_loc = outlineEnable_loc;
-
     // Set texture uniform locations
     scene_state.usetexture_loc = usetexture_loc;
     scene_state.texturescale_loc = texturescale_loc;
@@ -169,6 +182,19 @@ public:
     scene_state.usenormalmap_loc = usenormalmap_loc;
     scene_state.normalmap_loc = normalmap_loc;
 
+    scene_state.texturearray_loc = texturearray_loc;
+    scene_state.texturelayer_loc = texturelayer_loc;
+    scene_state.normalmaparray_loc = normalmaparray_loc;
+    scene_state.normalmaplayer_loc = normalmaplayer_loc;
+
+    // Meshes are all compact or all float (see vertexformat.h)
+    scene_state.gl_state.Uniform1i(compactvertices_loc, kCompactVertices ? 1 : 0);
+
+    // Array samplers always use their own units (a unit cannot be sampled
+    // as two sampler types by one program)
+    scene_state.gl_state.Uniform1i(texturearray_loc, kTextureArrayUnit);
+    scene_state.gl_state.Uniform1i(normalmaparray_loc, kNormalMapArrayUnit);
+
     // Set the light locations
     scene_state.usereallighting_loc = usereallighting_loc;
     scene_state.lightcount_loc = lightcount_loc;
@@ -237,8 +263,11 @@ protected:
   GLint normalmatrix_loc;		  // Normal transformation matrix location
   GLint cameraposition_loc;   // Camera position uniform location
 
-	// Outline Enable
-	GLint outlineEnable_loc;
+  // Instancing uniform locations
+  GLint projectionview_loc;   // Composite projection and view matrix location
+  GLint useinstancing_loc;    // Instancing flag location
+  GLint instancebase_loc;     // First instance location
+  GLint instancematrices_loc; // Instance matrix buffer texture location
 
   // Material uniform locations
   GLint materialambient_loc;  // Material ambient location
@@ -254,6 +283,12 @@ protected:
 
   GLint usenormalmap_loc;      // Normal map use flag location
   GLint normalmap_loc;         // Normal map unit location
+
+  GLint texturearray_loc;      // Color texture array unit location
+  GLint texturelayer_loc;      // Color texture array layer location
+  GLint normalmaparray_loc;    // Normal map array unit location
+  GLint normalmaplayer_loc;    // Normal map array layer location
+  GLint compactvertices_loc;   // Compact vertex flag location
   
   // Lighting uniforms
   GLint usereallighting_loc;
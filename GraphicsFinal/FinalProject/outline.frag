@@ -0,0 +1,52 @@
+#version 150
+
+// Outline pass. Fragment shader. Copies the scene color and darkens
+// pixels on depth discontinuities (silhouettes) and creases.
+//
+// Window depth is affine in screen space across a planar surface, so its
+// second difference is 0 on planes and large at silhouettes and creases.
+// The second difference is converted to view depth units and divided by
+// the view depth so the threshold does not depend on distance.
+
+out vec4 fragColor;
+
+smooth in vec2 texCoord;
+
+uniform sampler2D colorImage;
+uniform sampler2D depthImage;
+
+uniform vec2  texelSize;       // 1 / framebuffer size
+uniform float outlineWidth;    // Sample offset in pixels
+uniform float edgeThreshold;   // Relative second difference that starts an edge
+uniform vec4  outlineColor;
+uniform float nearClip;
+uniform float farClip;
+
+float windowDepth(in vec2 offset)
+{
+	return texture(depthImage, texCoord + offset * texelSize * outlineWidth).r;
+}
+
+void main()
+{
+	vec4 color = texture(colorImage, texCoord);
+
+	float c = windowDepth(vec2( 0.0,  0.0));
+	float l = windowDepth(vec2(-1.0,  0.0));
+	float r = windowDepth(vec2( 1.0,  0.0));
+	float d = windowDepth(vec2( 0.0, -1.0));
+	float u = windowDepth(vec2( 0.0,  1.0));
+
+	// View depth at the center: window z = f/(f-n) - (f n/(f-n)) / zv
+	float fn = farClip * nearClip;
+	float range = farClip - nearClip;
+	float zv = fn / (farClip - c * range);
+
+	// Second differences along x and y relative to the view depth
+	float dx = abs(l + r - 2.0 * c);
+	float dy = abs(d + u - 2.0 * c);
+	float edge = max(dx, dy) * zv * range / fn;
+
+	float amount = smoothstep(edgeThreshold, 2.0 * edgeThreshold, edge);
+	fragColor = mix(color, outlineColor, amount * outlineColor.a);
+}
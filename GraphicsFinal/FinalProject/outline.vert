@@ -0,0 +1,14 @@
+#version 150
+
+// Outline pass. Vertex shader. Draws a single triangle covering the
+// viewport - no vertex attributes are needed.
+
+smooth out vec2 texCoord;
+
+void main()
+{
+	// Vertex 0, 1, 2 -> (-1,-1), (3,-1), (-1,3)
+	vec2 p = vec2(float((gl_VertexID & 1) * 4 - 1), float((gl_VertexID & 2) * 2 - 1));
+	texCoord = p * 0.5 + 0.5;
+	gl_Position = vec4(p, 0.0, 1.0);
+}
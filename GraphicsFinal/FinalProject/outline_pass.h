@@ -0,0 +1,260 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    outline_pass.h
+//	Purpose: Optional screen space outline pass. The scene is rendered to
+//           an offscreen framebuffer and outlines are drawn from depth
+//           discontinuities and creases when copying it to the window.
+//
+//============================================================================
+
+#ifndef __OUTLINEPASS_H
+#define __OUTLINEPASS_H
+
+/**
+ * Screen space outline pass. When enabled, Begin() redirects rendering to
+ * an offscreen color + depth/stencil framebuffer and End() draws it to the
+ * window with outlines. When disabled Begin() and End() do nothing so the
+ * scene is drawn straight to the window.
+ */
+class OutlinePass {
+public:
+  /**
+   * Constructor.
+   */
+  OutlinePass()
+      : enabled(false),
+        fbo(0),
+        color_texture(0),
+        depth_texture(0),
+        vao(0),
+        width(0),
+        height(0),
+        near_clip(1.0f),
+        far_clip(1000.0f) {
+  }
+
+  /**
+   * Destructor.
+   */
+  ~OutlinePass() {
+    DeleteFramebuffer();
+    glDeleteVertexArrays(1, &vao);
+  }
+
+  /**
+   * Create the outline shader program.
+   * @param  vertexShaderFilename    Vertex shader file name
+   * @param  fragmentShaderFilename  Fragment shader file name
+   * @return  Returns true if successful, false if compile or link errors occur.
+   */
+  bool Create(const char* vertexShaderFilename, const char* fragmentShaderFilename) {
+    if (!vertex_shader.Create(vertexShaderFilename)) {
+      std::cout << "OutlinePass: Vertex Shader compile failed" << std::endl;
+      return false;
+    }
+    if (!fragment_shader.Create(fragmentShaderFilename)) {
+      std::cout << "OutlinePass: Fragment Shader compile failed" << std::endl;
+      return false;
+    }
+    shader_program.Create();
+    if (!shader_program.AttachShaders(vertex_shader.Get(), fragment_shader.Get())) {
+      std::cout << "OutlinePass: Shader program link failed" << std::endl;
+      return false;
+    }
+
+    GLuint program = shader_program.GetProgram();
+    colorimage_loc    = glGetUniformLocation(program, "colorImage");
+    depthimage_loc    = glGetUniformLocation(program, "depthImage");
+    texelsize_loc     = glGetUniformLocation(program, "texelSize");
+    outlinewidth_loc  = glGetUniformLocation(program, "outlineWidth");
+    threshold_loc     = glGetUniformLocation(program, "edgeThreshold");
+    outlinecolor_loc  = glGetUniformLocation(program, "outlineColor");
+    nearclip_loc      = glGetUniformLocation(program, "nearClip");
+    farclip_loc       = glGetUniformLocation(program, "farClip");
+
+    // The full screen triangle is generated from gl_VertexID but the core
+    // profile still requires a VAO to draw
+    glGenVertexArrays(1, &vao);
+
+    // Default look. The scene program stays current (the first scene pass
+    // draws with it before any shader node makes it current).
+    GLint prior_program;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &prior_program);
+    shader_program.Use();
+    glUniform1i(colorimage_loc, 0);
+    glUniform1i(depthimage_loc, 1);
+    glUniform1f(outlinewidth_loc, 1.0f);
+    glUniform1f(threshold_loc, 0.001f);
+    glUniform4f(outlinecolor_loc, 0.0f, 0.0f, 0.0f, 1.0f);
+    glUseProgram(prior_program);
+    return true;
+  }
+
+  /**
+   * Enable or disable the pass.
+   * @param  enable  True to draw outlines.
+   */
+  void SetEnabled(const bool enable) {
+    enabled = enable;
+    if (!enabled)
+      DeleteFramebuffer();
+  }
+
+  /**
+   * Check if the pass is enabled.
+   * @return  Returns true if outlines are drawn.
+   */
+  bool IsEnabled() const {
+    return enabled;
+  }
+
+  /**
+   * Set the camera clipping planes (used to convert depth to view distance).
+   * @param  n  Near plane distance
+   * @param  f  Far plane distance
+   */
+  void SetClipPlanes(const float n, const float f) {
+    near_clip = n;
+    far_clip = f;
+  }
+
+  /**
+   * Start rendering the scene. If enabled, binds the offscreen framebuffer
+   * (created or resized to match the viewport).
+   * @param  gl_state  OpenGL state cache.
+   * @param  w         Viewport width
+   * @param  h         Viewport height
+   */
+  void Begin(GLStateCache& gl_state, const int w, const int h) {
+    if (!enabled)
+      return;
+
+    if (fbo == 0 || w != width || h != height) {
+      bool created = CreateFramebuffer(w, h);
+      gl_state.InvalidateBindings();
+      if (!created) {
+        enabled = false;
+        return;
+      }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  }
+
+  /**
+   * Finish rendering the scene. If enabled, draws the offscreen color to
+   * the window with outlines. The scene program is made current again.
+   * @param  gl_state  OpenGL state cache.
+   */
+  void End(GLStateCache& gl_state) {
+    if (!enabled || fbo == 0)
+      return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    GLuint scene_program = gl_state.GetProgram();
+    gl_state.UseProgram(shader_program.GetProgram());
+    gl_state.Uniform2f(texelsize_loc, 1.0f / static_cast<float>(width),
+                       1.0f / static_cast<float>(height));
+    gl_state.Uniform1f(nearclip_loc, near_clip);
+    gl_state.Uniform1f(farclip_loc, far_clip);
+
+    gl_state.BindTexture(1, GL_TEXTURE_2D, depth_texture);
+    gl_state.BindTexture(0, GL_TEXTURE_2D, color_texture);
+
+    gl_state.BindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    gl_state.BindVertexArray(0);
+
+    if (scene_program != kUnknownBinding)
+      gl_state.UseProgram(scene_program);
+
+    if (depth_test)
+      glEnable(GL_DEPTH_TEST);
+    if (blend)
+      glEnable(GL_BLEND);
+  }
+
+protected:
+  bool    enabled;
+  GLuint  fbo;
+  GLuint  color_texture;
+  GLuint  depth_texture;     // Depth and stencil (the TV mirror uses stencil)
+  GLuint  vao;
+  int     width;
+  int     height;
+  float   near_clip;
+  float   far_clip;
+
+  GLSLVertexShader   vertex_shader;
+  GLSLFragmentShader fragment_shader;
+  GLSLShaderProgram  shader_program;
+
+  GLint colorimage_loc;
+  GLint depthimage_loc;
+  GLint texelsize_loc;
+  GLint outlinewidth_loc;
+  GLint threshold_loc;
+  GLint outlinecolor_loc;
+  GLint nearclip_loc;
+  GLint farclip_loc;
+
+  // Create the offscreen framebuffer. Returns false if it is incomplete.
+  bool CreateFramebuffer(const int w, const int h) {
+    DeleteFramebuffer();
+    width = w;
+    height = h;
+
+    glGenTextures(1, &color_texture);
+    glBindTexture(GL_TEXTURE_2D, color_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    SetTextureParameters();
+
+    glGenTextures(1, &depth_texture);
+    glBindTexture(GL_TEXTURE_2D, depth_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, w, h, 0,
+                 GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+    SetTextureParameters();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth_texture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+      printf("OutlinePass: framebuffer incomplete (0x%x)\n", status);
+      DeleteFramebuffer();
+      return false;
+    }
+    return true;
+  }
+
+  void DeleteFramebuffer() {
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &color_texture);
+    glDeleteTextures(1, &depth_texture);
+    fbo = 0;
+    color_texture = 0;
+    depth_texture = 0;
+  }
+
+  // Nearest filtering - the outline shader compares individual depth samples
+  void SetTextureParameters() {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+};
+
+#endif
@@ -7,7 +7,7 @@ out vec4 fragColor;
 // Incoming, interpolated normal and vertex position in world coordinates
 smooth in vec3 normal;
 smooth in vec3 vertex;
-smooth in vec2 texture;
+smooth in vec2 texCoord;
 in mat3 tbn;
 
 // Uniforms for material properties
@@ -17,9 +17,6 @@ uniform	vec4   materialSpecular;
 uniform	vec4   materialEmission;
 uniform	float  materialShininess;
 
-//outline uniforms
-uniform int outlineEnable;
-
 // Texture uniforms
 uniform int useTexture;
 uniform float textureScale;
@@ -28,6 +25,12 @@ uniform	sampler2D texImage;
 uniform int useNormalMap;
 uniform sampler2D normalMap;
 
+// Texture arrays. A layer of -1 samples texImage/normalMap instead.
+uniform sampler2DArray texImageArray;
+uniform int textureLayer;
+uniform sampler2DArray normalMapArray;
+uniform int normalMapLayer;
+
 // Lighting
 uniform int useRealLighting;
 
@@ -228,10 +231,17 @@ void main()
     if(useNormalMap == 1)
     {
         // Get the normal map texel in tangent coords
-        vec4 texel = texture2D(normalMap, texture * textureScale);
+        vec4 texel = (normalMapLayer < 0) ? texture2D(normalMap, texCoord * textureScale) :
+            texture(normalMapArray, vec3(texCoord * textureScale, float(normalMapLayer)));
+
+        // Set the texel to a value in the range [-1, 1]. Only x and y are
+        // stored in baked (BC5) normal maps so rebuild z from them.
+        vec3 tn;
+        tn.xy = texel.rg * 2.0 - 1.0;
+        tn.z = sqrt(max(1.0 - dot(tn.xy, tn.xy), 0.0));
 
-        // Set the texel to a value in the range [-1, 1] and then convert to world coords
-        n = normalize(tbn * (texel.rgb * 2.0 - 1.0));
+        // Convert to world coords
+        n = normalize(tbn * tn);
     }
 
 	// Construct a unit length vector from the vertex to the camera  
@@ -265,25 +275,9 @@ void main()
     if(useTexture == 1)
     {
         // If a texture is bound, get its texel and modulate lighting and texture color
-		vec4 texel = texture2D(texImage, texture * textureScale);
+		vec4 texel = (textureLayer < 0) ? texture2D(texImage, texCoord * textureScale) :
+			texture(texImageArray, vec3(texCoord * textureScale, float(textureLayer)));
 		color = vec4(color.rgb * texel.rgb, color.a * texel.a);
-		if(outlineEnable == 1)
-		{
-				if(texture[0] <= 0.025 || texture[0] >= 0.975)
-					color = vec4(0.0, 0.0, 0.0, 1.0);
-
-				if(texture[1]  <= 0.025 || texture[1] >= 0.975)
-					color = vec4(0.0, 0.0, 0.0, 1.0);
-		}
-	}
-	    
-  if(outlineEnable == 1)
-  {
-	if(texture[0] <= 0.025 || texture[0] >= 0.975)
-		color = vec4(0.0, 0.0, 0.0, 1.0);
-	
-	if(texture[1]  <= 0.025 || texture[1] >= 0.975)
-		color = vec4(0.0, 0.0, 0.0, 1.0);
 	}
 	fragColor = clamp(color, 0.0, 1.0);
 }
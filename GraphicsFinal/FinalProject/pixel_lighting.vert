@@ -3,12 +3,12 @@
 // Outgoing normal and vertex (interpolated) in world coordinates
 smooth out vec3 normal;
 smooth out vec3 vertex;
-smooth out vec2 texture;
+smooth out vec2 texCoord;
 out mat3 tbn;
 
 // Incoming vertex and normal attributes
 in vec3 vertexPosition;   // Vertex position attribute
-in vec3 vertexNormal;     // Vertex normal attribute
+in vec4 vertexNormal;     // Vertex normal attribute (packed frame for compact vertices)
 in vec2 texturePosition;  // Texture coordinate
 in vec3 tangent;          // Vertex tangent vector
 in vec3 bitangent;        // Vertex bitangent vector
@@ -18,26 +18,80 @@ uniform mat4 pvm;					  // Composite projection, view, model matrix
 uniform mat4 modelMatrix;	  // Modeling  matrix
 uniform mat4 normalMatrix;	// Normal transformation matrix
 
+// Instancing. When useInstancing is 1 the model and normal matrices are
+// read from instanceMatrices: 8 texels per instance (model matrix columns
+// then normal matrix columns) starting at instance instanceBase.
+uniform int  useInstancing;
+uniform int  instanceBase;
+uniform samplerBuffer instanceMatrices;
+uniform mat4 projectionView;          // Composite projection, view matrix
+
+// Compact vertex layouts. When compactVertices is 1 vertexNormal holds the
+// octahedral normal (xy) and tangent (zw) with the bitangent sign folded
+// into z. 16 bit positions are dequantized by the model matrix.
+uniform int  compactVertices;
+
+// Decode an octahedral encoded unit vector
+vec3 OctDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(v);
+}
+
 // Simple shader for Phong (per-pixel) shading. The fragment shader will
 // do all the work. We need to pass per-vertex normals to the fragment
 // shader. We also will transform the vertex into world coordinates so 
 // the fragment shader can interpolate world coordinates.
 void main()
 {
+    // Get the model, normal and composite matrices for this vertex
+    mat4 model = modelMatrix;
+    mat4 normalMat = normalMatrix;
+    mat4 pvmMat = pvm;
+    if (useInstancing == 1)
+    {
+        int i = (instanceBase + gl_InstanceID) * 8;
+        model = mat4(texelFetch(instanceMatrices, i),
+                     texelFetch(instanceMatrices, i + 1),
+                     texelFetch(instanceMatrices, i + 2),
+                     texelFetch(instanceMatrices, i + 3));
+        normalMat = mat4(texelFetch(instanceMatrices, i + 4),
+                         texelFetch(instanceMatrices, i + 5),
+                         texelFetch(instanceMatrices, i + 6),
+                         texelFetch(instanceMatrices, i + 7));
+        pvmMat = projectionView * model;
+    }
+
+    // Get the object space frame. The bitangent of a packed frame is
+    // rebuilt from the normal, tangent and sign.
+    vec3 objNormal = vertexNormal.xyz;
+    vec3 objTangent = tangent;
+    vec3 objBitangent = bitangent;
+    if (compactVertices == 1)
+    {
+        float handedness = (vertexNormal.z < 0.0) ? -1.0 : 1.0;
+        float tx = (abs(vertexNormal.z) * 32767.0 - 1.0) / 32766.0 * 2.0 - 1.0;
+        objNormal = OctDecode(vertexNormal.xy);
+        objTangent = OctDecode(vec2(tx, vertexNormal.w));
+        objBitangent = handedness * cross(objNormal, objTangent);
+    }
+
     // Create matrix that converts tangent coords to world coords
-    vec3 t = normalize(vec3(normalMatrix * vec4(tangent, 0.0)));
-    vec3 b = normalize(vec3(normalMatrix * vec4(bitangent, 0.0)));
-    vec3 n = normalize(vec3(normalMatrix * vec4(vertexNormal, 0.0)));
+    vec3 t = normalize(vec3(normalMat * vec4(objTangent, 0.0)));
+    vec3 b = normalize(vec3(normalMat * vec4(objBitangent, 0.0)));
+    vec3 n = normalize(vec3(normalMat * vec4(objNormal, 0.0)));
 
     tbn = mat3(t, b, n);
 
     // Output interpolated texture position
-	texture = texturePosition;
+	texCoord = texturePosition;
 
 	// Transform normal and position to world coords. 
-	normal = normalize(vec3(normalMatrix * vec4(vertexNormal, 0.0)));
-	vertex = vec3((modelMatrix * vec4(vertexPosition, 1.0)));
+	normal = n;
+	vertex = vec3((model * vec4(vertexPosition, 1.0)));
 
 	// Convert position to clip coordinates and pass along
-	gl_Position = pvm * vec4(vertexPosition, 1.0);
+	gl_Position = pvmMat * vec4(vertexPosition, 1.0);
 }
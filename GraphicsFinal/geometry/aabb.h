@@ -6,7 +6,7 @@
 //	Author:  David W. Nesbitt
 //	File:    AABB.h
 //	Purpose: Axis Aligned Bounding Box (3D).
-//          Applications should include "geometry.h" to get all 
+//          Applications should include "geometry.h" to get all
 //          class definitions included in proper order.
 //
 //============================================================================
@@ -14,20 +14,28 @@
 #ifndef __AABB_H__
 #define __AABB_H__
 
+#include <algorithm>
 #include <vector>
+#include "geometry/bounds_simd.h"
 
-// NOTE - this is not required until 605.767!
+class Matrix4x4;
 
 /**
- * Axis Aligned Bounding Box.
+ * Axis Aligned Bounding Box. A default constructed box is empty (min is
+ * greater than max) so points and boxes can be merged into it.
  */
 struct AABB
 {
+  Point3  m_minPt;         // Minimum x,y,z
+  Point3  m_maxPt;         // Maximum x,y,z
+  Point3  m_center;        // Center (set by ComputeCenter)
+  Vector3 m_halfDiagonal;  // Center to the max. point (set by ComputeCenter)
+
   /**
-   * Default constructor.
+   * Default constructor. Creates an empty box.
    */
   AABB() {
-    // Complete in 605.767
+    Clear();
   }
 
   /**
@@ -35,8 +43,10 @@ struct AABB
    * @param  minPt  Minimum point (x,y,z)
    * @param  maxPt  Maximum point (x,y,z)
    */
-  AABB(const Point3& minPt, const Point3& maxPt) {
-    // Complete in 605.767
+  AABB(const Point3& minPt, const Point3& maxPt)
+    : m_minPt(minPt),
+      m_maxPt(maxPt) {
+    ComputeCenter();
   }
 
   /**
@@ -44,7 +54,16 @@ struct AABB
    * @param  vertexList  Vertex list.
    */
   AABB(const std::vector<Point3>& vertexList) {
-    // Complete in 605.767
+    Create(vertexList);
+  }
+
+  /**
+   * Make the box empty.
+   */
+  void Clear() {
+    m_minPt.Set(FLT_MAX, FLT_MAX, FLT_MAX);
+    m_maxPt.Set(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    ComputeCenter();
   }
 
   /**
@@ -52,16 +71,86 @@ struct AABB
    * @param  vertexList  Vertex list.
    */
   void Create(const std::vector<Point3>& vertexList) {
-    // Complete in 605.767
+    if (vertexList.empty()) {
+      Clear();
+      return;
+    }
+    Create(&vertexList[0].x, sizeof(Point3), static_cast<uint32_t>(vertexList.size()));
+  }
+
+  /**
+   * Creates an AABB given an array of positions (e.g. interleaved vertices).
+   * @param  positions  First position (3 floats).
+   * @param  stride     Bytes between positions.
+   * @param  count      Number of positions.
+   */
+  void Create(const float* positions, const uint32_t stride, const uint32_t count) {
+    float lo[3];
+    float hi[3];
+    PointsMinMax(positions, stride, count, lo, hi);
+    m_minPt.Set(lo[0], lo[1], lo[2]);
+    m_maxPt.Set(hi[0], hi[1], hi[2]);
+    ComputeCenter();
+  }
+
+  /**
+   * Check if the box is empty (created from no points).
+   * @return  Returns true if the box is empty.
+   */
+  bool IsEmpty() const {
+    return m_minPt.x > m_maxPt.x;
+  }
+
+  /**
+   * Grow the box to contain a point.
+   * @param  p  Point.
+   */
+  void Extend(const Point3& p) {
+    m_minPt.Set(std::min(m_minPt.x, p.x), std::min(m_minPt.y, p.y), std::min(m_minPt.z, p.z));
+    m_maxPt.Set(std::max(m_maxPt.x, p.x), std::max(m_maxPt.y, p.y), std::max(m_maxPt.z, p.z));
+    ComputeCenter();
+  }
+
+  /**
+   * Grow the box to contain another box.
+   * @param  box  Box to merge with this box (may be empty).
+   */
+  void Merge(const AABB& box) {
+    if (box.IsEmpty())
+      return;
+    m_minPt.Set(std::min(m_minPt.x, box.m_minPt.x), std::min(m_minPt.y, box.m_minPt.y),
+                std::min(m_minPt.z, box.m_minPt.z));
+    m_maxPt.Set(std::max(m_maxPt.x, box.m_maxPt.x), std::max(m_maxPt.y, box.m_maxPt.y),
+                std::max(m_maxPt.z, box.m_maxPt.z));
+    ComputeCenter();
   }
 
+  /**
+   * Test if a point is inside (or on) the box.
+   * @param  p  Point.
+   * @return  Returns true if the box contains the point.
+   */
+  bool Contains(const Point3& p) const {
+    return p.x >= m_minPt.x && p.x <= m_maxPt.x &&
+           p.y >= m_minPt.y && p.y <= m_maxPt.y &&
+           p.z >= m_minPt.z && p.z <= m_maxPt.z;
+  }
+
+  /**
+   * Get the box containing this box after a transformation (Arvo's
+   * method: the half diagonal is transformed by the absolute value of the
+   * upper 3x3). Defined in geometry.h after Matrix4x4.
+   * @param  m  Affine transformation.
+   * @return  Returns the transformed box (empty if this box is empty).
+   */
+  AABB Transform(const Matrix4x4& m) const;
+
   /**
    * Get the point at the minimum x,y,z.
    * @return  Returns the min. point.
    */
   Point3 GetMinPt() const {
-    // Complete in 605.767
-    return Point3();
+    return m_minPt;
   }
 
   /**
@@ -69,15 +158,21 @@ struct AABB
    * @return  Returns the max. point.
    */
   Point3 GetMaxPt() const {
-    // Complete in 605.767
-    return Point3();
+    return m_maxPt;
   }
 
   /**
    * Compute center and half diagonal
    */
   void ComputeCenter() {
-    // Complete in 605.767
+    if (IsEmpty()) {
+      m_center.Set(0.0f, 0.0f, 0.0f);
+      m_halfDiagonal.Set(0.0f, 0.0f, 0.0f);
+      return;
+    }
+    m_center.Set((m_minPt.x + m_maxPt.x) * 0.5f, (m_minPt.y + m_maxPt.y) * 0.5f,
+                 (m_minPt.z + m_maxPt.z) * 0.5f);
+    m_halfDiagonal.Set(m_maxPt.x - m_center.x, m_maxPt.y - m_center.y, m_maxPt.z - m_center.z);
   }
 };
 
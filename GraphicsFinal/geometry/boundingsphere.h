@@ -14,8 +14,11 @@
 #ifndef __BOUNDINGSPHERE_H__
 #define __BOUNDINGSPHERE_H__
 
+#include <cmath>
 #include <vector>
 
+class Matrix4x4;
+
 /**
  * Sphere: center and radius.
  */
@@ -40,6 +43,17 @@ struct BoundingSphere {
       m_radius(s.m_radius) {
   }
 
+  /**
+   * Assignment operator
+   * @param   s   Sphere to assign to this sphere.
+   * @return  Returns the address of this sphere.
+   */
+  BoundingSphere& operator = (const BoundingSphere& s) {
+    m_center = s.m_center;
+    m_radius = s.m_radius;
+    return *this;
+  }
+
   /**
    * Constructor given a center point and radius.
    * @param  c  Center point.
@@ -54,19 +68,124 @@ struct BoundingSphere {
    * Construct a sphere given a vertex list. Method by Ritter.
    * @param  vertexList  Vertex list to surround with the sphere.
    */
-  BoundingSphere(std::vector<Point3>& vertexList) {
-    // Complete in 605.767
+  BoundingSphere(const std::vector<Point3>& vertexList) {
+    if (vertexList.empty()) {
+      m_center.Set(0.0f, 0.0f, 0.0f);
+      m_radius = 0.0f;
+      return;
+    }
+    Create(&vertexList[0].x, sizeof(Point3), static_cast<uint32_t>(vertexList.size()));
+  }
+
+  /**
+   * Create a sphere surrounding an array of positions (e.g. interleaved
+   * vertices). Ritter's method: start with the sphere through the farthest
+   * apart pair of the x, y and z extreme points and grow it to take in
+   * each point outside. The sphere around the center of the bounding box
+   * (found with the SIMD kernels) is used instead when it is smaller.
+   * @param  positions  First position (3 floats).
+   * @param  stride     Bytes between positions.
+   * @param  count      Number of positions.
+   */
+  void Create(const float* positions, const uint32_t stride, const uint32_t count) {
+    if (count == 0) {
+      m_center.Set(0.0f, 0.0f, 0.0f);
+      m_radius = 0.0f;
+      return;
+    }
+
+    // Extreme points along each axis
+    uint32_t lo[3] = { 0, 0, 0 };
+    uint32_t hi[3] = { 0, 0, 0 };
+    for (uint32_t i = 1; i < count; i++) {
+      const float* p = PositionAt(positions, stride, i);
+      for (int k = 0; k < 3; k++) {
+        if (p[k] < PositionAt(positions, stride, lo[k])[k])
+          lo[k] = i;
+        if (p[k] > PositionAt(positions, stride, hi[k])[k])
+          hi[k] = i;
+      }
+    }
+
+    // Initial sphere through the pair farthest apart
+    int axis = 0;
+    float best = -1.0f;
+    for (int k = 0; k < 3; k++) {
+      const float* a = PositionAt(positions, stride, lo[k]);
+      const float* b = PositionAt(positions, stride, hi[k]);
+      float d2 = (b[0] - a[0]) * (b[0] - a[0]) + (b[1] - a[1]) * (b[1] - a[1]) +
+                 (b[2] - a[2]) * (b[2] - a[2]);
+      if (d2 > best) {
+        best = d2;
+        axis = k;
+      }
+    }
+    const float* a = PositionAt(positions, stride, lo[axis]);
+    const float* b = PositionAt(positions, stride, hi[axis]);
+    float c[3] = { (a[0] + b[0]) * 0.5f, (a[1] + b[1]) * 0.5f, (a[2] + b[2]) * 0.5f };
+    float r = 0.5f * std::sqrt(best);
+
+    // Grow the sphere to each point outside it (moving the center toward
+    // the point so the far side stays put)
+    float r2 = r * r;
+    for (uint32_t i = 0; i < count; i++) {
+      const float* p = PositionAt(positions, stride, i);
+      float d[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+      float d2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+      if (d2 > r2) {
+        float dist = std::sqrt(d2);
+        float new_r = (r + dist) * 0.5f;
+        float move = (new_r - r) / dist;
+        for (int k = 0; k < 3; k++)
+          c[k] += d[k] * move;
+        r = new_r;
+        r2 = r * r;
+      }
+    }
+
+    // Sphere around the box center
+    float box_lo[3];
+    float box_hi[3];
+    PointsMinMax(positions, stride, count, box_lo, box_hi);
+    float box_c[3] = { (box_lo[0] + box_hi[0]) * 0.5f, (box_lo[1] + box_hi[1]) * 0.5f,
+                       (box_lo[2] + box_hi[2]) * 0.5f };
+    float box_r = std::sqrt(PointsMaxDistanceSquared(positions, stride, count, box_c));
+    if (box_r < r) {
+      m_center.Set(box_c[0], box_c[1], box_c[2]);
+      m_radius = box_r;
+    }
+    else {
+      // Round off while growing can leave points a hair outside
+      m_center.Set(c[0], c[1], c[2]);
+      m_radius = std::sqrt(PointsMaxDistanceSquared(positions, stride, count, c));
+    }
   }
 
   /**
    * Merge this bounding sphere with another to create the smallest sphere
    * containing the 2.
    * @param  s2  Sphere to merge with this sphere.
+   * @return  Returns the merged sphere.
    */
-  BoundingSphere Merge(BoundingSphere& s2) {
-    // Complete in 605.767
-    return BoundingSphere();
+  BoundingSphere Merge(const BoundingSphere& s2) const {
+    Vector3 v = s2.m_center - m_center;
+    float d = v.Norm();
+    if (d + s2.m_radius <= m_radius)
+      return *this;
+    if (d + m_radius <= s2.m_radius)
+      return s2;
+    float r = (d + m_radius + s2.m_radius) * 0.5f;
+    return BoundingSphere(m_center + v * ((r - m_radius) / d), r);
   }
+
+  /**
+   * Get the sphere containing this sphere after a transformation. The
+   * radius is scaled by the largest axis scale. Defined in geometry.h
+   * after Matrix4x4.
+   * @param  m  Affine transformation.
+   * @return  Returns the transformed sphere.
+   */
+  BoundingSphere Transform(const Matrix4x4& m) const;
 };
 
 #endif
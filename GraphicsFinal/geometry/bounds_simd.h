@@ -0,0 +1,152 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    bounds_simd.h
+//	Purpose: Kernels over vertex position arrays used to build bounding
+//          volumes. SSE versions are selected at compile time (see
+//          matrix_simd.h); the scalar versions are the reference. Positions
+//          are 3 floats every stride bytes (interleaved vertices).
+//
+//============================================================================
+
+#ifndef __BOUNDS_SIMD_H__
+#define __BOUNDS_SIMD_H__
+
+#include <float.h>
+#include "geometry/matrix_simd.h"
+
+// Position of vertex i in a strided array
+inline const float* PositionAt(const float* positions, const uint32_t stride, const uint32_t i) {
+  return reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(positions) +
+                                        static_cast<size_t>(i) * stride);
+}
+
+//----------------------------------------------------------------------------
+// Scalar (reference) kernels
+//----------------------------------------------------------------------------
+
+/**
+ * Minimum and maximum x, y, z of a position array. An empty array gives
+ * min = FLT_MAX and max = -FLT_MAX.
+ * @param  positions  First position.
+ * @param  stride     Bytes between positions.
+ * @param  count      Number of positions.
+ * @param  min_pt     Minimum (3 floats).
+ * @param  max_pt     Maximum (3 floats).
+ */
+inline void PointsMinMaxScalar(const float* positions, const uint32_t stride,
+                               const uint32_t count, float* min_pt, float* max_pt) {
+  for (int k = 0; k < 3; k++) {
+    min_pt[k] = FLT_MAX;
+    max_pt[k] = -FLT_MAX;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    const float* p = PositionAt(positions, stride, i);
+    for (int k = 0; k < 3; k++) {
+      min_pt[k] = (p[k] < min_pt[k]) ? p[k] : min_pt[k];
+      max_pt[k] = (p[k] > max_pt[k]) ? p[k] : max_pt[k];
+    }
+  }
+}
+
+/**
+ * Largest squared distance from a point to the positions of an array.
+ * @param  positions  First position.
+ * @param  stride     Bytes between positions.
+ * @param  count      Number of positions.
+ * @param  center     Point (3 floats).
+ * @return  Returns the largest squared distance (0 for an empty array).
+ */
+inline float PointsMaxDistanceSquaredScalar(const float* positions, const uint32_t stride,
+                                            const uint32_t count, const float* center) {
+  float d2 = 0.0f;
+  for (uint32_t i = 0; i < count; i++) {
+    const float* p = PositionAt(positions, stride, i);
+    float dx = p[0] - center[0];
+    float dy = p[1] - center[1];
+    float dz = p[2] - center[2];
+    float t = dx * dx + dy * dy + dz * dz;
+    d2 = (t > d2) ? t : d2;
+  }
+  return d2;
+}
+
+#ifdef GEOMETRY_USE_SSE
+//----------------------------------------------------------------------------
+// SSE kernels. A position is loaded with one unaligned 4 float load, which
+// reads the float after z - so the last position of the array is loaded
+// without it.
+//----------------------------------------------------------------------------
+
+inline void PointsMinMax(const float* positions, const uint32_t stride,
+                         const uint32_t count, float* min_pt, float* max_pt) {
+  if (count == 0) {
+    PointsMinMaxScalar(positions, stride, count, min_pt, max_pt);
+    return;
+  }
+  const float* last = PositionAt(positions, stride, count - 1);
+  __m128 lo = _mm_setr_ps(last[0], last[1], last[2], 0.0f);
+  __m128 hi = lo;
+  for (uint32_t i = 0; i + 1 < count; i++) {
+    __m128 p = _mm_loadu_ps(PositionAt(positions, stride, i));
+    lo = _mm_min_ps(lo, p);
+    hi = _mm_max_ps(hi, p);
+  }
+  float t[4];
+  _mm_storeu_ps(t, lo);
+  min_pt[0] = t[0];
+  min_pt[1] = t[1];
+  min_pt[2] = t[2];
+  _mm_storeu_ps(t, hi);
+  max_pt[0] = t[0];
+  max_pt[1] = t[1];
+  max_pt[2] = t[2];
+}
+
+// Positions are transposed 4 at a time so 4 distances are computed at once
+inline float PointsMaxDistanceSquared(const float* positions, const uint32_t stride,
+                                      const uint32_t count, const float* center) {
+  const __m128 cx = _mm_set1_ps(center[0]);
+  const __m128 cy = _mm_set1_ps(center[1]);
+  const __m128 cz = _mm_set1_ps(center[2]);
+  __m128 d2 = _mm_setzero_ps();
+  uint32_t i = 0;
+  for (; i + 4 < count; i += 4) {
+    __m128 p0 = _mm_loadu_ps(PositionAt(positions, stride, i));
+    __m128 p1 = _mm_loadu_ps(PositionAt(positions, stride, i + 1));
+    __m128 p2 = _mm_loadu_ps(PositionAt(positions, stride, i + 2));
+    __m128 p3 = _mm_loadu_ps(PositionAt(positions, stride, i + 3));
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    __m128 dx = _mm_sub_ps(p0, cx);
+    __m128 dy = _mm_sub_ps(p1, cy);
+    __m128 dz = _mm_sub_ps(p2, cz);
+    __m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+    d2 = _mm_max_ps(d2, t);
+  }
+  float t[4];
+  _mm_storeu_ps(t, d2);
+  float result = PointsMaxDistanceSquaredScalar(PositionAt(positions, stride, i), stride,
+                                                count - i, center);
+  for (int k = 0; k < 4; k++)
+    result = (t[k] > result) ? t[k] : result;
+  return result;
+}
+
+#else
+//----------------------------------------------------------------------------
+// No SIMD - use the scalar kernels
+//----------------------------------------------------------------------------
+inline void PointsMinMax(const float* positions, const uint32_t stride,
+                         const uint32_t count, float* min_pt, float* max_pt) {
+  PointsMinMaxScalar(positions, stride, count, min_pt, max_pt);
+}
+inline float PointsMaxDistanceSquared(const float* positions, const uint32_t stride,
+                                      const uint32_t count, const float* center) {
+  return PointsMaxDistanceSquaredScalar(positions, stride, count, center);
+}
+#endif
+
+#endif
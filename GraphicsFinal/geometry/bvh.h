@@ -0,0 +1,792 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    bvh.h
+//	Purpose: Bounding volume hierarchy over boxes (binned SAH build on the
+//           thread pool, flattened 32 byte nodes) and a triangle BVH for
+//           ray queries.
+//
+//============================================================================
+
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include <algorithm>
+#include <float.h>
+#include <vector>
+#include "geometry/parallel.h"
+
+// SAH bins per axis
+const uint32_t kBVHBins = 16;
+
+// Leaves hold at most this many primitives
+const uint32_t kBVHMaxLeafSize = 8;
+
+// Cost of visiting a node relative to intersecting one primitive
+const float kBVHTraversalCost = 1.0f;
+
+// Ranges smaller than this are built on one thread
+const uint32_t kBVHParallelMin = 4096;
+
+// Maximum tree depth (sizes the traversal stack). Nodes at this depth are
+// left as leaves whatever their size.
+const uint32_t kBVHMaxDepth = 64;
+
+/**
+ * Flattened BVH node (32 bytes - 2 per cache line). The children of an
+ * interior node are stored next to each other (first and first + 1).
+ */
+struct BVHNode {
+  float    min[3];   // Bounding box
+  uint32_t first;    // Leaf: first primitive (in the primitive order). Interior: left child
+  float    max[3];
+  uint32_t count;    // Leaf: number of primitives. Interior: 0
+
+  bool IsLeaf() const {
+    return count != 0;
+  }
+};
+
+/**
+ * Ray prepared for traversal: origin, direction and inverse direction
+ * (slab test). The direction need not be unit length - t is in units of
+ * the direction.
+ */
+struct BVHRay {
+  float o[3];
+  float d[3];
+  float inv_d[3];
+
+  /**
+   * Constructor.
+   * @param  ray  Ray.
+   */
+  BVHRay(const Ray3& ray) {
+    o[0] = ray.o.x;
+    o[1] = ray.o.y;
+    o[2] = ray.o.z;
+    d[0] = ray.d.x;
+    d[1] = ray.d.y;
+    d[2] = ray.d.z;
+    for (int k = 0; k < 3; k++)
+      inv_d[k] = 1.0f / d[k];
+  }
+
+  /**
+   * Slab test against a node's box.
+   * @param  node   Node.
+   * @param  t_max  Farthest t of interest.
+   * @param  t      (OUT) Entry t (clamped to 0).
+   * @return  Returns true if the ray enters the box before t_max.
+   */
+  bool IntersectNode(const BVHNode& node, const float t_max, float& t) const {
+    return RayBoxScalar(o, inv_d, node.min, node.max, t_max, t);
+  }
+};
+
+/**
+ * Ray hit: distance along the ray, barycentric coordinates and the
+ * primitive (original triangle index).
+ */
+struct RayHit {
+  float    t;
+  float    u;
+  float    v;
+  uint32_t primitive;
+};
+
+/**
+ * Bounding volume hierarchy over a set of boxes. Built with the surface
+ * area heuristic evaluated on kBVHBins bins per axis. The top of the tree
+ * is split on the calling thread until there are enough subtrees to keep
+ * the thread pool busy; the subtrees are then built in parallel and
+ * appended to the node array. Nodes are refit (boxes recomputed, tree
+ * kept) when the primitives move.
+ */
+class BVH {
+public:
+  /**
+   * Build the hierarchy.
+   * @param  bounds  Bounding box of each primitive.
+   */
+  void Build(const std::vector<AABB>& bounds) {
+    nodes.clear();
+    order.resize(bounds.size());
+    if (bounds.empty())
+      return;
+
+    // Boxes as plain floats (min x,y,z, max x,y,z), centroids and the
+    // primitive order
+    std::vector<float> boxes(bounds.size() * 6);
+    std::vector<float> centroids(bounds.size() * 3);
+    ParallelFor(bounds.size(), kBVHParallelMin, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        const AABB& b = bounds[i];
+        float* box = &boxes[i * 6];
+        box[0] = b.m_minPt.x;
+        box[1] = b.m_minPt.y;
+        box[2] = b.m_minPt.z;
+        box[3] = b.m_maxPt.x;
+        box[4] = b.m_maxPt.y;
+        box[5] = b.m_maxPt.z;
+        for (int k = 0; k < 3; k++)
+          centroids[i * 3 + k] = (box[k] + box[k + 3]) * 0.5f;
+        order[i] = static_cast<uint32_t>(i);
+      }
+    });
+    BuildContext ctx(boxes, centroids, order);
+
+    // Split the top levels here. Ranges at or below the task size are
+    // left as leaves to be built in parallel.
+    uint32_t tasks = ThreadPool::Get().GetThreadCount() * 4;
+    uint32_t task_size = std::max(kBVHParallelMin, static_cast<uint32_t>(bounds.size()) / tasks);
+    std::vector<uint32_t> pending;
+    nodes.push_back(BVHNode());
+    SetLeaf(ctx, nodes[0], 0, static_cast<uint32_t>(bounds.size()));
+    std::vector<uint32_t> stack(1, 0);
+    std::vector<uint32_t> depth(1, 0);
+    while (!stack.empty()) {
+      uint32_t n = stack.back();
+      uint32_t level = depth.back();
+      stack.pop_back();
+      depth.pop_back();
+      if (nodes[n].count <= task_size) {
+        pending.push_back(n);
+        continue;
+      }
+      uint32_t left = static_cast<uint32_t>(nodes.size());
+      BVHNode children[2];
+      if (!Split(ctx, nodes[n], level, children))
+        continue;
+      nodes[n].first = left;
+      nodes[n].count = 0;
+      nodes.push_back(children[0]);
+      nodes.push_back(children[1]);
+      stack.push_back(left);
+      stack.push_back(left + 1);
+      depth.push_back(level + 1);
+      depth.push_back(level + 1);
+    }
+
+    // Build the subtrees in parallel and append them. Each subtree root is
+    // already in place; its descendants are at local index 1 and up.
+    std::vector<std::vector<BVHNode>> subtrees(pending.size());
+    std::vector<uint32_t> levels(pending.size());
+    for (uint32_t i = 0; i < pending.size(); i++) {
+      uint32_t d = 0;
+      for (uint32_t n = pending[i]; n != 0; n = Parent(n))
+        d++;
+      levels[i] = d;
+    }
+    ParallelFor(pending.size(), 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        std::vector<BVHNode>& local = subtrees[i];
+        local.push_back(nodes[pending[i]]);
+        BuildSubtree(ctx, local, levels[i]);
+      }
+    });
+    for (uint32_t i = 0; i < pending.size(); i++) {
+      const std::vector<BVHNode>& local = subtrees[i];
+      uint32_t base = static_cast<uint32_t>(nodes.size()) - 1;
+      nodes[pending[i]] = local[0];
+      if (!local[0].IsLeaf())
+        nodes[pending[i]].first += base;
+      for (uint32_t k = 1; k < local.size(); k++) {
+        BVHNode node = local[k];
+        if (!node.IsLeaf())
+          node.first += base;
+        nodes.push_back(node);
+      }
+    }
+  }
+
+  /**
+   * Recompute the node boxes for moved primitives. The tree is kept so
+   * it may become less efficient as primitives move far.
+   * @param  bounds  Bounding box of each primitive (same count as Build).
+   */
+  void Refit(const std::vector<AABB>& bounds) {
+    // Children are always stored after their parent
+    for (size_t i = nodes.size(); i-- > 0; ) {
+      BVHNode& node = nodes[i];
+      AABB box;
+      if (node.IsLeaf()) {
+        for (uint32_t k = node.first; k < node.first + node.count; k++)
+          box.Merge(bounds[order[k]]);
+      }
+      else {
+        box.Merge(GetBox(nodes[node.first]));
+        box.Merge(GetBox(nodes[node.first + 1]));
+      }
+      SetBox(node, box);
+    }
+  }
+
+  /**
+   * Visit the leaves a ray enters, nearest first, skipping nodes beyond
+   * the closest hit so far.
+   * @param  ray    Prepared ray.
+   * @param  t_max  Farthest t of interest. Lowered by the leaf function.
+   * @param  leaf   Called as leaf(first, count, t_max) with the range of the
+   *                primitive order in the leaf. Returns true on a hit
+   *                (after lowering t_max).
+   * @return  Returns true if any leaf reported a hit.
+   */
+  template <typename LeafFn>
+  bool Traverse(const BVHRay& ray, float& t_max, LeafFn leaf) const {
+    if (nodes.empty())
+      return false;
+    float t;
+    if (!ray.IntersectNode(nodes[0], t_max, t))
+      return false;
+    bool hit = false;
+    uint32_t stack[kBVHMaxDepth];
+    uint32_t top = 0;
+    uint32_t n = 0;
+    for (;;) {
+      const BVHNode& node = nodes[n];
+      if (node.IsLeaf()) {
+        if (leaf(node.first, node.count, t_max))
+          hit = true;
+      }
+      else {
+        // Visit the nearer child first, push the other
+        float t0, t1;
+        uint32_t c0 = node.first;
+        uint32_t c1 = node.first + 1;
+        bool hit0 = ray.IntersectNode(nodes[c0], t_max, t0);
+        bool hit1 = ray.IntersectNode(nodes[c1], t_max, t1);
+        if (hit0 && hit1) {
+          if (t1 < t0)
+            std::swap(c0, c1);
+          stack[top++] = c1;
+          n = c0;
+          continue;
+        }
+        if (hit0 || hit1) {
+          n = hit0 ? c0 : c1;
+          continue;
+        }
+      }
+      if (top == 0)
+        break;
+      n = stack[--top];
+    }
+    return hit;
+  }
+
+  /**
+   * Visit the leaves entered by any ray of a packet. Children are visited
+   * nearest first along the direction of the first active ray.
+   * @param  rays    Rays.
+   * @param  active  Mask of the rays to trace.
+   * @param  t_max   Farthest t of interest for each ray. Lowered by the
+   *                 leaf function.
+   * @param  leaf    Called as leaf(first, count, mask) with the range of
+   *                 the primitive order in the leaf and the mask of rays
+   *                 that entered it.
+   */
+  template <typename LeafFn>
+  void TraversePacket(const RayPacket& rays, const uint32_t active, float* t_max,
+                      LeafFn leaf) const {
+    if (nodes.empty() || active == 0)
+      return;
+    uint32_t lane = 0;
+    while (!(active & (1u << lane)))
+      lane++;
+    const float dir[3] = { rays.d_x[lane], rays.d_y[lane], rays.d_z[lane] };
+
+    // Nodes are tested when popped with the mask of rays that entered the
+    // parent
+    uint32_t stack[kBVHMaxDepth];
+    uint32_t masks[kBVHMaxDepth];
+    uint32_t top = 0;
+    uint32_t n = 0;
+    uint32_t mask = active;
+    for (;;) {
+      const BVHNode& node = nodes[n];
+      mask &= PacketBox(rays, node.min, node.max, t_max);
+      if (mask != 0) {
+        if (node.IsLeaf()) {
+          leaf(node.first, node.count, mask);
+        }
+        else {
+          // Near child first along the axis separating the children most
+          const BVHNode& c0 = nodes[node.first];
+          const BVHNode& c1 = nodes[node.first + 1];
+          float best = -1.0f;
+          float order = 0.0f;
+          for (int k = 0; k < 3; k++) {
+            float dc = (c1.min[k] + c1.max[k]) - (c0.min[k] + c0.max[k]);
+            if (fabs(dc) > best) {
+              best = fabs(dc);
+              order = dc * dir[k];
+            }
+          }
+          uint32_t near_child = (order >= 0.0f) ? node.first : node.first + 1;
+          stack[top] = (order >= 0.0f) ? node.first + 1 : node.first;
+          masks[top++] = mask;
+          n = near_child;
+          continue;
+        }
+      }
+      if (top == 0)
+        break;
+      top--;
+      n = stack[top];
+      mask = masks[top];
+    }
+  }
+
+  /**
+   * Get the nodes (the root is node 0).
+   * @return  Returns the flattened nodes.
+   */
+  const std::vector<BVHNode>& GetNodes() const {
+    return nodes;
+  }
+
+  /**
+   * Get the primitive order. Leaves refer to ranges of this array.
+   * @return  Returns the primitive index at each position.
+   */
+  const std::vector<uint32_t>& GetOrder() const {
+    return order;
+  }
+
+  /**
+   * Get the bounding box of a node.
+   * @param  node  Node.
+   * @return  Returns the box.
+   */
+  static AABB GetBox(const BVHNode& node) {
+    return AABB(Point3(node.min[0], node.min[1], node.min[2]),
+                Point3(node.max[0], node.max[1], node.max[2]));
+  }
+
+protected:
+  std::vector<BVHNode>  nodes;
+  std::vector<uint32_t> order;
+
+  // Inputs shared by the build threads (each thread partitions its own
+  // range of the order)
+  struct BuildContext {
+    const std::vector<float>& boxes;
+    const std::vector<float>& centroids;
+    std::vector<uint32_t>&    order;
+
+    BuildContext(const std::vector<float>& b, const std::vector<float>& c,
+                 std::vector<uint32_t>& o)
+        : boxes(b),
+          centroids(c),
+          order(o) {
+    }
+
+  private:
+    // Holds references - no assignment
+    BuildContext& operator = (const BuildContext&);
+  };
+
+  // Box accumulated during the build
+  struct BuildBox {
+    float min[3];
+    float max[3];
+
+    BuildBox() {
+      min[0] = min[1] = min[2] = FLT_MAX;
+      max[0] = max[1] = max[2] = -FLT_MAX;
+    }
+
+    void Merge(const float* box) {
+      for (int k = 0; k < 3; k++) {
+        min[k] = (box[k] < min[k]) ? box[k] : min[k];
+        max[k] = (box[k + 3] > max[k]) ? box[k + 3] : max[k];
+      }
+    }
+
+    void Merge(const BuildBox& box) {
+      for (int k = 0; k < 3; k++) {
+        min[k] = (box.min[k] < min[k]) ? box.min[k] : min[k];
+        max[k] = (box.max[k] > max[k]) ? box.max[k] : max[k];
+      }
+    }
+
+    float HalfArea() const {
+      if (min[0] > max[0])
+        return 0.0f;
+      float x = max[0] - min[0];
+      float y = max[1] - min[1];
+      float z = max[2] - min[2];
+      return x * y + y * z + z * x;
+    }
+  };
+
+  // SAH bin
+  struct Bin {
+    BuildBox box;
+    uint32_t count;
+  };
+
+  static void SetBox(BVHNode& node, const AABB& box) {
+    node.min[0] = box.m_minPt.x;
+    node.min[1] = box.m_minPt.y;
+    node.min[2] = box.m_minPt.z;
+    node.max[0] = box.m_maxPt.x;
+    node.max[1] = box.m_maxPt.y;
+    node.max[2] = box.m_maxPt.z;
+  }
+
+  // Make a node a leaf over a range of the order
+  static void SetLeaf(const BuildContext& ctx, BVHNode& node, const uint32_t first,
+                      const uint32_t count) {
+    BuildBox box;
+    for (uint32_t i = first; i < first + count; i++)
+      box.Merge(&ctx.boxes[ctx.order[i] * 6]);
+    for (int k = 0; k < 3; k++) {
+      node.min[k] = box.min[k];
+      node.max[k] = box.max[k];
+    }
+    node.first = first;
+    node.count = count;
+  }
+
+  // Parent of a node in the top levels (a linear search - only used for
+  // the few subtree roots)
+  uint32_t Parent(const uint32_t n) const {
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+      if (!nodes[i].IsLeaf() && (nodes[i].first == n || nodes[i].first + 1 == n))
+        return i;
+    }
+    return 0;
+  }
+
+  // Build the subtree below local[0] into local
+  static void BuildSubtree(const BuildContext& ctx, std::vector<BVHNode>& local,
+                           const uint32_t root_depth) {
+    std::vector<uint32_t> stack(1, 0);
+    std::vector<uint32_t> depth(1, root_depth);
+    while (!stack.empty()) {
+      uint32_t n = stack.back();
+      uint32_t level = depth.back();
+      stack.pop_back();
+      depth.pop_back();
+      BVHNode children[2];
+      if (!Split(ctx, local[n], level, children))
+        continue;
+      uint32_t left = static_cast<uint32_t>(local.size());
+      local[n].first = left;
+      local[n].count = 0;
+      local.push_back(children[0]);
+      local.push_back(children[1]);
+      stack.push_back(left);
+      stack.push_back(left + 1);
+      depth.push_back(level + 1);
+      depth.push_back(level + 1);
+    }
+  }
+
+  // Split a leaf by the binned SAH. Returns false if the leaf is cheaper
+  // than any split.
+  static bool Split(const BuildContext& ctx, const BVHNode& node, const uint32_t level,
+                    BVHNode children[2]) {
+    uint32_t first = node.first;
+    uint32_t count = node.count;
+    if (count <= 1 || level + 2 >= kBVHMaxDepth)
+      return false;
+
+    // Bounds of the centroids
+    float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (uint32_t i = first; i < first + count; i++) {
+      const float* c = &ctx.centroids[ctx.order[i] * 3];
+      for (int k = 0; k < 3; k++) {
+        lo[k] = std::min(lo[k], c[k]);
+        hi[k] = std::max(hi[k], c[k]);
+      }
+    }
+
+    // Cheapest split over the bin boundaries of each axis
+    float leaf_cost = static_cast<float>(count);
+    float best_cost = FLT_MAX;
+    int best_axis = -1;
+    uint32_t best_bin = 0;
+    float ex = node.max[0] - node.min[0];
+    float ey = node.max[1] - node.min[1];
+    float ez = node.max[2] - node.min[2];
+    float node_area = ex * ey + ey * ez + ez * ex;
+    for (int axis = 0; axis < 3; axis++) {
+      float extent = hi[axis] - lo[axis];
+      if (extent <= 0.0f)
+        continue;
+      float scale = kBVHBins / extent;
+      Bin bins[kBVHBins];
+      for (uint32_t b = 0; b < kBVHBins; b++)
+        bins[b].count = 0;
+      for (uint32_t i = first; i < first + count; i++) {
+        uint32_t p = ctx.order[i];
+        uint32_t b = std::min(kBVHBins - 1,
+          static_cast<uint32_t>((ctx.centroids[p * 3 + axis] - lo[axis]) * scale));
+        bins[b].box.Merge(&ctx.boxes[p * 6]);
+        bins[b].count++;
+      }
+
+      // Sweep from the right, then from the left evaluating each boundary
+      float right_area[kBVHBins];
+      uint32_t right_count[kBVHBins];
+      BuildBox box;
+      uint32_t n = 0;
+      for (uint32_t b = kBVHBins - 1; b > 0; b--) {
+        box.Merge(bins[b].box);
+        n += bins[b].count;
+        right_area[b] = box.HalfArea();
+        right_count[b] = n;
+      }
+      box = BuildBox();
+      n = 0;
+      for (uint32_t b = 0; b < kBVHBins - 1; b++) {
+        box.Merge(bins[b].box);
+        n += bins[b].count;
+        if (n == 0 || right_count[b + 1] == 0)
+          continue;
+        float cost = n * box.HalfArea() + right_count[b + 1] * right_area[b + 1];
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_axis = axis;
+          best_bin = b;
+        }
+      }
+    }
+
+    // Compare to the cost of a leaf (split cost relative to this node)
+    uint32_t mid;
+    bool must_split = (count > kBVHMaxLeafSize);
+    if (best_axis >= 0 &&
+        (node_area <= 0.0f || kBVHTraversalCost + best_cost / node_area < leaf_cost || must_split)) {
+      float scale = kBVHBins / (hi[best_axis] - lo[best_axis]);
+      uint32_t* begin = &ctx.order[first];
+      uint32_t* end = begin + count;
+      const std::vector<float>& centroids = ctx.centroids;
+      float origin = lo[best_axis];
+      uint32_t* split = std::partition(begin, end, [&](uint32_t p) -> bool {
+        uint32_t b = std::min(kBVHBins - 1,
+          static_cast<uint32_t>((centroids[p * 3 + best_axis] - origin) * scale));
+        return b <= best_bin;
+      });
+      mid = first + static_cast<uint32_t>(split - begin);
+    }
+    else if (must_split) {
+      // All centroids are the same - split the range in half
+      mid = first + count / 2;
+    }
+    else {
+      return false;
+    }
+    SetLeaf(ctx, children[0], first, mid - first);
+    SetLeaf(ctx, children[1], mid, first + count - mid);
+    return true;
+  }
+};
+
+/**
+ * Triangle for ray tests: first vertex and the 2 edges from it.
+ */
+struct BVHTriangle {
+  Point3  v0;
+  Vector3 e1;
+  Vector3 e2;
+};
+
+/**
+ * BVH over the triangles of a mesh (object coordinates). Triangles are
+ * copied in leaf order so a leaf's triangles are contiguous.
+ */
+class TriangleBVH {
+public:
+  /**
+   * Build from a triangle list.
+   * @param  positions     Position (3 floats) of the first vertex.
+   * @param  stride        Bytes between positions.
+   * @param  indices       Triangle list indices.
+   * @param  index_count   Number of indices.
+   */
+  void Build(const float* positions, const uint32_t stride, const uint32_t* indices,
+             const uint32_t index_count) {
+    uint32_t tri_count = index_count / 3;
+    std::vector<BVHTriangle> input(tri_count);
+    std::vector<AABB> bounds(tri_count);
+    ParallelFor(tri_count, kBVHParallelMin, [&](size_t begin, size_t end) {
+      for (size_t t = begin; t < end; t++) {
+        const float* p0 = PositionAt(positions, stride, indices[t * 3]);
+        const float* p1 = PositionAt(positions, stride, indices[t * 3 + 1]);
+        const float* p2 = PositionAt(positions, stride, indices[t * 3 + 2]);
+        Point3 v0(p0[0], p0[1], p0[2]);
+        Point3 v1(p1[0], p1[1], p1[2]);
+        Point3 v2(p2[0], p2[1], p2[2]);
+        input[t].v0 = v0;
+        input[t].e1 = v1 - v0;
+        input[t].e2 = v2 - v0;
+        bounds[t] = AABB(
+          Point3(std::min(std::min(v0.x, v1.x), v2.x), std::min(std::min(v0.y, v1.y), v2.y),
+                 std::min(std::min(v0.z, v1.z), v2.z)),
+          Point3(std::max(std::max(v0.x, v1.x), v2.x), std::max(std::max(v0.y, v1.y), v2.y),
+                 std::max(std::max(v0.z, v1.z), v2.z)));
+      }
+    });
+    bvh.Build(bounds);
+
+    const std::vector<uint32_t>& order = bvh.GetOrder();
+    triangles.resize(tri_count);
+    for (uint32_t i = 0; i < tri_count; i++)
+      triangles[i] = input[order[i]];
+  }
+
+  /**
+   * Remove all triangles.
+   */
+  void Clear() {
+    bvh = BVH();
+    triangles.clear();
+  }
+
+  /**
+   * Check if there are no triangles.
+   * @return  Returns true if empty.
+   */
+  bool IsEmpty() const {
+    return triangles.empty();
+  }
+
+  /**
+   * Get the number of triangles.
+   * @return  Returns the triangle count.
+   */
+  uint32_t GetTriangleCount() const {
+    return static_cast<uint32_t>(triangles.size());
+  }
+
+  /**
+   * Get the bounds of all triangles.
+   * @return  Returns the root box (empty if there are no triangles).
+   */
+  AABB GetBound() const {
+    return IsEmpty() ? AABB() : BVH::GetBox(bvh.GetNodes()[0]);
+  }
+
+  /**
+   * Get the hierarchy.
+   * @return  Returns the BVH.
+   */
+  const BVH& GetBVH() const {
+    return bvh;
+  }
+
+  /**
+   * Find the nearest triangle hit by a ray (either side of the triangle).
+   * @param  ray    Prepared ray.
+   * @param  t_max  Farthest t of interest.
+   * @param  hit    (OUT) Set if a triangle nearer than t_max is hit.
+   * @return  Returns true if a triangle is hit.
+   */
+  bool Intersect(const BVHRay& ray, const float t_max, RayHit& hit) const {
+    float t_best = t_max;
+    const std::vector<uint32_t>& order = bvh.GetOrder();
+    return bvh.Traverse(ray, t_best, [&](uint32_t first, uint32_t count, float& t_near) -> bool {
+      bool found = false;
+      for (uint32_t i = first; i < first + count; i++) {
+        const BVHTriangle& tri = triangles[i];
+        if (RayTriangleScalar(ray.o, ray.d, &tri.v0.x, &tri.e1.x, &tri.e2.x, t_near, hit.u,
+                              hit.v)) {
+          hit.t = t_near;
+          hit.primitive = order[i];
+          found = true;
+        }
+      }
+      return found;
+    });
+  }
+
+  /**
+   * Find the nearest triangle hit by each ray of a packet. Inactive lanes
+   * must hold valid rays (e.g. copies of an active lane). Triangles are
+   * tested against all lanes, so inactive lanes may be hit too.
+   * @param  rays    Rays.
+   * @param  active  Mask of the rays to trace.
+   * @param  t       (IN/OUT) Farthest t of interest for each ray. Lowered
+   *                 to the t of the hit.
+   * @param  hits    (OUT) Set for each ray with a hit nearer than t.
+   * @return  Returns the mask of the rays (active or not) whose t was
+   *          lowered.
+   */
+  uint32_t IntersectPacket(const RayPacket& rays, const uint32_t active, float* t,
+                           RayHit* hits) const {
+    uint32_t found = 0;
+    float u[kRayPacketSize] = { 0.0f };
+    float v[kRayPacketSize] = { 0.0f };
+    const std::vector<uint32_t>& order = bvh.GetOrder();
+    // The leaf's ray mask is not needed: every lane is tested since a
+    // nearer hit is valid whether or not the ray entered this leaf
+    bvh.TraversePacket(rays, active, t, [&](uint32_t first, uint32_t count, uint32_t /*mask*/) {
+      for (uint32_t i = first; i < first + count; i++) {
+        const BVHTriangle& tri = triangles[i];
+        uint32_t hit = PacketTriangle(rays, &tri.v0.x, &tri.e1.x, &tri.e2.x, t, u, v);
+        for (uint32_t lane = 0; hit != 0; lane++, hit >>= 1) {
+          if (hit & 1) {
+            hits[lane].t = t[lane];
+            hits[lane].u = u[lane];
+            hits[lane].v = v[lane];
+            hits[lane].primitive = order[i];
+            found |= 1u << lane;
+          }
+        }
+      }
+    });
+    return found;
+  }
+
+  /**
+   * Moller-Trumbore ray/triangle test.
+   * @param  ray  Prepared ray.
+   * @param  tri  Triangle.
+   * @param  t    (OUT) Distance along the ray.
+   * @param  u    (OUT) Barycentric coordinate (weight of v1).
+   * @param  v    (OUT) Barycentric coordinate (weight of v2).
+   * @return  Returns true if the ray hits the triangle at t > 0.
+   */
+  static bool IntersectTriangle(const BVHRay& ray, const BVHTriangle& tri, float& t,
+                                float& u, float& v) {
+    t = FLT_MAX;
+    return RayTriangleScalar(ray.o, ray.d, &tri.v0.x, &tri.e1.x, &tri.e2.x, t, u, v);
+  }
+
+protected:
+  BVH                      bvh;
+  std::vector<BVHTriangle> triangles;   // In primitive order
+};
+
+/**
+ * Convert a triangle strip to a triangle list. Degenerate triangles (used
+ * to join strips) are dropped.
+ * @param  strip      Strip indices.
+ * @param  triangles  Filled with triangle list indices.
+ */
+inline void StripToTriangles(const std::vector<uint32_t>& strip, std::vector<uint32_t>& triangles) {
+  triangles.clear();
+  for (size_t i = 2; i < strip.size(); i++) {
+    uint32_t a = strip[i - 2];
+    uint32_t b = strip[i - 1];
+    uint32_t c = strip[i];
+    if (a == b || b == c || a == c)
+      continue;
+    // Every other triangle is reversed to keep the winding
+    if (i % 2 == 1)
+      std::swap(a, b);
+    triangles.push_back(a);
+    triangles.push_back(b);
+    triangles.push_back(c);
+  }
+}
+
+#endif
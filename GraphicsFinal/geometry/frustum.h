@@ -0,0 +1,116 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    frustum.h
+//	Purpose: View frustum planes extracted from a composite projection,
+//           view and model matrix, with sphere and box tests.
+//
+//============================================================================
+
+#ifndef __FRUSTUM_H__
+#define __FRUSTUM_H__
+
+// Frustum planes (in the order they are extracted)
+enum FrustumPlane { FRUSTUM_LEFT, FRUSTUM_RIGHT, FRUSTUM_BOTTOM, FRUSTUM_TOP,
+                    FRUSTUM_NEAR, FRUSTUM_FAR, FRUSTUM_PLANE_COUNT };
+
+/**
+ * View frustum. The planes are in the space the matrix transforms from
+ * (object space for projection * view * model) with unit normals pointing
+ * into the frustum, so Solve gives the signed distance inside.
+ */
+struct Frustum {
+  Plane planes[FRUSTUM_PLANE_COUNT];
+
+  /**
+   * Default constructor.
+   */
+  Frustum() {
+  }
+
+  /**
+   * Constructor given a composite matrix.
+   * @param  m  Projection * view (* model) matrix.
+   */
+  Frustum(const Matrix4x4& m) {
+    Set(m);
+  }
+
+  /**
+   * Extract the planes from a composite matrix (Gribb and Hartmann). A
+   * point is inside when -w <= x, y, z <= w in clip coordinates.
+   * @param  m  Projection * view (* model) matrix.
+   */
+  void Set(const Matrix4x4& m) {
+    for (uint32_t i = 0; i < FRUSTUM_PLANE_COUNT; i++) {
+      uint32_t row = i / 2;
+      float s = (i % 2 == 0) ? 1.0f : -1.0f;
+      Plane& p = planes[i];
+      p.a = m.m(3, 0) + s * m.m(row, 0);
+      p.b = m.m(3, 1) + s * m.m(row, 1);
+      p.c = m.m(3, 2) + s * m.m(row, 2);
+      p.d = -(m.m(3, 3) + s * m.m(row, 3));
+      p.Normalize();
+    }
+  }
+
+  /**
+   * Test if a sphere is entirely outside the frustum. Conservative: a
+   * sphere outside near a corner (but no single plane) is kept.
+   * @param  center  Sphere center.
+   * @param  radius  Sphere radius.
+   * @return  Returns true if the sphere is outside a plane.
+   */
+  bool IsOutside(const Point3& center, const float radius) const {
+    for (uint32_t i = 0; i < FRUSTUM_PLANE_COUNT; i++) {
+      if (planes[i].Solve(center) < -radius)
+        return true;
+    }
+    return false;
+  }
+
+  /**
+   * Test if a box is entirely outside the frustum. The box is outside a
+   * plane when its corner farthest along the plane normal is outside
+   * (center distance plus the half diagonal projected onto the normal).
+   * Conservative like the sphere test.
+   * @param  box  Box (must not be empty).
+   * @return  Returns true if the box is outside a plane.
+   */
+  bool IsOutside(const AABB& box) const {
+    const Vector3& h = box.m_halfDiagonal;
+    for (uint32_t i = 0; i < FRUSTUM_PLANE_COUNT; i++) {
+      const Plane& p = planes[i];
+      float extent = std::fabs(p.a) * h.x + std::fabs(p.b) * h.y + std::fabs(p.c) * h.z;
+      if (p.Solve(box.m_center) < -extent)
+        return true;
+    }
+    return false;
+  }
+
+  /**
+   * Get the eye (center of projection): the point the side planes meet.
+   * @param  eye  Set to the eye position.
+   * @return  Returns false for a parallel projection (no eye point).
+   */
+  bool GetEye(Point3& eye) const {
+    const Plane& p1 = planes[FRUSTUM_LEFT];
+    const Plane& p2 = planes[FRUSTUM_RIGHT];
+    const Plane& p3 = planes[FRUSTUM_TOP];
+    Vector3 n1 = p1.GetNormal();
+    Vector3 n2 = p2.GetNormal();
+    Vector3 n3 = p3.GetNormal();
+    Vector3 n23 = n2.Cross(n3);
+    float det = n1.Dot(n23);
+    if (std::fabs(det) < kEpsilon)
+      return false;
+    Vector3 v = (n23 * p1.d + n3.Cross(n1) * p2.d + n1.Cross(n2) * p3.d) * (1.0f / det);
+    eye.Set(v.x, v.y, v.z);
+    return true;
+  }
+};
+
+#endif
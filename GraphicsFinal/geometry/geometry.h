@@ -87,6 +87,13 @@ inline float FastInvSqrt(float x) {
 #include "geometry/ray3.h"
 #include "geometry/noise.h"
 #include "geometry/matrix.h"
+#include "geometry/transform_batch.h"
+#include "geometry/vertex_weld.h"
+#include "geometry/mesh_optimize.h"
+#include "geometry/frustum.h"
+#include "geometry/meshlet.h"
+#include "geometry/ray_simd.h"
+#include "geometry/bvh.h"
 
 /**
  * Structure to hold a vertex position and normal
@@ -216,4 +223,30 @@ inline bool Point3::IsInPolygon(const std::vector<Point3>& polygon,
     return IsInPolygonXY(polygon);   // Drop the z component
 }
 
+// Transform bounding volumes. Declared in AABB and BoundingSphere, defined
+// here since they use Matrix4x4.
+inline AABB AABB::Transform(const Matrix4x4& m) const {
+  if (IsEmpty())
+    return AABB();
+  float c[3];
+  float h[3];
+  for (uint32_t r = 0; r < 3; r++) {
+    c[r] = m.m(r, 0) * m_center.x + m.m(r, 1) * m_center.y + m.m(r, 2) * m_center.z + m.m(r, 3);
+    h[r] = fabs(m.m(r, 0)) * m_halfDiagonal.x + fabs(m.m(r, 1)) * m_halfDiagonal.y +
+           fabs(m.m(r, 2)) * m_halfDiagonal.z;
+  }
+  return AABB(Point3(c[0] - h[0], c[1] - h[1], c[2] - h[2]),
+              Point3(c[0] + h[0], c[1] + h[1], c[2] + h[2]));
+}
+
+inline BoundingSphere BoundingSphere::Transform(const Matrix4x4& m) const {
+  float scale2 = 0.0f;
+  for (uint32_t col = 0; col < 3; col++) {
+    float s2 = m.m(0, col) * m.m(0, col) + m.m(1, col) * m.m(1, col) + m.m(2, col) * m.m(2, col);
+    scale2 = (s2 > scale2) ? s2 : scale2;
+  }
+  HPoint3 c = m * m_center;
+  return BoundingSphere(Point3(c.x, c.y, c.z), m_radius * sqrtf(scale2));
+}
+
 #endif
@@ -14,6 +14,8 @@
 #ifndef __MATRIX4x4_H__
 #define __MATRIX4x4_H__
 
+#include "geometry/matrix_simd.h"
+
 /**
  * 4x4 matrix. All matrix elements (row, col) are indexed base 0.
  */
@@ -153,40 +155,8 @@ public:
    * @return  Returns the product of the current matrix and the supplied matrix.
    */
   Matrix4x4 operator * (const Matrix4x4& n) const {
-    // Unroll the loop, do 1 row at a time.
     Matrix4x4 t;
-    float a0 = m00();
-    float a1 = m01();
-    float a2 = m02();
-    float a3 = m03();
-    t.m00() = a0 * n.m00() + a1 * n.m10() + a2 * n.m20() + a3 * n.m30();
-    t.m01() = a0 * n.m01() + a1 * n.m11() + a2 * n.m21() + a3 * n.m31();
-    t.m02() = a0 * n.m02() + a1 * n.m12() + a2 * n.m22() + a3 * n.m32();
-    t.m03() = a0 * n.m03() + a1 * n.m13() + a2 * n.m23() + a3 * n.m33();
-    a0 = m10();
-    a1 = m11();
-    a2 = m12();
-    a3 = m13();
-    t.m10() = a0 * n.m00() + a1 * n.m10() + a2 * n.m20() + a3 * n.m30();
-    t.m11() = a0 * n.m01() + a1 * n.m11() + a2 * n.m21() + a3 * n.m31();
-    t.m12() = a0 * n.m02() + a1 * n.m12() + a2 * n.m22() + a3 * n.m32();
-    t.m13() = a0 * n.m03() + a1 * n.m13() + a2 * n.m23() + a3 * n.m33();
-    a0 = m20();
-    a1 = m21();
-    a2 = m22();
-    a3 = m23();
-    t.m20() = a0 * n.m00() + a1 * n.m10() + a2 * n.m20() + a3 * n.m30();
-    t.m21() = a0 * n.m01() + a1 * n.m11() + a2 * n.m21() + a3 * n.m31();
-    t.m22() = a0 * n.m02() + a1 * n.m12() + a2 * n.m22() + a3 * n.m32();
-    t.m23() = a0 * n.m03() + a1 * n.m13() + a2 * n.m23() + a3 * n.m33();
-    a0 = m30();
-    a1 = m31();
-    a2 = m32();
-    a3 = m33();
-    t.m30() = a0 * n.m00() + a1 * n.m10() + a2 * n.m20() + a3 * n.m30();
-    t.m31() = a0 * n.m01() + a1 * n.m11() + a2 * n.m21() + a3 * n.m31();
-    t.m32() = a0 * n.m02() + a1 * n.m12() + a2 * n.m22() + a3 * n.m32();
-    t.m33() = a0 * n.m03() + a1 * n.m13() + a2 * n.m23() + a3 * n.m33();
+    Mat4Multiply(a, n.a, t.a);
     return t;
   }
 
@@ -197,7 +167,7 @@ public:
    * @return  Returns the address of the current matrix.
    */
   Matrix4x4& operator *= (const Matrix4x4& n) {
-    *this = *this * n;
+    Mat4Multiply(a, n.a, a);
     return *this;
   }
 
@@ -220,10 +190,9 @@ public:
    * @return  Returns the transformed homogeneous coordinate position.
    */
   HPoint3 operator *(const HPoint3& v) const {
-    return HPoint3((a[0] * v.x + a[4] * v.y + a[8] * v.z + a[12] * v.w),
-                   (a[1] * v.x + a[5] * v.y + a[9] * v.z + a[13] * v.w),
-                   (a[2] * v.x + a[6] * v.y + a[10] * v.z + a[14] * v.w),
-                   (a[3] * v.x + a[7] * v.y + a[11] * v.z + a[15] * v.w));
+    float out[4];
+    Mat4Transform(a, &v.x, out);
+    return HPoint3(out[0], out[1], out[2], out[3]);
   }
 
   /**
@@ -233,10 +202,10 @@ public:
    * @return  Returns the transformed point.
    */
   HPoint3 operator *(const Point3& v) const {
-    return HPoint3((a[0] * v.x + a[4] * v.y + a[8] * v.z + a[12]),
-                   (a[1] * v.x + a[5] * v.y + a[9] * v.z + a[13]),
-                   (a[2] * v.x + a[6] * v.y + a[10] * v.z + a[14]),
-                   (a[3] * v.x + a[7] * v.y + a[11] * v.z + a[15]));
+    const float in[4] = { v.x, v.y, v.z, 1.0f };
+    float out[4];
+    Mat4Transform(a, in, out);
+    return HPoint3(out[0], out[1], out[2], out[3]);
   }
 
   /**
@@ -246,9 +215,10 @@ public:
    * @return  Returns the transformed direction.
    */
   Vector3 operator *(const Vector3& v) const {
-    return Vector3((a[0] * v.x + a[4] * v.y + a[8] * v.z),
-                   (a[1] * v.x + a[5] * v.y + a[9] * v.z),
-                   (a[2] * v.x + a[6] * v.y + a[10] * v.z));
+    const float in[4] = { v.x, v.y, v.z, 0.0f };
+    float out[4];
+    Mat4Transform(a, in, out);
+    return Vector3(out[0], out[1], out[2]);
   }
 
   /**
@@ -266,7 +236,7 @@ public:
    * @return   Returns the address of the current matrix.
    */
   Matrix4x4& Transpose() {
-    *this = GetTranspose();
+    Mat4Transpose(a, a);
     return *this;
   }
 
@@ -277,22 +247,7 @@ public:
    */
   Matrix4x4 GetTranspose() const {
     Matrix4x4 t;
-    t.m00() = m00();
-    t.m01() = m10();
-    t.m02() = m20();
-    t.m03() = m30();
-    t.m10() = m01();
-    t.m11() = m11();
-    t.m12() = m21();
-    t.m13() = m31();
-    t.m20() = m02();
-    t.m21() = m12();
-    t.m22() = m22();
-    t.m23() = m32();
-    t.m30() = m03();
-    t.m31() = m13();
-    t.m32() = m23();
-    t.m33() = m33();
+    Mat4Transpose(a, t.a);
     return t;
   }
 
@@ -447,59 +402,28 @@ public:
    * @return  Returns the inverse of the current matrix.
    */
   Matrix4x4 GetInverse() const {
-    int j, k;
-    int ind;
-    float v1, v2;
-    Matrix4x4 t = *this;
     Matrix4x4 b;
-    for (int i = 0; i < 4; i++) {
-      // Find pivot
-      v1 = t.m(i, i);
-      ind = i;
-      for (j = i + 1; j < 4; j++) {
-        if (fabs(t.m(j, i)) > fabs(v1)) {
-          ind = j;
-          v1 = t.m(j, i);
-        }
-      }
-
-      // Swap columns
-      if (ind != i) {
-        for (j = 0; j < 4; j++) {
-          v2 = b.m(i, j);
-          b.m(i, j) = b.m(ind, j);
-          b.m(ind, j) = v2;
-          v2 = t.m(i, j);
-          t.m(i, j) = t.m(ind, j);
-          t.m(ind, j) = v2;
-        }
-      }
-
-      // The matrix is singular (has no inverse), set the inverse
-      // to the identity matrix.
-      if (v1 == 0.0f) {
-        extern void logmsg(const char *message, ...);
-			  logmsg("InvertMatrix: Singular matrix");
-        b.SetIdentity();
-			  return b;
-      }
-
-      for (j = 0; j < 4; j++) {
-        t.m(i, j) /= v1;
-        b.m(i, j) /= v1;
-      }
-
-      // Eliminate column
-      for (j = 0; j < 4; j++) {
-        if (j == i)
-          continue;
-
-        v1 = t.m(j, i);
-        for (k = 0; k < 4; k++) {
-          t.m(j, k) -= t.m(i, k) * v1;
-          b.m(j, k) -= b.m(i, k) * v1;
-        }
-      }
+    if (!Mat4Inverse(a, b.a)) {
+      // The matrix is singular (has no inverse), the inverse is set to
+      // the identity matrix.
+      extern void logmsg(const char *message, ...);
+      logmsg("InvertMatrix: Singular matrix");
+    }
+    return b;
+  }
+
+  /**
+   * Calculates the inverse of the current matrix assuming it is affine
+   * (composed of rotations, scales and translations - the bottom row is
+   * 0 0 0 1). This is all TransformNode produces and is much cheaper than
+   * GetInverse.
+   * @return  Returns the inverse of the current matrix.
+   */
+  Matrix4x4 GetAffineInverse() const {
+    Matrix4x4 b;
+    if (!Mat4AffineInverse(a, b.a)) {
+      extern void logmsg(const char *message, ...);
+      logmsg("InvertMatrix: Singular matrix");
     }
     return b;
   }
@@ -0,0 +1,442 @@
+//============================================================================
+//	Johns Hopkins University Engineering for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    matrix_simd.h
+//	Purpose: 4x4 matrix kernels used by Matrix4x4. SSE and AVX versions
+//          are selected at compile time. The scalar versions are always
+//          available and are the reference the SIMD versions must match.
+//          All matrices are 16 floats in column order (same as Matrix4x4
+//          and OpenGL). Outputs may alias inputs.
+//
+//============================================================================
+
+#ifndef __MATRIX_SIMD_H__
+#define __MATRIX_SIMD_H__
+
+// Select the instruction set. Define GEOMETRY_NO_SIMD to force the scalar
+// kernels. SSE2 is the default for 32 bit Visual Studio builds (/arch:SSE2)
+// and all x64 builds. AVX is used when compiling with /arch:AVX or /arch:AVX2.
+#if !defined(GEOMETRY_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GEOMETRY_USE_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(GEOMETRY_USE_SSE) && defined(__AVX__)
+#define GEOMETRY_USE_AVX 1
+#include <immintrin.h>
+#endif
+#endif
+
+//----------------------------------------------------------------------------
+// Scalar (reference) kernels
+//----------------------------------------------------------------------------
+
+/**
+ * Multiply two matrices ( out = a b ).
+ * @param  a    Left matrix.
+ * @param  b    Right matrix.
+ * @param  out  Product.
+ */
+inline void Mat4MultiplyScalar(const float* a, const float* b, float* out) {
+  float t[16];
+  for (int c = 0; c < 4; c++) {
+    const float b0 = b[c * 4];
+    const float b1 = b[c * 4 + 1];
+    const float b2 = b[c * 4 + 2];
+    const float b3 = b[c * 4 + 3];
+    for (int r = 0; r < 4; r++) {
+      t[c * 4 + r] = a[r] * b0 + a[4 + r] * b1 + a[8 + r] * b2 + a[12 + r] * b3;
+    }
+  }
+  for (int i = 0; i < 16; i++)
+    out[i] = t[i];
+}
+
+/**
+ * Transpose a matrix.
+ * @param  a    Matrix to transpose.
+ * @param  out  Transposed matrix.
+ */
+inline void Mat4TransposeScalar(const float* a, float* out) {
+  float t[16];
+  for (int c = 0; c < 4; c++) {
+    for (int r = 0; r < 4; r++) {
+      t[r * 4 + c] = a[c * 4 + r];
+    }
+  }
+  for (int i = 0; i < 16; i++)
+    out[i] = t[i];
+}
+
+/**
+ * Transform a homogeneous coordinate ( out = a v ).
+ * @param  a    Matrix.
+ * @param  v    Homogeneous coordinate (x, y, z, w).
+ * @param  out  Transformed coordinate (x, y, z, w).
+ */
+inline void Mat4TransformScalar(const float* a, const float* v, float* out) {
+  const float x = v[0], y = v[1], z = v[2], w = v[3];
+  out[0] = a[0] * x + a[4] * y + a[8] * z + a[12] * w;
+  out[1] = a[1] * x + a[5] * y + a[9] * z + a[13] * w;
+  out[2] = a[2] * x + a[6] * y + a[10] * z + a[14] * w;
+  out[3] = a[3] * x + a[7] * y + a[11] * z + a[15] * w;
+}
+
+/**
+ * Invert a general matrix using Gauss-Jordan elimination with partial
+ * pivoting.
+ * @param  a    Matrix to invert.
+ * @param  out  Inverse (identity if the matrix is singular).
+ * @return  Returns false if the matrix is singular.
+ */
+inline bool Mat4InverseScalar(const float* a, float* out) {
+  // Row r, column c is element [c * 4 + r]
+  float t[16], b[16];
+  for (int i = 0; i < 16; i++) {
+    t[i] = a[i];
+    b[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+  }
+  for (int i = 0; i < 4; i++) {
+    // Find pivot
+    float v1 = t[i * 4 + i];
+    int ind = i;
+    for (int j = i + 1; j < 4; j++) {
+      if (fabs(t[i * 4 + j]) > fabs(v1)) {
+        ind = j;
+        v1 = t[i * 4 + j];
+      }
+    }
+
+    // Swap rows
+    if (ind != i) {
+      for (int j = 0; j < 4; j++) {
+        float v2 = b[j * 4 + i];
+        b[j * 4 + i] = b[j * 4 + ind];
+        b[j * 4 + ind] = v2;
+        v2 = t[j * 4 + i];
+        t[j * 4 + i] = t[j * 4 + ind];
+        t[j * 4 + ind] = v2;
+      }
+    }
+
+    // The matrix is singular (has no inverse)
+    if (v1 == 0.0f) {
+      for (int j = 0; j < 16; j++)
+        out[j] = (j % 5 == 0) ? 1.0f : 0.0f;
+      return false;
+    }
+
+    for (int j = 0; j < 4; j++) {
+      t[j * 4 + i] /= v1;
+      b[j * 4 + i] /= v1;
+    }
+
+    // Eliminate column
+    for (int j = 0; j < 4; j++) {
+      if (j == i)
+        continue;
+
+      v1 = t[i * 4 + j];
+      for (int k = 0; k < 4; k++) {
+        t[k * 4 + j] -= t[k * 4 + i] * v1;
+        b[k * 4 + j] -= b[k * 4 + i] * v1;
+      }
+    }
+  }
+  for (int i = 0; i < 16; i++)
+    out[i] = b[i];
+  return true;
+}
+
+/**
+ * Invert an affine matrix (rotation, scale, shear and translation - the
+ * bottom row is 0 0 0 1). The upper 3x3 is inverted with its adjugate
+ * (rows of the inverse are cross products of its columns) and the
+ * translation is transformed by the result.
+ * @param  a    Affine matrix to invert.
+ * @param  out  Inverse (identity if the matrix is singular).
+ * @return  Returns false if the matrix is singular.
+ */
+inline bool Mat4AffineInverseScalar(const float* a, float* out) {
+  // Columns of the upper 3x3 and the translation
+  const float c0x = a[0], c0y = a[1], c0z = a[2];
+  const float c1x = a[4], c1y = a[5], c1z = a[6];
+  const float c2x = a[8], c2y = a[9], c2z = a[10];
+  const float tx = a[12], ty = a[13], tz = a[14];
+
+  // Rows of the inverse (before dividing by the determinant)
+  const float r0x = c1y * c2z - c1z * c2y;
+  const float r0y = c1z * c2x - c1x * c2z;
+  const float r0z = c1x * c2y - c1y * c2x;
+  const float r1x = c2y * c0z - c2z * c0y;
+  const float r1y = c2z * c0x - c2x * c0z;
+  const float r1z = c2x * c0y - c2y * c0x;
+  const float r2x = c0y * c1z - c0z * c1y;
+  const float r2y = c0z * c1x - c0x * c1z;
+  const float r2z = c0x * c1y - c0y * c1x;
+  const float det = c0x * r0x + c0y * r0y + c0z * r0z;
+  if (det == 0.0f) {
+    for (int j = 0; j < 16; j++)
+      out[j] = (j % 5 == 0) ? 1.0f : 0.0f;
+    return false;
+  }
+  const float s = 1.0f / det;
+  out[0] = r0x * s;  out[4] = r0y * s;  out[8]  = r0z * s;
+  out[1] = r1x * s;  out[5] = r1y * s;  out[9]  = r1z * s;
+  out[2] = r2x * s;  out[6] = r2y * s;  out[10] = r2z * s;
+  out[3] = 0.0f;     out[7] = 0.0f;     out[11] = 0.0f;
+  out[12] = -(out[0] * tx + out[4] * ty + out[8] * tz);
+  out[13] = -(out[1] * tx + out[5] * ty + out[9] * tz);
+  out[14] = -(out[2] * tx + out[6] * ty + out[10] * tz);
+  out[15] = 1.0f;
+  return true;
+}
+
+#ifdef GEOMETRY_USE_SSE
+//----------------------------------------------------------------------------
+// SSE kernels. Loads and stores are unaligned since Matrix4x4 does not
+// guarantee 16 byte alignment (std::vector and std::list members).
+//----------------------------------------------------------------------------
+
+#define GEOMETRY_SHUFFLE(v, x, y, z, w) \
+  _mm_shuffle_ps((v), (v), _MM_SHUFFLE((w), (z), (y), (x)))
+
+// Linear combination of the 4 columns of a: c0 * v.x + c1 * v.y + c2 * v.z + c3 * v.w
+inline __m128 Mat4LinearCombineSSE(const __m128 c0, const __m128 c1, const __m128 c2,
+                                   const __m128 c3, const __m128 v) {
+  __m128 r = _mm_mul_ps(c0, GEOMETRY_SHUFFLE(v, 0, 0, 0, 0));
+  r = _mm_add_ps(r, _mm_mul_ps(c1, GEOMETRY_SHUFFLE(v, 1, 1, 1, 1)));
+  r = _mm_add_ps(r, _mm_mul_ps(c2, GEOMETRY_SHUFFLE(v, 2, 2, 2, 2)));
+  return _mm_add_ps(r, _mm_mul_ps(c3, GEOMETRY_SHUFFLE(v, 3, 3, 3, 3)));
+}
+
+// Cross product of the xyz components (w of the result is 0)
+inline __m128 CrossSSE(const __m128 a, const __m128 b) {
+  __m128 t = _mm_sub_ps(_mm_mul_ps(a, GEOMETRY_SHUFFLE(b, 1, 2, 0, 3)),
+                        _mm_mul_ps(GEOMETRY_SHUFFLE(a, 1, 2, 0, 3), b));
+  return GEOMETRY_SHUFFLE(t, 1, 2, 0, 3);
+}
+
+// 2x2 matrix products used by the block inverse. 2x2 matrices are stored
+// row order in a single register (m00, m01, m10, m11).
+// A B
+inline __m128 Mat2MulSSE(const __m128 a, const __m128 b) {
+  return _mm_add_ps(_mm_mul_ps(a, GEOMETRY_SHUFFLE(b, 0, 3, 0, 3)),
+                    _mm_mul_ps(GEOMETRY_SHUFFLE(a, 1, 0, 3, 2), GEOMETRY_SHUFFLE(b, 2, 1, 2, 1)));
+}
+// Adjugate(A) B
+inline __m128 Mat2AdjMulSSE(const __m128 a, const __m128 b) {
+  return _mm_sub_ps(_mm_mul_ps(GEOMETRY_SHUFFLE(a, 3, 3, 0, 0), b),
+                    _mm_mul_ps(GEOMETRY_SHUFFLE(a, 1, 1, 2, 2), GEOMETRY_SHUFFLE(b, 2, 3, 0, 1)));
+}
+// A Adjugate(B)
+inline __m128 Mat2MulAdjSSE(const __m128 a, const __m128 b) {
+  return _mm_sub_ps(_mm_mul_ps(a, GEOMETRY_SHUFFLE(b, 3, 0, 3, 0)),
+                    _mm_mul_ps(GEOMETRY_SHUFFLE(a, 1, 0, 3, 2), GEOMETRY_SHUFFLE(b, 2, 1, 2, 1)));
+}
+
+#ifdef GEOMETRY_USE_AVX
+/**
+ * Multiply two matrices ( out = a b ). AVX version - computes two
+ * columns of the product at a time.
+ */
+inline void Mat4Multiply(const float* a, const float* b, float* out) {
+  const __m256 c0 = _mm256_broadcast_ps((const __m128*)(a));
+  const __m256 c1 = _mm256_broadcast_ps((const __m128*)(a + 4));
+  const __m256 c2 = _mm256_broadcast_ps((const __m128*)(a + 8));
+  const __m256 c3 = _mm256_broadcast_ps((const __m128*)(a + 12));
+  const __m256 b01 = _mm256_loadu_ps(b);
+  const __m256 b23 = _mm256_loadu_ps(b + 8);
+  __m256 r01 = _mm256_mul_ps(c0, _mm256_permute_ps(b01, 0x00));
+  __m256 r23 = _mm256_mul_ps(c0, _mm256_permute_ps(b23, 0x00));
+  r01 = _mm256_add_ps(r01, _mm256_mul_ps(c1, _mm256_permute_ps(b01, 0x55)));
+  r23 = _mm256_add_ps(r23, _mm256_mul_ps(c1, _mm256_permute_ps(b23, 0x55)));
+  r01 = _mm256_add_ps(r01, _mm256_mul_ps(c2, _mm256_permute_ps(b01, 0xAA)));
+  r23 = _mm256_add_ps(r23, _mm256_mul_ps(c2, _mm256_permute_ps(b23, 0xAA)));
+  r01 = _mm256_add_ps(r01, _mm256_mul_ps(c3, _mm256_permute_ps(b01, 0xFF)));
+  r23 = _mm256_add_ps(r23, _mm256_mul_ps(c3, _mm256_permute_ps(b23, 0xFF)));
+  _mm256_storeu_ps(out, r01);
+  _mm256_storeu_ps(out + 8, r23);
+}
+#else
+/**
+ * Multiply two matrices ( out = a b ). SSE version - each column of the
+ * product is a linear combination of the columns of a.
+ */
+inline void Mat4Multiply(const float* a, const float* b, float* out) {
+  const __m128 c0 = _mm_loadu_ps(a);
+  const __m128 c1 = _mm_loadu_ps(a + 4);
+  const __m128 c2 = _mm_loadu_ps(a + 8);
+  const __m128 c3 = _mm_loadu_ps(a + 12);
+  const __m128 b0 = _mm_loadu_ps(b);
+  const __m128 b1 = _mm_loadu_ps(b + 4);
+  const __m128 b2 = _mm_loadu_ps(b + 8);
+  const __m128 b3 = _mm_loadu_ps(b + 12);
+  _mm_storeu_ps(out,      Mat4LinearCombineSSE(c0, c1, c2, c3, b0));
+  _mm_storeu_ps(out + 4,  Mat4LinearCombineSSE(c0, c1, c2, c3, b1));
+  _mm_storeu_ps(out + 8,  Mat4LinearCombineSSE(c0, c1, c2, c3, b2));
+  _mm_storeu_ps(out + 12, Mat4LinearCombineSSE(c0, c1, c2, c3, b3));
+}
+#endif
+
+/**
+ * Transpose a matrix. SSE version.
+ */
+inline void Mat4Transpose(const float* a, float* out) {
+  __m128 c0 = _mm_loadu_ps(a);
+  __m128 c1 = _mm_loadu_ps(a + 4);
+  __m128 c2 = _mm_loadu_ps(a + 8);
+  __m128 c3 = _mm_loadu_ps(a + 12);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+  _mm_storeu_ps(out, c0);
+  _mm_storeu_ps(out + 4, c1);
+  _mm_storeu_ps(out + 8, c2);
+  _mm_storeu_ps(out + 12, c3);
+}
+
+/**
+ * Transform a homogeneous coordinate ( out = a v ). SSE version.
+ */
+inline void Mat4Transform(const float* a, const float* v, float* out) {
+  _mm_storeu_ps(out, Mat4LinearCombineSSE(_mm_loadu_ps(a), _mm_loadu_ps(a + 4),
+                     _mm_loadu_ps(a + 8), _mm_loadu_ps(a + 12), _mm_loadu_ps(v)));
+}
+
+/**
+ * Invert a general matrix. SSE version using 2x2 block matrices:
+ * the 4x4 is split into 2x2 blocks A B / C D and the inverse is formed
+ * from their adjugates and determinants (no pivoting or branches).
+ */
+inline bool Mat4Inverse(const float* a, float* out) {
+  // Load the columns. The block math below works on rows, so this
+  // inverts the transpose. The inverse of the transpose is the transpose
+  // of the inverse, so storing the resulting rows as columns gives the
+  // inverse in column order.
+  const __m128 m0 = _mm_loadu_ps(a);
+  const __m128 m1 = _mm_loadu_ps(a + 4);
+  const __m128 m2 = _mm_loadu_ps(a + 8);
+  const __m128 m3 = _mm_loadu_ps(a + 12);
+
+  // 2x2 sub matrices
+  const __m128 A = _mm_movelh_ps(m0, m1);
+  const __m128 B = _mm_movehl_ps(m1, m0);
+  const __m128 C = _mm_movelh_ps(m2, m3);
+  const __m128 D = _mm_movehl_ps(m3, m2);
+
+  // Determinants of the sub matrices (|A| |B| |C| |D|)
+  const __m128 det_sub = _mm_sub_ps(
+    _mm_mul_ps(_mm_shuffle_ps(m0, m2, _MM_SHUFFLE(2, 0, 2, 0)),
+               _mm_shuffle_ps(m1, m3, _MM_SHUFFLE(3, 1, 3, 1))),
+    _mm_mul_ps(_mm_shuffle_ps(m0, m2, _MM_SHUFFLE(3, 1, 3, 1)),
+               _mm_shuffle_ps(m1, m3, _MM_SHUFFLE(2, 0, 2, 0))));
+  const __m128 det_a = GEOMETRY_SHUFFLE(det_sub, 0, 0, 0, 0);
+  const __m128 det_b = GEOMETRY_SHUFFLE(det_sub, 1, 1, 1, 1);
+  const __m128 det_c = GEOMETRY_SHUFFLE(det_sub, 2, 2, 2, 2);
+  const __m128 det_d = GEOMETRY_SHUFFLE(det_sub, 3, 3, 3, 3);
+
+  // Inverse = 1/|M| * (X Y / Z W), computed as adjugates X# Y# Z# W#
+  const __m128 d_c = Mat2AdjMulSSE(D, C);
+  const __m128 a_b = Mat2AdjMulSSE(A, B);
+  __m128 x = _mm_sub_ps(_mm_mul_ps(det_d, A), Mat2MulSSE(B, d_c));
+  __m128 w = _mm_sub_ps(_mm_mul_ps(det_a, D), Mat2MulSSE(C, a_b));
+  __m128 y = _mm_sub_ps(_mm_mul_ps(det_b, C), Mat2MulAdjSSE(D, a_b));
+  __m128 z = _mm_sub_ps(_mm_mul_ps(det_c, B), Mat2MulAdjSSE(A, d_c));
+
+  // |M| = |A||D| + |B||C| - trace((A# B)(D# C))
+  __m128 tr = _mm_mul_ps(a_b, GEOMETRY_SHUFFLE(d_c, 0, 2, 1, 3));
+  tr = _mm_add_ps(tr, GEOMETRY_SHUFFLE(tr, 2, 3, 0, 1));
+  tr = _mm_add_ps(tr, GEOMETRY_SHUFFLE(tr, 1, 0, 3, 2));
+  const __m128 det_m = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d),
+                                             _mm_mul_ps(det_b, det_c)), tr);
+  if (_mm_cvtss_f32(det_m) == 0.0f) {
+    for (int j = 0; j < 16; j++)
+      out[j] = (j % 5 == 0) ? 1.0f : 0.0f;
+    return false;
+  }
+
+  // Apply the adjugate signs and 1/|M|
+  const __m128 r_det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det_m);
+  x = _mm_mul_ps(x, r_det);
+  y = _mm_mul_ps(y, r_det);
+  z = _mm_mul_ps(z, r_det);
+  w = _mm_mul_ps(w, r_det);
+
+  // Adjugate shuffle combined with the store shuffle
+  _mm_storeu_ps(out,      _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+  _mm_storeu_ps(out + 4,  _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+  _mm_storeu_ps(out + 8,  _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+  _mm_storeu_ps(out + 12, _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+  return true;
+}
+
+/**
+ * Invert an affine matrix. SSE version of Mat4AffineInverseScalar.
+ */
+inline bool Mat4AffineInverse(const float* a, float* out) {
+  // Columns with w cleared
+  const __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+  const __m128 c0 = _mm_and_ps(_mm_loadu_ps(a), mask);
+  const __m128 c1 = _mm_and_ps(_mm_loadu_ps(a + 4), mask);
+  const __m128 c2 = _mm_and_ps(_mm_loadu_ps(a + 8), mask);
+  const __m128 t  = _mm_loadu_ps(a + 12);
+
+  // Rows of the inverse (before dividing by the determinant)
+  __m128 r0 = CrossSSE(c1, c2);
+  __m128 r1 = CrossSSE(c2, c0);
+  __m128 r2 = CrossSSE(c0, c1);
+  __m128 det = _mm_mul_ps(c0, r0);
+  det = _mm_add_ps(det, GEOMETRY_SHUFFLE(det, 1, 0, 3, 2));
+  det = _mm_add_ps(det, GEOMETRY_SHUFFLE(det, 2, 3, 0, 1));
+  if (_mm_cvtss_f32(det) == 0.0f) {
+    for (int j = 0; j < 16; j++)
+      out[j] = (j % 5 == 0) ? 1.0f : 0.0f;
+    return false;
+  }
+  const __m128 s = _mm_div_ps(_mm_set1_ps(1.0f), det);
+  r0 = _mm_mul_ps(r0, s);
+  r1 = _mm_mul_ps(r1, s);
+  r2 = _mm_mul_ps(r2, s);
+
+  // Transpose the rows into columns. The 4th row is 0 0 0 1 (the translation
+  // column is then replaced)
+  __m128 r3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+  // Translation column is -(inverse * t) (w = 1)
+  __m128 ti = _mm_mul_ps(r0, GEOMETRY_SHUFFLE(t, 0, 0, 0, 0));
+  ti = _mm_add_ps(ti, _mm_mul_ps(r1, GEOMETRY_SHUFFLE(t, 1, 1, 1, 1)));
+  ti = _mm_add_ps(ti, _mm_mul_ps(r2, GEOMETRY_SHUFFLE(t, 2, 2, 2, 2)));
+  ti = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), ti);
+  _mm_storeu_ps(out, r0);
+  _mm_storeu_ps(out + 4, r1);
+  _mm_storeu_ps(out + 8, r2);
+  _mm_storeu_ps(out + 12, ti);
+  return true;
+}
+
+#else
+//----------------------------------------------------------------------------
+// No SIMD - use the scalar kernels
+//----------------------------------------------------------------------------
+
+inline void Mat4Multiply(const float* a, const float* b, float* out) {
+  Mat4MultiplyScalar(a, b, out);
+}
+inline void Mat4Transpose(const float* a, float* out) {
+  Mat4TransposeScalar(a, out);
+}
+inline void Mat4Transform(const float* a, const float* v, float* out) {
+  Mat4TransformScalar(a, v, out);
+}
+inline bool Mat4Inverse(const float* a, float* out) {
+  return Mat4InverseScalar(a, out);
+}
+inline bool Mat4AffineInverse(const float* a, float* out) {
+  return Mat4AffineInverseScalar(a, out);
+}
+#endif
+
+#endif
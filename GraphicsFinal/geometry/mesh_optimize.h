@@ -0,0 +1,387 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    mesh_optimize.h
+//	Purpose: Reorders triangle list indices for the post-transform vertex
+//           cache and for less overdraw, and vertices for fetch locality.
+//
+//============================================================================
+
+#ifndef __MESH_OPTIMIZE_H__
+#define __MESH_OPTIMIZE_H__
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// FIFO cache size used to measure ACMR (a typical post-transform cache)
+const uint32_t kVertexCacheSize = 16;
+
+// LRU cache size of the vertex cache ordering score
+const uint32_t kVertexScoreCacheSize = 32;
+
+// Largest ACMR increase (as a factor) the overdraw ordering may cause
+const float kOverdrawThreshold = 1.05f;
+
+// Before and after statistics of OptimizeMesh
+struct MeshOptimizeStats {
+  uint32_t triangles;
+  float    acmr_before;   // Average cache miss ratio: transformed vertices per triangle
+  float    acmr_after;
+};
+
+/**
+ * Average cache miss ratio (vertices transformed per triangle) of a
+ * triangle list with a FIFO vertex cache. 3 is the worst case; about 0.5
+ * is the best for a regular grid.
+ * @param  indices       Triangle list indices.
+ * @param  vertex_count  Number of vertices.
+ * @param  cache_size    Cache size (entries).
+ * @return  Returns the ACMR (0 for an empty list).
+ */
+inline float ComputeACMR(const std::vector<uint32_t>& indices, const uint32_t vertex_count,
+                         const uint32_t cache_size = kVertexCacheSize) {
+  if (indices.size() < 3)
+    return 0.0f;
+
+  // A vertex is in the cache if fewer than cache_size misses happened
+  // since it was loaded
+  std::vector<uint32_t> loaded(vertex_count, 0);
+  uint32_t misses = 0;
+  for (size_t i = 0; i < indices.size(); i++) {
+    uint32_t v = indices[i];
+    if (loaded[v] == 0 || misses - loaded[v] >= cache_size) {
+      misses++;
+      loaded[v] = misses;
+    }
+  }
+  return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+// Score of a vertex for the vertex cache ordering (Forsyth, "Linear-Speed
+// Vertex Cache Optimisation"): recently used vertices score high (the last
+// triangle's vertices a little less, so strips do not form) and vertices
+// with few remaining triangles score high so they are finished off.
+inline float VertexCacheScore(const int cache_position, const uint32_t live_triangles) {
+  if (live_triangles == 0)
+    return -1.0f;
+  float score = 0.0f;
+  if (cache_position >= 0) {
+    if (cache_position < 3)
+      score = 0.75f;
+    else {
+      float s = 1.0f - (cache_position - 3) * (1.0f / (kVertexScoreCacheSize - 3));
+      score = powf(s, 1.5f);
+    }
+  }
+  return score + 2.0f / sqrtf(static_cast<float>(live_triangles));
+}
+
+/**
+ * Reorder triangles for the post-transform vertex cache. Greedily emits
+ * the best scoring triangle that uses a cached vertex, falling back to the
+ * next triangle in the original order. Linear in the number of triangles.
+ * @param  indices       Triangle list indices (reordered in place).
+ * @param  vertex_count  Number of vertices.
+ */
+inline void OptimizeVertexCache(std::vector<uint32_t>& indices, const uint32_t vertex_count) {
+  const uint32_t tri_count = static_cast<uint32_t>(indices.size() / 3);
+  if (tri_count == 0)
+    return;
+
+  // Triangles using each vertex. The first live[v] entries of a vertex's
+  // range are the triangles not yet emitted.
+  std::vector<uint32_t> live(vertex_count, 0);
+  for (uint32_t i = 0; i < tri_count * 3; i++)
+    live[indices[i]]++;
+  std::vector<uint32_t> first(vertex_count + 1, 0);
+  for (uint32_t v = 0; v < vertex_count; v++)
+    first[v + 1] = first[v] + live[v];
+  std::vector<uint32_t> adjacent(tri_count * 3);
+  std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+  for (uint32_t i = 0; i < tri_count * 3; i++)
+    adjacent[fill[indices[i]]++] = i / 3;
+
+  std::vector<int> cache_position(vertex_count, -1);
+  std::vector<float> vertex_score(vertex_count);
+  for (uint32_t v = 0; v < vertex_count; v++)
+    vertex_score[v] = VertexCacheScore(-1, live[v]);
+  std::vector<float> tri_score(tri_count);
+  for (uint32_t t = 0; t < tri_count; t++) {
+    tri_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] +
+                   vertex_score[indices[t * 3 + 2]];
+  }
+
+  std::vector<bool> emitted(tri_count, false);
+  std::vector<uint32_t> cache;
+  std::vector<uint32_t> next_cache;
+  std::vector<uint32_t> result;
+  result.reserve(tri_count * 3);
+  uint32_t scan = 0;
+  int best = 0;
+  while (result.size() < tri_count * 3) {
+    if (best < 0) {
+      while (emitted[scan])
+        scan++;
+      best = static_cast<int>(scan);
+    }
+
+    // Emit the triangle and remove it from its vertices' live lists
+    const uint32_t* tri = &indices[best * 3];
+    result.insert(result.end(), tri, tri + 3);
+    emitted[best] = true;
+    for (int k = 0; k < 3; k++) {
+      uint32_t v = tri[k];
+      uint32_t* list = adjacent.data() + first[v];
+      for (uint32_t j = 0; j < live[v]; j++) {
+        if (list[j] == static_cast<uint32_t>(best)) {
+          list[j] = list[live[v] - 1];
+          live[v]--;
+          break;
+        }
+      }
+    }
+
+    // Move the triangle's vertices to the front of the LRU cache. Vertices
+    // pushed past the end are evicted (kept in next_cache to rescore them).
+    next_cache.assign(tri, tri + 3);
+    for (size_t i = 0; i < cache.size(); i++) {
+      if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+        next_cache.push_back(cache[i]);
+    }
+    for (size_t i = 0; i < next_cache.size(); i++) {
+      cache_position[next_cache[i]] = (i < kVertexScoreCacheSize) ? static_cast<int>(i) : -1;
+      vertex_score[next_cache[i]] = VertexCacheScore(cache_position[next_cache[i]], live[next_cache[i]]);
+    }
+
+    // Rescore the live triangles of the cached and evicted vertices and
+    // pick the best one that uses a cached vertex
+    best = -1;
+    float best_score = -1.0f;
+    for (size_t i = 0; i < next_cache.size(); i++) {
+      uint32_t v = next_cache[i];
+      const uint32_t* list = adjacent.data() + first[v];
+      for (uint32_t j = 0; j < live[v]; j++) {
+        uint32_t t = list[j];
+        tri_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] +
+                       vertex_score[indices[t * 3 + 2]];
+        if (cache_position[v] >= 0 && tri_score[t] > best_score) {
+          best_score = tri_score[t];
+          best = static_cast<int>(t);
+        }
+      }
+    }
+    if (next_cache.size() > kVertexScoreCacheSize)
+      next_cache.resize(kVertexScoreCacheSize);
+    cache.swap(next_cache);
+  }
+  indices.swap(result);
+}
+
+/**
+ * Reorder triangle clusters to reduce overdraw (after OptimizeVertexCache).
+ * The list is split where the vertex cache is cold anyway, and further
+ * wherever a cluster's ACMR so far is within threshold of its whole
+ * cluster's. Clusters are then sorted so those facing outward from the
+ * mesh center draw first (Sander, Nehab and Barczak, "Fast Triangle
+ * Reordering for Vertex Locality and Reduced Overdraw").
+ * @param  indices       Triangle list indices (reordered in place).
+ * @param  positions     Position (3 floats) of the first vertex.
+ * @param  stride        Bytes between positions.
+ * @param  vertex_count  Number of vertices.
+ * @param  threshold     Allowed ACMR increase as a factor.
+ */
+inline void OptimizeOverdraw(std::vector<uint32_t>& indices, const float* positions,
+                             const uint32_t stride, const uint32_t vertex_count,
+                             const float threshold = kOverdrawThreshold) {
+  const uint32_t tri_count = static_cast<uint32_t>(indices.size() / 3);
+  if (tri_count < 2)
+    return;
+
+  // Cache misses of each triangle with a FIFO cache that is reset at the
+  // cluster starts
+  std::vector<uint32_t> loaded(vertex_count, 0);
+  uint32_t misses = 0;
+  uint32_t reset = 0;
+  auto triangle_misses = [&](const uint32_t t) -> uint32_t {
+    uint32_t m = 0;
+    for (int k = 0; k < 3; k++) {
+      uint32_t v = indices[t * 3 + k];
+      if (loaded[v] <= reset || misses - loaded[v] >= kVertexCacheSize) {
+        misses++;
+        loaded[v] = misses;
+        m++;
+      }
+    }
+    return m;
+  };
+
+  // Hard boundaries: triangles that miss all 3 vertices start with a cold
+  // cache so moving them costs nothing
+  std::vector<uint32_t> hard;
+  for (uint32_t t = 0; t < tri_count; t++) {
+    if (triangle_misses(t) == 3)
+      hard.push_back(t);
+  }
+  hard.push_back(tri_count);
+
+  // Soft boundaries within each hard cluster
+  std::vector<uint32_t> clusters;
+  for (size_t h = 0; h + 1 < hard.size(); h++) {
+    uint32_t start = hard[h];
+    uint32_t end = hard[h + 1];
+    reset = misses;
+    uint32_t cluster_misses = 0;
+    for (uint32_t t = start; t < end; t++)
+      cluster_misses += triangle_misses(t);
+    float limit = threshold * cluster_misses / (end - start);
+
+    reset = misses;
+    uint32_t cluster_start = start;
+    uint32_t running = 0;
+    clusters.push_back(start);
+    for (uint32_t t = start; t < end; t++) {
+      running += triangle_misses(t);
+      if (t + 1 < end && running <= limit * (t - cluster_start + 1)) {
+        clusters.push_back(t + 1);
+        cluster_start = t + 1;
+        running = 0;
+        reset = misses;
+      }
+    }
+  }
+  clusters.push_back(tri_count);
+
+  // Area weighted centroid and normal of each cluster and of the mesh
+  const unsigned char* base = reinterpret_cast<const unsigned char*>(positions);
+  auto position = [&](const uint32_t v) -> const float* {
+    return reinterpret_cast<const float*>(base + static_cast<size_t>(v) * stride);
+  };
+  const uint32_t cluster_count = static_cast<uint32_t>(clusters.size() - 1);
+  std::vector<float> centroid(cluster_count * 3, 0.0f);
+  std::vector<float> normal(cluster_count * 3, 0.0f);
+  float mesh_centroid[3] = { 0.0f, 0.0f, 0.0f };
+  float mesh_area = 0.0f;
+  for (uint32_t c = 0; c < cluster_count; c++) {
+    float area_sum = 0.0f;
+    for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+      const float* p0 = position(indices[t * 3]);
+      const float* p1 = position(indices[t * 3 + 1]);
+      const float* p2 = position(indices[t * 3 + 2]);
+      float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+      float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+      float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+                     e1[0] * e2[1] - e1[1] * e2[0] };
+      float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (int k = 0; k < 3; k++) {
+        float center = (p0[k] + p1[k] + p2[k]) * (1.0f / 3.0f);
+        centroid[c * 3 + k] += center * area;
+        normal[c * 3 + k] += n[k];
+        mesh_centroid[k] += center * area;
+      }
+      area_sum += area;
+    }
+    mesh_area += area_sum;
+    for (int k = 0; k < 3; k++)
+      centroid[c * 3 + k] = (area_sum > 0.0f) ? centroid[c * 3 + k] / area_sum : 0.0f;
+  }
+  for (int k = 0; k < 3; k++)
+    mesh_centroid[k] = (mesh_area > 0.0f) ? mesh_centroid[k] / mesh_area : 0.0f;
+
+  // Sort by how far the cluster faces away from the mesh center (outer
+  // surfaces first so they occlude inner ones)
+  std::vector<float> key(cluster_count);
+  std::vector<uint32_t> order(cluster_count);
+  for (uint32_t c = 0; c < cluster_count; c++) {
+    const float* n = &normal[c * 3];
+    float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    float d = 0.0f;
+    for (int k = 0; k < 3; k++)
+      d += (centroid[c * 3 + k] - mesh_centroid[k]) * n[k];
+    key[c] = (len > 0.0f) ? d / len : 0.0f;
+    order[c] = c;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) {
+    return key[a] > key[b];
+  });
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (uint32_t i = 0; i < cluster_count; i++) {
+    uint32_t c = order[i];
+    result.insert(result.end(), indices.begin() + clusters[c] * 3,
+                  indices.begin() + clusters[c + 1] * 3);
+  }
+  indices.swap(result);
+}
+
+/**
+ * Renumber vertices in the order the indices first use them so vertex
+ * fetches walk the vertex buffer in order. Unused vertices go last.
+ * @param  indices       Triangle list indices (renumbered in place).
+ * @param  vertex_count  Number of vertices.
+ * @param  remap         Filled with the new index of each old vertex.
+ */
+inline void OptimizeVertexFetch(std::vector<uint32_t>& indices, const uint32_t vertex_count,
+                                std::vector<uint32_t>& remap) {
+  remap.assign(vertex_count, 0xffffffff);
+  uint32_t next = 0;
+  for (size_t i = 0; i < indices.size(); i++) {
+    uint32_t& r = remap[indices[i]];
+    if (r == 0xffffffff)
+      r = next++;
+    indices[i] = r;
+  }
+  for (uint32_t v = 0; v < vertex_count; v++) {
+    if (remap[v] == 0xffffffff)
+      remap[v] = next++;
+  }
+}
+
+/**
+ * Reorder a vertex list with the remap from OptimizeVertexFetch.
+ * @param  vertices  Vertex list (reordered in place).
+ * @param  remap     New index of each vertex.
+ */
+template <class T>
+void RemapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap) {
+  std::vector<T> result(vertices.size());
+  for (size_t v = 0; v < vertices.size(); v++)
+    result[remap[v]] = vertices[v];
+  vertices.swap(result);
+}
+
+/**
+ * Run the vertex cache, overdraw and vertex fetch optimizations on a
+ * triangle list. The triangle order is kept if reordering raises the ACMR.
+ * The caller reorders its vertices with RemapVertices.
+ * @param  indices       Triangle list indices (reordered and renumbered).
+ * @param  positions     Position (3 floats) of the first vertex.
+ * @param  stride        Bytes between positions.
+ * @param  vertex_count  Number of vertices.
+ * @param  remap         Filled with the new index of each old vertex.
+ * @return  Returns the triangle count and ACMR before and after.
+ */
+inline MeshOptimizeStats OptimizeMesh(std::vector<uint32_t>& indices, const float* positions,
+                                      const uint32_t stride, const uint32_t vertex_count,
+                                      std::vector<uint32_t>& remap) {
+  MeshOptimizeStats stats;
+  stats.triangles = static_cast<uint32_t>(indices.size() / 3);
+  stats.acmr_before = ComputeACMR(indices, vertex_count);
+
+  // Keep the original triangle order if it was already better (e.g. small
+  // meshes built in a cache friendly order)
+  std::vector<uint32_t> original(indices);
+  OptimizeVertexCache(indices, vertex_count);
+  OptimizeOverdraw(indices, positions, stride, vertex_count);
+  if (ComputeACMR(indices, vertex_count) > stats.acmr_before)
+    indices.swap(original);
+  OptimizeVertexFetch(indices, vertex_count, remap);
+  stats.acmr_after = ComputeACMR(indices, vertex_count);
+  return stats;
+}
+
+#endif
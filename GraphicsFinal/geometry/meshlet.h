@@ -0,0 +1,155 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    meshlet.h
+//	Purpose: Splits a triangle list into small clusters (meshlets) with
+//           bounding spheres and normal cones for per-cluster culling.
+//
+//============================================================================
+
+#ifndef __MESHLET_H__
+#define __MESHLET_H__
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Meshlet size limits (unique vertices and triangles)
+const uint32_t kMeshletMaxVertices = 64;
+const uint32_t kMeshletMaxTriangles = 124;
+
+// Cone cutoff of a meshlet that is never backface culled
+const float kMeshletNoCone = 1.0f;
+
+/**
+ * Meshlet: a contiguous range of a triangle list. The normal cone holds
+ * every (non degenerate) triangle normal within acos(sqrt(1 - cutoff^2))
+ * of the axis - the meshlet faces away from any eye in the cone
+ * dot(center - eye, axis) >= cutoff * |center - eye| + radius.
+ */
+struct Meshlet {
+  uint32_t first_index;   // First index in the triangle list
+  uint32_t index_count;   // Number of indices (3 per triangle)
+  Point3   center;        // Bounding sphere
+  float    radius;
+  Vector3  cone_axis;     // Average triangle normal (unit length)
+  float    cone_cutoff;   // Sine of the cone half angle (kMeshletNoCone = no cone)
+
+  /**
+   * Test if the meshlet can be culled.
+   * @param  frustum   View frustum (same space as the meshlet).
+   * @param  eye       Eye position (same space).
+   * @param  use_eye   Use the normal cone (false if there is no eye).
+   * @return  Returns true if the meshlet is outside the frustum or faces
+   *          away from the eye.
+   */
+  bool IsCulled(const Frustum& frustum, const Point3& eye, const bool use_eye) const {
+    if (frustum.IsOutside(center, radius))
+      return true;
+    if (!use_eye || cone_cutoff >= kMeshletNoCone)
+      return false;
+    Vector3 v = center - eye;
+    return v.Dot(cone_axis) >= cone_cutoff * v.Norm() + radius;
+  }
+};
+
+/**
+ * Split a triangle list into meshlets. Triangles are taken in order (run
+ * OptimizeVertexCache first so neighboring triangles are together) until a
+ * meshlet reaches kMeshletMaxVertices unique vertices or
+ * kMeshletMaxTriangles triangles, so each meshlet is a contiguous range of
+ * the list and the index buffer is not changed.
+ * @param  indices       Triangle list indices.
+ * @param  index_count   Number of indices.
+ * @param  positions     Position (3 floats) of the first vertex.
+ * @param  stride        Bytes between positions.
+ * @param  vertex_count  Number of vertices.
+ * @param  meshlets      Filled with the meshlets.
+ */
+inline void BuildMeshlets(const uint32_t* indices, const uint32_t index_count,
+                          const float* positions, const uint32_t stride,
+                          const uint32_t vertex_count, std::vector<Meshlet>& meshlets) {
+  meshlets.clear();
+  const unsigned char* base = reinterpret_cast<const unsigned char*>(positions);
+  auto position = [&](const uint32_t v) -> Point3 {
+    const float* p = reinterpret_cast<const float*>(base + static_cast<size_t>(v) * stride);
+    return Point3(p[0], p[1], p[2]);
+  };
+
+  // Vertices are marked with the meshlet number (+1) that last used them
+  std::vector<uint32_t> mark(vertex_count, 0);
+  std::vector<Vector3> normals;
+  uint32_t tri_count = index_count / 3;
+  uint32_t t = 0;
+  while (t < tri_count) {
+    Meshlet m;
+    m.first_index = t * 3;
+    uint32_t id = static_cast<uint32_t>(meshlets.size()) + 1;
+    uint32_t unique = 0;
+    uint32_t count = 0;
+    while (t < tri_count && count < kMeshletMaxTriangles) {
+      const uint32_t* tri = &indices[t * 3];
+      uint32_t added = 0;
+      for (int k = 0; k < 3; k++) {
+        if (mark[tri[k]] != id && (k < 1 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]))
+          added++;
+      }
+      if (unique + added > kMeshletMaxVertices)
+        break;
+      for (int k = 0; k < 3; k++)
+        mark[tri[k]] = id;
+      unique += added;
+      count++;
+      t++;
+    }
+    m.index_count = count * 3;
+
+    // Bounding sphere: center of the bounding box, radius to the farthest vertex
+    const uint32_t* first = &indices[m.first_index];
+    Point3 lo = position(first[0]);
+    Point3 hi = lo;
+    for (uint32_t i = 1; i < m.index_count; i++) {
+      Point3 p = position(first[i]);
+      lo.Set(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+      hi.Set(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+    }
+    m.center.Set((lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f);
+    float r2 = 0.0f;
+    for (uint32_t i = 0; i < m.index_count; i++)
+      r2 = std::max(r2, (position(first[i]) - m.center).NormSquared());
+    m.radius = std::sqrt(r2);
+
+    // Normal cone: average of the unit triangle normals, opened to the
+    // farthest one. Cones wider than about 84 degrees rarely cull - keep
+    // them out of the test.
+    normals.clear();
+    Vector3 sum(0.0f, 0.0f, 0.0f);
+    for (uint32_t i = 0; i < m.index_count; i += 3) {
+      Point3 p0 = position(first[i]);
+      Vector3 n = (position(first[i + 1]) - p0).Cross(position(first[i + 2]) - p0);
+      float len = n.Norm();
+      if (len <= 0.0f)
+        continue;
+      n *= 1.0f / len;
+      normals.push_back(n);
+      sum += n;
+    }
+    m.cone_axis.Set(0.0f, 0.0f, 0.0f);
+    m.cone_cutoff = kMeshletNoCone;
+    float sum_len = sum.Norm();
+    if (!normals.empty() && sum_len > kEpsilon) {
+      m.cone_axis = sum * (1.0f / sum_len);
+      float min_dot = 1.0f;
+      for (size_t i = 0; i < normals.size(); i++)
+        min_dot = std::min(min_dot, normals[i].Dot(m.cone_axis));
+      if (min_dot > 0.1f)
+        m.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    }
+    meshlets.push_back(m);
+  }
+}
+
+#endif
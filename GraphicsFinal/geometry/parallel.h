@@ -0,0 +1,174 @@
+//============================================================================
+//	Johns Hopkins University Engineering for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    parallel.h
+//	Purpose: Persistent worker thread pool and a parallel for loop used
+//          by batch geometry operations.
+//
+//============================================================================
+
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Pool of worker threads that run ParallelFor loops. Threads are created
+ * on first use and sleep between loops. One loop runs at a time: a
+ * ParallelFor issued while another is running (or from inside a loop body)
+ * runs serially on the calling thread.
+ */
+class ThreadPool {
+public:
+  /**
+   * Get the thread pool. The first call must be made from the main thread
+   * (function local statics are not thread safe in Visual Studio 2013).
+   * The pool is never destroyed - worker threads are ended by the process
+   * exiting rather than joined from a static destructor.
+   * @return  Returns the thread pool.
+   */
+  static ThreadPool& Get() {
+    static ThreadPool* pool = new ThreadPool;
+    return *pool;
+  }
+
+  /**
+   * Get the number of threads that run loops (workers plus the caller).
+   * @return  Returns the thread count.
+   */
+  uint32_t GetThreadCount() const {
+    return static_cast<uint32_t>(threads.size()) + 1;
+  }
+
+  /**
+   * Run fn over the range [0, count) split into chunks of at least grain
+   * elements. fn is called as fn(begin, end) from the caller and the
+   * worker threads. Returns when all chunks are done.
+   * @param  count  Number of elements.
+   * @param  grain  Minimum number of elements per chunk.
+   * @param  fn     Loop body.
+   */
+  void ParallelFor(const size_t count, const size_t grain,
+                   const std::function<void(size_t, size_t)>& fn) {
+    if (count == 0)
+      return;
+
+    // Small loops, no workers, or a loop already running - run serially
+    bool expected = false;
+    if (count <= grain || threads.empty() ||
+        !running.compare_exchange_strong(expected, true)) {
+      fn(0, count);
+      return;
+    }
+
+    // Use a few chunks per thread so uneven chunks balance out
+    size_t chunk = count / (GetThreadCount() * 4);
+    if (chunk < grain)
+      chunk = grain;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      job = &fn;
+      job_count = count;
+      job_chunk = chunk;
+      next = 0;
+      active = static_cast<uint32_t>(threads.size());
+      generation++;
+    }
+    wake.notify_all();
+
+    // The calling thread works too
+    RunChunks();
+
+    // Wait for the workers to finish
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (active > 0)
+        done.wait(lock);
+      job = nullptr;
+    }
+    running = false;
+  }
+
+protected:
+  std::vector<std::thread> threads;
+  std::mutex               mutex;
+  std::condition_variable  wake;        // Signals workers a loop is ready
+  std::condition_variable  done;        // Signals the caller workers are done
+  std::atomic<bool>        running;     // A loop is in progress
+  std::atomic<size_t>      next;        // Next element to claim
+  const std::function<void(size_t, size_t)>* job;
+  size_t                   job_count;
+  size_t                   job_chunk;
+  uint32_t                 active;      // Workers still running the loop
+  uint32_t                 generation;  // Incremented for each loop
+
+  /**
+   * Constructor. Creates one worker per hardware thread less the caller.
+   */
+  ThreadPool()
+      : job(nullptr),
+        job_count(0),
+        job_chunk(0),
+        active(0),
+        generation(0) {
+    running = false;
+    next = 0;
+    uint32_t n = std::thread::hardware_concurrency();
+    for (uint32_t i = 1; i < n; i++) {
+      threads.push_back(std::thread(&ThreadPool::Worker, this));
+    }
+  }
+
+  // Claim and run chunks until the loop is exhausted
+  void RunChunks() {
+    for (;;) {
+      size_t begin = next.fetch_add(job_chunk);
+      if (begin >= job_count)
+        break;
+      size_t end = begin + job_chunk;
+      (*job)(begin, (end < job_count) ? end : job_count);
+    }
+  }
+
+  // Worker thread. Sleeps until a loop is issued, helps run it, then
+  // signals the caller.
+  void Worker() {
+    uint32_t seen = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (generation == seen)
+          wake.wait(lock);
+        seen = generation;
+      }
+
+      RunChunks();
+
+      std::unique_lock<std::mutex> lock(mutex);
+      if (--active == 0)
+        done.notify_one();
+    }
+  }
+};
+
+/**
+ * Run fn(begin, end) over [0, count) using the thread pool.
+ * @param  count  Number of elements.
+ * @param  grain  Minimum number of elements per chunk.
+ * @param  fn     Loop body.
+ */
+inline void ParallelFor(const size_t count, const size_t grain,
+                        const std::function<void(size_t, size_t)>& fn) {
+  ThreadPool::Get().ParallelFor(count, grain, fn);
+}
+
+#endif
@@ -13,6 +13,7 @@
 #ifndef __RAY_H__
 #define __RAY_H__
 
+#include <float.h>
 #include <math.h>
 #include <vector>
 
@@ -108,8 +109,14 @@ struct Ray3 {
    *          0.0f if no intersection occurs.
    */
   float Intersect(const Plane& p) const {
-    // Required in 605.767
-    return 0.0f; 
+    // Parallel to the plane (or in it) - no single intersection
+    float nd = p.a * d.x + p.b * d.y + p.c * d.z;
+    if (fabs(nd) < kEpsilon)
+      return 0.0f;
+
+    // Plane is behind the ray origin
+    float t = -p.Solve(o) / nd;
+    return (t > 0.0f) ? t : 0.0f;
   }
 
   /**
@@ -161,8 +168,36 @@ struct Ray3 {
    *          0.0f if no intersection occurs.
    */
   float Intersect(const AABB& box) const {
-    // Required in 605.767
-    return 0.0f; 
+    if (box.IsEmpty())
+      return 0.0f;
+
+    // Slab test: intersect the ray with the pair of planes bounding each
+    // axis and keep the overlap of the 3 intervals. The inverse direction
+    // turns the divides into multiplies (a zero component gives +/- infinity,
+    // so the slab either contains the ray or misses it).
+    const float inv[3] = { 1.0f / d.x, 1.0f / d.y, 1.0f / d.z };
+    const float origin[3] = { o.x, o.y, o.z };
+    const float lo[3] = { box.m_minPt.x, box.m_minPt.y, box.m_minPt.z };
+    const float hi[3] = { box.m_maxPt.x, box.m_maxPt.y, box.m_maxPt.z };
+    float t_near = -FLT_MAX;
+    float t_far = FLT_MAX;
+    for (int k = 0; k < 3; k++) {
+      float t0 = (lo[k] - origin[k]) * inv[k];
+      float t1 = (hi[k] - origin[k]) * inv[k];
+      if (t0 > t1) {
+        float tmp = t0;
+        t0 = t1;
+        t1 = tmp;
+      }
+      // Written so a NaN (origin on a slab of a parallel ray) is ignored
+      t_near = (t0 > t_near) ? t0 : t_near;
+      t_far = (t1 < t_far) ? t1 : t_far;
+    }
+    if (t_near > t_far || t_far <= 0.0f)
+      return 0.0f;
+
+    // Ray origin inside the box - the intersection is where it leaves
+    return (t_near > 0.0f) ? t_near : t_far;
   }
 
   /**
@@ -173,8 +208,14 @@ struct Ray3 {
    *          0.0f if no intersection occurs.
    */
   float Intersect(std::vector<Point3>& polygon, Vector3& normal) const {
-    // Required in 605.767
-    return 0.0f;
+    if (polygon.size() < 3)
+      return 0.0f;
+
+    // Intersect the plane of the polygon then test if the point is inside
+    float t = Intersect(Plane(polygon[0], normal));
+    if (t == 0.0f)
+      return 0.0f;
+    return Intersect(t).IsInPolygon(polygon, normal) ? t : 0.0f;
   }
 
   /**
@@ -189,8 +230,25 @@ struct Ray3 {
    */
   float Intersect(const Point3& v0, const Point3& v1, const Point3& v2,
                   float& u, float& v) const {
-    // Required in 605.767
-    return 0.0f;
+    // Moller-Trumbore: solve o + t d = (1 - u - v) v0 + u v1 + v v2 with
+    // Cramer's rule, rejecting early on the barycentric coordinates
+    Vector3 e1 = v1 - v0;
+    Vector3 e2 = v2 - v0;
+    Vector3 p = d.Cross(e2);
+    float det = e1.Dot(p);
+    if (fabs(det) < kEpsilon * kEpsilon)
+      return 0.0f;       // Ray is parallel to the triangle
+    float inv_det = 1.0f / det;
+    Vector3 s = o - v0;
+    u = s.Dot(p) * inv_det;
+    if (u < 0.0f || u > 1.0f)
+      return 0.0f;
+    Vector3 q = s.Cross(e1);
+    v = d.Dot(q) * inv_det;
+    if (v < 0.0f || u + v > 1.0f)
+      return 0.0f;
+    float t = e2.Dot(q) * inv_det;
+    return (t > 0.0f) ? t : 0.0f;
   }
 };
 
@@ -0,0 +1,513 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    ray_simd.h
+//	Purpose: Packet ray intersection kernels: one ray against a packet of
+//           boxes or triangles, and a packet of rays against one box or
+//           triangle. Packets are kRayPacketSize wide (8 with AVX, 4
+//           otherwise). The scalar versions are the reference the SIMD
+//           versions must match.
+//
+//============================================================================
+
+#ifndef __RAY_SIMD_H__
+#define __RAY_SIMD_H__
+
+#include <float.h>
+#include "geometry/matrix_simd.h"
+
+// Lanes in a packet
+#if defined(GEOMETRY_USE_AVX)
+const uint32_t kRayPacketSize = 8;
+#else
+const uint32_t kRayPacketSize = 4;
+#endif
+
+// Mask with a bit set for every lane
+const uint32_t kRayPacketMask = (1u << kRayPacketSize) - 1;
+
+// Triangles with |det| below this are parallel to the ray (same threshold
+// as Ray3::Intersect)
+const float kRayParallelDet = 0.000001f * 0.000001f;
+
+/**
+ * Boxes tested against one ray (SoA). Unused lanes should be empty boxes
+ * (min > max), see Clear.
+ */
+struct BoxPacket {
+  float min_x[kRayPacketSize];
+  float min_y[kRayPacketSize];
+  float min_z[kRayPacketSize];
+  float max_x[kRayPacketSize];
+  float max_y[kRayPacketSize];
+  float max_z[kRayPacketSize];
+
+  /**
+   * Make every lane an empty box.
+   */
+  void Clear() {
+    for (uint32_t i = 0; i < kRayPacketSize; i++) {
+      min_x[i] = min_y[i] = min_z[i] = FLT_MAX;
+      max_x[i] = max_y[i] = max_z[i] = -FLT_MAX;
+    }
+  }
+
+  /**
+   * Set one lane.
+   * @param  i    Lane.
+   * @param  box  Box.
+   */
+  void Set(const uint32_t i, const AABB& box) {
+    min_x[i] = box.m_minPt.x;
+    min_y[i] = box.m_minPt.y;
+    min_z[i] = box.m_minPt.z;
+    max_x[i] = box.m_maxPt.x;
+    max_y[i] = box.m_maxPt.y;
+    max_z[i] = box.m_maxPt.z;
+  }
+};
+
+/**
+ * Triangles tested against one ray (SoA): first vertex and the edges to
+ * the other 2. Unused lanes should be degenerate (zero edges), see Clear.
+ */
+struct TrianglePacket {
+  float v0_x[kRayPacketSize];
+  float v0_y[kRayPacketSize];
+  float v0_z[kRayPacketSize];
+  float e1_x[kRayPacketSize];
+  float e1_y[kRayPacketSize];
+  float e1_z[kRayPacketSize];
+  float e2_x[kRayPacketSize];
+  float e2_y[kRayPacketSize];
+  float e2_z[kRayPacketSize];
+
+  /**
+   * Make every lane a degenerate triangle (never hit).
+   */
+  void Clear() {
+    for (uint32_t i = 0; i < kRayPacketSize; i++) {
+      v0_x[i] = v0_y[i] = v0_z[i] = 0.0f;
+      e1_x[i] = e1_y[i] = e1_z[i] = 0.0f;
+      e2_x[i] = e2_y[i] = e2_z[i] = 0.0f;
+    }
+  }
+
+  /**
+   * Set one lane.
+   * @param  i   Lane.
+   * @param  v0  Vertex of the triangle.
+   * @param  v1  Vertex of the triangle.
+   * @param  v2  Vertex of the triangle.
+   */
+  void Set(const uint32_t i, const Point3& v0, const Point3& v1, const Point3& v2) {
+    v0_x[i] = v0.x;
+    v0_y[i] = v0.y;
+    v0_z[i] = v0.z;
+    e1_x[i] = v1.x - v0.x;
+    e1_y[i] = v1.y - v0.y;
+    e1_z[i] = v1.z - v0.z;
+    e2_x[i] = v2.x - v0.x;
+    e2_y[i] = v2.y - v0.y;
+    e2_z[i] = v2.z - v0.z;
+  }
+};
+
+/**
+ * Rays tested together (SoA): origin, direction and inverse direction.
+ * Directions need not be unit length.
+ */
+struct RayPacket {
+  float o_x[kRayPacketSize];
+  float o_y[kRayPacketSize];
+  float o_z[kRayPacketSize];
+  float d_x[kRayPacketSize];
+  float d_y[kRayPacketSize];
+  float d_z[kRayPacketSize];
+  float inv_x[kRayPacketSize];
+  float inv_y[kRayPacketSize];
+  float inv_z[kRayPacketSize];
+
+  /**
+   * Set one lane.
+   * @param  i    Lane.
+   * @param  ray  Ray.
+   */
+  void Set(const uint32_t i, const Ray3& ray) {
+    o_x[i] = ray.o.x;
+    o_y[i] = ray.o.y;
+    o_z[i] = ray.o.z;
+    d_x[i] = ray.d.x;
+    d_y[i] = ray.d.y;
+    d_z[i] = ray.d.z;
+    SetInverse(i);
+  }
+
+  /**
+   * Compute the inverse direction of a lane (after setting d).
+   * @param  i  Lane.
+   */
+  void SetInverse(const uint32_t i) {
+    inv_x[i] = 1.0f / d_x[i];
+    inv_y[i] = 1.0f / d_y[i];
+    inv_z[i] = 1.0f / d_z[i];
+  }
+};
+
+//----------------------------------------------------------------------------
+// Scalar (reference) kernels. The slab tests are written so a NaN (ray
+// origin on a slab of a ray parallel to it) leaves the interval unchanged.
+//----------------------------------------------------------------------------
+
+/**
+ * Slab test of one ray against one box.
+ * @param  o      Ray origin (3 floats).
+ * @param  inv_d  Inverse ray direction (3 floats).
+ * @param  lo     Box min (3 floats).
+ * @param  hi     Box max (3 floats).
+ * @param  t_max  Farthest t of interest.
+ * @param  t      (OUT) Entry t (clamped to 0).
+ * @return  Returns true if the ray enters the box at t in [0, t_max].
+ */
+inline bool RayBoxScalar(const float* o, const float* inv_d, const float* lo, const float* hi,
+                         const float t_max, float& t) {
+  float t0 = 0.0f;
+  float t1 = t_max;
+  for (int k = 0; k < 3; k++) {
+    float a = (lo[k] - o[k]) * inv_d[k];
+    float b = (hi[k] - o[k]) * inv_d[k];
+    float near_k = (a < b) ? a : b;
+    float far_k = (a < b) ? b : a;
+    t0 = (near_k > t0) ? near_k : t0;
+    t1 = (far_k < t1) ? far_k : t1;
+  }
+  t = t0;
+  return t0 <= t1;
+}
+
+/**
+ * Moller-Trumbore test of one ray against one triangle.
+ * @param  o   Ray origin (3 floats).
+ * @param  d   Ray direction (3 floats).
+ * @param  v0  First vertex (3 floats).
+ * @param  e1  Edge v1 - v0 (3 floats).
+ * @param  e2  Edge v2 - v0 (3 floats).
+ * @param  t   (IN/OUT) Nearest t so far. Lowered on a hit.
+ * @param  u   (OUT) Barycentric coordinate (weight of v1), set on a hit.
+ * @param  v   (OUT) Barycentric coordinate (weight of v2), set on a hit.
+ * @return  Returns true if the ray hits the triangle at 0 < t' < t.
+ */
+inline bool RayTriangleScalar(const float* o, const float* d, const float* v0, const float* e1,
+                              const float* e2, float& t, float& u, float& v) {
+  float px = d[1] * e2[2] - d[2] * e2[1];
+  float py = d[2] * e2[0] - d[0] * e2[2];
+  float pz = d[0] * e2[1] - d[1] * e2[0];
+  float det = e1[0] * px + e1[1] * py + e1[2] * pz;
+  if (!(det > kRayParallelDet || det < -kRayParallelDet))
+    return false;
+  float inv_det = 1.0f / det;
+  float sx = o[0] - v0[0];
+  float sy = o[1] - v0[1];
+  float sz = o[2] - v0[2];
+  float b1 = (sx * px + sy * py + sz * pz) * inv_det;
+  float qx = sy * e1[2] - sz * e1[1];
+  float qy = sz * e1[0] - sx * e1[2];
+  float qz = sx * e1[1] - sy * e1[0];
+  float b2 = (d[0] * qx + d[1] * qy + d[2] * qz) * inv_det;
+  float hit_t = (e2[0] * qx + e2[1] * qy + e2[2] * qz) * inv_det;
+  if (!(b1 >= 0.0f && b2 >= 0.0f && b1 + b2 <= 1.0f && hit_t > 0.0f && hit_t < t))
+    return false;
+  t = hit_t;
+  u = b1;
+  v = b2;
+  return true;
+}
+
+/**
+ * One ray against a packet of boxes (scalar reference).
+ * @param  o       Ray origin (3 floats).
+ * @param  inv_d   Inverse ray direction (3 floats).
+ * @param  boxes   Boxes.
+ * @param  t_max   Farthest t of interest.
+ * @param  t_near  (OUT) Entry t of each lane (valid where the mask bit is set).
+ * @return  Returns a mask of the boxes the ray enters.
+ */
+inline uint32_t RayBoxesScalar(const float* o, const float* inv_d, const BoxPacket& boxes,
+                               const float t_max, float* t_near) {
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < kRayPacketSize; i++) {
+    const float lo[3] = { boxes.min_x[i], boxes.min_y[i], boxes.min_z[i] };
+    const float hi[3] = { boxes.max_x[i], boxes.max_y[i], boxes.max_z[i] };
+    if (RayBoxScalar(o, inv_d, lo, hi, t_max, t_near[i]))
+      mask |= 1u << i;
+  }
+  return mask;
+}
+
+/**
+ * One ray against a packet of triangles (scalar reference).
+ * @param  o      Ray origin (3 floats).
+ * @param  d      Ray direction (3 floats).
+ * @param  tris   Triangles.
+ * @param  t_max  Farthest t of interest.
+ * @param  t      (OUT) t of each lane (valid where the mask bit is set).
+ * @param  u      (OUT) Barycentric coordinate of each lane.
+ * @param  v      (OUT) Barycentric coordinate of each lane.
+ * @return  Returns a mask of the triangles hit at 0 < t < t_max.
+ */
+inline uint32_t RayTrianglesScalar(const float* o, const float* d, const TrianglePacket& tris,
+                                   const float t_max, float* t, float* u, float* v) {
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < kRayPacketSize; i++) {
+    const float v0[3] = { tris.v0_x[i], tris.v0_y[i], tris.v0_z[i] };
+    const float e1[3] = { tris.e1_x[i], tris.e1_y[i], tris.e1_z[i] };
+    const float e2[3] = { tris.e2_x[i], tris.e2_y[i], tris.e2_z[i] };
+    t[i] = t_max;
+    if (RayTriangleScalar(o, d, v0, e1, e2, t[i], u[i], v[i]))
+      mask |= 1u << i;
+  }
+  return mask;
+}
+
+/**
+ * A packet of rays against one box (scalar reference).
+ * @param  rays   Rays.
+ * @param  lo     Box min (3 floats).
+ * @param  hi     Box max (3 floats).
+ * @param  t_max  Farthest t of interest for each ray.
+ * @return  Returns a mask of the rays that enter the box.
+ */
+inline uint32_t PacketBoxScalar(const RayPacket& rays, const float* lo, const float* hi,
+                                const float* t_max) {
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < kRayPacketSize; i++) {
+    const float o[3] = { rays.o_x[i], rays.o_y[i], rays.o_z[i] };
+    const float inv_d[3] = { rays.inv_x[i], rays.inv_y[i], rays.inv_z[i] };
+    float t;
+    if (RayBoxScalar(o, inv_d, lo, hi, t_max[i], t))
+      mask |= 1u << i;
+  }
+  return mask;
+}
+
+/**
+ * A packet of rays against one triangle (scalar reference).
+ * @param  rays  Rays.
+ * @param  v0    First vertex (3 floats).
+ * @param  e1    Edge v1 - v0 (3 floats).
+ * @param  e2    Edge v2 - v0 (3 floats).
+ * @param  t     (IN/OUT) Nearest t so far for each ray. Lowered on a hit.
+ * @param  u     (OUT) Barycentric coordinate, set for rays that hit.
+ * @param  v     (OUT) Barycentric coordinate, set for rays that hit.
+ * @return  Returns a mask of the rays that hit the triangle nearer than t.
+ */
+inline uint32_t PacketTriangleScalar(const RayPacket& rays, const float* v0, const float* e1,
+                                     const float* e2, float* t, float* u, float* v) {
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < kRayPacketSize; i++) {
+    const float o[3] = { rays.o_x[i], rays.o_y[i], rays.o_z[i] };
+    const float d[3] = { rays.d_x[i], rays.d_y[i], rays.d_z[i] };
+    if (RayTriangleScalar(o, d, v0, e1, e2, t[i], u[i], v[i]))
+      mask |= 1u << i;
+  }
+  return mask;
+}
+
+//----------------------------------------------------------------------------
+// SIMD kernels. The lane width and intrinsics are selected with the
+// instruction set; the arithmetic is the same as the scalar kernels.
+//----------------------------------------------------------------------------
+
+#if defined(GEOMETRY_USE_SSE)
+
+#if defined(GEOMETRY_USE_AVX)
+typedef __m256 RayLanes;
+inline RayLanes RayLoad(const float* p)            { return _mm256_loadu_ps(p); }
+inline void     RayStore(float* p, RayLanes a)     { _mm256_storeu_ps(p, a); }
+inline RayLanes RaySet1(const float a)             { return _mm256_set1_ps(a); }
+inline RayLanes RayAdd(RayLanes a, RayLanes b)     { return _mm256_add_ps(a, b); }
+inline RayLanes RaySub(RayLanes a, RayLanes b)     { return _mm256_sub_ps(a, b); }
+inline RayLanes RayMul(RayLanes a, RayLanes b)     { return _mm256_mul_ps(a, b); }
+inline RayLanes RayDiv(RayLanes a, RayLanes b)     { return _mm256_div_ps(a, b); }
+inline RayLanes RayMin(RayLanes a, RayLanes b)     { return _mm256_min_ps(a, b); }
+inline RayLanes RayMax(RayLanes a, RayLanes b)     { return _mm256_max_ps(a, b); }
+inline RayLanes RayAnd(RayLanes a, RayLanes b)     { return _mm256_and_ps(a, b); }
+inline RayLanes RayOr(RayLanes a, RayLanes b)      { return _mm256_or_ps(a, b); }
+inline RayLanes RayLess(RayLanes a, RayLanes b)    { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline RayLanes RayLessEq(RayLanes a, RayLanes b)  { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+inline RayLanes RayGreater(RayLanes a, RayLanes b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+inline RayLanes RayGreaterEq(RayLanes a, RayLanes b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+inline RayLanes RaySelect(RayLanes m, RayLanes a, RayLanes b) { return _mm256_blendv_ps(b, a, m); }
+inline uint32_t RayMask(RayLanes m)                { return static_cast<uint32_t>(_mm256_movemask_ps(m)); }
+#else
+typedef __m128 RayLanes;
+inline RayLanes RayLoad(const float* p)            { return _mm_loadu_ps(p); }
+inline void     RayStore(float* p, RayLanes a)     { _mm_storeu_ps(p, a); }
+inline RayLanes RaySet1(const float a)             { return _mm_set1_ps(a); }
+inline RayLanes RayAdd(RayLanes a, RayLanes b)     { return _mm_add_ps(a, b); }
+inline RayLanes RaySub(RayLanes a, RayLanes b)     { return _mm_sub_ps(a, b); }
+inline RayLanes RayMul(RayLanes a, RayLanes b)     { return _mm_mul_ps(a, b); }
+inline RayLanes RayDiv(RayLanes a, RayLanes b)     { return _mm_div_ps(a, b); }
+inline RayLanes RayMin(RayLanes a, RayLanes b)     { return _mm_min_ps(a, b); }
+inline RayLanes RayMax(RayLanes a, RayLanes b)     { return _mm_max_ps(a, b); }
+inline RayLanes RayAnd(RayLanes a, RayLanes b)     { return _mm_and_ps(a, b); }
+inline RayLanes RayOr(RayLanes a, RayLanes b)      { return _mm_or_ps(a, b); }
+inline RayLanes RayLess(RayLanes a, RayLanes b)    { return _mm_cmplt_ps(a, b); }
+inline RayLanes RayLessEq(RayLanes a, RayLanes b)  { return _mm_cmple_ps(a, b); }
+inline RayLanes RayGreater(RayLanes a, RayLanes b) { return _mm_cmpgt_ps(a, b); }
+inline RayLanes RayGreaterEq(RayLanes a, RayLanes b) { return _mm_cmpge_ps(a, b); }
+inline RayLanes RaySelect(RayLanes m, RayLanes a, RayLanes b) {
+  return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+inline uint32_t RayMask(RayLanes m)                { return static_cast<uint32_t>(_mm_movemask_ps(m)); }
+#endif
+
+// Slab test on lanes. Min/max take the second operand when either is NaN
+// (x86 semantics), which keeps t0/t1 as in the scalar kernel.
+inline RayLanes RaySlabs(RayLanes ox, RayLanes oy, RayLanes oz, RayLanes ix, RayLanes iy,
+                         RayLanes iz, RayLanes lo_x, RayLanes lo_y, RayLanes lo_z,
+                         RayLanes hi_x, RayLanes hi_y, RayLanes hi_z, RayLanes t_max,
+                         RayLanes& t_near) {
+  RayLanes t0 = RaySet1(0.0f);
+  RayLanes t1 = t_max;
+  RayLanes a = RayMul(RaySub(lo_x, ox), ix);
+  RayLanes b = RayMul(RaySub(hi_x, ox), ix);
+  t0 = RayMax(RaySelect(RayLess(a, b), a, b), t0);
+  t1 = RayMin(RaySelect(RayLess(a, b), b, a), t1);
+  a = RayMul(RaySub(lo_y, oy), iy);
+  b = RayMul(RaySub(hi_y, oy), iy);
+  t0 = RayMax(RaySelect(RayLess(a, b), a, b), t0);
+  t1 = RayMin(RaySelect(RayLess(a, b), b, a), t1);
+  a = RayMul(RaySub(lo_z, oz), iz);
+  b = RayMul(RaySub(hi_z, oz), iz);
+  t0 = RayMax(RaySelect(RayLess(a, b), a, b), t0);
+  t1 = RayMin(RaySelect(RayLess(a, b), b, a), t1);
+  t_near = t0;
+  return RayLessEq(t0, t1);
+}
+
+// Moller-Trumbore on lanes. Returns the hit mask and the t, u, v of every
+// lane (meaningful where the mask is set).
+inline RayLanes RayTriangleLanes(RayLanes ox, RayLanes oy, RayLanes oz, RayLanes dx, RayLanes dy,
+                                 RayLanes dz, RayLanes v0x, RayLanes v0y, RayLanes v0z,
+                                 RayLanes e1x, RayLanes e1y, RayLanes e1z, RayLanes e2x,
+                                 RayLanes e2y, RayLanes e2z, RayLanes t_max, RayLanes& t,
+                                 RayLanes& u, RayLanes& v) {
+  const RayLanes zero = RaySet1(0.0f);
+  RayLanes px = RaySub(RayMul(dy, e2z), RayMul(dz, e2y));
+  RayLanes py = RaySub(RayMul(dz, e2x), RayMul(dx, e2z));
+  RayLanes pz = RaySub(RayMul(dx, e2y), RayMul(dy, e2x));
+  RayLanes det = RayAdd(RayAdd(RayMul(e1x, px), RayMul(e1y, py)), RayMul(e1z, pz));
+  RayLanes mask = RayOr(RayGreater(det, RaySet1(kRayParallelDet)),
+                        RayLess(det, RaySet1(-kRayParallelDet)));
+  RayLanes inv_det = RayDiv(RaySet1(1.0f), det);
+  RayLanes sx = RaySub(ox, v0x);
+  RayLanes sy = RaySub(oy, v0y);
+  RayLanes sz = RaySub(oz, v0z);
+  u = RayMul(RayAdd(RayAdd(RayMul(sx, px), RayMul(sy, py)), RayMul(sz, pz)), inv_det);
+  RayLanes qx = RaySub(RayMul(sy, e1z), RayMul(sz, e1y));
+  RayLanes qy = RaySub(RayMul(sz, e1x), RayMul(sx, e1z));
+  RayLanes qz = RaySub(RayMul(sx, e1y), RayMul(sy, e1x));
+  v = RayMul(RayAdd(RayAdd(RayMul(dx, qx), RayMul(dy, qy)), RayMul(dz, qz)), inv_det);
+  t = RayMul(RayAdd(RayAdd(RayMul(e2x, qx), RayMul(e2y, qy)), RayMul(e2z, qz)), inv_det);
+  mask = RayAnd(mask, RayGreaterEq(u, zero));
+  mask = RayAnd(mask, RayGreaterEq(v, zero));
+  mask = RayAnd(mask, RayLessEq(RayAdd(u, v), RaySet1(1.0f)));
+  mask = RayAnd(mask, RayGreater(t, zero));
+  return RayAnd(mask, RayLess(t, t_max));
+}
+
+/**
+ * One ray against a packet of boxes. See RayBoxesScalar.
+ */
+inline uint32_t RayBoxes(const float* o, const float* inv_d, const BoxPacket& boxes,
+                         const float t_max, float* t_near) {
+  RayLanes t;
+  RayLanes hit = RaySlabs(RaySet1(o[0]), RaySet1(o[1]), RaySet1(o[2]), RaySet1(inv_d[0]),
+                          RaySet1(inv_d[1]), RaySet1(inv_d[2]), RayLoad(boxes.min_x),
+                          RayLoad(boxes.min_y), RayLoad(boxes.min_z), RayLoad(boxes.max_x),
+                          RayLoad(boxes.max_y), RayLoad(boxes.max_z), RaySet1(t_max), t);
+  RayStore(t_near, t);
+  return RayMask(hit);
+}
+
+/**
+ * One ray against a packet of triangles. See RayTrianglesScalar.
+ */
+inline uint32_t RayTriangles(const float* o, const float* d, const TrianglePacket& tris,
+                             const float t_max, float* t, float* u, float* v) {
+  RayLanes lt, lu, lv;
+  RayLanes tm = RaySet1(t_max);
+  RayLanes hit = RayTriangleLanes(RaySet1(o[0]), RaySet1(o[1]), RaySet1(o[2]), RaySet1(d[0]),
+                                  RaySet1(d[1]), RaySet1(d[2]), RayLoad(tris.v0_x),
+                                  RayLoad(tris.v0_y), RayLoad(tris.v0_z), RayLoad(tris.e1_x),
+                                  RayLoad(tris.e1_y), RayLoad(tris.e1_z), RayLoad(tris.e2_x),
+                                  RayLoad(tris.e2_y), RayLoad(tris.e2_z), tm, lt, lu, lv);
+  RayStore(t, RaySelect(hit, lt, tm));
+  RayStore(u, lu);
+  RayStore(v, lv);
+  return RayMask(hit);
+}
+
+/**
+ * A packet of rays against one box. See PacketBoxScalar.
+ */
+inline uint32_t PacketBox(const RayPacket& rays, const float* lo, const float* hi,
+                          const float* t_max) {
+  RayLanes t;
+  RayLanes hit = RaySlabs(RayLoad(rays.o_x), RayLoad(rays.o_y), RayLoad(rays.o_z),
+                          RayLoad(rays.inv_x), RayLoad(rays.inv_y), RayLoad(rays.inv_z),
+                          RaySet1(lo[0]), RaySet1(lo[1]), RaySet1(lo[2]), RaySet1(hi[0]),
+                          RaySet1(hi[1]), RaySet1(hi[2]), RayLoad(t_max), t);
+  return RayMask(hit);
+}
+
+/**
+ * A packet of rays against one triangle. See PacketTriangleScalar.
+ */
+inline uint32_t PacketTriangle(const RayPacket& rays, const float* v0, const float* e1,
+                               const float* e2, float* t, float* u, float* v) {
+  RayLanes lt, lu, lv;
+  RayLanes tm = RayLoad(t);
+  RayLanes hit = RayTriangleLanes(RayLoad(rays.o_x), RayLoad(rays.o_y), RayLoad(rays.o_z),
+                                  RayLoad(rays.d_x), RayLoad(rays.d_y), RayLoad(rays.d_z),
+                                  RaySet1(v0[0]), RaySet1(v0[1]), RaySet1(v0[2]),
+                                  RaySet1(e1[0]), RaySet1(e1[1]), RaySet1(e1[2]),
+                                  RaySet1(e2[0]), RaySet1(e2[1]), RaySet1(e2[2]), tm, lt, lu, lv);
+  uint32_t mask = RayMask(hit);
+  if (mask != 0) {
+    RayStore(t, RaySelect(hit, lt, tm));
+    RayStore(u, RaySelect(hit, lu, RayLoad(u)));
+    RayStore(v, RaySelect(hit, lv, RayLoad(v)));
+  }
+  return mask;
+}
+
+#else
+
+inline uint32_t RayBoxes(const float* o, const float* inv_d, const BoxPacket& boxes,
+                         const float t_max, float* t_near) {
+  return RayBoxesScalar(o, inv_d, boxes, t_max, t_near);
+}
+
+inline uint32_t RayTriangles(const float* o, const float* d, const TrianglePacket& tris,
+                             const float t_max, float* t, float* u, float* v) {
+  return RayTrianglesScalar(o, d, tris, t_max, t, u, v);
+}
+
+inline uint32_t PacketBox(const RayPacket& rays, const float* lo, const float* hi,
+                          const float* t_max) {
+  return PacketBoxScalar(rays, lo, hi, t_max);
+}
+
+inline uint32_t PacketTriangle(const RayPacket& rays, const float* v0, const float* e1,
+                               const float* e2, float* t, float* u, float* v) {
+  return PacketTriangleScalar(rays, v0, e1, e2, t, u, v);
+}
+
+#endif
+
+#endif
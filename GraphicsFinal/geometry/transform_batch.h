@@ -0,0 +1,342 @@
+//============================================================================
+//	Johns Hopkins University Engineering for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    transform_batch.h
+//	Purpose: Transform arrays of points, vectors and homogeneous points by
+//          a Matrix4x4. Packed (AoS), strided and SoA inputs are supported.
+//          Loops are SIMD (4 points per iteration) and large arrays are
+//          split across the thread pool.
+//
+//============================================================================
+
+#ifndef __TRANSFORM_BATCH_H__
+#define __TRANSFORM_BATCH_H__
+
+#include "geometry/parallel.h"
+
+// Arrays at least this long are split across the thread pool
+const size_t kBatchParallelThreshold = 65536;
+
+// Minimum number of elements each thread transforms
+const size_t kBatchParallelGrain = 16384;
+
+//----------------------------------------------------------------------------
+// Serial kernels. Each transforms n elements on the calling thread. Point
+// versions assume an affine matrix (bottom row 0 0 0 1) so no divide by w
+// is needed - use TransformHPoints for projective matrices. Vector versions
+// use the upper 3x3 only (no translation). Outputs may alias inputs.
+//----------------------------------------------------------------------------
+
+/**
+ * Transform SoA coordinates. w is 1 for points and 0 for vectors.
+ */
+inline void TransformSoASerial(const float* m, const float w,
+                               const float* x, const float* y, const float* z,
+                               float* ox, float* oy, float* oz, const size_t n) {
+  const float tx = m[12] * w, ty = m[13] * w, tz = m[14] * w;
+  size_t i = 0;
+#if defined(GEOMETRY_USE_AVX)
+  const __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+  const __m256 m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m6 = _mm256_set1_ps(m[6]);
+  const __m256 m8 = _mm256_set1_ps(m[8]), m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]);
+  const __m256 vtx = _mm256_set1_ps(tx), vty = _mm256_set1_ps(ty), vtz = _mm256_set1_ps(tz);
+  for (; i + 8 <= n; i += 8) {
+    const __m256 vx = _mm256_loadu_ps(x + i);
+    const __m256 vy = _mm256_loadu_ps(y + i);
+    const __m256 vz = _mm256_loadu_ps(z + i);
+    _mm256_storeu_ps(ox + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, vx), _mm256_mul_ps(m4, vy)),
+                                           _mm256_add_ps(_mm256_mul_ps(m8, vz), vtx)));
+    _mm256_storeu_ps(oy + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m1, vx), _mm256_mul_ps(m5, vy)),
+                                           _mm256_add_ps(_mm256_mul_ps(m9, vz), vty)));
+    _mm256_storeu_ps(oz + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m2, vx), _mm256_mul_ps(m6, vy)),
+                                           _mm256_add_ps(_mm256_mul_ps(m10, vz), vtz)));
+  }
+#elif defined(GEOMETRY_USE_SSE)
+  const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+  const __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+  const __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+  const __m128 vtx = _mm_set1_ps(tx), vty = _mm_set1_ps(ty), vtz = _mm_set1_ps(tz);
+  for (; i + 4 <= n; i += 4) {
+    const __m128 vx = _mm_loadu_ps(x + i);
+    const __m128 vy = _mm_loadu_ps(y + i);
+    const __m128 vz = _mm_loadu_ps(z + i);
+    _mm_storeu_ps(ox + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, vx), _mm_mul_ps(m4, vy)),
+                                     _mm_add_ps(_mm_mul_ps(m8, vz), vtx)));
+    _mm_storeu_ps(oy + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, vx), _mm_mul_ps(m5, vy)),
+                                     _mm_add_ps(_mm_mul_ps(m9, vz), vty)));
+    _mm_storeu_ps(oz + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, vx), _mm_mul_ps(m6, vy)),
+                                     _mm_add_ps(_mm_mul_ps(m10, vz), vtz)));
+  }
+#endif
+  for (; i < n; i++) {
+    const float px = x[i], py = y[i], pz = z[i];
+    ox[i] = m[0] * px + m[4] * py + m[8] * pz + tx;
+    oy[i] = m[1] * px + m[5] * py + m[9] * pz + ty;
+    oz[i] = m[2] * px + m[6] * py + m[10] * pz + tz;
+  }
+}
+
+/**
+ * Transform strided xyz triples (Point3, Vector3 or the position/normal
+ * within a vertex structure). Strides are in bytes. Packed arrays (stride
+ * of 12 bytes) load 4 triples with 3 loads and convert to SoA in registers.
+ */
+inline void TransformStridedSerial(const float* m, const float w,
+                                   const void* in, const size_t in_stride,
+                                   void* out, const size_t out_stride, const size_t n) {
+  const float tx = m[12] * w, ty = m[13] * w, tz = m[14] * w;
+  const char* src = static_cast<const char*>(in);
+  char* dst = static_cast<char*>(out);
+  size_t i = 0;
+#if defined(GEOMETRY_USE_SSE)
+  const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+  const __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+  const __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+  const __m128 vtx = _mm_set1_ps(tx), vty = _mm_set1_ps(ty), vtz = _mm_set1_ps(tz);
+  const bool packed = (in_stride == 3 * sizeof(float) && out_stride == 3 * sizeof(float));
+  for (; i + 4 <= n; i += 4) {
+    __m128 vx, vy, vz;
+    if (packed) {
+      // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+      const float* p = reinterpret_cast<const float*>(src + i * in_stride);
+      const __m128 a = _mm_loadu_ps(p);
+      const __m128 b = _mm_loadu_ps(p + 4);
+      const __m128 c = _mm_loadu_ps(p + 8);
+      const __m128 r = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));  // x2 y2 x3 y3
+      const __m128 s = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));  // y0 z0 y1 z1
+      vx = _mm_shuffle_ps(a, r, _MM_SHUFFLE(2, 0, 3, 0));
+      vy = _mm_shuffle_ps(s, r, _MM_SHUFFLE(3, 1, 2, 0));
+      vz = _mm_shuffle_ps(s, c, _MM_SHUFFLE(3, 0, 3, 1));
+    }
+    else {
+      const float* p0 = reinterpret_cast<const float*>(src + i * in_stride);
+      const float* p1 = reinterpret_cast<const float*>(src + (i + 1) * in_stride);
+      const float* p2 = reinterpret_cast<const float*>(src + (i + 2) * in_stride);
+      const float* p3 = reinterpret_cast<const float*>(src + (i + 3) * in_stride);
+      vx = _mm_setr_ps(p0[0], p1[0], p2[0], p3[0]);
+      vy = _mm_setr_ps(p0[1], p1[1], p2[1], p3[1]);
+      vz = _mm_setr_ps(p0[2], p1[2], p2[2], p3[2]);
+    }
+
+    const __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, vx), _mm_mul_ps(m4, vy)),
+                                 _mm_add_ps(_mm_mul_ps(m8, vz), vtx));
+    const __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, vx), _mm_mul_ps(m5, vy)),
+                                 _mm_add_ps(_mm_mul_ps(m9, vz), vty));
+    const __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, vx), _mm_mul_ps(m6, vy)),
+                                 _mm_add_ps(_mm_mul_ps(m10, vz), vtz));
+
+    if (packed) {
+      // Back to x0 y0 z0 x1, y1 z1 x2 y2, z2 x3 y3 z3
+      float* p = reinterpret_cast<float*>(dst + i * out_stride);
+      const __m128 xy = _mm_shuffle_ps(rx, ry, _MM_SHUFFLE(1, 0, 1, 0));  // x0 x1 y0 y1
+      const __m128 zx = _mm_shuffle_ps(rz, rx, _MM_SHUFFLE(3, 2, 1, 0));  // z0 z1 x2 x3
+      const __m128 yz = _mm_shuffle_ps(ry, rz, _MM_SHUFFLE(3, 2, 3, 2));  // y2 y3 z2 z3
+      const __m128 k0 = _mm_shuffle_ps(zx, xy, _MM_SHUFFLE(1, 1, 0, 0));  // z0 z0 x1 x1
+      const __m128 k1 = _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(1, 1, 3, 3));  // y1 y1 z1 z1
+      const __m128 k2 = _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(0, 0, 2, 2));  // x2 x2 y2 y2
+      const __m128 k3 = _mm_shuffle_ps(yz, zx, _MM_SHUFFLE(3, 3, 2, 2));  // z2 z2 x3 x3
+      _mm_storeu_ps(p,     _mm_shuffle_ps(xy, k0, _MM_SHUFFLE(2, 0, 2, 0)));
+      _mm_storeu_ps(p + 4, _mm_shuffle_ps(k1, k2, _MM_SHUFFLE(2, 0, 2, 0)));
+      _mm_storeu_ps(p + 8, _mm_shuffle_ps(k3, yz, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    else {
+      float ax[4], ay[4], az[4];
+      _mm_storeu_ps(ax, rx);
+      _mm_storeu_ps(ay, ry);
+      _mm_storeu_ps(az, rz);
+      for (int k = 0; k < 4; k++) {
+        float* p = reinterpret_cast<float*>(dst + (i + k) * out_stride);
+        p[0] = ax[k];
+        p[1] = ay[k];
+        p[2] = az[k];
+      }
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    const float* p = reinterpret_cast<const float*>(src + i * in_stride);
+    const float px = p[0], py = p[1], pz = p[2];
+    float* q = reinterpret_cast<float*>(dst + i * out_stride);
+    q[0] = m[0] * px + m[4] * py + m[8] * pz + tx;
+    q[1] = m[1] * px + m[5] * py + m[9] * pz + ty;
+    q[2] = m[2] * px + m[6] * py + m[10] * pz + tz;
+  }
+}
+
+/**
+ * Transform homogeneous points (full 4x4, no divide).
+ */
+inline void TransformHPointsSerial(const float* m, const HPoint3* in, HPoint3* out,
+                                   const size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    Mat4Transform(m, &in[i].x, &out[i].x);
+  }
+}
+
+//----------------------------------------------------------------------------
+// Public batch API. Arrays of at least kBatchParallelThreshold elements are
+// split across the thread pool. Call from the main thread.
+//----------------------------------------------------------------------------
+
+/**
+ * Transform an array of points (affine matrix).
+ * @param  m    Transformation matrix.
+ * @param  in   Points to transform.
+ * @param  out  Transformed points (may be the same array as in).
+ * @param  n    Number of points.
+ */
+inline void TransformPoints(const Matrix4x4& m, const Point3* in, Point3* out,
+                            const size_t n) {
+  const float* a = m.Get();
+  if (n < kBatchParallelThreshold) {
+    TransformStridedSerial(a, 1.0f, in, sizeof(Point3), out, sizeof(Point3), n);
+    return;
+  }
+  ParallelFor(n, kBatchParallelGrain, [=](size_t begin, size_t end) {
+    TransformStridedSerial(a, 1.0f, in + begin, sizeof(Point3), out + begin,
+                           sizeof(Point3), end - begin);
+  });
+}
+
+/**
+ * Transform an array of vectors (directions - no translation). Normals
+ * must be transformed by the normal matrix.
+ * @param  m    Transformation matrix.
+ * @param  in   Vectors to transform.
+ * @param  out  Transformed vectors (may be the same array as in).
+ * @param  n    Number of vectors.
+ */
+inline void TransformVectors(const Matrix4x4& m, const Vector3* in, Vector3* out,
+                             const size_t n) {
+  const float* a = m.Get();
+  if (n < kBatchParallelThreshold) {
+    TransformStridedSerial(a, 0.0f, in, sizeof(Vector3), out, sizeof(Vector3), n);
+    return;
+  }
+  ParallelFor(n, kBatchParallelGrain, [=](size_t begin, size_t end) {
+    TransformStridedSerial(a, 0.0f, in + begin, sizeof(Vector3), out + begin,
+                           sizeof(Vector3), end - begin);
+  });
+}
+
+/**
+ * Transform an array of homogeneous points by the full 4x4 matrix.
+ * @param  m    Transformation matrix.
+ * @param  in   Homogeneous points to transform.
+ * @param  out  Transformed points (may be the same array as in).
+ * @param  n    Number of points.
+ */
+inline void TransformHPoints(const Matrix4x4& m, const HPoint3* in, HPoint3* out,
+                             const size_t n) {
+  const float* a = m.Get();
+  if (n < kBatchParallelThreshold) {
+    TransformHPointsSerial(a, in, out, n);
+    return;
+  }
+  ParallelFor(n, kBatchParallelGrain, [=](size_t begin, size_t end) {
+    TransformHPointsSerial(a, in + begin, out + begin, end - begin);
+  });
+}
+
+/**
+ * Transform points stored within larger structures (e.g. the vertex member
+ * of VertexAndNormal). Strides are the distance in bytes between
+ * successive points.
+ * @param  m           Transformation matrix (affine).
+ * @param  in          First point to transform.
+ * @param  in_stride   Bytes between input points.
+ * @param  out         First transformed point.
+ * @param  out_stride  Bytes between output points.
+ * @param  n           Number of points.
+ */
+inline void TransformPointsStrided(const Matrix4x4& m, const Point3* in, const size_t in_stride,
+                                   Point3* out, const size_t out_stride, const size_t n) {
+  const float* a = m.Get();
+  if (n < kBatchParallelThreshold) {
+    TransformStridedSerial(a, 1.0f, in, in_stride, out, out_stride, n);
+    return;
+  }
+  const char* src = reinterpret_cast<const char*>(in);
+  char* dst = reinterpret_cast<char*>(out);
+  ParallelFor(n, kBatchParallelGrain, [=](size_t begin, size_t end) {
+    TransformStridedSerial(a, 1.0f, src + begin * in_stride, in_stride,
+                           dst + begin * out_stride, out_stride, end - begin);
+  });
+}
+
+/**
+ * Transform vectors stored within larger structures (no translation).
+ * @param  m           Transformation matrix.
+ * @param  in          First vector to transform.
+ * @param  in_stride   Bytes between input vectors.
+ * @param  out         First transformed vector.
+ * @param  out_stride  Bytes between output vectors.
+ * @param  n           Number of vectors.
+ */
+inline void TransformVectorsStrided(const Matrix4x4& m, const Vector3* in, const size_t in_stride,
+                                    Vector3* out, const size_t out_stride, const size_t n) {
+  const float* a = m.Get();
+  if (n < kBatchParallelThreshold) {
+    TransformStridedSerial(a, 0.0f, in, in_stride, out, out_stride, n);
+    return;
+  }
+  const char* src = reinterpret_cast<const char*>(in);
+  char* dst = reinterpret_cast<char*>(out);
+  ParallelFor(n, kBatchParallelGrain, [=](size_t begin, size_t end) {
+    TransformStridedSerial(a, 0.0f, src + begin * in_stride, in_stride,
+                           dst + begin * out_stride, out_stride, end - begin);
+  });
+}
+
+/**
+ * Transform points stored as separate x, y and z arrays (SoA).
+ * @param  m   Transformation matrix (affine).
+ * @param  x   Input x coordinates.
+ * @param  y   Input y coordinates.
+ * @param  z   Input z coordinates.
+ * @param  ox  Output x coordinates (may be the same array as x).
+ * @param  oy  Output y coordinates (may be the same array as y).
+ * @param  oz  Output z coordinates (may be the same array as z).
+ * @param  n   Number of points.
+ */
+inline void TransformPointsSoA(const Matrix4x4& m, const float* x, const float* y, const float* z,
+                               float* ox, float* oy, float* oz, const size_t n) {
+  const float* a = m.Get();
+  if (n < kBatchParallelThreshold) {
+    TransformSoASerial(a, 1.0f, x, y, z, ox, oy, oz, n);
+    return;
+  }
+  ParallelFor(n, kBatchParallelGrain, [=](size_t begin, size_t end) {
+    TransformSoASerial(a, 1.0f, x + begin, y + begin, z + begin,
+                       ox + begin, oy + begin, oz + begin, end - begin);
+  });
+}
+
+/**
+ * Transform vectors stored as separate x, y and z arrays (no translation).
+ * @param  m   Transformation matrix.
+ * @param  x   Input x components.
+ * @param  y   Input y components.
+ * @param  z   Input z components.
+ * @param  ox  Output x components (may be the same array as x).
+ * @param  oy  Output y components (may be the same array as y).
+ * @param  oz  Output z components (may be the same array as z).
+ * @param  n   Number of vectors.
+ */
+inline void TransformVectorsSoA(const Matrix4x4& m, const float* x, const float* y, const float* z,
+                                float* ox, float* oy, float* oz, const size_t n) {
+  const float* a = m.Get();
+  if (n < kBatchParallelThreshold) {
+    TransformSoASerial(a, 0.0f, x, y, z, ox, oy, oz, n);
+    return;
+  }
+  ParallelFor(n, kBatchParallelGrain, [=](size_t begin, size_t end) {
+    TransformSoASerial(a, 0.0f, x + begin, y + begin, z + begin,
+                       ox + begin, oy + begin, oz + begin, end - begin);
+  });
+}
+
+#endif
@@ -0,0 +1,201 @@
+//============================================================================
+//	Johns Hopkins University Engineering for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    vertex_weld.h
+//	Purpose: Spatial hash of vertex positions used to weld (share) equal
+//          or nearly equal vertices when building meshes.
+//
+//============================================================================
+
+#ifndef __VERTEX_WELD_H__
+#define __VERTEX_WELD_H__
+
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Marks the end of a cell's position list
+const uint32_t kNoWeldVertex = 0xffffffff;
+
+/**
+ * Vertex weld index. Positions are hashed into cubic cells and a lookup
+ * only tests the positions in the cells around the query point, so
+ * welding a mesh of n vertices is O(n) rather than the O(n^2) of a linear
+ * scan.
+ *
+ * With an epsilon of 0 positions must match exactly (same as
+ * Point3::operator==). With epsilon > 0 positions match when each
+ * coordinate differs by at most epsilon. When several positions match,
+ * the one inserted first is returned, so welding gives the same vertex
+ * order as a linear scan.
+ */
+class VertexWeldIndex {
+public:
+  /**
+   * Constructor.
+   * @param  epsilon  Weld tolerance (0 for exact matches).
+   */
+  VertexWeldIndex(const float epsilon = 0.0f) {
+    SetEpsilon(epsilon);
+  }
+
+  /**
+   * Set the weld tolerance. Positions already in the index are rehashed.
+   * @param  epsilon  Weld tolerance (0 for exact matches).
+   */
+  void SetEpsilon(const float epsilon) {
+    this->epsilon = (epsilon > 0.0f) ? epsilon : 0.0f;
+    inv_cell_size = (this->epsilon > 0.0f) ? 1.0f / this->epsilon : 0.0f;
+    Rehash();
+  }
+
+  /**
+   * Get the weld tolerance.
+   * @return  Returns the weld tolerance.
+   */
+  float GetEpsilon() const {
+    return epsilon;
+  }
+
+  /**
+   * Remove all positions.
+   */
+  void Clear() {
+    points.clear();
+    next.clear();
+    cells.clear();
+  }
+
+  /**
+   * Get the number of positions in the index.
+   * @return  Returns the number of positions.
+   */
+  uint32_t Size() const {
+    return static_cast<uint32_t>(points.size());
+  }
+
+  /**
+   * Append a position without checking for a match. Its index is the
+   * prior size of the index.
+   * @param  p  Position.
+   * @return  Returns the index of the position.
+   */
+  uint32_t Insert(const Point3& p) {
+    uint32_t index = static_cast<uint32_t>(points.size());
+    points.push_back(p);
+    next.push_back(kNoWeldVertex);
+    Link(index);
+    return index;
+  }
+
+  /**
+   * Find the first inserted position that matches p.
+   * @param  p      Position to find.
+   * @param  index  Returns the index of the matching position.
+   * @return  Returns true if a matching position was found.
+   */
+  bool Find(const Point3& p, uint32_t& index) const {
+    uint32_t found = kNoWeldVertex;
+    if (epsilon == 0.0f) {
+      FindInCell(ExactKey(p), p, found);
+    }
+    else {
+      // A match can be at most one cell away along each axis
+      int64_t cx = CellCoord(p.x), cy = CellCoord(p.y), cz = CellCoord(p.z);
+      for (int64_t dz = -1; dz <= 1; dz++) {
+        for (int64_t dy = -1; dy <= 1; dy++) {
+          for (int64_t dx = -1; dx <= 1; dx++) {
+            FindInCell(CellKey(cx + dx, cy + dy, cz + dz), p, found);
+          }
+        }
+      }
+    }
+    if (found == kNoWeldVertex)
+      return false;
+    index = found;
+    return true;
+  }
+
+protected:
+  float                                  epsilon;
+  float                                  inv_cell_size;
+  std::vector<Point3>                    points;
+  std::vector<uint32_t>                  next;   // Next position in the same cell
+  std::unordered_map<uint64_t, uint32_t> cells;  // Most recent position in each cell
+
+  // Rebuild the cells (after the cell size changes)
+  void Rehash() {
+    cells.clear();
+    for (uint32_t i = 0; i < points.size(); i++) {
+      next[i] = kNoWeldVertex;
+      Link(i);
+    }
+  }
+
+  // Add a position to the front of its cell's list
+  void Link(const uint32_t index) {
+    const Point3& p = points[index];
+    uint64_t key = (epsilon == 0.0f) ? ExactKey(p) :
+                   CellKey(CellCoord(p.x), CellCoord(p.y), CellCoord(p.z));
+    auto cell = cells.find(key);
+    if (cell == cells.end()) {
+      cells[key] = index;
+    }
+    else {
+      next[index] = cell->second;
+      cell->second = index;
+    }
+  }
+
+  // Test the positions in one cell, keeping the lowest matching index.
+  // Different cells can share a key - that only adds candidates since each
+  // one is tested against p
+  void FindInCell(const uint64_t key, const Point3& p, uint32_t& found) const {
+    auto cell = cells.find(key);
+    if (cell == cells.end())
+      return;
+    for (uint32_t i = cell->second; i != kNoWeldVertex; i = next[i]) {
+      if (i < found && Matches(points[i], p))
+        found = i;
+    }
+  }
+
+  bool Matches(const Point3& a, const Point3& b) const {
+    if (epsilon == 0.0f)
+      return a == b;
+    return std::fabs(a.x - b.x) <= epsilon &&
+           std::fabs(a.y - b.y) <= epsilon &&
+           std::fabs(a.z - b.z) <= epsilon;
+  }
+
+  // Cell coordinate along one axis. Clamped so huge or non-finite values
+  // still give a valid (shared) cell
+  int64_t CellCoord(const float v) const {
+    float c = std::floor(v * inv_cell_size);
+    if (!(c > -1.0e15f))
+      return -1000000000000000LL;
+    if (c > 1.0e15f)
+      return 1000000000000000LL;
+    return static_cast<int64_t>(c);
+  }
+
+  static uint64_t CellKey(const int64_t x, const int64_t y, const int64_t z) {
+    return static_cast<uint64_t>(x) * 73856093ULL ^
+           static_cast<uint64_t>(y) * 19349663ULL ^
+           static_cast<uint64_t>(z) * 83492791ULL;
+  }
+
+  // Key from the coordinate bits. Adding 0 maps -0 to +0 so both hash the
+  // same, as they compare equal
+  static uint64_t ExactKey(const Point3& p) {
+    float v[3] = { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f };
+    uint32_t b[3];
+    std::memcpy(b, v, sizeof(b));
+    return CellKey(b[0], b[1], b[2]);
+  }
+};
+
+#endif
@@ -0,0 +1,407 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    bccompress.h
+//	Purpose: BC1, BC3 and BC5 (S3TC / RGTC) block compression. Does not
+//           use OpenGL so it can be shared with offline tools.
+//
+//============================================================================
+
+#ifndef __BCCOMPRESS_H
+#define __BCCOMPRESS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// Block compressed formats. BC1 holds RGB (4 bits per texel), BC3 adds a
+// separately coded alpha channel (8 bits per texel) and BC5 holds two
+// channels coded like BC3 alpha - used for the x and y of normal maps.
+enum BCFormat { BC_FORMAT_BC1 = 0, BC_FORMAT_BC3, BC_FORMAT_BC5 };
+
+/**
+ * Get the size of a compressed 4x4 block.
+ * @param  format  Compressed format.
+ * @return  Returns the block size in bytes.
+ */
+inline uint32_t BCBlockBytes(const BCFormat format) {
+  return (format == BC_FORMAT_BC1) ? 8 : 16;
+}
+
+/**
+ * Get the size of a compressed image. Partial blocks at the right and top
+ * edges are stored as whole blocks.
+ * @param  format  Compressed format.
+ * @param  width   Image width.
+ * @param  height  Image height.
+ * @return  Returns the size in bytes.
+ */
+inline uint32_t BCImageBytes(const BCFormat format, const int width, const int height) {
+  return static_cast<uint32_t>((width + 3) / 4) * ((height + 3) / 4) * BCBlockBytes(format);
+}
+
+// Pack an RGB color (0-255 floats) to 5:6:5
+inline uint16_t BCPack565(const float* c) {
+  int r = static_cast<int>(c[0] * (31.0f / 255.0f) + 0.5f);
+  int g = static_cast<int>(c[1] * (63.0f / 255.0f) + 0.5f);
+  int b = static_cast<int>(c[2] * (31.0f / 255.0f) + 0.5f);
+  r = (r < 0) ? 0 : ((r > 31) ? 31 : r);
+  g = (g < 0) ? 0 : ((g > 63) ? 63 : g);
+  b = (b < 0) ? 0 : ((b > 31) ? 31 : b);
+  return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+// Expand a 5:6:5 color to 8 bits per channel
+inline void BCUnpack565(const uint16_t c, int* rgb) {
+  int r = (c >> 11) & 31;
+  int g = (c >> 5) & 63;
+  int b = c & 31;
+  rgb[0] = (r << 3) | (r >> 2);
+  rgb[1] = (g << 2) | (g >> 4);
+  rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Choose the nearest of the 4 palette colors for each texel. Returns the
+// packed 2 bit indices and the squared error.
+inline uint32_t BCColorIndices(const unsigned char* rgba, const uint16_t c0, const uint16_t c1,
+                               int& error) {
+  int palette[4][3];
+  BCUnpack565(c0, palette[0]);
+  BCUnpack565(c1, palette[1]);
+  for (int k = 0; k < 3; k++) {
+    palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+    palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+  }
+  uint32_t indices = 0;
+  error = 0;
+  for (int i = 0; i < 16; i++) {
+    const unsigned char* p = rgba + i * 4;
+    int best = 0;
+    int best_d = 0x7fffffff;
+    for (int j = 0; j < 4; j++) {
+      int dr = p[0] - palette[j][0];
+      int dg = p[1] - palette[j][1];
+      int db = p[2] - palette[j][2];
+      int d = dr * dr + dg * dg + db * db;
+      if (d < best_d) {
+        best_d = d;
+        best = j;
+      }
+    }
+    indices |= static_cast<uint32_t>(best) << (i * 2);
+    error += best_d;
+  }
+  return indices;
+}
+
+/**
+ * Compress a 4x4 block of RGBA texels to BC1 (alpha is ignored). Endpoints
+ * are fitted along the principal axis of the block's colors, then refined
+ * once by least squares for the chosen indices (kept if the error drops).
+ * Always uses the 4 color mode, so the block is also valid as the color
+ * half of BC3.
+ * @param  rgba  16 texels, 4 bytes each, row by row.
+ * @param  out   8 byte block (out).
+ */
+inline void EncodeBC1Block(const unsigned char* rgba, unsigned char* out) {
+  // Mean and covariance of the colors
+  float mean[3] = { 0.0f, 0.0f, 0.0f };
+  for (int i = 0; i < 16; i++) {
+    for (int k = 0; k < 3; k++)
+      mean[k] += rgba[i * 4 + k];
+  }
+  for (int k = 0; k < 3; k++)
+    mean[k] *= 1.0f / 16.0f;
+  float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+  for (int i = 0; i < 16; i++) {
+    float r = rgba[i * 4] - mean[0];
+    float g = rgba[i * 4 + 1] - mean[1];
+    float b = rgba[i * 4 + 2] - mean[2];
+    cov[0] += r * r;
+    cov[1] += r * g;
+    cov[2] += r * b;
+    cov[3] += g * g;
+    cov[4] += g * b;
+    cov[5] += b * b;
+  }
+
+  // Principal axis by power iteration
+  float axis[3] = { 1.0f, 1.0f, 1.0f };
+  for (int iter = 0; iter < 8; iter++) {
+    float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+    float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+    float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+    float m = (x > y) ? x : y;
+    m = (m > z) ? m : z;
+    m = (m > -x) ? m : -x;
+    m = (m > -y) ? m : -y;
+    m = (m > -z) ? m : -z;
+    if (m < 1.0e-6f)
+      break;
+    axis[0] = x / m;
+    axis[1] = y / m;
+    axis[2] = z / m;
+  }
+
+  // Endpoints are the extreme colors along the axis
+  float min_d = 1.0e30f;
+  float max_d = -1.0e30f;
+  int min_i = 0;
+  int max_i = 0;
+  for (int i = 0; i < 16; i++) {
+    float d = rgba[i * 4] * axis[0] + rgba[i * 4 + 1] * axis[1] + rgba[i * 4 + 2] * axis[2];
+    if (d < min_d) {
+      min_d = d;
+      min_i = i;
+    }
+    if (d > max_d) {
+      max_d = d;
+      max_i = i;
+    }
+  }
+  float e0[3];
+  float e1[3];
+  for (int k = 0; k < 3; k++) {
+    e0[k] = rgba[max_i * 4 + k];
+    e1[k] = rgba[min_i * 4 + k];
+  }
+  uint16_t c0 = BCPack565(e0);
+  uint16_t c1 = BCPack565(e1);
+
+  // Refine the endpoints by least squares for the chosen indices
+  int error = 0;
+  uint32_t indices = 0;
+  if (c0 != c1) {
+    if (c0 < c1) {
+      uint16_t t = c0;
+      c0 = c1;
+      c1 = t;
+    }
+    indices = BCColorIndices(rgba, c0, c1, error);
+    static const float weight[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+    float aa = 0.0f;
+    float ab = 0.0f;
+    float bb = 0.0f;
+    float ax[3] = { 0.0f, 0.0f, 0.0f };
+    float bx[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++) {
+      float a = weight[(indices >> (i * 2)) & 3];
+      float b = 1.0f - a;
+      aa += a * a;
+      ab += a * b;
+      bb += b * b;
+      for (int k = 0; k < 3; k++) {
+        ax[k] += a * rgba[i * 4 + k];
+        bx[k] += b * rgba[i * 4 + k];
+      }
+    }
+    float det = aa * bb - ab * ab;
+    if (det > 1.0e-6f) {
+      for (int k = 0; k < 3; k++) {
+        e0[k] = (ax[k] * bb - bx[k] * ab) / det;
+        e1[k] = (bx[k] * aa - ax[k] * ab) / det;
+      }
+      uint16_t r0 = BCPack565(e0);
+      uint16_t r1 = BCPack565(e1);
+      if (r0 < r1) {
+        uint16_t t = r0;
+        r0 = r1;
+        r1 = t;
+      }
+      int refined_error;
+      uint32_t refined = (r0 != r1) ? BCColorIndices(rgba, r0, r1, refined_error) : 0;
+      if (r0 != r1 && refined_error < error) {
+        c0 = r0;
+        c1 = r1;
+        indices = refined;
+      }
+    }
+  }
+
+  // Equal endpoints select the 3 color mode - index 0 is the color
+  out[0] = static_cast<unsigned char>(c0 & 0xff);
+  out[1] = static_cast<unsigned char>(c0 >> 8);
+  out[2] = static_cast<unsigned char>(c1 & 0xff);
+  out[3] = static_cast<unsigned char>(c1 >> 8);
+  for (int i = 0; i < 4; i++)
+    out[4 + i] = static_cast<unsigned char>((indices >> (i * 8)) & 0xff);
+}
+
+/**
+ * Compress one channel of a 4x4 block to a BC4 block (the alpha half of
+ * BC3 and each half of BC5). Uses the 8 value mode with the channel's
+ * minimum and maximum as endpoints.
+ * @param  texels  First texel's channel value.
+ * @param  stride  Bytes between texels.
+ * @param  out     8 byte block (out).
+ */
+inline void EncodeBC4Block(const unsigned char* texels, const int stride, unsigned char* out) {
+  int lo = 255;
+  int hi = 0;
+  for (int i = 0; i < 16; i++) {
+    int v = texels[i * stride];
+    lo = (v < lo) ? v : lo;
+    hi = (v > hi) ? v : hi;
+  }
+  out[0] = static_cast<unsigned char>(hi);
+  out[1] = static_cast<unsigned char>(lo);
+
+  uint64_t indices = 0;
+  if (hi != lo) {
+    // Palette index order is hi, lo, then 6 values from hi to lo
+    static const int order[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+    int range = hi - lo;
+    for (int i = 0; i < 16; i++) {
+      int v = texels[i * stride];
+      int step = ((hi - v) * 14 + range) / (2 * range);   // Nearest of 0..7
+      indices |= static_cast<uint64_t>(order[step]) << (i * 3);
+    }
+  }
+  for (int i = 0; i < 6; i++)
+    out[2 + i] = static_cast<unsigned char>((indices >> (i * 8)) & 0xff);
+}
+
+/**
+ * Compress an RGBA image to a block compressed format. Texels past the
+ * right and top edges of partial blocks repeat the edge texels.
+ * @param  format  Compressed format. BC5 stores the red and green channels.
+ * @param  rgba    Image, 4 bytes per texel.
+ * @param  width   Image width.
+ * @param  height  Image height.
+ * @param  row0    First block row to compress.
+ * @param  row1    One past the last block row to compress.
+ * @param  out     Compressed image (BCImageBytes in size).
+ */
+inline void EncodeBCRows(const BCFormat format, const unsigned char* rgba, const int width,
+                         const int height, const int row0, const int row1, unsigned char* out) {
+  int blocks_x = (width + 3) / 4;
+  uint32_t block_bytes = BCBlockBytes(format);
+  unsigned char block[64];
+  for (int by = row0; by < row1; by++) {
+    for (int bx = 0; bx < blocks_x; bx++) {
+      for (int y = 0; y < 4; y++) {
+        int sy = (by * 4 + y < height) ? by * 4 + y : height - 1;
+        for (int x = 0; x < 4; x++) {
+          int sx = (bx * 4 + x < width) ? bx * 4 + x : width - 1;
+          memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+        }
+      }
+      unsigned char* dst = out + (static_cast<size_t>(by) * blocks_x + bx) * block_bytes;
+      switch (format) {
+      case BC_FORMAT_BC1:
+        EncodeBC1Block(block, dst);
+        break;
+      case BC_FORMAT_BC3:
+        EncodeBC4Block(block + 3, 4, dst);
+        EncodeBC1Block(block, dst + 8);
+        break;
+      case BC_FORMAT_BC5:
+        EncodeBC4Block(block, 4, dst);
+        EncodeBC4Block(block + 1, 4, dst + 8);
+        break;
+      }
+    }
+  }
+}
+
+// Decode a BC1 color block to 16 RGBA texels. Blocks with c0 <= c1 use the
+// 3 color mode unless four_color is set (the color half of BC3).
+inline void DecodeBC1Block(const unsigned char* in, unsigned char* rgba, const bool four_color) {
+  uint16_t c0 = static_cast<uint16_t>(in[0] | (in[1] << 8));
+  uint16_t c1 = static_cast<uint16_t>(in[2] | (in[3] << 8));
+  int palette[4][4];
+  BCUnpack565(c0, palette[0]);
+  BCUnpack565(c1, palette[1]);
+  palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+  for (int k = 0; k < 3; k++) {
+    if (four_color || c0 > c1) {
+      palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+      palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+    }
+    else {
+      palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+      palette[3][k] = 0;
+    }
+  }
+  if (!four_color && c0 <= c1)
+    palette[3][3] = 0;
+  uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | (static_cast<uint32_t>(in[7]) << 24);
+  for (int i = 0; i < 16; i++) {
+    int j = (indices >> (i * 2)) & 3;
+    for (int k = 0; k < 4; k++)
+      rgba[i * 4 + k] = static_cast<unsigned char>(palette[j][k]);
+  }
+}
+
+// Decode a BC4 block to one channel of 16 texels
+inline void DecodeBC4Block(const unsigned char* in, unsigned char* texels, const int stride) {
+  int palette[8];
+  palette[0] = in[0];
+  palette[1] = in[1];
+  if (palette[0] > palette[1]) {
+    for (int i = 1; i < 7; i++)
+      palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+  }
+  else {
+    for (int i = 1; i < 5; i++)
+      palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; i++)
+    indices |= static_cast<uint64_t>(in[2 + i]) << (i * 8);
+  for (int i = 0; i < 16; i++)
+    texels[i * stride] = static_cast<unsigned char>(palette[(indices >> (i * 3)) & 7]);
+}
+
+/**
+ * Decode a block compressed image to RGBA (BC5 decodes to red and green,
+ * with blue 0 and alpha 255 as OpenGL returns it). Used to check baked
+ * textures.
+ * @param  format  Compressed format.
+ * @param  in      Compressed image.
+ * @param  width   Image width.
+ * @param  height  Image height.
+ * @param  rgba    Decoded image (out).
+ */
+inline void DecodeBCImage(const BCFormat format, const unsigned char* in, const int width,
+                          const int height, std::vector<unsigned char>& rgba) {
+  rgba.resize(static_cast<size_t>(width) * height * 4);
+  int blocks_x = (width + 3) / 4;
+  int blocks_y = (height + 3) / 4;
+  uint32_t block_bytes = BCBlockBytes(format);
+  unsigned char block[64];
+  for (int by = 0; by < blocks_y; by++) {
+    for (int bx = 0; bx < blocks_x; bx++) {
+      const unsigned char* src = in + (static_cast<size_t>(by) * blocks_x + bx) * block_bytes;
+      switch (format) {
+      case BC_FORMAT_BC1:
+        DecodeBC1Block(src, block, false);
+        break;
+      case BC_FORMAT_BC3:
+        DecodeBC1Block(src + 8, block, true);
+        DecodeBC4Block(src, block + 3, 4);
+        break;
+      case BC_FORMAT_BC5:
+        memset(block, 0, sizeof(block));
+        DecodeBC4Block(src, block, 4);
+        DecodeBC4Block(src + 8, block + 1, 4);
+        for (int i = 0; i < 16; i++)
+          block[i * 4 + 3] = 255;
+        break;
+      }
+      for (int y = 0; y < 4 && by * 4 + y < height; y++) {
+        for (int x = 0; x < 4 && bx * 4 + x < width; x++) {
+          memcpy(&rgba[(static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4],
+                 block + (y * 4 + x) * 4, 4);
+        }
+      }
+    }
+  }
+}
+
+#endif
@@ -38,6 +38,7 @@ public:
     lpt = Point3(0.0f, 0.0f, 0.0f);
     vrp = Point3(0.0f, 0.0f, 1.0f);
     v = Vector3(0.0f, 1.0f, 0.0f);
+    pv_stamp = 0;
   }
 
   /**
@@ -47,13 +48,14 @@ public:
    */
   void Draw(SceneState& scene_state) {
     // Copy the current composite projection and viewing matrix to the scene state
-    scene_state.pv = projection * view;
+    scene_state.pv = pv;
+    scene_state.pv_stamp = pv_stamp;
 
     // Set the shader PVM matrix - this will allow drawing children without a TransformNode
-    glUniformMatrix4fv(scene_state.pvm_loc, 1, GL_FALSE, scene_state.pv.Get());
+    scene_state.gl_state.UniformMatrix4fv(scene_state.pvm_loc, scene_state.pv.Get());
 
     // Set the camera position
-    glUniform3fv(scene_state.cameraposition_loc, 1, &vrp.x);
+    scene_state.gl_state.Uniform3fv(scene_state.cameraposition_loc, &vrp.x);
  
     // Draw children
     SceneNode::Draw(scene_state);
@@ -255,6 +257,38 @@ public:
     return view;
   }
 
+  /**
+   * Gets the near clipping plane distance.
+   * @return  Returns the near plane distance.
+   */
+  float GetNearClip() const {
+    return near_clip;
+  }
+
+  /**
+   * Gets the far clipping plane distance.
+   * @return  Returns the far plane distance.
+   */
+  float GetFarClip() const {
+    return far_clip;
+  }
+
+  /**
+   * Gets the field of view angle y.
+   * @return  Returns the field of view (degrees).
+   */
+  float GetFieldOfView() const {
+    return fov;
+  }
+
+  /**
+   * Gets the aspect ratio.
+   * @return  Returns the aspect ratio (width / height).
+   */
+  float GetAspectRatio() const {
+    return aspect;
+  }
+
   /**
    * Sets a symmetric perspective projection
    * @param  fv  Field of view angle y (degrees)
@@ -300,6 +334,15 @@ public:
     SetPerspective();
   }
 
+  /**
+   * Compile. The camera sets the view for all descendants, so the camera
+   * and its children are drawn by traversal.
+   * @param  list  Render list being built.
+   */
+  void Compile(RenderList& list) {
+    list.AddNode(this);
+  }
+
 private:
   // Perspective projection parameters
   float   fov;          // Field of view in degrees
@@ -318,6 +361,15 @@ private:
   // Matrices
   Matrix4x4 view;	      // Viewing matrix
   Matrix4x4 projection; // Projection matrix
+  Matrix4x4 pv;         // Composite projection and viewing matrix
+  uint32_t  pv_stamp;   // Stamp identifying pv (changes when the camera changes)
+
+  // Update the composite projection and viewing matrix. Called whenever
+  // the view or projection changes
+  void UpdateCompositeMatrix() {
+    pv = projection * view;
+    pv_stamp = SceneState::NewStamp();
+  }
 
   // Sets the view axes
   void LookAt() {
@@ -361,6 +413,7 @@ private:
     projection.m31() = 0.0f;
     projection.m32() = -1.0f;
     projection.m33() = 0.0f;
+    UpdateCompositeMatrix();
   }
 
   // Create viewing transformation matrix by composing the translation 
@@ -386,6 +439,7 @@ private:
     view.m31() = 0.0f;
     view.m32() = 0.0f;
     view.m33() = 1.0f;
+    UpdateCompositeMatrix();
   }
 };
 
@@ -0,0 +1,174 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    ddsfile.h
+//	Purpose: Read and write block compressed, mipmapped textures as DDS
+//           files. Does not use OpenGL so it can be shared with offline
+//           tools.
+//
+//============================================================================
+
+#ifndef __DDSFILE_H
+#define __DDSFILE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "scene/bccompress.h"
+
+// Extension of baked (block compressed) textures
+const char* const kBakedTextureExtension = ".dds";
+
+// Mipmap level of a compressed image
+struct CompressedLevel {
+  int      width;
+  int      height;
+  uint32_t offset;    // Into CompressedImage::data
+  uint32_t size;      // Bytes
+};
+
+// Block compressed image with its mipmap chain. Rows are stored bottom to
+// top (the order OpenGL uploads them in), so baked files appear upside
+// down in DDS viewers.
+struct CompressedImage {
+  BCFormat                     format;
+  std::vector<CompressedLevel> levels;
+  std::vector<unsigned char>   data;
+};
+
+// DDS header (follows the "DDS " magic). Only the fields needed for
+// legacy FourCC block compressed files are used.
+struct DDSHeader {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t height;
+  uint32_t width;
+  uint32_t linear_size;
+  uint32_t depth;
+  uint32_t mipmap_count;
+  uint32_t reserved1[11];
+  uint32_t pf_size;
+  uint32_t pf_flags;
+  uint32_t pf_fourcc;
+  uint32_t pf_bit_count;
+  uint32_t pf_masks[4];
+  uint32_t caps;
+  uint32_t caps2;
+  uint32_t caps3;
+  uint32_t caps4;
+  uint32_t reserved2;
+};
+
+// Make a FourCC code
+inline uint32_t DDSFourCC(const char* s) {
+  return static_cast<uint32_t>(s[0]) | (static_cast<uint32_t>(s[1]) << 8) |
+         (static_cast<uint32_t>(s[2]) << 16) | (static_cast<uint32_t>(s[3]) << 24);
+}
+
+/**
+ * Get the baked texture filename for a texture image (same name with the
+ * .dds extension).
+ * @param  fname  Texture image filename.
+ * @return  Returns the baked texture filename.
+ */
+inline std::string BakedTextureName(const std::string& fname) {
+  size_t dot = fname.rfind('.');
+  size_t slash = fname.find_last_of("/\\");
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    return fname + kBakedTextureExtension;
+  return fname.substr(0, dot) + kBakedTextureExtension;
+}
+
+/**
+ * Write a compressed image as a DDS file (DXT1, DXT5 or ATI2 FourCC).
+ * @param  path   File path.
+ * @param  image  Compressed image.
+ * @return  Returns true if the file was written.
+ */
+inline bool WriteDDS(const std::string& path, const CompressedImage& image) {
+  if (image.levels.empty())
+    return false;
+  DDSHeader h;
+  memset(&h, 0, sizeof(h));
+  h.size = 124;
+  h.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;  // Caps, size, format, mips, linear size
+  h.width = image.levels[0].width;
+  h.height = image.levels[0].height;
+  h.linear_size = image.levels[0].size;
+  h.mipmap_count = static_cast<uint32_t>(image.levels.size());
+  h.pf_size = 32;
+  h.pf_flags = 0x4;                                         // FourCC
+  h.pf_fourcc = DDSFourCC((image.format == BC_FORMAT_BC1) ? "DXT1" :
+                          (image.format == BC_FORMAT_BC3) ? "DXT5" : "ATI2");
+  h.caps = 0x1000 | 0x400000 | 0x8;                         // Texture, mipmap, complex
+
+  FILE* f = fopen(path.c_str(), "wb");
+  if (f == nullptr)
+    return false;
+  bool ok = fwrite("DDS ", 4, 1, f) == 1 && fwrite(&h, sizeof(h), 1, f) == 1 &&
+            fwrite(&image.data[0], 1, image.data.size(), f) == image.data.size();
+  return (fclose(f) == 0) && ok;
+}
+
+/**
+ * Read a DDS file written by WriteDDS (DXT1, DXT5 or ATI2/BC5U FourCC with
+ * a mipmap chain). Thread safe.
+ * @param  path   File path.
+ * @param  image  Compressed image (out).
+ * @return  Returns false if the file does not exist or is not a supported
+ *          DDS file.
+ */
+inline bool ReadDDS(const std::string& path, CompressedImage& image) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == nullptr)
+    return false;
+
+  char magic[4];
+  DDSHeader h;
+  bool ok = fread(magic, 4, 1, f) == 1 && memcmp(magic, "DDS ", 4) == 0 &&
+            fread(&h, sizeof(h), 1, f) == 1 && h.size == 124 && (h.pf_flags & 0x4) != 0 &&
+            h.width > 0 && h.height > 0 && h.width <= 16384 && h.height <= 16384;
+  if (ok) {
+    if (h.pf_fourcc == DDSFourCC("DXT1"))
+      image.format = BC_FORMAT_BC1;
+    else if (h.pf_fourcc == DDSFourCC("DXT5"))
+      image.format = BC_FORMAT_BC3;
+    else if (h.pf_fourcc == DDSFourCC("ATI2") || h.pf_fourcc == DDSFourCC("BC5U"))
+      image.format = BC_FORMAT_BC5;
+    else
+      ok = false;
+  }
+  if (ok) {
+    // Level sizes follow from the base size
+    uint32_t count = (h.mipmap_count > 0) ? h.mipmap_count : 1;
+    int w = static_cast<int>(h.width);
+    int hgt = static_cast<int>(h.height);
+    uint32_t offset = 0;
+    image.levels.clear();
+    for (uint32_t i = 0; i < count && ok; i++) {
+      CompressedLevel level;
+      level.width = w;
+      level.height = hgt;
+      level.offset = offset;
+      level.size = BCImageBytes(image.format, w, hgt);
+      image.levels.push_back(level);
+      offset += level.size;
+      if (w == 1 && hgt == 1)
+        break;
+      w = (w > 1) ? w / 2 : 1;
+      hgt = (hgt > 1) ? hgt / 2 : 1;
+    }
+    image.data.resize(offset);
+    ok = fread(&image.data[0], 1, offset, f) == offset;
+  }
+  fclose(f);
+  if (!ok)
+    printf("Error reading baked texture. %s\n", path.c_str());
+  return ok;
+}
+
+#endif
@@ -23,6 +23,7 @@ public:
   GeometryNode() {
     node_type = SCENE_GEOMETRY;
     reference_count = 0;
+    sphere.m_radius = 0.0f;
   }
 
   /**
@@ -36,6 +37,80 @@ public:
    */
   virtual void Draw(SceneState& sceneState) {
   }
+
+  /**
+   * Get the draw call used to draw this geometry. Geometry that needs more
+   * than a single glDrawElements call (or extra GL state) returns false.
+   * @param  call  Filled in with the draw call.
+   * @return  Returns true if the geometry can be drawn with the draw call.
+   */
+  virtual bool GetDrawCall(DrawElementsCall& /*call*/) const {
+    return false;
+  }
+
+  /**
+   * Compile this geometry node. Adds a draw record if the geometry exports
+   * a draw call, otherwise adds the node to be drawn by traversal.
+   * @param  list  Render list being built.
+   */
+  virtual void Compile(RenderList& list) {
+    DrawElementsCall call;
+    if (GetDrawCall(call))
+      list.AddDraw(call, GetBound());
+    else
+      list.AddNode(this);
+  }
+
+  /**
+   * Get the BVH over this node's triangles (object coordinates). The base
+   * class has no triangles.
+   * @return  Returns the triangle BVH or NULL.
+   */
+  virtual const TriangleBVH* GetTriangleBVH() {
+    return nullptr;
+  }
+
+  /**
+   * Add this node's triangles to a scene BVH.
+   * @param  bvh  Scene BVH being collected.
+   */
+  virtual void CollectBVH(SceneBVH& bvh) {
+    bvh.AddInstance(this, GetTriangleBVH());
+    SceneNode::CollectBVH(bvh);
+  }
+
+  /**
+   * Get the bounding box of this node's own geometry (object coordinates).
+   * @return  Returns the bounding box (empty until the geometry is created).
+   */
+  const AABB& GetAABB() const {
+    return aabb;
+  }
+
+  /**
+   * Get the bounding sphere of this node's own geometry (object coordinates).
+   * @return  Returns the bounding sphere (radius 0 until the geometry is created).
+   */
+  const BoundingSphere& GetBoundingSphere() const {
+    return sphere;
+  }
+
+protected:
+  AABB           aabb;    // Bounds of the geometry, set when its
+  BoundingSphere sphere;  // vertex buffers are created
+
+  // Set the bounds from the vertex positions
+  void SetBounds(const float* positions, const uint32_t stride, const uint32_t count) {
+    aabb.Create(positions, stride, count);
+    sphere.Create(positions, stride, count);
+  }
+
+  // Bound of the geometry and any children
+  virtual AABB ComputeBound() {
+    AABB box = SceneNode::ComputeBound();
+    box.Merge(aabb);
+    return box;
+  }
 };
 
 #endif
@@ -0,0 +1,344 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    glstate.h
+//	Purpose: Shadow copy of OpenGL binding and uniform state used to skip
+//           redundant state changes while drawing.
+//
+//============================================================================
+
+#ifndef __GLSTATE_H
+#define __GLSTATE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Texture units tracked by the state cache
+const uint32_t kMaxTextureUnits = 8;
+
+// Shadowed value that is not known (set outside the cache)
+const GLuint kUnknownBinding = 0xffffffff;
+
+// Kinds of state changes counted by the state cache
+enum GLStateKind { GL_STATE_PROGRAM, GL_STATE_VERTEX_ARRAY, GL_STATE_TEXTURE,
+                   GL_STATE_UNIFORM, GL_STATE_KIND_COUNT };
+
+/**
+ * OpenGL state cache. Keeps a shadow copy of the bound program, vertex array
+ * object, texture bindings per unit and the uniform values of each program
+ * and only calls OpenGL when a value changes. Uniform values belong to the
+ * program so they stay valid while other programs are in use.
+ *
+ * Code that changes bindings without the cache (resource creation) must be
+ * followed by InvalidateBindings before the cache is used again. Uniforms of
+ * a program set through the cache must always be set through the cache.
+ */
+class GLStateCache {
+public:
+  /**
+   * Constructor. Nothing is known about the OpenGL state.
+   */
+  GLStateCache() {
+    Invalidate();
+    ResetStats();
+  }
+
+  /**
+   * Forget all shadowed state, including uniform values.
+   */
+  void Invalidate() {
+    program = kUnknownBinding;
+    current_uniforms = -1;
+    program_uniforms.clear();
+    InvalidateBindings();
+  }
+
+  /**
+   * Forget the vertex array and texture bindings. Call after OpenGL code
+   * outside the cache binds textures or vertex array objects.
+   */
+  void InvalidateBindings() {
+    vertex_array = kUnknownBinding;
+    active_unit = kUnknownBinding;
+    for (uint32_t u = 0; u < kMaxTextureUnits; u++) {
+      for (uint32_t t = 0; t < kTextureTargetCount; t++) {
+        textures[u][t] = kUnknownBinding;
+      }
+    }
+  }
+
+  /**
+   * Make a shader program current.
+   * @param  p  Program object.
+   */
+  void UseProgram(const GLuint p) {
+    if (p == program) {
+      Skipped(GL_STATE_PROGRAM);
+      return;
+    }
+    glUseProgram(p);
+    Issued(GL_STATE_PROGRAM);
+    program = p;
+    current_uniforms = FindProgramUniforms(p);
+  }
+
+  /**
+   * Get the current program.
+   * @return  Returns the program object (kUnknownBinding if not known).
+   */
+  GLuint GetProgram() const {
+    return program;
+  }
+
+  /**
+   * Bind a vertex array object.
+   * @param  vao  Vertex array object (0 to unbind).
+   */
+  void BindVertexArray(const GLuint vao) {
+    if (vao == vertex_array) {
+      Skipped(GL_STATE_VERTEX_ARRAY);
+      return;
+    }
+    glBindVertexArray(vao);
+    Issued(GL_STATE_VERTEX_ARRAY);
+    vertex_array = vao;
+  }
+
+  /**
+   * Make a texture unit active. Texture object changes (glTexParameter,
+   * glTexBuffer, ...) apply to the textures bound to the active unit.
+   * @param  unit  Texture unit (0 based, not GL_TEXTURE0 based).
+   */
+  void ActiveTexture(const uint32_t unit) {
+    if (unit == active_unit) {
+      Skipped(GL_STATE_TEXTURE);
+      return;
+    }
+    glActiveTexture(GL_TEXTURE0 + unit);
+    Issued(GL_STATE_TEXTURE);
+    active_unit = unit;
+  }
+
+  /**
+   * Bind a texture to a texture unit. The active texture unit is only
+   * changed when the binding changes.
+   * @param  unit     Texture unit (0 based, not GL_TEXTURE0 based).
+   * @param  target   Texture target (GL_TEXTURE_2D, GL_TEXTURE_BUFFER, ...).
+   * @param  texture  Texture object (0 to unbind).
+   */
+  void BindTexture(const uint32_t unit, const GLenum target, const GLuint texture) {
+    int t = GetTargetIndex(target);
+    if (unit >= kMaxTextureUnits || t < 0) {
+      // Not shadowed - always issue
+      ActiveTexture(unit);
+      glBindTexture(target, texture);
+      Issued(GL_STATE_TEXTURE);
+      return;
+    }
+    if (textures[unit][t] == texture) {
+      Skipped(GL_STATE_TEXTURE);
+      return;
+    }
+    ActiveTexture(unit);
+    glBindTexture(target, texture);
+    Issued(GL_STATE_TEXTURE);
+    textures[unit][t] = texture;
+  }
+
+  /**
+   * Set an int (or sampler) uniform of the current program.
+   * @param  loc  Uniform location.
+   * @param  v    Value.
+   */
+  void Uniform1i(const GLint loc, const GLint v) {
+    if (UniformChanged(loc, &v, sizeof(v)))
+      glUniform1i(loc, v);
+  }
+
+  /**
+   * Set a float uniform of the current program.
+   * @param  loc  Uniform location.
+   * @param  v    Value.
+   */
+  void Uniform1f(const GLint loc, const GLfloat v) {
+    if (UniformChanged(loc, &v, sizeof(v)))
+      glUniform1f(loc, v);
+  }
+
+  /**
+   * Set a vec2 uniform of the current program.
+   * @param  loc  Uniform location.
+   * @param  x    First component.
+   * @param  y    Second component.
+   */
+  void Uniform2f(const GLint loc, const GLfloat x, const GLfloat y) {
+    GLfloat v[2] = { x, y };
+    if (UniformChanged(loc, v, sizeof(v)))
+      glUniform2f(loc, x, y);
+  }
+
+  /**
+   * Set a vec3 uniform of the current program.
+   * @param  loc  Uniform location.
+   * @param  v    3 values.
+   */
+  void Uniform3fv(const GLint loc, const GLfloat* v) {
+    if (UniformChanged(loc, v, 3 * sizeof(GLfloat)))
+      glUniform3fv(loc, 1, v);
+  }
+
+  /**
+   * Set a vec4 uniform of the current program.
+   * @param  loc  Uniform location.
+   * @param  v    4 values.
+   */
+  void Uniform4fv(const GLint loc, const GLfloat* v) {
+    if (UniformChanged(loc, v, 4 * sizeof(GLfloat)))
+      glUniform4fv(loc, 1, v);
+  }
+
+  /**
+   * Set a mat4 uniform of the current program.
+   * @param  loc  Uniform location.
+   * @param  m    16 values (column major).
+   */
+  void UniformMatrix4fv(const GLint loc, const GLfloat* m) {
+    if (UniformChanged(loc, m, 16 * sizeof(GLfloat)))
+      glUniformMatrix4fv(loc, 1, GL_FALSE, m);
+  }
+
+  /**
+   * Reset the issued and skipped call counts.
+   */
+  void ResetStats() {
+    for (uint32_t k = 0; k < GL_STATE_KIND_COUNT; k++) {
+      issued[k] = 0;
+      skipped[k] = 0;
+    }
+  }
+
+  /**
+   * Get the number of OpenGL calls made since ResetStats.
+   * @param  kind  Kind of state change.
+   * @return  Returns the number of calls issued.
+   */
+  uint32_t GetIssued(const GLStateKind kind) const {
+    return issued[kind];
+  }
+
+  /**
+   * Get the number of redundant OpenGL calls skipped since ResetStats.
+   * @param  kind  Kind of state change.
+   * @return  Returns the number of calls skipped.
+   */
+  uint32_t GetSkipped(const GLStateKind kind) const {
+    return skipped[kind];
+  }
+
+  /**
+   * Print the issued and skipped call counts.
+   */
+  void PrintStats() const {
+    static const char* names[GL_STATE_KIND_COUNT] = { "program", "vertex array",
+                                                      "texture", "uniform" };
+    uint32_t total_issued = 0;
+    uint32_t total_skipped = 0;
+    for (uint32_t k = 0; k < GL_STATE_KIND_COUNT; k++) {
+      printf("  %-13s %6u issued %6u skipped\n", names[k], issued[k], skipped[k]);
+      total_issued += issued[k];
+      total_skipped += skipped[k];
+    }
+    printf("  %-13s %6u issued %6u skipped\n", "total", total_issued, total_skipped);
+  }
+
+protected:
+  // Texture targets shadowed per unit
+  static const uint32_t kTextureTargetCount = 3;
+
+  // Last value set for one uniform location
+  struct UniformValue {
+    uint32_t size;       // Size in bytes (0 if never set)
+    GLfloat  data[16];
+  };
+
+  // Uniform values of one program, indexed by location
+  struct ProgramUniforms {
+    GLuint                    program;
+    std::vector<UniformValue> values;
+  };
+
+  GLuint program;
+  GLuint vertex_array;
+  GLuint active_unit;
+  GLuint textures[kMaxTextureUnits][kTextureTargetCount];
+
+  std::vector<ProgramUniforms> program_uniforms;
+  int                          current_uniforms;  // Index into program_uniforms (-1 if not known)
+
+  uint32_t issued[GL_STATE_KIND_COUNT];
+  uint32_t skipped[GL_STATE_KIND_COUNT];
+
+  void Issued(const GLStateKind kind) {
+    issued[kind]++;
+  }
+
+  void Skipped(const GLStateKind kind) {
+    skipped[kind]++;
+  }
+
+  // Texture target index (-1 if the target is not shadowed)
+  static int GetTargetIndex(const GLenum target) {
+    switch (target) {
+    case GL_TEXTURE_2D:       return 0;
+    case GL_TEXTURE_2D_ARRAY: return 1;
+    case GL_TEXTURE_BUFFER:   return 2;
+    default:                  return -1;
+    }
+  }
+
+  // Find (or add) the uniform values of a program
+  int FindProgramUniforms(const GLuint p) {
+    for (uint32_t i = 0; i < program_uniforms.size(); i++) {
+      if (program_uniforms[i].program == p)
+        return static_cast<int>(i);
+    }
+    ProgramUniforms uniforms;
+    uniforms.program = p;
+    program_uniforms.push_back(uniforms);
+    return static_cast<int>(program_uniforms.size()) - 1;
+  }
+
+  // Compare a uniform value to the shadow copy, updating it if different.
+  // Returns true if the uniform must be set. Location -1 (not an active
+  // uniform) is ignored by OpenGL so it is never set. If the current
+  // program is not known the value is set and nothing is recorded.
+  bool UniformChanged(const GLint loc, const void* data, const uint32_t size) {
+    if (loc < 0) {
+      Skipped(GL_STATE_UNIFORM);
+      return false;
+    }
+    if (current_uniforms >= 0) {
+      std::vector<UniformValue>& values = program_uniforms[current_uniforms].values;
+      if (static_cast<uint32_t>(loc) >= values.size()) {
+        UniformValue empty;
+        empty.size = 0;
+        values.resize(loc + 1, empty);
+      }
+      UniformValue& value = values[loc];
+      if (value.size == size && memcmp(value.data, data, size) == 0) {
+        Skipped(GL_STATE_UNIFORM);
+        return false;
+      }
+      value.size = size;
+      memcpy(value.data, data, size);
+    }
+    Issued(GL_STATE_UNIFORM);
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,151 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    imagedecode.h
+//	Purpose: Thread safe image file decoding to RGBA. Does not use OpenGL
+//           so it can be shared with offline tools.
+//
+//============================================================================
+
+#ifndef __IMAGEDECODE_H
+#define __IMAGEDECODE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// DevIL include -just the base image library
+#include <IL/il.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <wincodec.h>
+#endif
+
+/**
+ * Decoded image: RGBA, 8 bits per component, lower left origin.
+ */
+struct TextureImage {
+  int                        width;
+  int                        height;
+  std::vector<unsigned char> pixels;
+};
+
+// Lock for DevIL (it decodes into a global current image). The first call
+// must be made before threads decode (function local statics are not
+// thread safe in Visual Studio 2013).
+inline std::mutex& DevILMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Decode with DevIL. Serialized - DevIL is not thread safe.
+inline bool DecodeDevIL(const std::string& path, TextureImage& image) {
+  // Check the file exists first so missing files fall through to the next
+  // search path without taking the lock
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == nullptr)
+    return false;
+  fclose(f);
+
+  std::unique_lock<std::mutex> lock(DevILMutex());
+  ILuint id;
+  ilGenImages(1, &id);
+  ilBindImage(id);
+  ilOriginFunc(IL_ORIGIN_LOWER_LEFT);
+  ilEnable(IL_ORIGIN_SET);
+  bool ok = ilLoadImage(path.c_str()) && ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
+  if (ok) {
+    image.width = ilGetInteger(IL_IMAGE_WIDTH);
+    image.height = ilGetInteger(IL_IMAGE_HEIGHT);
+    const unsigned char* data = ilGetData();
+    ok = (data != nullptr && image.width > 0 && image.height > 0);
+    if (ok)
+      image.pixels.assign(data, data + image.width * image.height * 4);
+  }
+  ilDeleteImages(1, &id);
+  while (ilGetError() != IL_NO_ERROR) { }
+  return ok;
+}
+
+#ifdef _WIN32
+// Decode with WIC. Flips rows to a lower left origin.
+inline bool DecodeWIC(const std::string& path, TextureImage& image) {
+  std::wstring wpath(path.begin(), path.end());
+  IWICImagingFactory* factory = nullptr;
+  IWICBitmapDecoder* decoder = nullptr;
+  IWICBitmapFrameDecode* frame = nullptr;
+  IWICFormatConverter* converter = nullptr;
+  UINT w = 0;
+  UINT h = 0;
+  bool ok = SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+                                       IID_PPV_ARGS(&factory))) &&
+            SUCCEEDED(factory->CreateDecoderFromFilename(wpath.c_str(), nullptr, GENERIC_READ,
+                                                         WICDecodeMetadataCacheOnDemand, &decoder)) &&
+            SUCCEEDED(decoder->GetFrame(0, &frame)) &&
+            SUCCEEDED(factory->CreateFormatConverter(&converter)) &&
+            SUCCEEDED(converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA,
+                                            WICBitmapDitherTypeNone, nullptr, 0.0,
+                                            WICBitmapPaletteTypeCustom)) &&
+            SUCCEEDED(converter->GetSize(&w, &h)) && w > 0 && h > 0;
+  if (ok) {
+    UINT stride = w * 4;
+    std::vector<unsigned char> top_down(stride * h);
+    ok = SUCCEEDED(converter->CopyPixels(nullptr, stride, static_cast<UINT>(top_down.size()),
+                                         &top_down[0]));
+    if (ok) {
+      image.width = static_cast<int>(w);
+      image.height = static_cast<int>(h);
+      image.pixels.resize(top_down.size());
+      for (UINT y = 0; y < h; y++) {
+        memcpy(&image.pixels[y * stride], &top_down[(h - 1 - y) * stride], stride);
+      }
+    }
+  }
+  if (converter) converter->Release();
+  if (frame) frame->Release();
+  if (decoder) decoder->Release();
+  if (factory) factory->Release();
+  return ok;
+}
+#endif
+
+/**
+ * Decode an image file to RGBA with a lower left origin. Thread safe.
+ * Images are decoded with WIC on Windows (thread safe, so decodes run in
+ * parallel). DevIL keeps global state so it is only used under a lock: on
+ * other platforms and for files WIC cannot decode. Threads decoding with
+ * WIC must initialize COM (CoInitializeEx).
+ * @param  path   Image file path.
+ * @param  image  Decoded image (out).
+ * @return  Returns true if the image was decoded.
+ */
+inline bool DecodeImageFile(const std::string& path, TextureImage& image) {
+#ifdef _WIN32
+  if (DecodeWIC(path, image))
+    return true;
+#endif
+  return DecodeDevIL(path, image);
+}
+
+/**
+ * Decode an image from the textures directory. Tries ../textures, then
+ * ../../textures (the working directory is the project or output folder).
+ * @param  fname  Image filename (relative to textures).
+ * @param  image  Decoded image (out).
+ * @return  Returns true if the image was decoded.
+ */
+inline bool DecodeTextureFile(const std::string& fname, TextureImage& image) {
+  return DecodeImageFile("../textures/" + fname, image) ||
+         DecodeImageFile("../../textures/" + fname, image);
+}
+
+#endif
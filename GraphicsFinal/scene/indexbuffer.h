@@ -0,0 +1,148 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    indexbuffer.h
+//	Purpose: Element (index) buffer that stores indexes with the smallest
+//           type that can address the vertex list.
+//
+//============================================================================
+
+#ifndef __INDEXBUFFER_H
+#define __INDEXBUFFER_H
+
+#include <vector>
+
+/**
+ * Index type traits. Maps an index type to its OpenGL type enum and the
+ * number of vertices it can address.
+ */
+template <typename T>
+struct IndexTraits;
+
+template <>
+struct IndexTraits<uint16_t> {
+  static GLenum GLType() { return GL_UNSIGNED_SHORT; }
+  static uint32_t MaxVertices() { return 65536; }
+};
+
+template <>
+struct IndexTraits<uint32_t> {
+  static GLenum GLType() { return GL_UNSIGNED_INT; }
+  static uint32_t MaxVertices() { return 0xffffffff; }
+};
+
+/**
+ * Index buffer. Indexes are built as 32 bit values on the CPU and uploaded
+ * as 16 bit values when the vertex list has at most 65536 vertices, 32 bit
+ * values otherwise. Draw calls use GetType() for the index type.
+ */
+class IndexBuffer {
+public:
+  /**
+   * Constructor.
+   */
+  IndexBuffer()
+      : buffer(0),
+        type(GL_UNSIGNED_SHORT),
+        count(0) {
+  }
+
+  /**
+   * Destructor. Deletes the buffer object.
+   */
+  ~IndexBuffer() {
+    glDeleteBuffers(1, &buffer);
+  }
+
+  /**
+   * Create (or replace) the buffer object from an index list. Must be
+   * called with the VAO the indexes belong to bound (or no VAO bound and
+   * Bind() called later with the VAO bound).
+   * @param  indexes       Index list.
+   * @param  vertex_count  Number of vertices in the vertex list.
+   * @return  Returns false if an index is out of range of the vertex list.
+   */
+  bool Create(const std::vector<uint32_t>& indexes, const uint32_t vertex_count) {
+    for (auto index : indexes) {
+      if (index >= vertex_count) {
+        printf("IndexBuffer: index %u is out of range (%u vertices)\n",
+               index, vertex_count);
+        count = 0;
+        return false;
+      }
+    }
+
+    if (buffer == 0)
+      glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    if (vertex_count <= IndexTraits<uint16_t>::MaxVertices())
+      Upload<uint16_t>(indexes);
+    else
+      Upload<uint32_t>(indexes);
+    count = static_cast<GLsizei>(indexes.size());
+    return true;
+  }
+
+  /**
+   * Bind the buffer object as the element array buffer.
+   */
+  void Bind() const {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+  }
+
+  /**
+   * Get the buffer object.
+   * @return  Returns the buffer object (0 before Create).
+   */
+  GLuint GetBuffer() const {
+    return buffer;
+  }
+
+  /**
+   * Get the index type.
+   * @return  Returns GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+   */
+  GLenum GetType() const {
+    return type;
+  }
+
+  /**
+   * Get the number of indexes.
+   * @return  Returns the number of indexes in the buffer.
+   */
+  GLsizei GetCount() const {
+    return count;
+  }
+
+protected:
+  GLuint  buffer;
+  GLenum  type;
+  GLsizei count;
+
+  // Convert the indexes to type T and upload them
+  template <typename T>
+  void Upload(const std::vector<uint32_t>& indexes) {
+    type = IndexTraits<T>::GLType();
+    if (sizeof(T) == sizeof(uint32_t)) {
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexes.size() * sizeof(T),
+                   indexes.empty() ? nullptr : (void*)&indexes[0], GL_STATIC_DRAW);
+      return;
+    }
+    std::vector<T> packed(indexes.size());
+    for (size_t i = 0; i < indexes.size(); i++) {
+      packed[i] = static_cast<T>(indexes[i]);
+    }
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, packed.size() * sizeof(T),
+                 packed.empty() ? nullptr : (void*)&packed[0], GL_STATIC_DRAW);
+  }
+
+private:
+  // Buffer objects are owned - no copies
+  IndexBuffer(const IndexBuffer&);
+  IndexBuffer& operator=(const IndexBuffer&);
+};
+
+#endif
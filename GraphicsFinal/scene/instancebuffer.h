@@ -0,0 +1,147 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    instancebuffer.h
+//	Purpose: Per instance model and normal matrices stored in a buffer
+//           texture for instanced drawing.
+//
+//============================================================================
+
+#ifndef __INSTANCEBUFFER_H
+#define __INSTANCEBUFFER_H
+
+#include <vector>
+
+// Texture unit used for the instance matrices (0 and 1 are used by the
+// material texture and normal map)
+const GLenum kInstanceTextureUnit = 2;
+
+// Number of RGBA32F texels per instance: 4 model matrix columns followed by
+// 4 normal matrix columns
+const uint32_t kInstanceTexels = 8;
+
+/**
+ * Instance buffer. Holds model and normal matrices for a set of instances
+ * in a buffer texture. The vertex shader reads them with texelFetch using
+ * gl_InstanceID (OpenGL 3.2 has no vertex attribute divisors).
+ */
+class InstanceBuffer {
+public:
+  /**
+   * Constructor.
+   */
+  InstanceBuffer()
+      : buffer(0),
+        texture(0),
+        capacity(0),
+        count(0) {
+  }
+
+  /**
+   * Destructor. Deletes the buffer and texture objects.
+   */
+  ~InstanceBuffer() {
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &buffer);
+  }
+
+  /**
+   * Check if the current shader supports instanced draws.
+   * @param  scene_state  Current scene state.
+   * @return  Returns true if the instancing uniforms are present.
+   */
+  static bool IsSupported(const SceneState& scene_state) {
+    return scene_state.useinstancing_loc >= 0 &&
+           scene_state.instancematrices_loc >= 0;
+  }
+
+  /**
+   * Replace the instance matrices. Leaves the buffer texture bound to
+   * kInstanceTextureUnit.
+   * @param  gl_state  OpenGL state cache.
+   * @param  model     Model matrix of each instance.
+   * @param  normal    Normal matrix of each instance (same count as model).
+   */
+  void Upload(GLStateCache& gl_state, const std::vector<Matrix4x4>& model,
+              const std::vector<Matrix4x4>& normal) {
+    count = static_cast<uint32_t>(model.size());
+    if (count == 0)
+      return;
+
+    staging.resize(count * kInstanceTexels * 4);
+    float* dst = &staging[0];
+    for (uint32_t i = 0; i < count; i++, dst += kInstanceTexels * 4) {
+      memcpy(dst, model[i].Get(), 16 * sizeof(float));
+      memcpy(dst + 16, normal[i].Get(), 16 * sizeof(float));
+    }
+
+    if (buffer == 0) {
+      glGenBuffers(1, &buffer);
+      glGenTextures(1, &texture);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    GLsizeiptr size = staging.size() * sizeof(float);
+    if (count > capacity) {
+      glBufferData(GL_TEXTURE_BUFFER, size, &staging[0], GL_DYNAMIC_DRAW);
+      capacity = count;
+
+      // Attach the (reallocated) buffer store to the texture
+      gl_state.ActiveTexture(kInstanceTextureUnit);
+      gl_state.BindTexture(kInstanceTextureUnit, GL_TEXTURE_BUFFER, texture);
+      glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+    }
+    else {
+      glBufferSubData(GL_TEXTURE_BUFFER, 0, size, &staging[0]);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  }
+
+  /**
+   * Get the number of instances.
+   * @return  Returns the number of instances uploaded.
+   */
+  uint32_t GetCount() const {
+    return count;
+  }
+
+  /**
+   * Draw a range of instances. The current program must be the lighting
+   * shader (IsSupported returns true). Each instance's pvm is formed in
+   * the shader from scene_state.pv and its model matrix.
+   * @param  scene_state  Current scene state.
+   * @param  call         Draw call for the geometry.
+   * @param  first        Index of the first instance.
+   * @param  n            Number of instances to draw.
+   */
+  void Draw(SceneState& scene_state, const DrawElementsCall& call,
+            const uint32_t first, const uint32_t n) const {
+    GLStateCache& gl_state = scene_state.gl_state;
+    gl_state.BindTexture(kInstanceTextureUnit, GL_TEXTURE_BUFFER, texture);
+    gl_state.Uniform1i(scene_state.instancematrices_loc, kInstanceTextureUnit);
+    gl_state.Uniform1i(scene_state.instancebase_loc, first);
+    gl_state.UniformMatrix4fv(scene_state.projectionview_loc, scene_state.pv.Get());
+    gl_state.Uniform1i(scene_state.useinstancing_loc, 1);
+
+    gl_state.BindVertexArray(call.vao);
+    glDrawElementsInstanced(call.mode, call.index_count, call.index_type, (void*)0, n);
+
+    gl_state.Uniform1i(scene_state.useinstancing_loc, 0);
+  }
+
+protected:
+  GLuint             buffer;
+  GLuint             texture;
+  uint32_t           capacity;   // Instances the buffer store can hold
+  uint32_t           count;
+  std::vector<float> staging;
+
+private:
+  // Buffer objects are owned - no copies
+  InstanceBuffer(const InstanceBuffer&);
+  InstanceBuffer& operator=(const InstanceBuffer&);
+};
+
+#endif
@@ -0,0 +1,213 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    instancedgeometrynode.h
+//	Purpose: Scene graph node that draws one geometry node many times
+//           with a single instanced draw call.
+//
+//============================================================================
+
+#ifndef __INSTANCEDGEOMETRYNODE_H
+#define __INSTANCEDGEOMETRYNODE_H
+
+/**
+ * Instanced geometry node. Draws a geometry node once per instance, each
+ * with its own local modeling matrix (applied after the current model
+ * matrix, as if each instance had a TransformNode parent). When the
+ * geometry exports a draw call all instances are drawn with one
+ * glDrawElementsInstanced call. Inside a render list each instance
+ * compiles to its own record; consecutive records of the same geometry
+ * and material are drawn instanced by the render list node.
+ */
+class InstancedGeometryNode : public GeometryNode {
+public:
+  /**
+   * Constructor.
+   * @param  node  Geometry node to instance.
+   */
+  InstancedGeometryNode(GeometryNode* node)
+      : geometry(node),
+        next_slot(0) {
+    for (uint32_t i = 0; i < kTransformCacheSlots; i++) {
+      slots[i].stamp = 0;
+    }
+    AddChild(node);
+  }
+
+  /**
+   * Destructor.
+   */
+  virtual ~InstancedGeometryNode() { }
+
+  /**
+   * Add an instance.
+   * @param  m  Local modeling matrix of the instance.
+   * @return  Returns the index of the instance.
+   */
+  uint32_t AddInstance(const Matrix4x4& m) {
+    instances.push_back(m);
+    instance_normals.push_back(m.GetAffineInverse().Transpose());
+    Invalidate();
+    return static_cast<uint32_t>(instances.size()) - 1;
+  }
+
+  /**
+   * Replace the modeling matrix of an instance.
+   * @param  index  Instance index (from AddInstance).
+   * @param  m      Local modeling matrix of the instance.
+   */
+  void SetInstance(const uint32_t index, const Matrix4x4& m) {
+    instances[index] = m;
+    instance_normals[index] = m.GetAffineInverse().Transpose();
+    Invalidate();
+  }
+
+  /**
+   * Remove all instances.
+   */
+  void ClearInstances() {
+    instances.clear();
+    instance_normals.clear();
+    Invalidate();
+  }
+
+  /**
+   * Get the number of instances.
+   * @return  Returns the number of instances.
+   */
+  uint32_t GetInstanceCount() const {
+    return static_cast<uint32_t>(instances.size());
+  }
+
+  /**
+   * Draw all instances. Instance matrices are uploaded only when the
+   * current model matrix or the instances change.
+   * @param  scene_state  Current scene state
+   */
+  virtual void Draw(SceneState& scene_state) {
+    if (instances.empty())
+      return;
+
+    DrawElementsCall call;
+    if (!geometry->GetDrawCall(call) || !InstanceBuffer::IsSupported(scene_state)) {
+      DrawEach(scene_state);
+      return;
+    }
+
+    InstanceBuffer& buffer = GetInstanceBuffer(scene_state, call.layout);
+    buffer.Draw(scene_state, call, 0, buffer.GetCount());
+  }
+
+  /**
+   * Compile. Adds the geometry once per instance with the instance
+   * transform applied.
+   * @param  list  Render list being built.
+   */
+  virtual void Compile(RenderList& list) {
+    for (uint32_t i = 0; i < instances.size(); i++) {
+      list.PushTransform(instances[i]);
+      geometry->Compile(list);
+      list.PopTransform();
+    }
+  }
+
+  /**
+   * Collect the geometry once per instance with the instance transform
+   * applied. All instances share the geometry's triangle BVH.
+   * @param  bvh  Scene BVH being collected.
+   */
+  virtual void CollectBVH(SceneBVH& bvh) {
+    for (uint32_t i = 0; i < instances.size(); i++) {
+      bvh.PushTransform(instances[i]);
+      geometry->CollectBVH(bvh);
+      bvh.PopTransform();
+    }
+  }
+
+protected:
+  // Instance matrices for one model matrix
+  struct InstanceSlot {
+    uint32_t       stamp;   // Stamp of the model matrix (0 if empty)
+    InstanceBuffer buffer;
+  };
+
+  GeometryNode*          geometry;
+  std::vector<Matrix4x4> instances;
+  std::vector<Matrix4x4> instance_normals;
+  InstanceSlot           slots[kTransformCacheSlots];
+  uint32_t               next_slot;
+
+  // Bound of the geometry placed at each instance
+  virtual AABB ComputeBound() {
+    AABB box;
+    const AABB& local = geometry->GetBound();
+    for (uint32_t i = 0; i < instances.size(); i++) {
+      box.Merge(local.Transform(instances[i]));
+    }
+    return box;
+  }
+
+  // Instances changed - discard uploaded matrices and compiled lists
+  void Invalidate() {
+    for (uint32_t i = 0; i < kTransformCacheSlots; i++) {
+      slots[i].stamp = 0;
+    }
+    InvalidateGraph();
+  }
+
+  // Get the uploaded instance matrices for the current model matrix. World
+  // matrices of quantized geometry include the dequantization.
+  InstanceBuffer& GetInstanceBuffer(SceneState& scene_state, const CompactVertexLayout* layout) {
+    for (uint32_t i = 0; i < kTransformCacheSlots; i++) {
+      if (slots[i].stamp == scene_state.model_stamp)
+        return slots[i].buffer;
+    }
+
+    InstanceSlot& slot = slots[next_slot];
+    next_slot = (next_slot + 1) % kTransformCacheSlots;
+    std::vector<Matrix4x4> world(instances.size());
+    std::vector<Matrix4x4> normal(instances.size());
+    for (uint32_t i = 0; i < instances.size(); i++) {
+      world[i] = scene_state.model_matrix * instances[i];
+      normal[i] = scene_state.normal_matrix * instance_normals[i];
+      if (IsQuantized(layout))
+        world[i] *= GetDequantizeMatrix(*layout);
+    }
+    slot.buffer.Upload(scene_state.gl_state, world, normal);
+    slot.stamp = scene_state.model_stamp;
+    return slot.buffer;
+  }
+
+  // Draw the instances one at a time (geometry without a draw call or a
+  // shader without instancing support)
+  void DrawEach(SceneState& scene_state) {
+    for (uint32_t i = 0; i < instances.size(); i++) {
+      Matrix4x4 world = scene_state.model_matrix * instances[i];
+      Matrix4x4 normal = scene_state.normal_matrix * instance_normals[i];
+      Matrix4x4 pvm = scene_state.pv * world;
+      scene_state.gl_state.UniformMatrix4fv(scene_state.modelmatrix_loc, world.Get());
+      scene_state.gl_state.UniformMatrix4fv(scene_state.normalmatrix_loc, normal.Get());
+      scene_state.gl_state.UniformMatrix4fv(scene_state.pvm_loc, pvm.Get());
+
+      // The geometry may re-set its matrices from the scene state (e.g.
+      // to dequantize positions)
+      scene_state.PushTransforms();
+      scene_state.model_matrix = world;
+      scene_state.normal_matrix = normal;
+      scene_state.model_stamp = SceneState::NewStamp();
+      geometry->Draw(scene_state);
+      scene_state.PopTransforms();
+    }
+
+    // Restore the current matrices for nodes drawn after this one
+    Matrix4x4 pvm = scene_state.pv * scene_state.model_matrix;
+    scene_state.gl_state.UniformMatrix4fv(scene_state.modelmatrix_loc, scene_state.model_matrix.Get());
+    scene_state.gl_state.UniformMatrix4fv(scene_state.normalmatrix_loc, scene_state.normal_matrix.Get());
+    scene_state.gl_state.UniformMatrix4fv(scene_state.pvm_loc, pvm.Get());
+  }
+};
+
+#endif
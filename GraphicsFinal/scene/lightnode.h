@@ -145,27 +145,27 @@ public:
    * @param  scene_state  Current scene state.
 	 */
 	void Draw(SceneState& scene_state) {
-    glUniform1i(scene_state.lights[index].enabled, static_cast<int>(enabled));
+    scene_state.gl_state.Uniform1i(scene_state.lights[index].enabled, static_cast<int>(enabled));
 		if (enabled){
-      glUniform1i(scene_state.lights[index].spotlight, static_cast<int>(is_spotlight));
-      glUniform4fv(scene_state.lights[index].position, 1, &position.x);
-      glUniform4fv(scene_state.lights[index].ambient, 1, &ambient.r);
-      glUniform4fv(scene_state.lights[index].diffuse, 1, &diffuse.r);
-      glUniform4fv(scene_state.lights[index].specular, 1, &specular.r);
-      glUniform1f(scene_state.lights[index].att_constant, atten0);
-      glUniform1f(scene_state.lights[index].att_linear, atten1);
-      glUniform1f(scene_state.lights[index].att_quadratic, atten2);
+      scene_state.gl_state.Uniform1i(scene_state.lights[index].spotlight, static_cast<int>(is_spotlight));
+      scene_state.gl_state.Uniform4fv(scene_state.lights[index].position, &position.x);
+      scene_state.gl_state.Uniform4fv(scene_state.lights[index].ambient, &ambient.r);
+      scene_state.gl_state.Uniform4fv(scene_state.lights[index].diffuse, &diffuse.r);
+      scene_state.gl_state.Uniform4fv(scene_state.lights[index].specular, &specular.r);
+      scene_state.gl_state.Uniform1f(scene_state.lights[index].att_constant, atten0);
+      scene_state.gl_state.Uniform1f(scene_state.lights[index].att_linear, atten1);
+      scene_state.gl_state.Uniform1f(scene_state.lights[index].att_quadratic, atten2);
       if (is_spotlight) {
         // Note we use cos of the spotlight cutoff angle so we don't have
         // to compute cos in the shader
-        glUniform1f(scene_state.lights[index].spot_cutoffcos, spot_cutoffcos);
-        glUniform3fv(scene_state.lights[index].spot_direction, 1, &spot_direction.x);
-        glUniform1f(scene_state.lights[index].spot_exponent, spot_exponent);
+        scene_state.gl_state.Uniform1f(scene_state.lights[index].spot_cutoffcos, spot_cutoffcos);
+        scene_state.gl_state.Uniform3fv(scene_state.lights[index].spot_direction, &spot_direction.x);
+        scene_state.gl_state.Uniform1f(scene_state.lights[index].spot_exponent, spot_exponent);
       }
 
       // Track the maximum light index that is enabled
       if (index >= (uint32_t)scene_state.max_enabled_light) {
-        glUniform1i(scene_state.lightcount_loc, index + 1);
+        scene_state.gl_state.Uniform1i(scene_state.lightcount_loc, index + 1);
         scene_state.max_enabled_light = index;
       }
     }
@@ -175,9 +175,18 @@ public:
 
     // To be proper we should disable this light so it does not impact any nodes that 
     // are not descended from this node
-    glUniform1i(scene_state.lights[index].enabled, 0);
+    scene_state.gl_state.Uniform1i(scene_state.lights[index].enabled, 0);
 	}
 	
+  /**
+   * Compile. Lights set uniforms used by all descendants, so the light and
+   * its children are drawn by traversal.
+   * @param  list  Render list being built.
+   */
+  void Compile(RenderList& list) {
+    list.AddNode(this);
+  }
+
 protected:
   bool     enabled;
   bool     is_spotlight;
@@ -0,0 +1,153 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    mappedfile.h
+//	Purpose: Read only memory mapped file.
+//
+//============================================================================
+
+#ifndef __MAPPEDFILE_H
+#define __MAPPEDFILE_H
+
+#include <stdint.h>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Read only memory mapped file. Pages are read from disk when first
+ * touched, so opening a large file is cheap.
+ */
+class MappedFile {
+public:
+  /**
+   * Constructor.
+   */
+  MappedFile()
+      : data(nullptr),
+        size(0) {
+#ifdef _WIN32
+    file = INVALID_HANDLE_VALUE;
+    mapping = nullptr;
+#endif
+  }
+
+  /**
+   * Destructor. Unmaps the file.
+   */
+  ~MappedFile() {
+    Close();
+  }
+
+  /**
+   * Map a file.
+   * @param  path  File path.
+   * @return  Returns false if the file does not exist or cannot be mapped.
+   */
+  bool Open(const std::string& path) {
+    Close();
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return false;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+      Close();
+      return false;
+    }
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+      Close();
+      return false;
+    }
+    data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr) {
+      Close();
+      return false;
+    }
+    size = static_cast<uint64_t>(file_size.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      return false;
+    }
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+      return false;
+    data = static_cast<const unsigned char*>(p);
+    size = static_cast<uint64_t>(st.st_size);
+#endif
+    return true;
+  }
+
+  /**
+   * Unmap the file.
+   */
+  void Close() {
+#ifdef _WIN32
+    if (data != nullptr)
+      UnmapViewOfFile(data);
+    if (mapping != nullptr)
+      CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (data != nullptr)
+      munmap(const_cast<unsigned char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+  }
+
+  /**
+   * Get the mapped contents.
+   * @return  Returns the start of the file (NULL if not open).
+   */
+  const unsigned char* GetData() const {
+    return data;
+  }
+
+  /**
+   * Get the file size.
+   * @return  Returns the size in bytes (0 if not open).
+   */
+  uint64_t GetSize() const {
+    return size;
+  }
+
+protected:
+  const unsigned char* data;
+  uint64_t             size;
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE mapping;
+#endif
+
+private:
+  // Mapping is owned - no copies
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+};
+
+#endif
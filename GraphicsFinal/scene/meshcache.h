@@ -0,0 +1,286 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    meshcache.h
+//	Purpose: Binary cache of imported model meshes (interleaved vertices,
+//           indices and material textures) so models load without running
+//           the importer. Does not use OpenGL.
+//
+//============================================================================
+
+#ifndef __MESHCACHE_H
+#define __MESHCACHE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "scene/mappedfile.h"
+
+// Cache file identification. The version changes whenever the layout of
+// the file or of ModelVertex changes, or meshes are processed differently
+// before they are stored (2: vertex cache and overdraw optimized).
+const char     kMeshCacheMagic[4] = { 'M', 'S', 'H', 'C' };
+const uint32_t kMeshCacheVersion = 2;
+const char* const kMeshCacheExtension = ".meshcache";
+
+// Alignment of vertex and index data in the file
+const uint64_t kMeshCacheAlignment = 16;
+
+// Longest material texture path stored
+const uint32_t kMeshCacheMaxPath = 260;
+
+// Attributes present in a mesh (others are zero)
+enum MeshCacheAttributes {
+  MESHCACHE_NORMALS   = 1,
+  MESHCACHE_TEXCOORDS = 2
+};
+
+// Interleaved model vertex
+struct ModelVertex {
+  float position[3];
+  float normal[3];
+  float texcoord[2];
+};
+
+// File header
+struct MeshCacheHeader {
+  char     magic[4];
+  uint32_t version;
+  uint64_t source_hash;      // Hash of the model file and import flags
+  uint32_t import_flags;
+  uint32_t vertex_size;      // sizeof(ModelVertex)
+  uint32_t mesh_count;
+  uint32_t reserved;
+};
+
+// Mesh table entry (follows the header, one per mesh)
+struct MeshCacheEntry {
+  uint64_t vertex_offset;    // From the start of the file
+  uint64_t index_offset;
+  uint32_t vertex_count;
+  uint32_t index_count;      // Triangle list (3 per face)
+  uint32_t attributes;       // MeshCacheAttributes
+  char     texture[kMeshCacheMaxPath];  // Diffuse texture as named by the model ("" if none)
+};
+
+// Mesh to write to a cache
+struct CachedMesh {
+  std::vector<ModelVertex> vertices;
+  std::vector<uint32_t>    indices;
+  uint32_t                 attributes;
+  std::string              texture;
+};
+
+/**
+ * Get the cache filename for a model file (the model filename with
+ * .meshcache appended, so models differing only by extension do not
+ * share a cache).
+ * @param  path  Model file path.
+ * @return  Returns the cache file path.
+ */
+inline std::string MeshCacheName(const std::string& path) {
+  return path + kMeshCacheExtension;
+}
+
+/**
+ * Hash model file contents and import flags (64 bit FNV-1a). A cache is
+ * used only if it was written for the same hash.
+ * @param  data          Model file contents.
+ * @param  size          Size in bytes.
+ * @param  import_flags  Importer post processing flags.
+ * @return  Returns the hash.
+ */
+inline uint64_t MeshCacheHash(const void* data, const uint64_t size, const uint32_t import_flags) {
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  uint64_t h = 14695981039346656037ULL;
+  for (uint64_t i = 0; i < size; i++) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  for (int k = 0; k < 4; k++) {
+    h ^= (import_flags >> (k * 8)) & 0xff;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+/**
+ * Write meshes to a cache file.
+ * @param  path          Cache file path.
+ * @param  source_hash   Hash of the model file (MeshCacheHash).
+ * @param  import_flags  Importer post processing flags.
+ * @param  meshes        Meshes to store.
+ * @return  Returns true if the file was written.
+ */
+inline bool WriteMeshCache(const std::string& path, const uint64_t source_hash,
+                           const uint32_t import_flags, const std::vector<CachedMesh>& meshes) {
+  MeshCacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMeshCacheMagic, 4);
+  header.version = kMeshCacheVersion;
+  header.source_hash = source_hash;
+  header.import_flags = import_flags;
+  header.vertex_size = sizeof(ModelVertex);
+  header.mesh_count = static_cast<uint32_t>(meshes.size());
+
+  // Lay out the data after the mesh table
+  std::vector<MeshCacheEntry> table(meshes.size());
+  uint64_t offset = sizeof(MeshCacheHeader) + meshes.size() * sizeof(MeshCacheEntry);
+  for (size_t i = 0; i < meshes.size(); i++) {
+    MeshCacheEntry& e = table[i];
+    memset(&e, 0, sizeof(e));
+    if (meshes[i].texture.size() >= kMeshCacheMaxPath)
+      return false;
+    memcpy(e.texture, meshes[i].texture.c_str(), meshes[i].texture.size());
+    e.attributes = meshes[i].attributes;
+    e.vertex_count = static_cast<uint32_t>(meshes[i].vertices.size());
+    e.index_count = static_cast<uint32_t>(meshes[i].indices.size());
+    offset = (offset + kMeshCacheAlignment - 1) / kMeshCacheAlignment * kMeshCacheAlignment;
+    e.vertex_offset = offset;
+    offset += e.vertex_count * sizeof(ModelVertex);
+    offset = (offset + kMeshCacheAlignment - 1) / kMeshCacheAlignment * kMeshCacheAlignment;
+    e.index_offset = offset;
+    offset += e.index_count * sizeof(uint32_t);
+  }
+
+  FILE* f = fopen(path.c_str(), "wb");
+  if (f == nullptr)
+    return false;
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            (table.empty() || fwrite(&table[0], sizeof(MeshCacheEntry), table.size(), f) == table.size());
+  static const char padding[kMeshCacheAlignment] = { 0 };
+  uint64_t written = sizeof(MeshCacheHeader) + meshes.size() * sizeof(MeshCacheEntry);
+  for (size_t i = 0; i < meshes.size() && ok; i++) {
+    const MeshCacheEntry& e = table[i];
+    ok = fwrite(padding, 1, e.vertex_offset - written, f) == e.vertex_offset - written &&
+         (e.vertex_count == 0 ||
+          fwrite(&meshes[i].vertices[0], sizeof(ModelVertex), e.vertex_count, f) == e.vertex_count);
+    written = e.vertex_offset + e.vertex_count * sizeof(ModelVertex);
+    ok = ok && fwrite(padding, 1, e.index_offset - written, f) == e.index_offset - written &&
+         (e.index_count == 0 ||
+          fwrite(&meshes[i].indices[0], sizeof(uint32_t), e.index_count, f) == e.index_count);
+    written = e.index_offset + e.index_count * sizeof(uint32_t);
+  }
+  if (fclose(f) != 0 || !ok) {
+    remove(path.c_str());
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Mesh cache reader. Maps the cache file; vertex and index data are read
+ * in place (e.g. passed straight to glBufferData).
+ */
+class MeshCacheReader {
+public:
+  /**
+   * Constructor.
+   */
+  MeshCacheReader()
+      : header(nullptr),
+        table(nullptr) {
+  }
+
+  /**
+   * Open a cache file. Fails if the file does not exist, was written by a
+   * different version or for a different model file or import flags, or
+   * is truncated.
+   * @param  path          Cache file path.
+   * @param  source_hash   Hash of the model file (MeshCacheHash).
+   * @param  import_flags  Importer post processing flags.
+   * @return  Returns true if the cache can be used.
+   */
+  bool Open(const std::string& path, const uint64_t source_hash, const uint32_t import_flags) {
+    Close();
+    if (!file.Open(path))
+      return false;
+    const unsigned char* data = file.GetData();
+    uint64_t size = file.GetSize();
+    const MeshCacheHeader* h = reinterpret_cast<const MeshCacheHeader*>(data);
+    bool ok = size >= sizeof(MeshCacheHeader) && memcmp(h->magic, kMeshCacheMagic, 4) == 0 &&
+              h->version == kMeshCacheVersion && h->source_hash == source_hash &&
+              h->import_flags == import_flags && h->vertex_size == sizeof(ModelVertex) &&
+              size >= sizeof(MeshCacheHeader) + h->mesh_count * sizeof(MeshCacheEntry);
+    const MeshCacheEntry* t = reinterpret_cast<const MeshCacheEntry*>(h + 1);
+    for (uint32_t i = 0; ok && i < h->mesh_count; i++) {
+      ok = t[i].vertex_offset + t[i].vertex_count * sizeof(ModelVertex) <= size &&
+           t[i].index_offset + t[i].index_count * sizeof(uint32_t) <= size &&
+           t[i].texture[kMeshCacheMaxPath - 1] == '\0';
+      for (uint32_t k = 0; ok && k < t[i].index_count; k++)
+        ok = GetIndicesOf(data, t[i])[k] < t[i].vertex_count;
+    }
+    if (!ok) {
+      file.Close();
+      return false;
+    }
+    header = h;
+    table = t;
+    return true;
+  }
+
+  /**
+   * Close the cache file.
+   */
+  void Close() {
+    file.Close();
+    header = nullptr;
+    table = nullptr;
+  }
+
+  /**
+   * Get the number of meshes.
+   * @return  Returns the mesh count.
+   */
+  uint32_t GetMeshCount() const {
+    return (header != nullptr) ? header->mesh_count : 0;
+  }
+
+  /**
+   * Get a mesh table entry.
+   * @param  i  Mesh index.
+   * @return  Returns the entry (counts, attributes and texture).
+   */
+  const MeshCacheEntry& GetMesh(const uint32_t i) const {
+    return table[i];
+  }
+
+  /**
+   * Get the vertices of a mesh.
+   * @param  i  Mesh index.
+   * @return  Returns the interleaved vertices (in the mapping).
+   */
+  const ModelVertex* GetVertices(const uint32_t i) const {
+    return reinterpret_cast<const ModelVertex*>(file.GetData() + table[i].vertex_offset);
+  }
+
+  /**
+   * Get the indices of a mesh.
+   * @param  i  Mesh index.
+   * @return  Returns the triangle list indices (in the mapping).
+   */
+  const uint32_t* GetIndices(const uint32_t i) const {
+    return GetIndicesOf(file.GetData(), table[i]);
+  }
+
+protected:
+  MappedFile             file;
+  const MeshCacheHeader* header;
+  const MeshCacheEntry*  table;
+
+  static const uint32_t* GetIndicesOf(const unsigned char* data, const MeshCacheEntry& e) {
+    return reinterpret_cast<const uint32_t*>(data + e.index_offset);
+  }
+
+private:
+  // Mapping is owned - no copies
+  MeshCacheReader(const MeshCacheReader&);
+  MeshCacheReader& operator=(const MeshCacheReader&);
+};
+
+#endif
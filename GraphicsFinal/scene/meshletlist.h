@@ -0,0 +1,136 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    meshletlist.h
+//	Purpose: Meshlets of a large mesh, culled against the view each draw
+//           and drawn with one glMultiDrawElements call.
+//
+//============================================================================
+
+#ifndef __MESHLETLIST_H
+#define __MESHLETLIST_H
+
+#include <vector>
+#include "geometry/parallel.h"
+
+// Meshes with fewer triangles are drawn with a single glDrawElements (the
+// culling would cost more than the vertex work it saves)
+const uint32_t kMeshletMinTriangles = 2048;
+
+// Minimum meshlets culled per thread pool chunk
+const size_t kMeshletCullGrain = 256;
+
+/**
+ * Meshlet list. Splits a mesh's triangle list into meshlets (see
+ * meshlet.h). Each draw culls them against the view frustum and their
+ * normal cones (on the thread pool) and draws the visible ones with one
+ * glMultiDrawElements call. Visible meshlets that are next to each other
+ * in the index buffer are merged into one range. Culling is in object
+ * space so it uses the current model matrix, not the dequantization of
+ * compact vertices.
+ */
+class MeshletList {
+public:
+  /**
+   * Constructor.
+   */
+  MeshletList()
+      : visible_count(0) {
+  }
+
+  /**
+   * Build the meshlets. Meshes smaller than kMeshletMinTriangles get none.
+   * @param  indices       Triangle list indices (as uploaded).
+   * @param  index_count   Number of indices.
+   * @param  positions     Position (3 floats) of the first vertex.
+   * @param  stride        Bytes between positions.
+   * @param  vertex_count  Number of vertices.
+   */
+  void Build(const uint32_t* indices, const uint32_t index_count, const float* positions,
+             const uint32_t stride, const uint32_t vertex_count) {
+    meshlets.clear();
+    if (index_count / 3 < kMeshletMinTriangles)
+      return;
+    BuildMeshlets(indices, index_count, positions, stride, vertex_count, meshlets);
+  }
+
+  /**
+   * Check if the mesh has meshlets.
+   * @return  Returns true if the mesh is drawn without culling.
+   */
+  bool IsEmpty() const {
+    return meshlets.empty();
+  }
+
+  /**
+   * Get the number of meshlets.
+   * @return  Returns the meshlet count.
+   */
+  uint32_t GetCount() const {
+    return static_cast<uint32_t>(meshlets.size());
+  }
+
+  /**
+   * Get the number of meshlets drawn by the last Draw.
+   * @return  Returns the visible meshlet count.
+   */
+  uint32_t GetVisibleCount() const {
+    return visible_count;
+  }
+
+  /**
+   * Cull the meshlets and draw the visible ones. The mesh's VAO must be
+   * bound and its matrices set.
+   * @param  scene_state  Current scene state (projection/view and model matrix).
+   * @param  index_type   GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+   */
+  void Draw(const SceneState& scene_state, const GLenum index_type) {
+    Frustum frustum(scene_state.pv * scene_state.model_matrix);
+    Point3 eye;
+    bool use_eye = frustum.GetEye(eye);
+    culled.resize(meshlets.size());
+    ParallelFor(meshlets.size(), kMeshletCullGrain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
+        culled[i] = meshlets[i].IsCulled(frustum, eye, use_eye) ? 1 : 0;
+    });
+
+    // Compact the visible meshlets into draw ranges
+    size_t index_size = (index_type == GL_UNSIGNED_INT) ? sizeof(uint32_t) : sizeof(uint16_t);
+    counts.clear();
+    offsets.clear();
+    visible_count = 0;
+    uint32_t range_end = 0;
+    for (size_t i = 0; i < meshlets.size(); i++) {
+      if (culled[i])
+        continue;
+      const Meshlet& m = meshlets[i];
+      if (!counts.empty() && range_end == m.first_index) {
+        counts.back() += m.index_count;
+      }
+      else {
+        counts.push_back(m.index_count);
+        offsets.push_back(reinterpret_cast<const GLvoid*>(m.first_index * index_size));
+      }
+      range_end = m.first_index + m.index_count;
+      visible_count++;
+    }
+    if (!counts.empty()) {
+      glMultiDrawElements(GL_TRIANGLES, &counts[0], index_type, &offsets[0],
+                          static_cast<GLsizei>(counts.size()));
+    }
+  }
+
+protected:
+  std::vector<Meshlet>       meshlets;
+  uint32_t                   visible_count;
+
+  // Per draw scratch (kept to avoid allocating each frame)
+  std::vector<unsigned char> culled;
+  std::vector<GLsizei>       counts;
+  std::vector<const GLvoid*> offsets;
+};
+
+#endif
@@ -0,0 +1,390 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    mipbuilder.h
+//	Purpose: CPU mipmap generation with box or Kaiser filters. Color is
+//           filtered in linear light (sRGB decoded) and normal maps are
+//           renormalized. Filter loops are SSE/AVX (selected at compile
+//           time like the matrix kernels). Does not use OpenGL so it can
+//           run on loader threads and in offline tools.
+//
+//============================================================================
+
+#ifndef __MIPBUILDER_H
+#define __MIPBUILDER_H
+
+#include <math.h>
+#include <vector>
+#include "geometry/matrix_simd.h"
+#include "scene/imagedecode.h"
+
+// Mipmap filters. Box averages the texels each level texel covers. Kaiser
+// is a windowed sinc (width 3, alpha 4): sharper minification with less
+// aliasing at about 6x the cost.
+enum MipFilter { MIP_FILTER_BOX, MIP_FILTER_KAISER };
+
+// What the texels hold. Selects how they are filtered.
+//   MIP_COLOR_SRGB    sRGB color: filtered in linear light, alpha linearly
+//   MIP_COLOR_LINEAR  Data filtered as stored (bump maps, masks)
+//   MIP_NORMAL_MAP    Tangent space normals: filtered and renormalized
+enum MipContent { MIP_COLOR_SRGB, MIP_COLOR_LINEAR, MIP_NORMAL_MAP };
+
+// Kaiser filter window (in level texels) and shape
+const float kMipKaiserWidth = 3.0f;
+const float kMipKaiserAlpha = 4.0f;
+
+/**
+ * Get the number of mipmap levels below a base image (to 1x1).
+ * @param  width   Base width.
+ * @param  height  Base height.
+ * @return  Returns the number of levels, not counting the base.
+ */
+inline int MipLevelCount(int width, int height) {
+  int count = 0;
+  while (width > 1 || height > 1) {
+    width = (width > 1) ? width / 2 : 1;
+    height = (height > 1) ? height / 2 : 1;
+    count++;
+  }
+  return count;
+}
+
+// sRGB to linear for each 8 bit value
+inline const float* MipSRGBToLinearTable() {
+  static float table[256];
+  static bool initialized = false;
+  if (!initialized) {
+    for (int i = 0; i < 256; i++) {
+      float c = i / 255.0f;
+      table[i] = (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    initialized = true;
+  }
+  return table;
+}
+
+// Linear to 8 bit sRGB, indexed by linear * 4095
+inline const unsigned char* MipLinearToSRGBTable() {
+  static unsigned char table[4096];
+  static bool initialized = false;
+  if (!initialized) {
+    for (int i = 0; i < 4096; i++) {
+      float c = i / 4095.0f;
+      float s = (c <= 0.0031308f) ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+      table[i] = static_cast<unsigned char>(s * 255.0f + 0.5f);
+    }
+    initialized = true;
+  }
+  return table;
+}
+
+// Zeroth order modified Bessel function of the first kind
+inline float MipBesselI0(const float x) {
+  float sum = 1.0f;
+  float term = 1.0f;
+  float q = x * x * 0.25f;
+  for (int k = 1; k < 32; k++) {
+    term *= q / static_cast<float>(k * k);
+    sum += term;
+    if (term < sum * 1.0e-7f)
+      break;
+  }
+  return sum;
+}
+
+// Kaiser windowed sinc at x (level texels)
+inline float MipKaiser(const float x) {
+  if (fabsf(x) >= kMipKaiserWidth)
+    return 0.0f;
+  float px = 3.14159265f * x;
+  float sinc = (fabsf(x) < 1.0e-6f) ? 1.0f : sinf(px) / px;
+  float t = x / kMipKaiserWidth;
+  return sinc * MipBesselI0(kMipKaiserAlpha * sqrtf(1.0f - t * t)) / MipBesselI0(kMipKaiserAlpha);
+}
+
+// Filter taps for one axis. Each destination texel reads taps source
+// texels starting at first (clamped to the edge when the window runs off
+// the image).
+struct MipTaps {
+  int                taps;
+  std::vector<int>   index;     // dst * taps source texel indices
+  std::vector<float> weight;    // dst * taps weights (sum to 1)
+};
+
+// Build the taps to resample src texels to dst texels. The Kaiser window
+// is never narrower than a source texel (when magnifying).
+inline void MipBuildTaps(const MipFilter filter, const int src, const int dst, MipTaps& t) {
+  float scale = static_cast<float>(src) / dst;
+  float support = (scale > 1.0f) ? scale : 1.0f;
+  float radius = (filter == MIP_FILTER_BOX) ? scale * 0.5f : kMipKaiserWidth * support;
+  t.taps = 1;
+  for (int x = 0; x < dst; x++) {
+    float center = (x + 0.5f) * scale;
+    int n = static_cast<int>(ceilf(center + radius) - floorf(center - radius));
+    t.taps = (n > t.taps) ? n : t.taps;
+  }
+  t.index.assign(static_cast<size_t>(dst) * t.taps, 0);
+  t.weight.assign(static_cast<size_t>(dst) * t.taps, 0.0f);
+  for (int x = 0; x < dst; x++) {
+    float center = (x + 0.5f) * scale;
+    int first = static_cast<int>(floorf(center - radius));
+    float sum = 0.0f;
+    for (int i = 0; i < t.taps; i++) {
+      int s = first + i;
+      float w;
+      if (filter == MIP_FILTER_BOX) {
+        float lo = (s > center - radius) ? static_cast<float>(s) : center - radius;
+        float hi = (s + 1 < center + radius) ? static_cast<float>(s + 1) : center + radius;
+        w = (hi > lo) ? hi - lo : 0.0f;
+      }
+      else
+        w = MipKaiser((s + 0.5f - center) / support);
+      t.index[x * t.taps + i] = (s < 0) ? 0 : ((s >= src) ? src - 1 : s);
+      t.weight[x * t.taps + i] = w;
+      sum += w;
+    }
+    for (int i = 0; i < t.taps; i++)
+      t.weight[x * t.taps + i] /= sum;
+  }
+}
+
+// Horizontal pass over one row of RGBA float texels
+inline void MipFilterRow(const float* src, const MipTaps& t, const int dst_width, float* out) {
+  for (int x = 0; x < dst_width; x++) {
+    const int* index = &t.index[x * t.taps];
+    const float* weight = &t.weight[x * t.taps];
+#ifdef GEOMETRY_USE_SSE
+    __m128 acc = _mm_setzero_ps();
+    for (int i = 0; i < t.taps; i++)
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(src + index[i] * 4), _mm_set1_ps(weight[i])));
+    _mm_storeu_ps(out + x * 4, acc);
+#else
+    float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < t.taps; i++) {
+      const float* p = src + index[i] * 4;
+      for (int k = 0; k < 4; k++)
+        acc[k] += p[k] * weight[i];
+    }
+    for (int k = 0; k < 4; k++)
+      out[x * 4 + k] = acc[k];
+#endif
+  }
+}
+
+// Vertical pass: out = sum of weight[i] * rows[i], n floats per row
+inline void MipFilterColumn(const float* const* rows, const float* weight, const int taps,
+                            const int n, float* out) {
+  int j = 0;
+#if defined(GEOMETRY_USE_AVX)
+  for (; j + 8 <= n; j += 8) {
+    __m256 acc = _mm256_setzero_ps();
+    for (int i = 0; i < taps; i++)
+      acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(rows[i] + j),
+                                             _mm256_set1_ps(weight[i])));
+    _mm256_storeu_ps(out + j, acc);
+  }
+#endif
+#if defined(GEOMETRY_USE_SSE)
+  for (; j + 4 <= n; j += 4) {
+    __m128 acc = _mm_setzero_ps();
+    for (int i = 0; i < taps; i++)
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(rows[i] + j), _mm_set1_ps(weight[i])));
+    _mm_storeu_ps(out + j, acc);
+  }
+#endif
+  for (; j < n; j++) {
+    float acc = 0.0f;
+    for (int i = 0; i < taps; i++)
+      acc += rows[i][j] * weight[i];
+    out[j] = acc;
+  }
+}
+
+// Convert 8 bit texels to filter space (linear light, or -1..1 normals)
+inline void MipToFloat(const unsigned char* src, const int n, const MipContent content,
+                       float* out) {
+  const float* srgb = MipSRGBToLinearTable();
+  for (int i = 0; i < n; i++) {
+    const unsigned char* p = src + i * 4;
+    float* o = out + i * 4;
+    if (content == MIP_COLOR_SRGB) {
+      o[0] = srgb[p[0]];
+      o[1] = srgb[p[1]];
+      o[2] = srgb[p[2]];
+    }
+    else if (content == MIP_NORMAL_MAP) {
+      o[0] = p[0] * (2.0f / 255.0f) - 1.0f;
+      o[1] = p[1] * (2.0f / 255.0f) - 1.0f;
+      o[2] = p[2] * (2.0f / 255.0f) - 1.0f;
+    }
+    else {
+      o[0] = p[0] * (1.0f / 255.0f);
+      o[1] = p[1] * (1.0f / 255.0f);
+      o[2] = p[2] * (1.0f / 255.0f);
+    }
+    o[3] = p[3] * (1.0f / 255.0f);
+  }
+}
+
+// Convert filtered texels back to 8 bits (clamping Kaiser overshoot).
+// Normals are renormalized.
+inline void MipToBytes(const float* src, const int n, const MipContent content,
+                       unsigned char* out) {
+  const unsigned char* srgb = MipLinearToSRGBTable();
+#ifdef GEOMETRY_USE_SSE
+  const float color_scale = (content == MIP_COLOR_SRGB) ? 4095.0f : 255.0f;
+  const __m128 scale = _mm_set_ps(255.0f, color_scale, color_scale, color_scale);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 half = _mm_set1_ps(0.5f);
+#endif
+  for (int i = 0; i < n; i++) {
+    const float* p = src + i * 4;
+    unsigned char* o = out + i * 4;
+    float c[3] = { p[0], p[1], p[2] };
+    if (content == MIP_NORMAL_MAP) {
+      float len2 = c[0] * c[0] + c[1] * c[1] + c[2] * c[2];
+      float s = (len2 > 1.0e-12f) ? 1.0f / sqrtf(len2) : 0.0f;
+      for (int k = 0; k < 3; k++)
+        c[k] = (c[k] * s + 1.0f) * 0.5f;
+      if (s == 0.0f)
+        c[2] = 1.0f;
+    }
+#ifdef GEOMETRY_USE_SSE
+    // Clamp and scale all four channels at once (sRGB channels to table
+    // indices)
+    __m128 v = _mm_min_ps(_mm_max_ps(_mm_set_ps(p[3], c[2], c[1], c[0]), zero), one);
+    __m128i q = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half));
+    int32_t n4[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(n4), q);
+    for (int k = 0; k < 3; k++)
+      o[k] = (content == MIP_COLOR_SRGB) ? srgb[n4[k]] : static_cast<unsigned char>(n4[k]);
+    o[3] = static_cast<unsigned char>(n4[3]);
+#else
+    for (int k = 0; k < 3; k++) {
+      float v = (c[k] < 0.0f) ? 0.0f : ((c[k] > 1.0f) ? 1.0f : c[k]);
+      o[k] = (content == MIP_COLOR_SRGB) ? srgb[static_cast<int>(v * 4095.0f + 0.5f)] :
+                                           static_cast<unsigned char>(v * 255.0f + 0.5f);
+    }
+    float a = (p[3] < 0.0f) ? 0.0f : ((p[3] > 1.0f) ? 1.0f : p[3]);
+    o[3] = static_cast<unsigned char>(a * 255.0f + 0.5f);
+#endif
+  }
+}
+
+// Make the conversion tables. Call from the main thread before building
+// mipmaps on other threads (function local statics are not thread safe
+// in Visual Studio 2013).
+inline void MipInitTables() {
+  MipSRGBToLinearTable();
+  MipLinearToSRGBTable();
+}
+
+/**
+ * Resample an RGBA image to another size with the mipmap filters (used to
+ * fit images to the layer size of a texture array). Thread safe (after
+ * MipInitTables).
+ * @param  src      Source image.
+ * @param  width    Width of the resampled image.
+ * @param  height   Height of the resampled image.
+ * @param  filter   Filter.
+ * @param  content  What the texels hold.
+ * @param  dst      Resampled image (out).
+ */
+inline void ResampleImage(const TextureImage& src, const int width, const int height,
+                          const MipFilter filter, const MipContent content, TextureImage& dst) {
+  MipTaps tx;
+  MipTaps ty;
+  MipBuildTaps(filter, src.width, width, tx);
+  MipBuildTaps(filter, src.height, height, ty);
+
+  // Rows
+  std::vector<float> src_row(static_cast<size_t>(src.width) * 4);
+  std::vector<float> rows(static_cast<size_t>(width) * src.height * 4);
+  for (int y = 0; y < src.height; y++) {
+    MipToFloat(&src.pixels[static_cast<size_t>(y) * src.width * 4], src.width, content,
+               &src_row[0]);
+    MipFilterRow(&src_row[0], tx, width, &rows[static_cast<size_t>(y) * width * 4]);
+  }
+
+  // Columns, converted back to bytes a row at a time
+  std::vector<float> dst_row(static_cast<size_t>(width) * 4);
+  std::vector<const float*> row_ptrs(ty.taps);
+  dst.width = width;
+  dst.height = height;
+  dst.pixels.resize(static_cast<size_t>(width) * height * 4);
+  for (int y = 0; y < height; y++) {
+    for (int i = 0; i < ty.taps; i++)
+      row_ptrs[i] = &rows[static_cast<size_t>(ty.index[y * ty.taps + i]) * width * 4];
+    MipFilterColumn(&row_ptrs[0], &ty.weight[y * ty.taps], ty.taps, width * 4, &dst_row[0]);
+    MipToBytes(&dst_row[0], width, content, &dst.pixels[static_cast<size_t>(y) * width * 4]);
+  }
+}
+
+/**
+ * Build the mipmap chain of an RGBA image, down to 1x1. Each level is
+ * filtered from the float result of the level above (not the rounded 8
+ * bit texels), separably: rows first, then columns. Edges are clamped.
+ * Thread safe (after MipInitTables) - runs on the calling thread.
+ * @param  base     Base (level 0) image.
+ * @param  filter   Filter.
+ * @param  content  What the texels hold.
+ * @param  levels   Levels 1 to n (out).
+ */
+inline void BuildMipChain(const TextureImage& base, const MipFilter filter,
+                          const MipContent content, std::vector<TextureImage>& levels) {
+  levels.resize(MipLevelCount(base.width, base.height));
+  int src_w = base.width;
+  int src_h = base.height;
+  std::vector<float> src;          // Float texels of the level above (not for the base)
+  std::vector<float> src_row(static_cast<size_t>(src_w) * 4);
+  std::vector<float> rows;         // Horizontally filtered rows
+  std::vector<float> dst;
+  std::vector<const float*> row_ptrs;
+  MipTaps tx;
+  MipTaps ty;
+  for (size_t level = 0; level < levels.size(); level++) {
+    int dst_w = (src_w > 1) ? src_w / 2 : 1;
+    int dst_h = (src_h > 1) ? src_h / 2 : 1;
+    MipBuildTaps(filter, src_w, dst_w, tx);
+    MipBuildTaps(filter, src_h, dst_h, ty);
+
+    // Rows. The base is converted to float a row at a time.
+    rows.resize(static_cast<size_t>(dst_w) * src_h * 4);
+    for (int y = 0; y < src_h; y++) {
+      const float* row;
+      if (level == 0) {
+        MipToFloat(&base.pixels[static_cast<size_t>(y) * src_w * 4], src_w, content, &src_row[0]);
+        row = &src_row[0];
+      }
+      else
+        row = &src[static_cast<size_t>(y) * src_w * 4];
+      MipFilterRow(row, tx, dst_w, &rows[static_cast<size_t>(y) * dst_w * 4]);
+    }
+
+    // Columns
+    dst.resize(static_cast<size_t>(dst_w) * dst_h * 4);
+    row_ptrs.resize(ty.taps);
+    for (int y = 0; y < dst_h; y++) {
+      for (int i = 0; i < ty.taps; i++)
+        row_ptrs[i] = &rows[static_cast<size_t>(ty.index[y * ty.taps + i]) * dst_w * 4];
+      MipFilterColumn(&row_ptrs[0], &ty.weight[y * ty.taps], ty.taps, dst_w * 4,
+                      &dst[static_cast<size_t>(y) * dst_w * 4]);
+    }
+
+    TextureImage& out = levels[level];
+    out.width = dst_w;
+    out.height = dst_h;
+    out.pixels.resize(static_cast<size_t>(dst_w) * dst_h * 4);
+    MipToBytes(&dst[0], dst_w * dst_h, content, &out.pixels[0]);
+
+    src.swap(dst);
+    src_w = dst_w;
+    src_h = dst_h;
+  }
+}
+
+#endif
@@ -19,10 +19,9 @@
 #include "assimp/PostProcess.h"
 #include "assimp/Scene.h"
 
-// DevIL
-#include "IL/il.h"
-
 #include <math.h>
+#include <stddef.h>
+#include <chrono>
 #include <fstream>
 #include <map>
 #include <string>
@@ -31,19 +30,28 @@
 // Note - this does not handle node hierarchy and transformations
 // It does handle multiple meshes and textures.
 
+// Post processing applied by the importer (part of the mesh cache key)
+const uint32_t kModelImportFlags = aiProcessPreset_TargetRealtime_Quality;
+
 // Information to render each assimp node
 struct ModelMesh {
   bool has_texture;
   GLuint texture_id;
-  int numFaces;
+  GLsizei index_count;
   GLuint vao;
-  GLuint position_vbo;
-  GLuint normal_vbo;
-  GLuint texture_vbo;
+  GLuint vertex_vbo;    // Interleaved ModelVertex or compact vertices
+  GLuint index_vbo;
+  CompactVertexLayout layout;    // Layout of the vertex buffer (if kCompactVertices)
+  MeshletList meshlets;          // Meshlets culled each draw (none for small meshes)
+  AABB aabb;                     // Bounds of the mesh (model coordinates)
+  BoundingSphere sphere;
 };
 
 /**
- * Node that loads a model using Assimp.
+ * Node that loads a model using Assimp. Imported meshes are saved to a
+ * binary cache next to the model (see meshcache.h) and later runs load
+ * the cache instead of running the importer. The cache is rebuilt when
+ * the model file or import flags change.
  */
 class ModelNode : public SceneNode {
 public:
@@ -56,21 +64,36 @@ public:
    */
   ModelNode(const int position_loc, const int normal_loc, const int texture_loc, 
             const std::string& filename) {
-      ImportModelFromFile(filename);
-      GenVAOsAndUniformBuffer(scene, position_loc, normal_loc, texture_loc);
-   }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    FindModelFile(filename);
+
+    // The cache is keyed by the model file contents
+    MappedFile source;
+    if (!source.Open(model_filename)) {
+      std::cout << "Couldn't open file: " << model_filename << std::endl;
+      system("pause");
+      exit(1);
+    }
+    uint64_t hash = MeshCacheHash(source.GetData(), source.GetSize(), kModelImportFlags);
+    source.Close();
+
+    bool cached = LoadCache(hash, position_loc, normal_loc, texture_loc);
+    if (!cached)
+      ImportModel(hash, position_loc, normal_loc, texture_loc);
+    double ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+    printf("ModelNode: %s %s in %.1f ms (%u meshes)\n", model_filename.c_str(),
+           cached ? "loaded from cache" : "imported", ms, static_cast<uint32_t>(meshes.size()));
+  }
 
   ~ModelNode() {
     for (uint32_t n = 0; n < meshes.size(); ++n) {
       // Delete vertex buffer objects, VAO, and texture objects
-      if (meshes[n].position_vbo > 0)
-        glDeleteBuffers(1, &meshes[n].position_vbo);
-      if (meshes[n].normal_vbo > 0)
-        glDeleteBuffers(1, &meshes[n].normal_vbo);
-      if (meshes[n].texture_vbo > 0)
-        glDeleteBuffers(1, &meshes[n].texture_vbo);
+      glDeleteBuffers(1, &meshes[n].vertex_vbo);
+      glDeleteBuffers(1, &meshes[n].index_vbo);
       glDeleteVertexArrays(1, &meshes[n].vao);
       if (meshes[n].has_texture) {
+        TextureLoader::Get().Cancel(meshes[n].texture_id);
         glDeleteTextures(1, &meshes[n].texture_id);
       }
     }
@@ -84,198 +107,308 @@ public:
     // Draw all meshes assigned to this node
     for (uint32_t n = 0; n < meshes.size(); ++n) {
       if (meshes[n].has_texture) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, meshes[n].texture_id);
-        glUniform1i(scene_state.usetexture_loc, 1);   // Tell shader we are using textures
-        glUniform1i(scene_state.textureunit_loc, 0);  // Texture unit 0
+        scene_state.gl_state.BindTexture(0, GL_TEXTURE_2D, meshes[n].texture_id);
+        scene_state.gl_state.Uniform1i(scene_state.usetexture_loc, 1);   // Tell shader we are using textures
+        scene_state.gl_state.Uniform1i(scene_state.textureunit_loc, 0);  // Texture unit 0
+        scene_state.gl_state.Uniform1i(scene_state.texturelayer_loc, -1);  // Not an array
       }
       else {
-        glUniform1i(scene_state.usetexture_loc, 0);
+        scene_state.gl_state.Uniform1i(scene_state.usetexture_loc, 0);
       }
-      glBindVertexArray(meshes[n].vao);
-      glDrawElements(GL_TRIANGLES, meshes[n].numFaces * 3, GL_UNSIGNED_INT, 0);
+      bool quantized = kCompactVertices && IsQuantized(&meshes[n].layout);
+      if (quantized)
+        SetDequantizeMatrices(scene_state, &meshes[n].layout);
+      scene_state.gl_state.BindVertexArray(meshes[n].vao);
+      if (meshes[n].meshlets.IsEmpty())
+        glDrawElements(GL_TRIANGLES, meshes[n].index_count, GL_UNSIGNED_INT, 0);
+      else
+        meshes[n].meshlets.Draw(scene_state, GL_UNSIGNED_INT);
+      if (quantized)
+        SetDequantizeMatrices(scene_state, nullptr);
+    }
+  }
+
+  /**
+   * Get the bounding box of all meshes (model coordinates).
+   * @return  Returns the bounding box.
+   */
+  const AABB& GetAABB() const {
+    return aabb;
+  }
+
+  /**
+   * Get the bounding sphere of all meshes (model coordinates).
+   * @return  Returns the bounding sphere.
+   */
+  const BoundingSphere& GetBoundingSphere() const {
+    return sphere;
+  }
+
+  /**
+   * Compile. Model meshes bind their own textures so the model is drawn
+   * by traversal.
+   * @param  list  Render list being built.
+   */
+  void Compile(RenderList& list) {
+    list.AddNode(this);
+  }
+
+  /**
+   * Get the BVH over the triangles of all meshes (model coordinates).
+   * Built on first use from positions kept as the meshes are added, which
+   * are then freed.
+   * @return  Returns the triangle BVH.
+   */
+  const TriangleBVH* GetTriangleBVH() {
+    if (triangle_bvh.IsEmpty() && !bvh_indices.empty()) {
+      triangle_bvh.Build(&bvh_positions[0], 3 * sizeof(float), &bvh_indices[0],
+                         static_cast<uint32_t>(bvh_indices.size()));
+      std::vector<float>().swap(bvh_positions);
+      std::vector<uint32_t>().swap(bvh_indices);
     }
+    return &triangle_bvh;
+  }
+
+  /**
+   * Add the model's triangles to a scene BVH.
+   * @param  bvh  Scene BVH being collected.
+   */
+  void CollectBVH(SceneBVH& bvh) {
+    bvh.AddInstance(this, GetTriangleBVH());
+    SceneNode::CollectBVH(bvh);
   }
 
 protected:
   std::vector<ModelMesh> meshes;
-  const aiScene* scene;
-  Assimp::Importer importer;
   std::string model_filename;
   std::string model_directory;
+  AABB aabb;               // Bounds of all meshes
+  BoundingSphere sphere;
+  TriangleBVH triangle_bvh;              // Over all meshes (built on first use)
+  std::vector<float> bvh_positions;      // Positions and triangles of all meshes
+  std::vector<uint32_t> bvh_indices;     // until the triangle BVH is built
+
+  // Bound of the meshes
+  virtual AABB ComputeBound() {
+    return aabb;
+  }
 
   /**
-  * Import the model into a Assimp scene
-  */
-  void ImportModelFromFile(const std::string& filename) {
-    // Check if file exists (look in parent directory under model subdir)
+   * Find the model file (look in parent directory under model subdir)
+   */
+  void FindModelFile(const std::string& filename) {
     std::string full_path = "../model/" + filename;
-    std::ifstream fin(full_path.c_str());
-    if (!fin.fail()) {
-      fin.close();
-    } else {
+    if (!fileExists(full_path)) {
       // Try up 2 levels
       full_path = "../../model/" + filename;
-      std::ifstream fin(full_path.c_str());
-      if (!fin.fail()) {
-        fin.close();
-      } else {
+      if (!fileExists(full_path)) {
         std::cout << "Couldn't open file: " << full_path << std::endl;
-        std::cout << importer.GetErrorString() << std::endl;
         system("pause");
         exit(1);
       }
     }
     model_filename = full_path;
     model_directory = GetFilePath(full_path);
+  }
+
+  /**
+   * Load the meshes from the cache. Vertex and index data are uploaded
+   * straight from the mapped file.
+   * @return  Returns false if there is no cache for this model file.
+   */
+  bool LoadCache(const uint64_t hash, const int position_loc, const int normal_loc,
+                 const int texture_loc) {
+    MeshCacheReader cache;
+    if (!cache.Open(MeshCacheName(model_filename), hash, kModelImportFlags))
+      return false;
+    for (uint32_t n = 0; n < cache.GetMeshCount(); ++n) {
+      const MeshCacheEntry& e = cache.GetMesh(n);
+      AddMesh(cache.GetVertices(n), e.vertex_count, cache.GetIndices(n), e.index_count,
+              e.attributes, e.texture, position_loc, normal_loc, texture_loc);
+    }
+    return true;
+  }
 
-    scene = importer.ReadFile(model_filename, aiProcessPreset_TargetRealtime_Quality);
+  /**
+   * Import the model with Assimp, upload its meshes and save them to the
+   * cache.
+   */
+  void ImportModel(const uint64_t hash, const int position_loc, const int normal_loc,
+                   const int texture_loc) {
+    Assimp::Importer importer;
+    const aiScene* sc = importer.ReadFile(model_filename, kModelImportFlags);
 
     // If the import failed, report it
-    if (!scene) {
+    if (!sc) {
       std::cout << importer.GetErrorString() << std::endl;
       system("pause");
       exit(1);
     }
-//    std::cout << "Import of scene " << filename << " succeeded." << std::endl;
 
-    // Now we can access the file's contents. Everything will be cleaned up
-    // by the importer destructor
-  }
-
-  /**
-   * Load the model from a Assimp scene into VBOs.
-   */
-  void GenVAOsAndUniformBuffer(const aiScene *sc, const int vertexLoc, 
-                          const int normal_loc, const int texture_loc) {
-    ModelMesh model_mesh;
-    GLuint buffer;
-
-    // For each mesh
+    // Convert each mesh to interleaved vertices and a triangle list
+    std::vector<CachedMesh> cached(sc->mNumMeshes);
     for (uint32_t n = 0; n < sc->mNumMeshes; ++n) {
       const aiMesh* mesh = sc->mMeshes[n];
-
-      // create array with faces. Convert from Assimp format to array
-      uint32_t* faceArray = (uint32_t *)malloc(sizeof(uint32_t) * mesh->mNumFaces * 3);
-      uint32_t faceIndex = 0;
-      for (uint32_t t = 0; t < mesh->mNumFaces; ++t) {
-        const aiFace* face = &mesh->mFaces[t];
-        memcpy(&faceArray[faceIndex], face->mIndices, 3 * sizeof(uint32_t));
-        faceIndex += 3;
-      }
-      model_mesh.numFaces = sc->mMeshes[n]->mNumFaces;
-
-      // Generate Vertex Array Object for mesh
-      glGenVertexArrays(1, &(model_mesh.vao));
-      glBindVertexArray(model_mesh.vao);
-
-      // Buffer for faces
-      glGenBuffers(1, &buffer);
-      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
-      glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * mesh->mNumFaces * 3, faceArray, GL_STATIC_DRAW);
-
-      // buffer for vertex positions
-      if (mesh->HasPositions()) {
-        glGenBuffers(1, &buffer);
-        glBindBuffer(GL_ARRAY_BUFFER, buffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * mesh->mNumVertices, mesh->mVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(vertexLoc);
-        glVertexAttribPointer(vertexLoc, 3, GL_FLOAT, 0, 0, 0);
+      CachedMesh& c = cached[n];
+      c.attributes = (mesh->HasNormals() ? MESHCACHE_NORMALS : 0) |
+                     (mesh->HasTextureCoords(0) ? MESHCACHE_TEXCOORDS : 0);
+      c.vertices.resize(mesh->mNumVertices);
+      for (uint32_t k = 0; k < mesh->mNumVertices; ++k) {
+        ModelVertex& v = c.vertices[k];
+        memset(&v, 0, sizeof(v));
+        v.position[0] = mesh->mVertices[k].x;
+        v.position[1] = mesh->mVertices[k].y;
+        v.position[2] = mesh->mVertices[k].z;
+        if (mesh->HasNormals()) {
+          v.normal[0] = mesh->mNormals[k].x;
+          v.normal[1] = mesh->mNormals[k].y;
+          v.normal[2] = mesh->mNormals[k].z;
+        }
+        if (mesh->HasTextureCoords(0)) {
+          v.texcoord[0] = mesh->mTextureCoords[0][k].x;
+          v.texcoord[1] = mesh->mTextureCoords[0][k].y;
+        }
       }
 
-      // buffer for vertex normals
-      if (mesh->HasNormals()) {
-        glGenBuffers(1, &buffer);
-        glBindBuffer(GL_ARRAY_BUFFER, buffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * mesh->mNumVertices, mesh->mNormals, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(normal_loc);
-        glVertexAttribPointer(normal_loc, 3, GL_FLOAT, 0, 0, 0);
+      // Triangulated by the importer - skip point and line faces
+      c.indices.reserve(mesh->mNumFaces * 3);
+      for (uint32_t t = 0; t < mesh->mNumFaces; ++t) {
+        const aiFace& face = mesh->mFaces[t];
+        if (face.mNumIndices == 3)
+          c.indices.insert(c.indices.end(), face.mIndices, face.mIndices + 3);
       }
 
-      // buffer for vertex texture coordinates
-      if (mesh->HasTextureCoords(0)) {
-        float* texCoords = (float *)malloc(sizeof(float) * 2 * mesh->mNumVertices);
-        for (uint32_t k = 0; k < mesh->mNumVertices; ++k) {
-            texCoords[k * 2] = mesh->mTextureCoords[0][k].x;
-            texCoords[k * 2 + 1] = mesh->mTextureCoords[0][k].y;
-        }
-
-        glGenBuffers(1, &buffer);
-        glBindBuffer(GL_ARRAY_BUFFER, buffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 2 * mesh->mNumVertices, texCoords, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(texture_loc);
-        glVertexAttribPointer(texture_loc, 2, GL_FLOAT, 0, 0, 0);
+      // Reorder for the vertex cache and overdraw. The cache stores the
+      // optimized order so this only runs on import.
+      if (c.indices.size() >= 3 && !c.vertices.empty()) {
+        std::vector<uint32_t> remap;
+        MeshOptimizeStats stats = OptimizeMesh(c.indices, c.vertices[0].position, sizeof(ModelVertex),
+                                               mesh->mNumVertices, remap);
+        RemapVertices(c.vertices, remap);
+        printf("ModelNode: mesh %u %u triangles, ACMR %.3f -> %.3f\n", n, stats.triangles,
+               stats.acmr_before, stats.acmr_after);
       }
 
-      // unbind buffers
-      glBindVertexArray(0);
-      glBindBuffer(GL_ARRAY_BUFFER, 0);
-      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-      // Create material uniform buffer
       aiMaterial *mtl = sc->mMaterials[mesh->mMaterialIndex];
       aiString texPath;	// contains filename of texture
-      if (AI_SUCCESS == mtl->GetTexture(aiTextureType_DIFFUSE, 0, &texPath)) {
-        std::string texFilename(texPath.data);
-        if (!fileExists(texFilename)) {
-            texFilename = model_directory;
-            texFilename += "/";
-            texFilename += texPath.data;
-        }
+      if (AI_SUCCESS == mtl->GetTexture(aiTextureType_DIFFUSE, 0, &texPath))
+        c.texture = texPath.data;
 
-        // Load the image file
-        // Bind a DevIL image
-        ILuint id;
-        ilGenImages(1, &id);
-        ilBindImage(id);
-        ILuint err = ilGetError();
-        if (err) {
-          printf("Error binding image. %s %d\n", texFilename.c_str(), err);
-          system("pause");
-          exit(1);
-        }
+      AddMesh(c.vertices.empty() ? nullptr : &c.vertices[0], mesh->mNumVertices,
+              c.indices.empty() ? nullptr : &c.indices[0], static_cast<uint32_t>(c.indices.size()),
+              c.attributes, c.texture, position_loc, normal_loc, texture_loc);
+    }
 
-        // Load image using lower left origin. Convert to RGBA
-        ilOriginFunc(IL_ORIGIN_LOWER_LEFT);
-        ilEnable(IL_ORIGIN_SET);
-        ilLoadImage(texFilename.c_str());
-        ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
-        err = ilGetError();
-        if (err) {
-          printf("Error loading texture. %s %d\n", texFilename.c_str(), err);
-          system("pause");
-          exit(1);
-        }
+    if (!WriteMeshCache(MeshCacheName(model_filename), hash, kModelImportFlags, cached))
+      printf("ModelNode: could not write mesh cache %s\n", MeshCacheName(model_filename).c_str());
+  }
 
-        // Get image dimensions and data
-        int w = ilGetInteger(IL_IMAGE_WIDTH);
-        int h = ilGetInteger(IL_IMAGE_HEIGHT);
-        unsigned char* data = ilGetData();
-        if (ilGetError() != IL_NO_ERROR) {
-            printf("Error getting image data\n");
-            system("pause");
-            exit(1);
-        }
+  /**
+   * Create the VAO and buffers for a mesh and load its texture. A mesh with
+   * no vertices (vertices may then be NULL) has nothing to draw and is
+   * skipped.
+   */
+  void AddMesh(const ModelVertex* vertices, const uint32_t vertex_count, const uint32_t* indices,
+               const uint32_t index_count, const uint32_t attributes, const std::string& texture,
+               const int position_loc, const int normal_loc, const int texture_loc) {
+    if (vertices == nullptr || vertex_count == 0)
+      return;
 
-        // Open GL stuff to generate texture ID, bind texture, load image data, generate mipmaps, set wrapping and filter modes...
-        glGenTextures(1, &model_mesh.texture_id);
-        glBindTexture(GL_TEXTURE_2D, model_mesh.texture_id);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    ModelMesh model_mesh;
+    model_mesh.index_count = index_count;
+
+    // Generate Vertex Array Object for mesh
+    glGenVertexArrays(1, &model_mesh.vao);
+    glBindVertexArray(model_mesh.vao);
+
+    // Buffer for faces
+    glGenBuffers(1, &model_mesh.index_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model_mesh.index_vbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * index_count, indices, GL_STATIC_DRAW);
+
+    // One interleaved buffer for positions, normals and texture coordinates
+    // (packed to a compact layout unless kCompactVertices is false)
+    glGenBuffers(1, &model_mesh.vertex_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, model_mesh.vertex_vbo);
+    if (kCompactVertices) {
+      VertexSource source;
+      source.position = vertices[0].position;
+      source.normal = (attributes & MESHCACHE_NORMALS) ? vertices[0].normal : nullptr;
+      source.texcoord = (attributes & MESHCACHE_TEXCOORDS) ? vertices[0].texcoord : nullptr;
+      source.tangent = nullptr;
+      source.bitangent = nullptr;
+      source.stride = sizeof(ModelVertex);
+      source.count = vertex_count;
+      model_mesh.layout = ChooseVertexLayout(source);
+      std::vector<unsigned char> packed;
+      PackVertices(source, model_mesh.layout, packed);
+      glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.empty() ? nullptr : &packed[0],
+                   GL_STATIC_DRAW);
+      SetVertexAttributes(model_mesh.layout, position_loc, normal_loc, texture_loc);
+    }
+    else {
+      glBufferData(GL_ARRAY_BUFFER, sizeof(ModelVertex) * vertex_count, vertices, GL_STATIC_DRAW);
+      glEnableVertexAttribArray(position_loc);
+      glVertexAttribPointer(position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex),
+                            (void*)offsetof(ModelVertex, position));
+      if (attributes & MESHCACHE_NORMALS) {
+        glEnableVertexAttribArray(normal_loc);
+        glVertexAttribPointer(normal_loc, 3, GL_FLOAT, GL_FALSE, sizeof(ModelVertex),
+                              (void*)offsetof(ModelVertex, normal));
+      }
+      if (attributes & MESHCACHE_TEXCOORDS) {
+        glEnableVertexAttribArray(texture_loc);
+        glVertexAttribPointer(texture_loc, 2, GL_FLOAT, GL_FALSE, sizeof(ModelVertex),
+                              (void*)offsetof(ModelVertex, texcoord));
+      }
+    }
 
-        // Set wrap, repeat mode
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // unbind buffers
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    // Bounds of the mesh, merged into the bounds of the model
+    model_mesh.aabb.Create(vertices[0].position, sizeof(ModelVertex), vertex_count);
+    model_mesh.sphere.Create(vertices[0].position, sizeof(ModelVertex), vertex_count);
+    sphere = aabb.IsEmpty() ? model_mesh.sphere : sphere.Merge(model_mesh.sphere);
+    aabb.Merge(model_mesh.aabb);
+    InvalidateGraph();
+
+    // Keep the positions and triangles for the triangle BVH
+    if (index_count > 0) {
+      uint32_t base = static_cast<uint32_t>(bvh_positions.size() / 3);
+      for (uint32_t k = 0; k < vertex_count; ++k)
+        bvh_positions.insert(bvh_positions.end(), vertices[k].position, vertices[k].position + 3);
+      for (uint32_t k = 0; k < index_count; ++k)
+        bvh_indices.push_back(base + indices[k]);
+    }
 
-        model_mesh.has_texture = true;
-      }
-      else {
-        model_mesh.has_texture = false;
+    // Split large meshes into meshlets for culling
+    if (index_count > 0) {
+      model_mesh.meshlets.Build(indices, index_count, vertices[0].position, sizeof(ModelVertex),
+                                vertex_count);
+    }
+
+    if (!texture.empty()) {
+      std::string texFilename(texture);
+      if (!fileExists(texFilename)) {
+          texFilename = model_directory;
+          texFilename += "/";
+          texFilename += texture;
       }
-      meshes.push_back(model_mesh);
+
+      // Decoded and mipmapped in the background (see TextureLoader).
+      // A texture that fails to load keeps the placeholder.
+      model_mesh.texture_id = TextureLoader::Get().LoadFile(texFilename, TEXTURE_COLOR,
+          GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_NEAREST, GL_LINEAR);
+      model_mesh.has_texture = true;
+    }
+    else {
+      model_mesh.texture_id = 0;
+      model_mesh.has_texture = false;
     }
+    meshes.push_back(model_mesh);
   }
 
   std::string GetFilePath(const std::string& str) {
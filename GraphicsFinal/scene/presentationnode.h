@@ -12,8 +12,6 @@
 #ifndef __PRESENTATIONNODE_H
 #define __PRESENTATIONNODE_H
 
-// DevIL include -just the base image library
-#include <IL/il.h>
 #include <sstream>
 /**
 * Presentation node. Holds material properties.
@@ -49,6 +47,14 @@ public:
         initialize();
 	}
 
+	/**
+	 * Destructor. Releases the textures.
+	 */
+	virtual ~PresentationNode() {
+		ReleaseTextures();
+		TextureCache::Get().Release(normalMapID);
+	}
+
     /**
      * Initialize the presentation node attributes
      */
@@ -63,6 +69,14 @@ public:
         
         useNormalMap = 0;
         normalMapID = 0;      // Default to no normal map
+
+        texture_array = nullptr;   // Default to 2D textures
+        texture_layer = -1;
+        normal_array = nullptr;
+        normal_layer = -1;
+
+        video = nullptr;      // Default to no video
+        off_texture = 0;
     }
 
 	/**
@@ -79,6 +93,7 @@ public:
 	 */
 	void SetMaterialDiffuse(const Color4& c) {
 		material_diffuse = c;
+		InvalidateGraph();
 	}
 
 	/**
@@ -89,6 +104,7 @@ public:
 	void SetMaterialAmbientAndDiffuse(const Color4& c) {
 		material_ambient = c;
 		material_diffuse = c;
+		InvalidateGraph();
 	}
 
 	/**
@@ -116,7 +132,9 @@ public:
 	}
 
 	/**
-	 * Set the texture to used for the material.
+	 * Set the texture to used for the material. Textures are shared through
+	 * the TextureCache and loaded in the background (see TextureLoader) - a
+	 * placeholder is shown until then.
 	 * @param  fname  Texture image filename
 	 * @param  wrap_s  OpenGL wrap option (s)
 	 * @param  wrap_t  OpenGL wrap option (t)
@@ -125,169 +143,55 @@ public:
 	 */
 	void SetTexture(const std::string& fname, GLuint wrap_s, GLuint wrap_t,
 		GLuint min_filter, GLuint mag_filter) {
-		// Bind a DevIL image
-		ILuint id;
-		ilGenImages(1, &id);
-		ilBindImage(id);
-		ILuint err = ilGetError();
-		if (err) {
-			printf("Error binding image. %s %d\n", fname, err);
-			return;
-		}
-
-		// Load image using lower left origin. Convert to RGBA. Tyr loading from 
-		// ../textures, if that fails try ../../textures
-		ilOriginFunc(IL_ORIGIN_LOWER_LEFT);
-		ilEnable(IL_ORIGIN_SET);
-		std::string full_path_name = "../textures/" + fname;
-		ilLoadImage(full_path_name.c_str());
-		err = ilGetError();
-		if (err) {
-			full_path_name = "../../textures/" + fname;
-			ilLoadImage(full_path_name.c_str());
-		}
-		err = ilGetError();
-		if (err) {
-			printf("Error loading texture. %s %d\n", fname, err);
-			return;
-		}
-		ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
-		err = ilGetError();
-		if (err) {
-			printf("Could not convert texture to RGBA. %s %d\n", fname, err);
-			return;
-		}
-
-		// Get image dimensions and data
-		int w = ilGetInteger(IL_IMAGE_WIDTH);
-		int h = ilGetInteger(IL_IMAGE_HEIGHT);
-
-		unsigned char* data = ilGetData();
-		if (ilGetError() != IL_NO_ERROR) {
-			std::cout << "Error getting image data" << std::endl;
-			return;
-		}
-
-		// Generate an OpenGL textureID, bind it
-		glGenTextures(1, &texture_id);
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-
-		// Load image data and generate mipmaps
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h,
-			0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		// Set wrapping mode
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_s);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_t);
-
-		// Set texture filters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+		GLuint texture = TextureCache::Get().Acquire(fname, TEXTURE_COLOR, wrap_s, wrap_t,
+			min_filter, mag_filter);
+		ReleaseTextures();
+		texture_id = texture;
+	}
 
-		// Bind null texture
-		glBindTexture(GL_TEXTURE_2D, 0);
+	/**
+	 * Use a layer of a texture array for the material texture. Materials
+	 * sharing an array switch textures without a texture bind. The array
+	 * is not owned by the material.
+	 * @param  array  Color texture array
+	 * @param  fname  Texture image filename
+	 * @return  Returns false if the array is full (no texture is used).
+	 */
+	bool SetTextureLayer(TextureArray* array, const std::string& fname) {
+		int layer = array->AddLayer(fname);
+		ReleaseTextures();
+		if (layer < 0)
+			return false;
+		texture_array = array;
+		texture_layer = layer;
+		return true;
 	}
 
 	/**
-	* Set the texture to used for the material.
+	* Set a video texture for the material. Frames are streamed (see
+	* VideoTexture) and the file after the last frame is shown while the
+	* power is off.
 	* @param  basefname  Texture image filename base
 	* @param  wrap_s  OpenGL wrap option (s)
 	* @param  wrap_t  OpenGL wrap option (t)
 	* @param  min_filter  OpenGL filter to use for minification
 	* @param  mag_filter  OpenGL filter to use for magnification
+	* @param  frames  Number of video frames
+	* @param  ext  Filename extension (including the '.')
 	*/
 	void SetAnimatedTexture(const std::string& basefname, GLuint wrap_s, GLuint wrap_t,
 		GLuint min_filter, GLuint mag_filter, int frames, const std::string& ext) {
-		this->texture_ids = std::vector<GLuint>();
-		this->frames = frames;
-		for (int i = 1; i <= frames + 1; i++)
-		{
-			// Bind a DevIL image
-			ILuint id;
-			ilGenImages(1, &id);
-			ilBindImage(id);
-			std::string fname = basefname;
-			std::stringstream ss;
-			ss << i;
-			if (i < 10)
-			{
-				fname += "00" + ss.str() + ext;
-			}
-			else if (i < 100)
-			{
-				fname += "0" + ss.str() + ext;
-			}
-			else
-			{
-				fname += ss.str() + ext;
-			}
-
-			ILuint err = ilGetError();
-			if (err) {
-				printf("Error binding image. %s %d\n", fname, err);
-				return;
-			}
-
-			// Load image using lower left origin. Convert to RGBA. Tyr loading from 
-			// ../textures, if that fails try ../../textures
-			ilOriginFunc(IL_ORIGIN_LOWER_LEFT);
-			ilEnable(IL_ORIGIN_SET);
-			std::string full_path_name = "../textures/" + fname;
-			ilLoadImage(full_path_name.c_str());
-			err = ilGetError();
-			if (err) {
-				full_path_name = "../../textures/" + fname;
-				ilLoadImage(full_path_name.c_str());
-			}
-			err = ilGetError();
-			if (err) {
-				printf("Error loading texture. %s %d\n", fname, err);
-				return;
-			}
-			ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
-			err = ilGetError();
-			if (err) {
-				printf("Could not convert texture to RGBA. %s %d\n", fname, err);
-				return;
-			}
-
-			// Get image dimensions and data
-			int w = ilGetInteger(IL_IMAGE_WIDTH);
-			int h = ilGetInteger(IL_IMAGE_HEIGHT);
-
-			unsigned char* data = ilGetData();
-			if (ilGetError() != IL_NO_ERROR) {
-				std::cout << "Error getting image data" << std::endl;
-				return;
-			}
-
-			// Generate an OpenGL textureID, bind it
-			glGenTextures(1, &texture_id);
-			glBindTexture(GL_TEXTURE_2D, texture_id);
-			this->texture_ids.push_back(texture_id);
-			// Load image data and generate mipmaps
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h,
-				0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-			glGenerateMipmap(GL_TEXTURE_2D);
-
-			// Set wrapping mode
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_s);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_t);
-
-			// Set texture filters
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
-
-			// Bind null texture
-			glBindTexture(GL_TEXTURE_2D, 0);
-		}
-		texture_id = this->texture_ids[0];
-		texture_index = 0;
+		ReleaseTextures();
+		video = new VideoTexture;
+		video->Open(basefname, frames, ext, wrap_s, wrap_t, min_filter, mag_filter);
+		off_texture = TextureCache::Get().Acquire(video->GetFrameName(frames), TEXTURE_COLOR,
+			wrap_s, wrap_t, min_filter, mag_filter);
+		texture_id = (powered_on) ? video->GetTexture() : off_texture;
 	}
 
 	/**
-	* Set the normal map to use for the material.
+	* Set the normal map to use for the material. The image is loaded in the
+	* background - a flat normal is used until then.
 	* @param  fname  Texture image filename
 	* @param  wrap_s  OpenGL wrap option (s)
 	* @param  wrap_t  OpenGL wrap option (t)
@@ -296,75 +200,42 @@ public:
 	*/
 	void setNormalMap(const std::string& fname, GLuint wrap_s, GLuint wrap_t, GLuint min_filter, GLuint mag_filter)
 	{
-		// Bind a DevIL image
-		ILuint id;
-		ilGenImages(1, &id);
-		ilBindImage(id);
-		ILuint err = ilGetError();
-		if (err) {
-			printf("Error binding image. %s %d\n", fname, err);
-			return;
-		}
-
-		// Load image using lower left origin. Convert to RGB. Tyr loading from 
-		// ../textures, if that fails try ../../textures
-		ilOriginFunc(IL_ORIGIN_LOWER_LEFT);
-		ilEnable(IL_ORIGIN_SET);
-		std::string full_path_name = "../textures/" + fname;
-		ilLoadImage(full_path_name.c_str());
-		err = ilGetError();
-		if (err) {
-			full_path_name = "../../textures/" + fname;
-			ilLoadImage(full_path_name.c_str());
-		}
-		err = ilGetError();
-		if (err) {
-			printf("Error loading texture. %s %d\n", fname, err);
-			return;
-		}
-		ilConvertImage(IL_RGB, IL_UNSIGNED_BYTE);
-		err = ilGetError();
-		if (err) {
-			printf("Could not convert texture to RGB. %s %d\n", fname, err);
-			return;
-		}
-
-		// Get image dimensions and data
-		int w = ilGetInteger(IL_IMAGE_WIDTH);
-		int h = ilGetInteger(IL_IMAGE_HEIGHT);
-
-		unsigned char* data = ilGetData();
-		if (ilGetError() != IL_NO_ERROR) {
-			std::cout << "Error getting image data" << std::endl;
-			return;
-		}
-
-		// Generate an OpenGL textureID, bind it
-		glGenTextures(1, &normalMapID);
-		glBindTexture(GL_TEXTURE_2D, normalMapID);
-
-		// Load image data and generate mipmaps
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		// Set wrapping mode
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_s);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_t);
-
-		// Set texture filters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+		GLuint previous = normalMapID;
+		normalMapID = TextureCache::Get().Acquire(fname, TEXTURE_NORMAL_MAP, wrap_s, wrap_t,
+			min_filter, mag_filter);
+		TextureCache::Get().Release(previous);
+		normal_array = nullptr;
+		normal_layer = -1;
+	}
 
-		// Bind null texture
-		glBindTexture(GL_TEXTURE_2D, 0);
+	/**
+	 * Use a layer of a texture array for the normal map. The array is not
+	 * owned by the material.
+	 * @param  array  Normal map texture array
+	 * @param  fname  Texture image filename
+	 * @return  Returns false if the array is full (no normal map is used).
+	 */
+	bool SetNormalMapLayer(TextureArray* array, const std::string& fname) {
+		int layer = array->AddLayer(fname);
+		TextureCache::Get().Release(normalMapID);
+		normalMapID = 0;
+		normal_array = (layer < 0) ? nullptr : array;
+		normal_layer = layer;
+		return layer >= 0;
 	}
 
 	/**
-	 * Update texture filtering for this material
+	 * Update texture filtering for this material. Texture arrays are
+	 * updated for every material using them.
 	 * @param  min_filter  OpenGL filter to use for minification
 	 * @param  mag_filter  OpenGL filter to use for magnification
 	 */
 	void UpdateTextureFilters(GLuint min_filter, GLuint mag_filter) {
+		if (texture_array != nullptr)
+			texture_array->SetFilters(min_filter, mag_filter);
+		if (normal_array != nullptr)
+			normal_array->SetFilters(min_filter, mag_filter);
+
 		if (texture_id) {
 			glBindTexture(GL_TEXTURE_2D, texture_id);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
@@ -399,64 +270,126 @@ public:
         useNormalMap = useNormalMapFlag;
     }
 
+    /**
+     * Get the texture bound by this material (the texture array if it uses
+     * one, so materials sharing an array sort together).
+     * @return  Returns the texture object (0 if none).
+     */
+    GLuint GetTextureId() const
+    {
+        return (texture_array != nullptr) ? texture_array->GetTexture() : texture_id;
+    }
+
+    /**
+     * Check if this material is blended with what is behind it.
+     * @return  Returns true if the diffuse alpha is less than 1.
+     */
+    bool IsTransparent() const
+    {
+        return material_diffuse.a < 1.0f;
+    }
+
 	/**
 	 * Draw. Sets the material properties.
 	 * @param  scene_state  Scene state (holds material uniform locations)
 	 */
 	void Draw(SceneState& scene_state) {
-		// Set the material uniform values
-		glUniform4fv(scene_state.materialambient_loc, 1, &material_ambient.r);
-		glUniform4fv(scene_state.materialdiffuse_loc, 1, &material_diffuse.r);
-		glUniform4fv(scene_state.materialspecular_loc, 1, &material_specular.r);
-		glUniform4fv(scene_state.materialemission_loc, 1, &material_emission.r);
-		glUniform1f(scene_state.materialshininess_loc, material_shininess);
+		Bind(scene_state);
 
-		// Enable texture mapping and bind the texture
-		if (texture_id) {
-            glUniform1i(scene_state.usetexture_loc, useTexture);      // Tell shader we are using textures
-            glUniform1f(scene_state.texturescale_loc, textureScale);
+		// Draw children of this node
+		SceneNode::Draw(scene_state);
 
-			glUniform1i(scene_state.textureunit_loc, 0);  // Texture unit 0
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, texture_id);
+		Unbind(scene_state);
+	}
+
+	/**
+	 * Compile this presentation node and its children. Children are added
+	 * using this material.
+	 * @param  list  Render list being built.
+	 */
+	void Compile(RenderList& list) {
+		list.PushMaterial(this);
+		SceneNode::Compile(list);
+		list.PopMaterial();
+	}
+
+	/**
+	 * Set the material properties and bind the textures. All material
+	 * uniforms are set so a material can be bound over another one without
+	 * unbinding it first.
+	 * @param  scene_state  Scene state (holds material uniform locations)
+	 */
+	void Bind(SceneState& scene_state) {
+		GLStateCache& gl_state = scene_state.gl_state;
+
+		// Set the material uniform values
+		gl_state.Uniform4fv(scene_state.materialambient_loc, &material_ambient.r);
+		gl_state.Uniform4fv(scene_state.materialdiffuse_loc, &material_diffuse.r);
+		gl_state.Uniform4fv(scene_state.materialspecular_loc, &material_specular.r);
+		gl_state.Uniform4fv(scene_state.materialemission_loc, &material_emission.r);
+		gl_state.Uniform1f(scene_state.materialshininess_loc, material_shininess);
+
+		// Enable texture mapping and bind the texture. Materials sharing a
+		// texture array only change the layer.
+		if (texture_array != nullptr) {
+			gl_state.Uniform1i(scene_state.usetexture_loc, useTexture);
+			gl_state.Uniform1f(scene_state.texturescale_loc, textureScale);
+			gl_state.Uniform1i(scene_state.texturelayer_loc, texture_layer);
+			gl_state.BindTexture(kTextureArrayUnit, GL_TEXTURE_2D_ARRAY, texture_array->GetTexture());
+		}
+		else if (texture_id) {
+            gl_state.Uniform1i(scene_state.usetexture_loc, useTexture);      // Tell shader we are using textures
+            gl_state.Uniform1f(scene_state.texturescale_loc, textureScale);
+
+			gl_state.Uniform1i(scene_state.textureunit_loc, 0);  // Texture unit 0
+			gl_state.Uniform1i(scene_state.texturelayer_loc, -1);
+			gl_state.BindTexture(0, GL_TEXTURE_2D, texture_id);
 		}
 		else {
 			// Set a special value to tell the shader we are not using textures
-			glUniform1i(scene_state.usetexture_loc, 0);
+			gl_state.Uniform1i(scene_state.usetexture_loc, 0);
 		}
 
 		// Enable normal mapping and bind the texture
-		if (normalMapID)
+		if (normal_array != nullptr) {
+			gl_state.Uniform1i(scene_state.usenormalmap_loc, useNormalMap);
+			gl_state.Uniform1i(scene_state.normalmaplayer_loc, normal_layer);
+			gl_state.BindTexture(kNormalMapArrayUnit, GL_TEXTURE_2D_ARRAY, normal_array->GetTexture());
+		}
+		else if (normalMapID)
 		{
-			glUniform1i(scene_state.usenormalmap_loc, useNormalMap);  // Tell shader we are using normal maps
-			glUniform1i(scene_state.normalmap_loc, 1);                // Texture unit 1
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, normalMapID);
+			gl_state.Uniform1i(scene_state.normalmaplayer_loc, -1);
+			gl_state.Uniform1i(scene_state.usenormalmap_loc, useNormalMap);  // Tell shader we are using normal maps
+			gl_state.Uniform1i(scene_state.normalmap_loc, 1);                // Texture unit 1
+			gl_state.BindTexture(1, GL_TEXTURE_2D, normalMapID);
 		}
+		else {
+			gl_state.Uniform1i(scene_state.usenormalmap_loc, 0);
+		}
+	}
 
-		// Draw children of this node
-		SceneNode::Draw(scene_state);
-
-
-		// Turn off texture mapping for any nodes not descended from this presentation node
-		glUniform1i(scene_state.usetexture_loc, 0);
-		glUniform1i(scene_state.usenormalmap_loc, 0);
-		glBindTexture(GL_TEXTURE_2D, 0);
+	/**
+	 * Turn off texture mapping for any nodes not using this material. The
+	 * textures stay bound (the shader does not sample them) so binding the
+	 * same material again does not rebind them.
+	 * @param  scene_state  Scene state (holds material uniform locations)
+	 */
+	void Unbind(SceneState& scene_state) {
+		scene_state.gl_state.Uniform1i(scene_state.usetexture_loc, 0);
+		scene_state.gl_state.Uniform1i(scene_state.usenormalmap_loc, 0);
 	}
 
 	/**
-	 * Updates the image to be used during an animation
+	 * Updates the image to be used during an animation. Shows the next video
+	 * frame if it has been decoded.
 	 */
 	void UpdateFrame()
 	{
-		texture_index++;
-
-		if (texture_index == frames)
+		if (video != nullptr)
 		{
-			texture_index = 0;
+			video->Advance();
+			texture_id = video->GetTexture();
 		}
-
-		texture_id = this->texture_ids[texture_index];
 	}
 
 	/**
@@ -474,9 +407,9 @@ public:
 	{
 		powered_on = !powered_on;
 
-		if (!powered_on)
+		if (!powered_on && video != nullptr)
 		{
-			texture_id = texture_ids[frames];
+			texture_id = off_texture;
 		}
 	}
 
@@ -489,15 +422,35 @@ protected:
 
     int useTexture;
     float textureScale;
-	std::vector<GLuint> texture_ids;
 	GLuint texture_id;
 
     int useNormalMap;
 	GLuint normalMapID;
 
-	int texture_index;
-	int frames;
+	TextureArray* texture_array;   // Used instead of texture_id if set
+	int           texture_layer;
+	TextureArray* normal_array;    // Used instead of normalMapID if set
+	int           normal_layer;
+
+	VideoTexture* video;
+	GLuint off_texture;   // Shown while the video is powered off
 	bool powered_on = true;
+
+	// Release the texture or video
+	void ReleaseTextures() {
+		if (video != nullptr) {
+			delete video;
+			video = nullptr;
+			TextureCache::Get().Release(off_texture);
+			off_texture = 0;
+		}
+		else {
+			TextureCache::Get().Release(texture_id);
+		}
+		texture_id = 0;
+		texture_array = nullptr;
+		texture_layer = -1;
+	}
 };
 
 #endif
@@ -0,0 +1,917 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    profiler.h
+//	Purpose: Per frame OpenGL call counts, CPU scope timers and GPU pass
+//           timers with rolling stats and Chrome trace export.
+//
+//============================================================================
+
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+// Profiling is built into debug builds only. Define SCENE_PROFILING as 0 or
+// 1 ahead of this header to override. When 0 the PROFILE_ macros expand to
+// nothing and no profiler code is compiled.
+#ifndef SCENE_PROFILING
+#ifdef NDEBUG
+#define SCENE_PROFILING 0
+#else
+#define SCENE_PROFILING 1
+#endif
+#endif
+
+#if SCENE_PROFILING
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#ifndef _WIN32
+#include <chrono>
+#endif
+
+// Frames kept for the rolling stats
+const uint32_t kProfileHistory = 120;
+
+// Distinct CPU scope names and GPU pass names
+const uint32_t kMaxCPUTimers = 32;
+const uint32_t kMaxGPUTimers = 8;
+
+// GPU queries in flight per pass. Results are read this many frames later
+// so reading them does not stall the pipeline.
+const uint32_t kGPUQueryLatency = 4;
+
+// Per frame OpenGL counters
+enum FrameCounter { FRAME_DRAW_CALLS, FRAME_INSTANCES, FRAME_INDICES,
+                    FRAME_UNIFORMS, FRAME_PROGRAM_BINDS,
+                    FRAME_VERTEX_ARRAY_BINDS, FRAME_TEXTURE_BINDS,
+                    FRAME_BUFFER_UPLOADS, FRAME_TEXTURE_UPLOADS,
+                    FRAME_UPLOAD_BYTES, FRAME_CULLED, FRAME_VISIBLE,
+                    FRAME_COUNTER_COUNT };
+
+/**
+ * Frame profiler. Counts the OpenGL calls made by the scene graph (by
+ * replacing the gl3w entry points with counting wrappers), times named CPU
+ * scopes and times passes on the GPU with GL_TIME_ELAPSED queries. Results
+ * are kept for the last kProfileHistory frames and can be printed as a
+ * rolling stats block or captured to a Chrome trace file (load it with
+ * chrome://tracing).
+ *
+ * Timer names are not copied - use string literals or other strings that
+ * outlive the profiler. There is a single instance (Get) as the OpenGL
+ * hooks have no context argument.
+ */
+class FrameProfiler {
+public:
+  /**
+   * Get the profiler.
+   * @return  Returns the single profiler instance.
+   */
+  static FrameProfiler& Get() {
+    static FrameProfiler profiler;
+    return profiler;
+  }
+
+  /**
+   * Replace the OpenGL entry points used by the scene graph with counting
+   * wrappers. Call once after gl3wInit. GPU timing is enabled if timer
+   * queries (OpenGL 3.3) are supported.
+   */
+  void InstallGLHooks() {
+    if (hooks_installed)
+      return;
+    GLHooks& h = Hooks();
+    h.DrawElements = glDrawElements;
+    h.DrawElementsInstanced = glDrawElementsInstanced;
+    h.DrawArrays = glDrawArrays;
+    h.MultiDrawElements = glMultiDrawElements;
+    h.Uniform1i = glUniform1i;
+    h.Uniform1f = glUniform1f;
+    h.Uniform2f = glUniform2f;
+    h.Uniform3fv = glUniform3fv;
+    h.Uniform4f = glUniform4f;
+    h.Uniform4fv = glUniform4fv;
+    h.UniformMatrix4fv = glUniformMatrix4fv;
+    h.UseProgram = glUseProgram;
+    h.BindVertexArray = glBindVertexArray;
+    h.BindTexture = glBindTexture;
+    h.BufferData = glBufferData;
+    h.BufferSubData = glBufferSubData;
+    h.TexImage2D = glTexImage2D;
+    h.TexSubImage2D = glTexSubImage2D;
+    h.TexImage3D = glTexImage3D;
+    h.TexSubImage3D = glTexSubImage3D;
+    h.CompressedTexImage2D = glCompressedTexImage2D;
+
+    glDrawElements = CountDrawElements;
+    glDrawElementsInstanced = CountDrawElementsInstanced;
+    glDrawArrays = CountDrawArrays;
+    glMultiDrawElements = CountMultiDrawElements;
+    glUniform1i = CountUniform1i;
+    glUniform1f = CountUniform1f;
+    glUniform2f = CountUniform2f;
+    glUniform3fv = CountUniform3fv;
+    glUniform4f = CountUniform4f;
+    glUniform4fv = CountUniform4fv;
+    glUniformMatrix4fv = CountUniformMatrix4fv;
+    glUseProgram = CountUseProgram;
+    glBindVertexArray = CountBindVertexArray;
+    glBindTexture = CountBindTexture;
+    glBufferData = CountBufferData;
+    glBufferSubData = CountBufferSubData;
+    glTexImage2D = CountTexImage2D;
+    glTexSubImage2D = CountTexSubImage2D;
+    glTexImage3D = CountTexImage3D;
+    glTexSubImage3D = CountTexSubImage3D;
+    glCompressedTexImage2D = CountCompressedTexImage2D;
+
+    hooks_installed = true;
+    gpu_supported = gl3wIsSupported(3, 3) != 0;
+    if (!gpu_supported)
+      printf("FrameProfiler: timer queries not supported - no GPU times\n");
+  }
+
+  /**
+   * Start a frame. Counters and timers are reset.
+   */
+  void BeginFrame() {
+    memset(&current, 0, sizeof(current));
+    for (uint32_t t = 0; t < kMaxGPUTimers; t++) {
+      current.gpu_ms[t] = -1.0;
+    }
+    cpu_stack.clear();
+    frame_start = Now();
+    in_frame = true;
+  }
+
+  /**
+   * End a frame. Stores the frame in the history, reads GPU results that
+   * are ready and writes the trace file once a capture completes (waiting
+   * for the GPU results of the captured frames).
+   */
+  void EndFrame() {
+    if (!in_frame)
+      return;
+    in_frame = false;
+    uint64_t end = Now();
+    current.cpu_ms = TicksToMs(end - frame_start);
+    history[frame % kProfileHistory] = current;
+
+    if (capturing) {
+      AddEvent("frame", "frame", frame_start, end - frame_start, kTraceCPUThread);
+      AddCounterEvents(frame_start);
+    }
+
+    ResolveGPUQueries(false);
+    frame++;
+
+    if (capturing && frame == capture_end) {
+      capturing = false;
+      ResolveGPUQueries(true);
+      WriteTrace(capture_name);
+      capture_name = nullptr;
+    }
+  }
+
+  /**
+   * Check if a frame is in progress (between BeginFrame and EndFrame).
+   * @return  Returns true if timing is active.
+   */
+  bool InFrame() const {
+    return in_frame;
+  }
+
+  /**
+   * Add to a frame counter.
+   * @param  counter  Counter to add to.
+   * @param  n        Amount to add.
+   */
+  void Count(const FrameCounter counter, const uint64_t n = 1) {
+    current.counters[counter] += n;
+  }
+
+  /**
+   * Start timing a CPU scope. Scopes nest: a scope's self time excludes
+   * the time of scopes started inside it.
+   * @param  name  Scope name.
+   */
+  void BeginCPU(const char* name) {
+    if (!in_frame)
+      return;
+    OpenScope scope;
+    scope.timer = FindTimer(cpu_names, cpu_timer_count, kMaxCPUTimers, name);
+    scope.start = Now();
+    scope.child_ticks = 0;
+    cpu_stack.push_back(scope);
+  }
+
+  /**
+   * Stop timing the most recently started CPU scope.
+   */
+  void EndCPU() {
+    if (!in_frame || cpu_stack.empty())
+      return;
+    OpenScope scope = cpu_stack.back();
+    cpu_stack.pop_back();
+    uint64_t elapsed = Now() - scope.start;
+    if (!cpu_stack.empty())
+      cpu_stack.back().child_ticks += elapsed;
+    if (scope.timer < 0)
+      return;
+
+    // Total time only counts the outermost scope of a name so recursive
+    // scopes (nested nodes of the same type) are not counted twice
+    bool nested = false;
+    for (auto& s : cpu_stack) {
+      if (s.timer == scope.timer) {
+        nested = true;
+        break;
+      }
+    }
+    if (!nested)
+      current.cpu_total_ms[scope.timer] += TicksToMs(elapsed);
+    current.cpu_self_ms[scope.timer] += TicksToMs(elapsed - scope.child_ticks);
+    current.cpu_calls[scope.timer]++;
+
+    if (capturing)
+      AddEvent(cpu_names[scope.timer], "cpu", scope.start, elapsed, kTraceCPUThread);
+  }
+
+  /**
+   * Start timing a pass on the GPU. GPU passes do not nest (OpenGL allows
+   * one GL_TIME_ELAPSED query at a time).
+   * @param  name  Pass name.
+   * @return  Returns true if a query was started (EndGPU must be called).
+   */
+  bool BeginGPU(const char* name) {
+    if (!in_frame || !gpu_supported || gpu_active >= 0)
+      return false;
+    int t = FindTimer(gpu_names, gpu_timer_count, kMaxGPUTimers, name);
+    if (t < 0)
+      return false;
+
+    GPUQuery& query = gpu_queries[t][frame % kGPUQueryLatency];
+    if (query.query == 0)
+      glGenQueries(1, &query.query);
+    else if (query.pending)
+      ResolveQuery(t, query, true);
+
+    glBeginQuery(GL_TIME_ELAPSED, query.query);
+    query.frame = frame;
+    query.submit = Now();
+    query.pending = true;
+    gpu_active = t;
+    return true;
+  }
+
+  /**
+   * Stop timing the active GPU pass.
+   */
+  void EndGPU() {
+    if (gpu_active < 0)
+      return;
+    glEndQuery(GL_TIME_ELAPSED);
+    gpu_active = -1;
+  }
+
+  /**
+   * Print the average, minimum and maximum of the counters and timers over
+   * the frames in the history.
+   */
+  void PrintRolling() const {
+    static const char* counter_names[FRAME_COUNTER_COUNT] = {
+      "draw calls", "instances", "indices", "uniforms", "program binds",
+      "vao binds", "texture binds", "buffer uploads", "texture uploads",
+      "upload bytes", "culled", "visible" };
+
+    uint32_t n = (frame < kProfileHistory) ? static_cast<uint32_t>(frame) : kProfileHistory;
+    if (n == 0) {
+      printf("Frame stats: no frames drawn\n");
+      return;
+    }
+    printf("Frame stats (last %u frames)          avg        min        max\n", n);
+
+    RollingStat cpu;
+    for (uint32_t i = 0; i < n; i++) {
+      cpu.Add(history[i].cpu_ms);
+    }
+    cpu.Print("cpu frame ms");
+
+    for (uint32_t t = 0; t < gpu_timer_count; t++) {
+      RollingStat gpu;
+      for (uint32_t i = 0; i < n; i++) {
+        if (history[i].gpu_ms[t] >= 0.0)
+          gpu.Add(history[i].gpu_ms[t]);
+      }
+      char label[64];
+      sprintf(label, "gpu %s ms", gpu_names[t]);
+      gpu.Print(label);
+    }
+
+    for (uint32_t c = 0; c < FRAME_COUNTER_COUNT; c++) {
+      RollingStat stat;
+      for (uint32_t i = 0; i < n; i++) {
+        stat.Add(static_cast<double>(history[i].counters[c]));
+      }
+      stat.Print(counter_names[c]);
+    }
+
+    printf("  %-24s %10s %10s %10s\n", "cpu scope (per frame)", "self ms", "total ms", "calls");
+    for (uint32_t t = 0; t < cpu_timer_count; t++) {
+      double self_ms = 0.0;
+      double total_ms = 0.0;
+      double calls = 0.0;
+      for (uint32_t i = 0; i < n; i++) {
+        self_ms += history[i].cpu_self_ms[t];
+        total_ms += history[i].cpu_total_ms[t];
+        calls += history[i].cpu_calls[t];
+      }
+      printf("  %-24s %10.3f %10.3f %10.1f\n", cpu_names[t], self_ms / n,
+             total_ms / n, calls / n);
+    }
+  }
+
+  /**
+   * Enable or disable printing the rolling stats every kProfileHistory
+   * frames.
+   * @param  enable  True to print periodically.
+   */
+  void SetPeriodicPrint(const bool enable) {
+    periodic_print = enable;
+    print_frame = frame + kProfileHistory;
+  }
+
+  /**
+   * Check if the rolling stats are printed periodically.
+   * @return  Returns true if periodic printing is enabled.
+   */
+  bool GetPeriodicPrint() const {
+    return periodic_print;
+  }
+
+  /**
+   * Print the rolling stats if periodic printing is enabled and a full
+   * history has been drawn since the last print. Call after EndFrame.
+   */
+  void PeriodicPrint() {
+    if (periodic_print && frame >= print_frame) {
+      PrintRolling();
+      print_frame = frame + kProfileHistory;
+    }
+  }
+
+  /**
+   * Capture the next frames drawn to a Chrome trace file. The file is
+   * written when the last frame ends. Call between frames.
+   * @param  filename  Trace file name (must outlive the capture).
+   * @param  frames    Number of frames to capture.
+   * @return  Returns false if a capture is already in progress.
+   */
+  bool StartCapture(const char* filename, const uint32_t frames) {
+    if (capturing || in_frame || frames == 0)
+      return false;
+    events.clear();
+    capture_name = filename;
+    capture_start_frame = frame;
+    capture_end = frame + frames;
+    capture_origin = Now();
+    capturing = true;
+    return true;
+  }
+
+  /**
+   * Check if a trace capture is in progress.
+   * @return  Returns true if frames are being captured.
+   */
+  bool IsCapturing() const {
+    return capturing;
+  }
+
+  /**
+   * Write the captured events as a Chrome trace (JSON object format).
+   * @param  filename  File to write.
+   * @return  Returns true if the file was written.
+   */
+  bool WriteTrace(const char* filename) const {
+    FILE* f = fopen(filename, "w");
+    if (f == nullptr) {
+      printf("FrameProfiler: could not open trace file %s\n", filename);
+      return false;
+    }
+    fprintf(f, "{\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"CPU\"}},\n",
+            kTraceCPUThread);
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}",
+            kTraceGPUThread);
+    for (auto& e : events) {
+      double ts = TicksToMs(e.start - capture_origin) * 1000.0;
+      if (e.tid == kTraceCounterThread) {
+        fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"value\":%llu}}",
+                e.name, ts, static_cast<unsigned long long>(e.value));
+      }
+      else {
+        double dur = (e.tid == kTraceGPUThread) ? e.gpu_ms * 1000.0 :
+                     TicksToMs(e.value) * 1000.0;
+        fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                e.name, e.category, ts, dur, e.tid);
+      }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    printf("FrameProfiler: wrote %u events to %s\n",
+           static_cast<uint32_t>(events.size()), filename);
+    return true;
+  }
+
+  /**
+   * Get the counters of the last completed frame.
+   * @param  counter  Counter to get.
+   * @return  Returns the counter value (0 if no frame has completed).
+   */
+  uint64_t GetLastFrameCount(const FrameCounter counter) const {
+    if (frame == 0)
+      return 0;
+    return history[(frame - 1) % kProfileHistory].counters[counter];
+  }
+
+protected:
+  // Trace threads (CPU scopes, GPU passes placed at their submit time and
+  // counter events)
+  static const uint32_t kTraceCPUThread = 1;
+  static const uint32_t kTraceGPUThread = 2;
+  static const uint32_t kTraceCounterThread = 3;
+
+  // One frame of results
+  struct FrameSample {
+    double   cpu_ms;
+    uint64_t counters[FRAME_COUNTER_COUNT];
+    double   cpu_self_ms[kMaxCPUTimers];
+    double   cpu_total_ms[kMaxCPUTimers];
+    uint32_t cpu_calls[kMaxCPUTimers];
+    double   gpu_ms[kMaxGPUTimers];       // -1 if not (yet) known
+  };
+
+  // CPU scope in progress
+  struct OpenScope {
+    int      timer;         // Timer index (-1 if out of timers)
+    uint64_t start;
+    uint64_t child_ticks;   // Time spent in nested scopes
+  };
+
+  // GPU timer query of one pass and frame
+  struct GPUQuery {
+    GLuint   query;
+    bool     pending;
+    uint64_t frame;
+    uint64_t submit;        // CPU time the pass started
+  };
+
+  // Captured trace event
+  struct TraceEvent {
+    const char* name;
+    const char* category;
+    uint64_t    start;      // Ticks
+    uint64_t    value;      // CPU duration in ticks or counter value
+    double      gpu_ms;     // GPU duration
+    uint32_t    tid;
+  };
+
+  // Running average, minimum and maximum
+  struct RollingStat {
+    double   sum;
+    double   min;
+    double   max;
+    uint32_t n;
+
+    RollingStat() : sum(0.0), min(0.0), max(0.0), n(0) { }
+
+    void Add(const double v) {
+      min = (n == 0 || v < min) ? v : min;
+      max = (n == 0 || v > max) ? v : max;
+      sum += v;
+      n++;
+    }
+
+    void Print(const char* label) const {
+      if (n == 0)
+        printf("  %-24s %10s\n", label, "n/a");
+      else
+        printf("  %-24s %10.3f %10.3f %10.3f\n", label, sum / n, min, max);
+    }
+  };
+
+  // Original OpenGL entry points
+  struct GLHooks {
+    PFNGLDRAWELEMENTSPROC          DrawElements;
+    PFNGLDRAWELEMENTSINSTANCEDPROC DrawElementsInstanced;
+    PFNGLDRAWARRAYSPROC            DrawArrays;
+    PFNGLMULTIDRAWELEMENTSPROC     MultiDrawElements;
+    PFNGLUNIFORM1IPROC             Uniform1i;
+    PFNGLUNIFORM1FPROC             Uniform1f;
+    PFNGLUNIFORM2FPROC             Uniform2f;
+    PFNGLUNIFORM3FVPROC            Uniform3fv;
+    PFNGLUNIFORM4FPROC             Uniform4f;
+    PFNGLUNIFORM4FVPROC            Uniform4fv;
+    PFNGLUNIFORMMATRIX4FVPROC      UniformMatrix4fv;
+    PFNGLUSEPROGRAMPROC            UseProgram;
+    PFNGLBINDVERTEXARRAYPROC       BindVertexArray;
+    PFNGLBINDTEXTUREPROC           BindTexture;
+    PFNGLBUFFERDATAPROC            BufferData;
+    PFNGLBUFFERSUBDATAPROC         BufferSubData;
+    PFNGLTEXIMAGE2DPROC            TexImage2D;
+    PFNGLTEXSUBIMAGE2DPROC         TexSubImage2D;
+    PFNGLTEXIMAGE3DPROC            TexImage3D;
+    PFNGLTEXSUBIMAGE3DPROC         TexSubImage3D;
+    PFNGLCOMPRESSEDTEXIMAGE2DPROC  CompressedTexImage2D;
+  };
+
+  FrameSample history[kProfileHistory];
+  FrameSample current;
+  uint64_t    frame;            // Frames completed
+  uint64_t    frame_start;
+  bool        in_frame;
+  bool        hooks_installed;
+
+  const char*            cpu_names[kMaxCPUTimers];
+  uint32_t               cpu_timer_count;
+  std::vector<OpenScope> cpu_stack;
+
+  const char* gpu_names[kMaxGPUTimers];
+  uint32_t    gpu_timer_count;
+  GPUQuery    gpu_queries[kMaxGPUTimers][kGPUQueryLatency];
+  int         gpu_active;       // Pass with a query in progress (-1 if none)
+  bool        gpu_supported;
+
+  bool     periodic_print;
+  uint64_t print_frame;
+
+  const char*             capture_name;          // Trace file
+  bool                    capturing;
+  uint64_t                capture_start_frame;
+  uint64_t                capture_end;           // First frame not captured
+  uint64_t                capture_origin;        // Ticks at trace time 0
+  std::vector<TraceEvent> events;
+
+  FrameProfiler()
+      : frame(0),
+        frame_start(0),
+        in_frame(false),
+        hooks_installed(false),
+        cpu_timer_count(0),
+        gpu_timer_count(0),
+        gpu_active(-1),
+        gpu_supported(false),
+        periodic_print(false),
+        print_frame(0),
+        capture_name(nullptr),
+        capturing(false),
+        capture_start_frame(0),
+        capture_end(0),
+        capture_origin(0) {
+    memset(history, 0, sizeof(history));
+    memset(&current, 0, sizeof(current));
+    memset(gpu_queries, 0, sizeof(gpu_queries));
+  }
+
+  static GLHooks& Hooks() {
+    static GLHooks hooks;
+    return hooks;
+  }
+
+  // Current time in ticks
+  static uint64_t Now() {
+#ifdef _WIN32
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return static_cast<uint64_t>(t.QuadPart);
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+  }
+
+  // Convert ticks to milliseconds
+  static double TicksToMs(const uint64_t ticks) {
+#ifdef _WIN32
+    static double ms_per_tick = 0.0;
+    if (ms_per_tick == 0.0) {
+      LARGE_INTEGER f;
+      QueryPerformanceFrequency(&f);
+      ms_per_tick = 1000.0 / static_cast<double>(f.QuadPart);
+    }
+    return ticks * ms_per_tick;
+#else
+    return ticks * 1.0e-6;
+#endif
+  }
+
+  // Find a timer by name, adding it if there is room. Names are usually
+  // string literals so compare pointers before contents.
+  static int FindTimer(const char** names, uint32_t& count, const uint32_t max_count,
+                       const char* name) {
+    for (uint32_t i = 0; i < count; i++) {
+      if (names[i] == name || strcmp(names[i], name) == 0)
+        return static_cast<int>(i);
+    }
+    if (count == max_count)
+      return -1;
+    names[count] = name;
+    return static_cast<int>(count++);
+  }
+
+  // Read the result of a GPU query into the history. If wait is false the
+  // result is only read if available.
+  void ResolveQuery(const int t, GPUQuery& query, const bool wait) {
+    if (!wait) {
+      GLint available = 0;
+      glGetQueryObjectiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available)
+        return;
+    }
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &ns);
+    query.pending = false;
+
+    // Results of frames older than the history are dropped
+    double ms = static_cast<double>(ns) * 1.0e-6;
+    if (query.frame + kProfileHistory > frame)
+      history[query.frame % kProfileHistory].gpu_ms[t] = ms;
+    if (capturing && query.frame >= capture_start_frame &&
+        query.frame < capture_end) {
+      TraceEvent e;
+      e.name = gpu_names[t];
+      e.category = "gpu";
+      e.start = query.submit;
+      e.value = 0;
+      e.gpu_ms = ms;
+      e.tid = kTraceGPUThread;
+      events.push_back(e);
+    }
+  }
+
+  // Read the results of pending queries
+  void ResolveGPUQueries(const bool wait) {
+    for (uint32_t t = 0; t < gpu_timer_count; t++) {
+      for (uint32_t i = 0; i < kGPUQueryLatency; i++) {
+        if (gpu_queries[t][i].pending)
+          ResolveQuery(t, gpu_queries[t][i], wait);
+      }
+    }
+  }
+
+  // Add a CPU event to the trace
+  void AddEvent(const char* name, const char* category, const uint64_t start,
+                const uint64_t ticks, const uint32_t tid) {
+    TraceEvent e;
+    e.name = name;
+    e.category = category;
+    e.start = start;
+    e.value = ticks;
+    e.gpu_ms = 0.0;
+    e.tid = tid;
+    events.push_back(e);
+  }
+
+  // Add the frame counters to the trace
+  void AddCounterEvents(const uint64_t start) {
+    static const char* names[FRAME_COUNTER_COUNT] = {
+      "draw calls", "instances", "indices", "uniforms", "program binds",
+      "vao binds", "texture binds", "buffer uploads", "texture uploads",
+      "upload bytes", "culled", "visible" };
+    for (uint32_t c = 0; c < FRAME_COUNTER_COUNT; c++) {
+      TraceEvent e;
+      e.name = names[c];
+      e.category = "counter";
+      e.start = start;
+      e.value = current.counters[c];
+      e.gpu_ms = 0.0;
+      e.tid = kTraceCounterThread;
+      events.push_back(e);
+    }
+  }
+
+  // Counting wrappers for the OpenGL entry points
+  static void APIENTRY CountDrawElements(GLenum mode, GLsizei count, GLenum type,
+                                         const GLvoid* indices) {
+    Get().Count(FRAME_DRAW_CALLS);
+    Get().Count(FRAME_INSTANCES);
+    Get().Count(FRAME_INDICES, count);
+    Hooks().DrawElements(mode, count, type, indices);
+  }
+
+  static void APIENTRY CountDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                                                  const GLvoid* indices, GLsizei instancecount) {
+    Get().Count(FRAME_DRAW_CALLS);
+    Get().Count(FRAME_INSTANCES, instancecount);
+    Get().Count(FRAME_INDICES, static_cast<uint64_t>(count) * instancecount);
+    Hooks().DrawElementsInstanced(mode, count, type, indices, instancecount);
+  }
+
+  static void APIENTRY CountDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    Get().Count(FRAME_DRAW_CALLS);
+    Get().Count(FRAME_INSTANCES);
+    Hooks().DrawArrays(mode, first, count);
+  }
+
+  static void APIENTRY CountMultiDrawElements(GLenum mode, const GLsizei* count, GLenum type,
+                                              const GLvoid* const* indices, GLsizei drawcount) {
+    Get().Count(FRAME_DRAW_CALLS);
+    Get().Count(FRAME_INSTANCES, drawcount);
+    for (GLsizei i = 0; i < drawcount; i++) {
+      Get().Count(FRAME_INDICES, count[i]);
+    }
+    Hooks().MultiDrawElements(mode, count, type, indices, drawcount);
+  }
+
+  static void APIENTRY CountUniform1i(GLint location, GLint v0) {
+    Get().Count(FRAME_UNIFORMS);
+    Hooks().Uniform1i(location, v0);
+  }
+
+  static void APIENTRY CountUniform1f(GLint location, GLfloat v0) {
+    Get().Count(FRAME_UNIFORMS);
+    Hooks().Uniform1f(location, v0);
+  }
+
+  static void APIENTRY CountUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+    Get().Count(FRAME_UNIFORMS);
+    Hooks().Uniform2f(location, v0, v1);
+  }
+
+  static void APIENTRY CountUniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+    Get().Count(FRAME_UNIFORMS);
+    Hooks().Uniform3fv(location, count, value);
+  }
+
+  static void APIENTRY CountUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2,
+                                      GLfloat v3) {
+    Get().Count(FRAME_UNIFORMS);
+    Hooks().Uniform4f(location, v0, v1, v2, v3);
+  }
+
+  static void APIENTRY CountUniform4fv(GLint location, GLsizei count, const GLfloat* value) {
+    Get().Count(FRAME_UNIFORMS);
+    Hooks().Uniform4fv(location, count, value);
+  }
+
+  static void APIENTRY CountUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose,
+                                             const GLfloat* value) {
+    Get().Count(FRAME_UNIFORMS);
+    Hooks().UniformMatrix4fv(location, count, transpose, value);
+  }
+
+  static void APIENTRY CountUseProgram(GLuint program) {
+    Get().Count(FRAME_PROGRAM_BINDS);
+    Hooks().UseProgram(program);
+  }
+
+  static void APIENTRY CountBindVertexArray(GLuint array) {
+    Get().Count(FRAME_VERTEX_ARRAY_BINDS);
+    Hooks().BindVertexArray(array);
+  }
+
+  static void APIENTRY CountBindTexture(GLenum target, GLuint texture) {
+    Get().Count(FRAME_TEXTURE_BINDS);
+    Hooks().BindTexture(target, texture);
+  }
+
+  static void APIENTRY CountBufferData(GLenum target, GLsizeiptr size, const GLvoid* data,
+                                       GLenum usage) {
+    Get().Count(FRAME_BUFFER_UPLOADS);
+    Get().Count(FRAME_UPLOAD_BYTES, (data != nullptr) ? size : 0);
+    Hooks().BufferData(target, size, data, usage);
+  }
+
+  static void APIENTRY CountBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
+                                          const GLvoid* data) {
+    Get().Count(FRAME_BUFFER_UPLOADS);
+    Get().Count(FRAME_UPLOAD_BYTES, size);
+    Hooks().BufferSubData(target, offset, size, data);
+  }
+
+  static void APIENTRY CountTexImage2D(GLenum target, GLint level, GLint internalformat,
+                                       GLsizei width, GLsizei height, GLint border,
+                                       GLenum format, GLenum type, const GLvoid* pixels) {
+    Get().Count(FRAME_TEXTURE_UPLOADS);
+    Get().Count(FRAME_UPLOAD_BYTES, (pixels != nullptr) ? PixelBytes(width, height, 1, format, type) : 0);
+    Hooks().TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+  }
+
+  static void APIENTRY CountTexSubImage2D(GLenum target, GLint level, GLint xoffset,
+                                          GLint yoffset, GLsizei width, GLsizei height,
+                                          GLenum format, GLenum type, const GLvoid* pixels) {
+    Get().Count(FRAME_TEXTURE_UPLOADS);
+    Get().Count(FRAME_UPLOAD_BYTES, PixelBytes(width, height, 1, format, type));
+    Hooks().TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+  }
+
+  static void APIENTRY CountTexImage3D(GLenum target, GLint level, GLint internalformat,
+                                       GLsizei width, GLsizei height, GLsizei depth,
+                                       GLint border, GLenum format, GLenum type,
+                                       const GLvoid* pixels) {
+    Get().Count(FRAME_TEXTURE_UPLOADS);
+    Get().Count(FRAME_UPLOAD_BYTES, (pixels != nullptr) ? PixelBytes(width, height, depth, format, type) : 0);
+    Hooks().TexImage3D(target, level, internalformat, width, height, depth, border, format,
+                       type, pixels);
+  }
+
+  static void APIENTRY CountTexSubImage3D(GLenum target, GLint level, GLint xoffset,
+                                          GLint yoffset, GLint zoffset, GLsizei width,
+                                          GLsizei height, GLsizei depth, GLenum format,
+                                          GLenum type, const GLvoid* pixels) {
+    Get().Count(FRAME_TEXTURE_UPLOADS);
+    Get().Count(FRAME_UPLOAD_BYTES, PixelBytes(width, height, depth, format, type));
+    Hooks().TexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth,
+                          format, type, pixels);
+  }
+
+  static void APIENTRY CountCompressedTexImage2D(GLenum target, GLint level,
+                                                 GLenum internalformat, GLsizei width,
+                                                 GLsizei height, GLint border,
+                                                 GLsizei imageSize, const GLvoid* data) {
+    Get().Count(FRAME_TEXTURE_UPLOADS);
+    Get().Count(FRAME_UPLOAD_BYTES, imageSize);
+    Hooks().CompressedTexImage2D(target, level, internalformat, width, height, border,
+                                 imageSize, data);
+  }
+
+  // Approximate size of uncompressed pixel data (ignores unpack alignment)
+  static uint64_t PixelBytes(const GLsizei width, const GLsizei height, const GLsizei depth,
+                             const GLenum format, const GLenum type) {
+    uint64_t components;
+    switch (format) {
+    case GL_RED:  components = 1; break;
+    case GL_RG:   components = 2; break;
+    case GL_RGB:
+    case GL_BGR:  components = 3; break;
+    default:      components = 4; break;
+    }
+    uint64_t size = (type == GL_FLOAT) ? 4 : (type == GL_HALF_FLOAT) ? 2 : 1;
+    return static_cast<uint64_t>(width) * height * depth * components * size;
+  }
+
+private:
+  // Single instance - no copies
+  FrameProfiler(const FrameProfiler&);
+  FrameProfiler& operator=(const FrameProfiler&);
+};
+
+/**
+ * Times a CPU scope for the life of the object.
+ */
+class ScopedCPUTimer {
+public:
+  ScopedCPUTimer(const char* name) {
+    FrameProfiler::Get().BeginCPU(name);
+  }
+
+  ~ScopedCPUTimer() {
+    FrameProfiler::Get().EndCPU();
+  }
+};
+
+/**
+ * Times a GPU pass for the life of the object.
+ */
+class ScopedGPUTimer {
+public:
+  ScopedGPUTimer(const char* name) {
+    started = FrameProfiler::Get().BeginGPU(name);
+  }
+
+  ~ScopedGPUTimer() {
+    if (started)
+      FrameProfiler::Get().EndGPU();
+  }
+
+protected:
+  bool started;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_INSTALL_GL_HOOKS() FrameProfiler::Get().InstallGLHooks()
+#define PROFILE_BEGIN_FRAME() FrameProfiler::Get().BeginFrame()
+#define PROFILE_END_FRAME() FrameProfiler::Get().EndFrame()
+#define PROFILE_CPU_SCOPE(name) ScopedCPUTimer PROFILE_CONCAT(cpu_scope_, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) ScopedGPUTimer PROFILE_CONCAT(gpu_scope_, __LINE__)(name)
+#define PROFILE_PASS(name) PROFILE_CPU_SCOPE(name); PROFILE_GPU_SCOPE(name)
+#define PROFILE_COUNT(counter, n) FrameProfiler::Get().Count(counter, n)
+
+#else
+
+#define PROFILE_INSTALL_GL_HOOKS()
+#define PROFILE_BEGIN_FRAME()
+#define PROFILE_END_FRAME()
+#define PROFILE_CPU_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#define PROFILE_PASS(name)
+#define PROFILE_COUNT(counter, n)
+
+#endif
+
+#endif
@@ -0,0 +1,198 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    renderlist.h
+//	Purpose: Flat list of draw records compiled from a scene graph.
+//
+//============================================================================
+
+#ifndef __RENDERLIST_H
+#define __RENDERLIST_H
+
+#include <vector>
+
+class SceneNode;
+class PresentationNode;
+
+/**
+ * Description of an indexed draw call. Geometry nodes that can be drawn
+ * with a single glDrawElements call export this so they can be drawn
+ * without traversing the scene graph.
+ */
+struct DrawElementsCall {
+  GLenum  mode;           // Primitive type (GL_TRIANGLES, GL_TRIANGLE_STRIP, ...)
+  GLuint  vao;            // Vertex array object
+  GLsizei index_count;    // Number of indexes to draw
+  GLenum  index_type;     // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  const CompactVertexLayout* layout;  // Vertex layout of the VAO (NULL for float vertices)
+
+  DrawElementsCall()
+      : layout(nullptr) {
+  }
+};
+
+/**
+ * A single compiled draw. Holds everything needed to draw one piece of
+ * geometry: the draw call, the material to apply and the world and normal
+ * matrices accumulated along the path from the compiled root. If node is
+ * set the record is a fallback: the node (and its subtree) could not be
+ * flattened and is drawn by traversal with the record's matrices applied.
+ */
+struct DrawRecord {
+  DrawElementsCall call;           // Indexed draw call
+  uint32_t         material_id;    // Index into the render list materials (0 = none)
+  Matrix4x4        world_matrix;   // Composite modeling matrix (and position dequantization)
+  Matrix4x4        normal_matrix;  // Transpose of the inverse of world_matrix
+  SceneNode*       node;           // Node drawn by traversal (fallback) or NULL
+  AABB             bound;          // Bound relative to the compiled root
+  bool             cullable;       // Record may be skipped when out of view
+};
+
+/**
+ * Render list. Built by SceneNode::Compile: transform and presentation
+ * nodes push/pop state while geometry nodes append draw records.
+ */
+class RenderList {
+public:
+  /**
+   * Constructor.
+   */
+  RenderList() {
+    Clear();
+  }
+
+  /**
+   * Remove all records and materials and reset the compile state.
+   */
+  void Clear() {
+    records.clear();
+    materials.clear();
+    materials.push_back(nullptr);  // Material id 0 means no material
+    world_matrix.SetIdentity();
+    world_stack.clear();
+    material_stack.clear();
+    current_material = 0;
+  }
+
+  /**
+   * Apply a modeling transform while compiling. Postmultiplies the current
+   * world matrix (same order as TransformNode::Draw).
+   * @param  m  Local modeling matrix.
+   */
+  void PushTransform(const Matrix4x4& m) {
+    world_stack.push_back(world_matrix);
+    world_matrix *= m;
+  }
+
+  /**
+   * Revert to the world matrix prior to the last PushTransform.
+   */
+  void PopTransform() {
+    world_matrix = world_stack.back();
+    world_stack.pop_back();
+  }
+
+  /**
+   * Set the material used by records added until the matching PopMaterial.
+   * @param  material  Presentation node holding the material.
+   */
+  void PushMaterial(PresentationNode* material) {
+    material_stack.push_back(current_material);
+    current_material = GetMaterialId(material);
+  }
+
+  /**
+   * Revert to the material prior to the last PushMaterial.
+   */
+  void PopMaterial() {
+    current_material = material_stack.back();
+    material_stack.pop_back();
+  }
+
+  /**
+   * Add a draw record using the current world matrix and material.
+   * @param  call   Draw call for the geometry.
+   * @param  bound  Bound of the geometry (object coordinates).
+   */
+  void AddDraw(const DrawElementsCall& call, const AABB& bound) {
+    DrawRecord record;
+    record.call = call;
+    record.node = nullptr;
+    record.cullable = !bound.IsEmpty();
+    AddRecord(record, bound);
+  }
+
+  /**
+   * Add a node that cannot be flattened. It is drawn by traversal using the
+   * current world matrix and material. Defined in scenenode.h.
+   * @param  node  Scene node to draw.
+   */
+  void AddNode(SceneNode* node);
+
+  /**
+   * Get the compiled draw records.
+   * @return  Returns the list of draw records in draw order.
+   */
+  const std::vector<DrawRecord>& GetRecords() const {
+    return records;
+  }
+
+  /**
+   * Reorder the draw records.
+   * @param  order  Index of the record to place at each position (a
+   *                permutation of 0 to record count - 1).
+   */
+  void Reorder(const std::vector<uint32_t>& order) {
+    std::vector<DrawRecord> sorted(records.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+      sorted[i] = records[order[i]];
+    }
+    records.swap(sorted);
+  }
+
+  /**
+   * Get a material given its id.
+   * @param  id  Material id (from a draw record).
+   * @return  Returns the presentation node (NULL if id is 0).
+   */
+  PresentationNode* GetMaterial(const uint32_t id) const {
+    return materials[id];
+  }
+
+protected:
+  std::vector<DrawRecord>        records;
+  std::vector<PresentationNode*> materials;
+
+  // Compile state
+  Matrix4x4              world_matrix;
+  std::vector<Matrix4x4> world_stack;
+  uint32_t               current_material;
+  std::vector<uint32_t>  material_stack;
+
+  // Fill in the current matrices, material and bound and store the record
+  void AddRecord(DrawRecord& record, const AABB& bound) {
+    record.material_id = current_material;
+    record.world_matrix = world_matrix;
+    record.bound = bound.Transform(world_matrix);
+    record.normal_matrix = world_matrix.GetAffineInverse().Transpose();
+    if (IsQuantized(record.call.layout))
+      record.world_matrix *= GetDequantizeMatrix(*record.call.layout);
+    records.push_back(record);
+  }
+
+  // Find the id of a material, adding it if this is the first reference.
+  // Materials are few so a linear search is fine.
+  uint32_t GetMaterialId(PresentationNode* material) {
+    for (uint32_t i = 1; i < materials.size(); i++) {
+      if (materials[i] == material)
+        return i;
+    }
+    materials.push_back(material);
+    return (uint32_t)materials.size() - 1;
+  }
+};
+
+#endif
@@ -16,7 +16,16 @@
 
 enum SceneNodeType { SCENE_BASE, SCENE_PRESENTATION, 
                      SCENE_TRANSFORM, SCENE_GEOMETRY,
-                     SCENE_SHADER, SCENE_CAMERA, SCENE_LIGHT };
+                     SCENE_SHADER, SCENE_CAMERA, SCENE_LIGHT,
+                     SCENE_RENDERLIST };
+
+// Name of a scene node type (used to label profiler scopes)
+inline const char* GetNodeTypeName(const SceneNodeType type) {
+  static const char* names[] = { "base", "presentation", "transform",
+                                 "geometry", "shader", "camera", "light",
+                                 "render list" };
+  return names[type];
+}
 
 inline void CheckError(const char* str) {
   GLenum err = glGetError();
@@ -34,14 +43,27 @@ inline std::vector<Point3> FormTriangle(const Point3& v0, const Point3& v1,
 #include <stdint.h>
 #include "scene/color3.h"
 #include "scene/color4.h"
+#include "scene/glstate.h"
+#include "scene/profiler.h"
 #include "scene/scenestate.h"
+#include "scene/vertexformat.h"
+#include "scene/renderlist.h"
+#include "scene/scenebvh.h"
+#include "scene/instancebuffer.h"
 #include "scene/scenenode.h"
 #include "scene/transformnode.h"
+#include "scene/textureloader.h"
+#include "scene/texturecache.h"
+#include "scene/texturearray.h"
+#include "scene/videopack.h"
+#include "scene/videotexture.h"
 #include "scene/presentationnode.h"
 #include "scene/lightnode.h"
 #include "scene/geometrynode.h"
 #include "scene/shadernode.h"
 #include "scene/cameranode.h"
+#include "scene/indexbuffer.h"
+#include "scene/meshletlist.h"
 #include "scene/trisurface.h"
 #include "scene/textured_trisurface.h"
 #include "scene/meshteapot.h"
@@ -50,6 +72,9 @@ inline std::vector<Point3> FormTriangle(const Point3& v0, const Point3& v1,
 #include "scene/spheresection.h"
 #include "scene/surface_of_revolution.h"
 #include "scene/torus.h"
+#include "scene/meshcache.h"
 #include "scene/modelnode.h"
+#include "scene/instancedgeometrynode.h"
+#include "scene/renderlistnode.h"
 
 #endif
@@ -0,0 +1,283 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    scenebvh.h
+//	Purpose: Two level BVH over the triangles of a scene graph for ray
+//           queries (picking, collision).
+//
+//============================================================================
+
+#ifndef __SCENEBVH_H
+#define __SCENEBVH_H
+
+#include <chrono>
+#include <vector>
+
+class SceneNode;
+
+/**
+ * Ray hit in the scene: distance along the ray, the node and triangle hit,
+ * barycentric coordinates in the triangle and the world point.
+ */
+struct SceneHit {
+  float      t;
+  SceneNode* node;
+  uint32_t   triangle;
+  float      u;
+  float      v;
+  Point3     point;
+};
+
+/**
+ * Two level BVH over a scene graph. Each geometry node owns a triangle
+ * BVH in object coordinates (bottom level). The scene BVH holds one
+ * instance per placement of a triangle BVH - its world matrix and world
+ * bound - and a BVH over the instance bounds (top level). Rays are
+ * transformed into object coordinates for the bottom level. When only
+ * transforms change, the top level is refit rather than rebuilt and the
+ * triangle BVHs are untouched.
+ */
+class SceneBVH {
+public:
+  /**
+   * Constructor.
+   */
+  SceneBVH()
+      : revision(0),
+        build_ms(0.0f),
+        triangle_count(0),
+        refit(false) {
+  }
+
+  /**
+   * Build the BVH over a scene graph (defined in scenenode.h).
+   * @param  root  Root of the scene graph.
+   */
+  void Build(SceneNode* root);
+
+  /**
+   * Bring the BVH up to date with a scene graph (defined in scenenode.h).
+   * Nothing is done if the graph has not changed since the last update.
+   * If the same geometry is placed in the same order the top level is
+   * refit to the new transforms, otherwise it is rebuilt.
+   * @param  root  Root of the scene graph.
+   */
+  void Update(SceneNode* root);
+
+  /**
+   * Find the nearest triangle hit by a ray. The BVH must be up to date
+   * with the scene graph (nodes are referenced, not owned).
+   * @param  ray    Ray (world coordinates).
+   * @param  t_max  Farthest t of interest.
+   * @param  hit    (OUT) Set if a triangle is hit.
+   * @return  Returns true if a triangle is hit.
+   */
+  bool Intersect(const Ray3& ray, const float t_max, SceneHit& hit) const {
+    float t_best = t_max;
+    BVHRay world_ray(ray);
+    bool found = top.Traverse(world_ray, t_best,
+                              [&](uint32_t first, uint32_t count, float& t_near) -> bool {
+      bool leaf_hit = false;
+      const std::vector<uint32_t>& order = top.GetOrder();
+      for (uint32_t i = first; i < first + count; i++) {
+        const Instance& instance = instances[order[i]];
+
+        // Object space ray. The direction is not normalized so t is the
+        // same in both spaces.
+        Ray3 local;
+        HPoint3 o = instance.inverse * ray.o;
+        local.o.Set(o.x, o.y, o.z);
+        local.d = instance.inverse * ray.d;
+        RayHit rh;
+        if (instance.triangles->Intersect(BVHRay(local), t_near, rh)) {
+          t_near = rh.t;
+          hit.t = rh.t;
+          hit.node = instance.node;
+          hit.triangle = rh.primitive;
+          hit.u = rh.u;
+          hit.v = rh.v;
+          leaf_hit = true;
+        }
+      }
+      return leaf_hit;
+    });
+    if (found)
+      hit.point = ray.Intersect(hit.t);
+    return found;
+  }
+
+  /**
+   * Find the nearest triangle hit by each ray of a packet. Inactive lanes
+   * must hold valid rays (e.g. copies of an active lane).
+   * @param  rays    Rays (world coordinates).
+   * @param  active  Mask of the rays to trace.
+   * @param  t_max   Farthest t of interest.
+   * @param  hits    (OUT) Set for each active ray that hits a triangle.
+   * @return  Returns the mask of the active rays that hit a triangle.
+   */
+  uint32_t IntersectPacket(const RayPacket& rays, const uint32_t active, const float t_max,
+                           SceneHit* hits) const {
+    float t[kRayPacketSize];
+    for (uint32_t i = 0; i < kRayPacketSize; i++)
+      t[i] = t_max;
+    uint32_t found = 0;
+    top.TraversePacket(rays, active, t, [&](uint32_t first, uint32_t count, uint32_t mask) {
+      const std::vector<uint32_t>& order = top.GetOrder();
+      for (uint32_t i = first; i < first + count; i++) {
+        uint32_t index = order[i];
+        uint32_t instance_mask = mask & PacketBox(rays, &bounds[index].m_minPt.x,
+                                                  &bounds[index].m_maxPt.x, t);
+        if (instance_mask == 0)
+          continue;
+
+        // Object space rays (directions not normalized so t is unchanged)
+        const Instance& instance = instances[index];
+        RayPacket local;
+        TransformSoASerial(instance.inverse.Get(), 1.0f, rays.o_x, rays.o_y, rays.o_z,
+                           local.o_x, local.o_y, local.o_z, kRayPacketSize);
+        TransformSoASerial(instance.inverse.Get(), 0.0f, rays.d_x, rays.d_y, rays.d_z,
+                           local.d_x, local.d_y, local.d_z, kRayPacketSize);
+        for (uint32_t lane = 0; lane < kRayPacketSize; lane++)
+          local.SetInverse(lane);
+        RayHit rh[kRayPacketSize];
+        uint32_t hit = instance.triangles->IntersectPacket(local, instance_mask, t, rh);
+        found |= hit;
+        for (uint32_t lane = 0; hit != 0; lane++, hit >>= 1) {
+          if (hit & 1) {
+            hits[lane].t = rh[lane].t;
+            hits[lane].node = instance.node;
+            hits[lane].triangle = rh[lane].primitive;
+            hits[lane].u = rh[lane].u;
+            hits[lane].v = rh[lane].v;
+          }
+        }
+      }
+    });
+    found &= active;
+    for (uint32_t lane = 0; lane < kRayPacketSize; lane++) {
+      if (found & (1u << lane)) {
+        hits[lane].point.Set(rays.o_x[lane] + rays.d_x[lane] * hits[lane].t,
+                             rays.o_y[lane] + rays.d_y[lane] * hits[lane].t,
+                             rays.o_z[lane] + rays.d_z[lane] * hits[lane].t);
+      }
+    }
+    return found;
+  }
+
+  /**
+   * Add the current transform to the transform stack used while
+   * collecting instances.
+   * @param  m  Transform of the node being entered.
+   */
+  void PushTransform(const Matrix4x4& m) {
+    world_stack.push_back(world_matrix);
+    world_matrix *= m;
+  }
+
+  /**
+   * Revert to the transform prior to the last PushTransform.
+   */
+  void PopTransform() {
+    world_matrix = world_stack.back();
+    world_stack.pop_back();
+  }
+
+  /**
+   * Add an instance of a triangle BVH with the current transform. Called
+   * by nodes while collecting.
+   * @param  node       Node that owns the triangles.
+   * @param  triangles  Triangle BVH (object coordinates). May be NULL or
+   *                    empty, in which case nothing is added.
+   */
+  void AddInstance(SceneNode* node, const TriangleBVH* triangles) {
+    if (triangles == nullptr || triangles->IsEmpty())
+      return;
+    Instance instance;
+    instance.node = node;
+    instance.triangles = triangles;
+    instance.world = world_matrix;
+    instance.inverse = world_matrix.GetAffineInverse();
+    collected.push_back(instance);
+  }
+
+  /**
+   * Get the number of instances.
+   * @return  Returns the instance count.
+   */
+  uint32_t GetInstanceCount() const {
+    return static_cast<uint32_t>(instances.size());
+  }
+
+  /**
+   * Get the number of triangles over all instances.
+   * @return  Returns the triangle count.
+   */
+  uint32_t GetTriangleCount() const {
+    return triangle_count;
+  }
+
+  /**
+   * Get the time taken by the last Build or Update (including building
+   * triangle BVHs that were out of date).
+   * @return  Returns the time in milliseconds.
+   */
+  float GetBuildTime() const {
+    return build_ms;
+  }
+
+  /**
+   * Check if the last update refit the top level rather than rebuilding.
+   * @return  Returns true if the top level was refit.
+   */
+  bool WasRefit() const {
+    return refit;
+  }
+
+protected:
+  // Placement of a triangle BVH
+  struct Instance {
+    SceneNode*         node;
+    const TriangleBVH* triangles;
+    Matrix4x4          world;
+    Matrix4x4          inverse;
+  };
+
+  BVH                    top;             // Over the instance bounds
+  std::vector<Instance>  instances;
+  std::vector<AABB>      bounds;          // World bound of each instance
+  std::vector<Instance>  collected;       // Filled by CollectBVH
+  Matrix4x4              world_matrix;
+  std::vector<Matrix4x4> world_stack;
+  uint32_t               revision;        // Graph revision of the last update
+  float                  build_ms;
+  uint32_t               triangle_count;
+  bool                   refit;
+
+  // Collect the instances of a scene graph (defined in scenenode.h)
+  void Collect(SceneNode* root);
+
+  // Replace the instances with the collected ones. Returns true if the
+  // same triangle BVHs are placed in the same order.
+  bool TakeCollected() {
+    bool same = (collected.size() == instances.size());
+    for (uint32_t i = 0; same && i < collected.size(); i++) {
+      same = (collected[i].node == instances[i].node &&
+              collected[i].triangles == instances[i].triangles);
+    }
+    instances.swap(collected);
+    collected.clear();
+
+    bounds.resize(instances.size());
+    triangle_count = 0;
+    for (uint32_t i = 0; i < instances.size(); i++) {
+      bounds[i] = instances[i].triangles->GetBound().Transform(instances[i].world);
+      triangle_count += instances[i].triangles->GetTriangleCount();
+    }
+    return same;
+  }
+};
+
+#endif
@@ -26,7 +26,9 @@ public:
 	 */
   SceneNode() 
     : node_type(SCENE_BASE),
-      reference_count(0) {
+      reference_count(0),
+      bound_revision(0),
+      bound_keep(false) {
   } 
 
 	/**
@@ -54,8 +56,11 @@ public:
    * @param  scene_state  Current scene state
 	 */
 	virtual void Draw(SceneState& scene_state) {
-		// Loop through the list and draw the children
+		// Loop through the list and draw the children that are in view
     for (auto c : children) {
+      if (c->IsCulled(scene_state))
+        continue;
+      PROFILE_CPU_SCOPE(GetNodeTypeName(c->GetNodeType()));
 			c->Draw(scene_state);
     } 
 	}
@@ -71,6 +76,30 @@ public:
     }
 	}	
 	
+	/**
+	 * Compile the scene node and its children into a render list. The base
+   * class just compiles the children. Nodes that cannot be flattened add
+   * themselves to the list so they are drawn by traversal.
+   * @param  list  Render list being built.
+	 */
+	virtual void Compile(RenderList& list) {
+    for (auto c : children) {
+      c->Compile(list);
+    }
+	}
+
+  /**
+   * Add this node's triangles and its children's to a scene BVH. The base
+   * class just collects the children. Nodes with triangles add an instance
+   * and transform nodes push their transform.
+   * @param  bvh  Scene BVH being collected.
+   */
+  virtual void CollectBVH(SceneBVH& bvh) {
+    for (auto c : children) {
+      c->CollectBVH(bvh);
+    }
+  }
+
 	/**
 	 * Destroy all the children
 	 */
@@ -78,6 +107,9 @@ public:
     for (auto c : children) {
       c->Release();
     }
+    if (!children.empty()) {
+      InvalidateGraph();
+    }
     children.clear();
 	}
 
@@ -88,8 +120,63 @@ public:
 	void AddChild(SceneNode* node) {
 		children.push_back(node);
 		node->reference_count++;
+    InvalidateGraph();
 	}
 
+  /**
+   * Get the scene graph revision. The revision changes whenever any node
+   * changes in a way that invalidates compiled render lists.
+   * @return  Returns the current scene graph revision.
+   */
+  static uint32_t GraphRevision() {
+    return GraphRevisionCounter();
+  }
+
+  /**
+   * Mark compiled render lists as out of date.
+   */
+  static void InvalidateGraph() {
+    GraphRevisionCounter()++;
+  }
+
+  /**
+   * Get the bounding box of this node and its children (in the coordinates
+   * of this node's parent). The bound is recomputed the first time it is
+   * requested after the scene graph changes. Nodes do not know their
+   * parents, so any change (e.g. a transform) invalidates every bound.
+   * @return  Returns the bounding box (empty if there is no geometry).
+   */
+  const AABB& GetBound() {
+    UpdateBound();
+    return bound;
+  }
+
+  /**
+   * Check if this node and its children can be skipped when out of view.
+   * Nodes that set state used outside their subtree (lights, cameras and
+   * shaders) are always drawn, as are nodes without geometry.
+   * @return  Returns true if the node may be culled.
+   */
+  bool IsCullable() {
+    UpdateBound();
+    return !bound_keep && !bound.IsEmpty();
+  }
+
+  /**
+   * Test if this node is outside the view. The bound is transformed by the
+   * current model matrix (the parent's world matrix, which includes the
+   * reflection of the mirrored pass) and tested against the view frustum.
+   * @param  scene_state  Current scene state
+   * @return  Returns true if the node and its children can be skipped.
+   */
+  bool IsCulled(SceneState& scene_state) {
+    if (!IsCullable())
+      return false;
+    bool culled = scene_state.IsOutsideView(bound.Transform(scene_state.model_matrix));
+    PROFILE_COUNT(culled ? FRAME_CULLED : FRAME_VISIBLE, 1);
+    return culled;
+  }
+
   /**
 	 * Get the type of scene node
    * @return  Returns the type of hte scene node.
@@ -119,6 +206,91 @@ protected:
 	SceneNodeType           node_type;
 	int                     reference_count;
 	std::vector<SceneNode*> children;
+  AABB                    bound;             // Cached by GetBound
+  uint32_t                bound_revision;    // Graph revision of bound
+  bool                    bound_keep;        // Subtree has a light, camera or shader
+
+  // Recompute the bound if the graph changed since it was computed
+  void UpdateBound() {
+    if (bound_revision == GraphRevision())
+      return;
+    bound = ComputeBound();
+    bound_keep = (node_type == SCENE_LIGHT || node_type == SCENE_CAMERA ||
+                  node_type == SCENE_SHADER);
+    for (auto c : children) {
+      c->UpdateBound();
+      bound_keep = bound_keep || c->bound_keep;
+    }
+    bound_revision = GraphRevision();
+  }
+
+  /**
+   * Compute the bounding box of this node and its children. The base class
+   * merges the bounds of the children.
+   * @return  Returns the bounding box.
+   */
+  virtual AABB ComputeBound() {
+    AABB box;
+    for (auto c : children) {
+      box.Merge(c->GetBound());
+    }
+    return box;
+  }
+
+  // Revision counter shared by all nodes. Starts at 1 so a render list
+  // that has never been compiled (revision 0) is always out of date.
+  static uint32_t& GraphRevisionCounter() {
+    static uint32_t revision = 1;
+    return revision;
+  }
 };
 
+// Add a node drawn by traversal. Defined here since the record needs the
+// node's bound.
+inline void RenderList::AddNode(SceneNode* node) {
+  DrawRecord record;
+  record.call.mode = GL_TRIANGLES;
+  record.call.vao = 0;
+  record.call.index_count = 0;
+  record.call.index_type = GL_UNSIGNED_SHORT;
+  record.node = node;
+  record.cullable = node->IsCullable();
+  AddRecord(record, node->GetBound());
+}
+
+// Scene BVH methods that traverse the scene graph. Defined here since they
+// need the complete node class.
+inline void SceneBVH::Collect(SceneNode* root) {
+  world_matrix.SetIdentity();
+  world_stack.clear();
+  collected.clear();
+  root->CollectBVH(*this);
+}
+
+inline void SceneBVH::Build(SceneNode* root) {
+  auto start = std::chrono::high_resolution_clock::now();
+  Collect(root);
+  TakeCollected();
+  top.Build(bounds);
+  refit = false;
+  revision = SceneNode::GraphRevision();
+  build_ms = std::chrono::duration<float, std::milli>(
+    std::chrono::high_resolution_clock::now() - start).count();
+}
+
+inline void SceneBVH::Update(SceneNode* root) {
+  if (revision == SceneNode::GraphRevision())
+    return;
+  auto start = std::chrono::high_resolution_clock::now();
+  Collect(root);
+  refit = TakeCollected() && !top.GetNodes().empty();
+  if (refit)
+    top.Refit(bounds);
+  else
+    top.Build(bounds);
+  revision = SceneNode::GraphRevision();
+  build_ms = std::chrono::duration<float, std::milli>(
+    std::chrono::high_resolution_clock::now() - start).count();
+}
+
 #endif
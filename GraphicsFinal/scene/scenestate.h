@@ -16,6 +16,18 @@
 
 const uint32_t kMaxLights = 8;
 
+// Stamp identifying the identity model matrix. Stamps identify the contents
+// of the model and projection/view matrices so nodes can cache results that
+// depend on them. Stamp 0 is never used (marks an empty cache entry).
+const uint32_t kIdentityStamp = 1;
+
+// Modeling and normal matrices saved by PushTransforms
+struct TransformState {
+  Matrix4x4 model_matrix;
+  Matrix4x4 normal_matrix;
+  uint32_t  model_stamp;
+};
+
 // Simple structure to hold light uniform locations
 struct LightUniforms {
   GLint enabled;
@@ -53,6 +65,12 @@ struct SceneState {
   GLint normalmatrix_loc;   // Normal matrix location
   GLint cameraposition_loc; // Camera position loc
 
+  // Instancing uniform locations
+  GLint projectionview_loc;    // Composite projection and view matrix location
+  GLint useinstancing_loc;     // Instancing flag location
+  GLint instancebase_loc;      // Index of the first instance location
+  GLint instancematrices_loc;  // Instance matrix buffer texture location
+
   // Material uniform locations
   GLint materialambient_loc;   // Material ambient reflection location
   GLint materialdiffuse_loc;   // Material diffuse reflection location
@@ -60,9 +78,6 @@ struct SceneState {
   GLint materialemission_loc;  // Material emission location
   GLint materialshininess_loc; // Material shininess location
 
-  //Outline Enable
-  GLint outlineEnable_loc;
-
   // Texture mapping
   GLint usetexture_loc;
   GLint texturescale_loc;
@@ -71,6 +86,12 @@ struct SceneState {
   GLint usenormalmap_loc;  // Normal map flag location
   GLint normalmap_loc;
 
+  // Texture arrays
+  GLint texturearray_loc;     // Color texture array sampler location
+  GLint texturelayer_loc;     // Color texture array layer location
+  GLint normalmaparray_loc;   // Normal map array sampler location
+  GLint normalmaplayer_loc;   // Normal map array layer location
+
   // Lights
   GLint usereallighting_loc;
   int    max_enabled_light;    // Index of the maximum enabled light index
@@ -82,9 +103,28 @@ struct SceneState {
   Matrix4x4 ortho_matrix;   // Orthographic projection matrix (2-D)
   Matrix4x4 pv;             // Current composite projection and view matrix
   Matrix4x4 model_matrix;   // Current model matrix
+  Matrix4x4 normal_matrix;  // Current normal matrix (transpose of the inverse of model_matrix)
+  uint32_t  model_stamp;    // Identifies the current model matrix
+  uint32_t  pv_stamp;       // Identifies the current projection and view matrix
+
+  // World space view frustum (see GetFrustum)
+  Frustum   frustum;
+  uint32_t  frustum_stamp;  // pv_stamp of the frustum
 
   // Retained state to push/pop modeling matrix
-  std::list<Matrix4x4> modelmatrix_stack;
+  std::list<TransformState> modelmatrix_stack;
+
+  // Shadow of the OpenGL state - nodes make state changes through it so
+  // redundant changes are skipped
+  GLStateCache gl_state;
+
+  /**
+  * Constructor. No camera has set the projection and view matrix yet.
+  */
+  SceneState()
+      : pv_stamp(0),
+        frustum_stamp(0) {
+  }
 
   /**
   * Initialize scene state prior to drawing.
@@ -92,14 +132,56 @@ struct SceneState {
   void Init() {
     max_enabled_light = 0;
     model_matrix.SetIdentity();
+    normal_matrix.SetIdentity();
+    model_stamp = kIdentityStamp;
     modelmatrix_stack.clear();
   }
 
+  /**
+  * Set the current model matrix. Computes the normal matrix.
+  * @param  m      Model matrix.
+  * @param  stamp  Stamp identifying the matrix. Use the same stamp each
+  *                time the same matrix is set so cached transforms are reused.
+  */
+  void SetModelMatrix(const Matrix4x4& m, const uint32_t stamp) {
+    model_matrix = m;
+    normal_matrix = m.GetAffineInverse().Transpose();
+    model_stamp = stamp;
+  }
+
+  /**
+  * Get the view frustum in world coordinates. Extracted from the current
+  * projection and view matrix the first time it is needed after the
+  * camera changes.
+  * @return  Returns the frustum.
+  */
+  const Frustum& GetFrustum() {
+    if (frustum_stamp != pv_stamp) {
+      frustum.Set(pv);
+      frustum_stamp = pv_stamp;
+    }
+    return frustum;
+  }
+
+  /**
+  * Test if a box is outside the view. Nothing is outside until a camera
+  * sets the projection and view matrix.
+  * @param  box  Box in world coordinates (must not be empty).
+  * @return  Returns true if the box is entirely outside the frustum.
+  */
+  bool IsOutsideView(const AABB& box) {
+    return pv_stamp != 0 && GetFrustum().IsOutside(box);
+  }
+
   /**
   * Copy current matrix onto stack
   */
   void PushTransforms() {
-    modelmatrix_stack.push_back(model_matrix);
+    TransformState state;
+    state.model_matrix = model_matrix;
+    state.normal_matrix = normal_matrix;
+    state.model_stamp = model_stamp;
+    modelmatrix_stack.push_back(state);
   }
 
   /**
@@ -111,11 +193,26 @@ struct SceneState {
     // remove it from the stack
     if (modelmatrix_stack.size() > 0)
     {
-      model_matrix = modelmatrix_stack.back();
+      const TransformState& state = modelmatrix_stack.back();
+      model_matrix = state.model_matrix;
+      normal_matrix = state.normal_matrix;
+      model_stamp = state.model_stamp;
       modelmatrix_stack.pop_back();
     }
-    else
+    else {
       model_matrix.SetIdentity();
+      normal_matrix.SetIdentity();
+      model_stamp = kIdentityStamp;
+    }
+  }
+
+  /**
+  * Allocate a new stamp. Called whenever a node computes a new matrix.
+  * @return  Returns a stamp not returned before.
+  */
+  static uint32_t NewStamp() {
+    static uint32_t stamp = kIdentityStamp;
+    return ++stamp;
   }
 };
 
@@ -91,6 +91,15 @@ public:
   // Derived classes must add this to set all internal uniforms and attribute locations
   virtual bool GetLocations() = 0;
 
+  /**
+   * Compile. The shader program and uniform locations apply to all
+   * descendants, so the shader node and its children are drawn by traversal.
+   * @param  list  Render list being built.
+   */
+  virtual void Compile(RenderList& list) {
+    list.AddNode(this);
+  }
+
 protected:
  GLSLVertexShader   vertex_shader;
  GLSLFragmentShader fragment_shader;
@@ -62,20 +62,16 @@ public:
     // ConstructRowColFaceList forms ccw triangles
     std::reverse(vertices.begin(), vertices.end());
 
-    // Create a rotation matrix
-    Matrix4x4 m;
-    m.RotateZ(360.0f / static_cast<float>(n));
-
-    // Rotate the prior "edge" vertices
-    uint32_t index = 0;  // Index to the prior edge at this row
-    for (uint32_t i = 0; i < n; i++) {
-      for (uint32_t j = 0; j < nrows; j++) {
-        // Rotate the vertex and the normal
-        vtx.vertex = m * vertices[index].vertex;
-        vtx.normal = m * vertices[index].normal;
-        vertices.push_back(vtx);
-        index++;
-      }
+    // Add the rotated "edge" vertices. Each column is the first column
+    // rotated about z, transformed as a batch
+    vertices.resize(nrows * (n + 1));
+    const size_t stride = sizeof(VertexAndNormal);
+    for (uint32_t i = 1; i <= n; i++) {
+      Matrix4x4 m;
+      m.RotateZ(360.0f * static_cast<float>(i) / static_cast<float>(n));
+      VertexAndNormal* column = &vertices[i * nrows];
+      TransformPointsStrided(m, &vertices[0].vertex, stride, &column->vertex, stride, nrows);
+      TransformVectorsStrided(m, &vertices[0].normal, stride, &column->normal, stride, nrows);
     }
 
     // Copy the first column of vertices
@@ -164,24 +160,21 @@ public:
     // ConstructRowColFaceList forms ccw triangles
     std::reverse(vertices.begin(), vertices.end());
 
-    // Create a rotation matrix
-    Matrix4x4 m;
-    m.RotateZ(360.0f / static_cast<float>(n));
-
-    // Rotate the prior "edge" vertices
+    // Add the rotated "edge" vertices. Each column is a copy of the first
+    // column (keeps t) rotated about z, transformed as a batch
     float ds = 1.0f / static_cast<float>(n);
-    float s = ds;
-    uint32_t index = 0;  // Index to the prior edge at this row
-    for (uint32_t i = 0; i < n; i++, s += ds) {
-      vtx.s = s;
+    const size_t stride = sizeof(PNTVertex);
+    for (uint32_t i = 1; i <= n; i++) {
       for (uint32_t j = 0; j < nrows; j++) {
-        // Rotate the vertex and the normal
-        vtx.vertex = m * vertices[index].vertex;
-        vtx.normal = m * vertices[index].normal;
-        vtx.t = vertices[index].t;
+        vtx = vertices[j];
+        vtx.s = ds * static_cast<float>(i);
         vertices.push_back(vtx);
-        index++;
       }
+      Matrix4x4 m;
+      m.RotateZ(360.0f * static_cast<float>(i) / static_cast<float>(n));
+      PNTVertex* column = &vertices[i * nrows];
+      TransformPointsStrided(m, &column->vertex, stride, &column->vertex, stride, nrows);
+      TransformVectorsStrided(m, &column->normal, stride, &column->normal, stride, nrows);
     }
 
     // Copy the first column of vertices
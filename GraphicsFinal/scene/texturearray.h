@@ -0,0 +1,167 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    texturearray.h
+//	Purpose: Material textures packed into the layers of one
+//           GL_TEXTURE_2D_ARRAY so materials can switch textures by
+//           changing a layer uniform instead of a texture binding.
+//
+//============================================================================
+
+#ifndef __TEXTUREARRAY_H
+#define __TEXTUREARRAY_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Texture units the material texture arrays are bound to (0 and 1 hold the
+// material texture and normal map, 2 the instance matrices)
+const GLenum kTextureArrayUnit = 3;
+const GLenum kNormalMapArrayUnit = 4;
+
+/**
+ * Texture array. Holds a fixed number of layers of the same size, usage
+ * and sampler state (the sampler state is stored in the texture object so
+ * every layer shares it). Layers are loaded in the background through the
+ * TextureLoader; images of a different size are resampled to the layer
+ * size on the loader threads. Until then a layer holds the same
+ * placeholder as a texture (grey or a flat normal).
+ *
+ * Resampling keeps one size per array, so pick the size of the largest
+ * image that matters: smaller images are stored at the larger size.
+ */
+class TextureArray {
+public:
+  /**
+   * Constructor. Creates the array with all mipmap levels.
+   * @param  usage       Color textures or normal maps
+   * @param  width       Layer width
+   * @param  height      Layer height
+   * @param  layers      Number of layers
+   * @param  wrap_s      OpenGL wrap option (s)
+   * @param  wrap_t      OpenGL wrap option (t)
+   * @param  min_filter  OpenGL filter to use for minification
+   * @param  mag_filter  OpenGL filter to use for magnification
+   */
+  TextureArray(const TextureUsage usage, const int width, const int height, const int layers,
+               GLuint wrap_s, GLuint wrap_t, GLuint min_filter, GLuint mag_filter)
+      : usage(usage),
+        width(width),
+        height(height),
+        capacity(layers) {
+    static const unsigned char grey[4] = { 128, 128, 128, 255 };
+    static const unsigned char flat_normal[4] = { 128, 128, 255, 255 };
+    const unsigned char* placeholder = (usage == TEXTURE_NORMAL_MAP) ? flat_normal : grey;
+
+    // Fill every layer of every level with the placeholder
+    std::vector<unsigned char> fill(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < fill.size(); i += 4) {
+      for (int k = 0; k < 4; k++)
+        fill[i + k] = placeholder[k];
+    }
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    int w = width;
+    int h = height;
+    for (int level = 0; level <= MipLevelCount(width, height); level++) {
+      glTexImage3D(GL_TEXTURE_2D_ARRAY, level, TextureLoader::InternalFormat(usage), w, h,
+                   layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+      for (int layer = 0; layer < layers; layer++) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, w, h, 1, GL_RGBA,
+                        GL_UNSIGNED_BYTE, &fill[0]);
+      }
+      w = (w > 1) ? w / 2 : 1;
+      h = (h > 1) ? h / 2 : 1;
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap_s);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap_t);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, mag_filter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, min_filter);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  }
+
+  /**
+   * Destructor. Deletes the texture. Layers still loading are cancelled.
+   */
+  ~TextureArray() {
+    if (!files.empty())
+      TextureLoader::Get().Cancel(texture);
+    glDeleteTextures(1, &texture);
+  }
+
+  /**
+   * Add a layer loaded from an image in the textures directory. A file
+   * already added returns its layer.
+   * @param  fname  Texture image filename (relative to textures)
+   * @return  Returns the layer index, or -1 if the array is full.
+   */
+  int AddLayer(const std::string& fname) {
+    for (uint32_t i = 0; i < files.size(); i++) {
+      if (files[i] == fname)
+        return static_cast<int>(i);
+    }
+    if (static_cast<int>(files.size()) == capacity) {
+      printf("TextureArray: no free layer for %s\n", fname.c_str());
+      return -1;
+    }
+    int layer = static_cast<int>(files.size());
+    files.push_back(fname);
+    TextureLoader::Get().LoadLayer(fname, usage, texture, layer, width, height);
+    return layer;
+  }
+
+  /**
+   * Get the texture array object.
+   * @return  Returns the GL_TEXTURE_2D_ARRAY texture.
+   */
+  GLuint GetTexture() const {
+    return texture;
+  }
+
+  /**
+   * Get the usage of the layers.
+   * @return  Returns whether the layers are color textures or normal maps.
+   */
+  TextureUsage GetUsage() const {
+    return usage;
+  }
+
+  /**
+   * Get the number of layers in use.
+   * @return  Returns the number of layers added.
+   */
+  int GetLayerCount() const {
+    return static_cast<int>(files.size());
+  }
+
+  /**
+   * Update the texture filtering (shared by all layers).
+   * @param  min_filter  OpenGL filter to use for minification
+   * @param  mag_filter  OpenGL filter to use for magnification
+   */
+  void SetFilters(GLuint min_filter, GLuint mag_filter) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, mag_filter);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, min_filter);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  }
+
+protected:
+  TextureUsage             usage;
+  int                      width;
+  int                      height;
+  int                      capacity;
+  GLuint                   texture;
+  std::vector<std::string> files;   // Image of each layer
+
+private:
+  // Textures are owned - no copies
+  TextureArray(const TextureArray&);
+  TextureArray& operator=(const TextureArray&);
+};
+
+#endif
@@ -0,0 +1,197 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    texturecache.h
+//	Purpose: Reference counted textures shared by materials that use the
+//           same image with the same sampler state.
+//
+//============================================================================
+
+#ifndef __TEXTURECACHE_H
+#define __TEXTURECACHE_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/**
+ * Texture cache. Materials acquire textures by file name, usage and
+ * sampler state; a texture already loaded with the same key is shared
+ * (its reference count is incremented) instead of being decoded and
+ * uploaded again. New textures are loaded through the TextureLoader, which
+ * frees the decoded image once it is uploaded. The texture is deleted when
+ * the last reference is released.
+ *
+ * Sampler state is part of the key because it is stored in the texture
+ * object. Changing it on a shared texture (glTexParameter) changes it for
+ * every user.
+ */
+class TextureCache {
+public:
+  /**
+   * Get the texture cache. Call from the OpenGL thread.
+   * @return  Returns the texture cache.
+   */
+  static TextureCache& Get() {
+    static TextureCache cache;
+    return cache;
+  }
+
+  /**
+   * Get a texture, loading it if it is not in the cache. Each call must be
+   * matched by a call to Release.
+   * @param  fname       Texture image filename (relative to textures)
+   * @param  usage       Color texture or normal map
+   * @param  wrap_s      OpenGL wrap option (s)
+   * @param  wrap_t      OpenGL wrap option (t)
+   * @param  min_filter  OpenGL filter to use for minification
+   * @param  mag_filter  OpenGL filter to use for magnification
+   * @return  Returns the texture object.
+   */
+  GLuint Acquire(const std::string& fname, const TextureUsage usage, GLuint wrap_s,
+                 GLuint wrap_t, GLuint min_filter, GLuint mag_filter) {
+    // Textures are few so a linear search is fine
+    for (auto& e : entries) {
+      if (e.fname == fname && e.usage == usage && e.wrap_s == wrap_s &&
+          e.wrap_t == wrap_t && e.min_filter == min_filter && e.mag_filter == mag_filter) {
+        e.references++;
+        return e.texture;
+      }
+    }
+
+    Entry e;
+    e.fname = fname;
+    e.usage = usage;
+    e.wrap_s = wrap_s;
+    e.wrap_t = wrap_t;
+    e.min_filter = min_filter;
+    e.mag_filter = mag_filter;
+    e.references = 1;
+    e.texture = TextureLoader::Get().Load(fname, usage, wrap_s, wrap_t, min_filter, mag_filter);
+    entries.push_back(e);
+    return e.texture;
+  }
+
+  /**
+   * Release a texture acquired with Acquire. Deletes the texture when it
+   * has no more references (cancelling its load if it is still loading).
+   * Texture 0 is ignored.
+   * @param  texture  Texture object.
+   */
+  void Release(const GLuint texture) {
+    if (texture == 0)
+      return;
+    for (uint32_t i = 0; i < entries.size(); i++) {
+      if (entries[i].texture == texture) {
+        if (--entries[i].references == 0) {
+          TextureLoader::Get().Cancel(entries[i].texture);
+          glDeleteTextures(1, &entries[i].texture);
+          entries.erase(entries.begin() + i);
+        }
+        return;
+      }
+    }
+    printf("TextureCache: release of unknown texture %u\n", texture);
+  }
+
+  /**
+   * Get the number of textures in the cache.
+   * @return  Returns the number of distinct textures.
+   */
+  uint32_t GetCount() const {
+    return static_cast<uint32_t>(entries.size());
+  }
+
+  /**
+   * Get the GPU memory used by a texture (all mipmap levels). Textures that
+   * are still loading report the size of their placeholder. Baked textures
+   * report their compressed size.
+   * @param  texture  Texture object.
+   * @return  Returns the size in bytes.
+   */
+  static uint64_t GetResidentBytes(const GLuint texture) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    uint64_t bytes = 0;
+    for (GLint level = 0; ; level++) {
+      GLint w = 0;
+      GLint h = 0;
+      GLint format = 0;
+      GLint compressed = GL_FALSE;
+      glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &w);
+      glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &h);
+      glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_INTERNAL_FORMAT, &format);
+      glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+      if (w == 0 || h == 0)
+        break;
+      if (compressed) {
+        GLint size = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+        bytes += static_cast<uint64_t>(size);
+      }
+      else
+        bytes += static_cast<uint64_t>(w) * h * BytesPerTexel(format);
+      if (w == 1 && h == 1)
+        break;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return bytes;
+  }
+
+  /**
+   * Print each texture with its reference count, size and GPU memory.
+   * Changes the texture binding of the active unit.
+   */
+  void PrintStats() const {
+    uint64_t total = 0;
+    uint32_t shared = 0;
+    printf("Textures (%u):\n", static_cast<uint32_t>(entries.size()));
+    for (auto& e : entries) {
+      GLint w = 0;
+      GLint h = 0;
+      glBindTexture(GL_TEXTURE_2D, e.texture);
+      glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+      glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+      uint64_t bytes = GetResidentBytes(e.texture);
+      total += bytes;
+      if (e.references > 1)
+        shared++;
+      printf("  %-36s %4d x %-4d %2u refs %8.2f MB\n", e.fname.c_str(), w, h,
+             e.references, bytes / (1024.0 * 1024.0));
+    }
+    printf("  %u shared, %.2f MB resident\n", shared, total / (1024.0 * 1024.0));
+  }
+
+protected:
+  // Cached texture and the key it was loaded with
+  struct Entry {
+    std::string  fname;
+    TextureUsage usage;
+    GLuint       wrap_s;
+    GLuint       wrap_t;
+    GLuint       min_filter;
+    GLuint       mag_filter;
+    GLuint       texture;
+    uint32_t     references;
+  };
+
+  std::vector<Entry> entries;
+
+  // Storage per texel of the internal formats used for textures. 3
+  // component formats are padded to 4 bytes by drivers.
+  static uint32_t BytesPerTexel(const GLint format) {
+    switch (format) {
+    case GL_R8:     return 1;
+    case GL_RG8:    return 2;
+    case GL_RGBA16F:
+    case GL_RGB16F: return 8;
+    case GL_RGBA32F:
+    case GL_RGB32F: return 16;
+    default:        return 4;
+    }
+  }
+};
+
+#endif
@@ -14,7 +14,8 @@
 #define __TEXTUREDTRISURFACE_H
 
 /**
- * Textured triangle mesh surface.
+ * Textured triangle mesh surface. Vertices are uploaded in a compact
+ * layout (see vertexformat.h) unless kCompactVertices is false.
  */
 class TexturedTriSurface : public GeometryNode {
 public:
@@ -22,9 +23,9 @@ public:
 	 * Constructor. 
 	 */
 	TexturedTriSurface() {
-    vao        = 0;
-    vbo        = 0;
-    facebuffer = 0;
+    vao = 0;
+    vbo = 0;
+    triangle_list = true;
   }
 	
 	/**
@@ -33,7 +34,6 @@ public:
 	~TexturedTriSurface() {
     // Delete vertex buffer objects
     glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &facebuffer);
     glDeleteVertexArrays(1, &vao);
   }
 	
@@ -41,35 +41,35 @@ public:
   * Draw this geometry node.
   */
   void Draw(SceneState& scene_state) {
-    glBindVertexArray(vao);
-		// Render the mesh into the stencil buffer.
-#define USE_OUTLINE_TEXTURE 0
-#if USE_OUTLINE_TEXTURE
-		glEnable(GL_STENCIL_TEST);
-
-		glStencilFunc(GL_ALWAYS, 1, -1);
-		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-#endif
-		//glEnable(GL_STENCIL_TEST);
-
-
-		glDrawElements(GL_TRIANGLES, (GLsizei)face_count, GL_UNSIGNED_SHORT, (void*)0);
-
-
-		// Render the thick wireframe version.
-#if USE_OUTLINE_TEXTURE
-		glStencilFunc(GL_NOTEQUAL, 1, -1);
-		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-
-		glLineWidth(10);
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		glDrawElements(GL_LINE_LOOP, (GLsizei)face_count, GL_UNSIGNED_SHORT, (void*)0);
-#endif
-		glBindVertexArray(0);
+    bool quantized = IsQuantized(GetVertexLayout());
+    if (quantized)
+      SetDequantizeMatrices(scene_state, GetVertexLayout());
+    scene_state.gl_state.BindVertexArray(vao);
+    glDrawElements(GL_TRIANGLES, index_buffer.GetCount(), index_buffer.GetType(), (void*)0);
+    if (quantized)
+      SetDequantizeMatrices(scene_state, nullptr);
+  }
 
+  /**
+   * Get the draw call used to draw this surface.
+   * @param  call  Filled in with the draw call.
+   * @return  Returns true once the vertex buffers have been created.
+   */
+  virtual bool GetDrawCall(DrawElementsCall& call) const {
+    call.mode = GL_TRIANGLES;
+    call.vao = vao;
+    call.index_count = index_buffer.GetCount();
+    call.index_type = index_buffer.GetType();
+    call.layout = GetVertexLayout();
+    return vao != 0;
+  }
 
-    // Disable texture vertex attribute 
-    glDisableVertexAttribArray(scene_state.texture_loc);
+  /**
+   * Get the vertex layout.
+   * @return  Returns the compact layout or NULL if the vertices are float.
+   */
+  const CompactVertexLayout* GetVertexLayout() const {
+    return kCompactVertices ? &layout : nullptr;
   }
 	
 	/**
@@ -81,7 +81,7 @@ public:
     *@param   texture_loc  Location of the vertex texture attribute
 	 */
 	void Construct(std::vector<PNTVertex>& vertexList, 
-                   std::vector<uint16_t> faceList, 
+                   std::vector<uint32_t> faceList, 
                    const int position_loc, 
                    const int normal_loc, 
                    const int texture_loc, 
@@ -97,8 +97,10 @@ public:
 
   /**
   * Marks the end of a triangle mesh. Calculates the vertex normals.
+  * @return  Returns false if the buffers could not be created (see
+  *          CreateVertexBuffers).
   */
-  void End(const int position_loc, 
+  bool End(const int position_loc, 
            const int normal_loc, 
            const int texture_loc, 
            const int tangent_loc, 
@@ -137,7 +139,7 @@ public:
     }
 
     // Create the vertex and face buffers
-    CreateVertexBuffers(position_loc, normal_loc, texture_loc, tangent_loc, bitangent_loc);
+    return CreateVertexBuffers(position_loc, normal_loc, texture_loc, tangent_loc, bitangent_loc);
   }
 
   /**
@@ -165,8 +167,8 @@ public:
 
   // Convenience method to get the index into the vertex list given the
   // "row" and "column" of the subdivision/grid
-  uint16_t GetIndex(uint32_t row, uint32_t col, uint32_t ncols) const {
-    return static_cast<uint16_t>((row*ncols) + col);
+  uint32_t GetIndex(uint32_t row, uint32_t col, uint32_t ncols) const {
+    return (row*ncols) + col;
   }
 
   /**
@@ -214,26 +216,48 @@ public:
 
   /**
    * Creates vertex buffers for this object.
+   * @return  Returns false if the face list indexes vertices that are not
+   *          in the vertex list. The faces are dropped (nothing is drawn).
    */
-  void CreateVertexBuffers(const int position_loc, 
+  bool CreateVertexBuffers(const int position_loc, 
                            const int normal_loc, 
                            const int texture_loc, 
                            const int tangent_loc, 
                            const int bitangent_loc) {
-     // Generate vertex buffers for the vertex list and the face list
+     // Reorder the triangles and vertices for the vertex cache
+     if (triangle_list)
+       OptimizeFaces();
+
+     // Generate a vertex buffer for the vertex list
      glGenBuffers(1, &vbo);
-     glGenBuffers(1, &facebuffer);
 
-     // Bind the vertex list to the vertex buffer object
+     // Bind the vertex list to the vertex buffer object. Compact vertices
+     // are packed from the float vertices (which are kept).
      glBindBuffer(GL_ARRAY_BUFFER, vbo);
-     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PNTVertex), (void*)&vertices[0], GL_STATIC_DRAW);
-
-     // Bind the face list to the vertex buffer object
-     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, facebuffer);
-     glBufferData(GL_ELEMENT_ARRAY_BUFFER, faces.size() * sizeof(uint16_t), (void*)&faces[0], GL_STATIC_DRAW);
-
-     // Copy the face list count for use in Draw (then we can clear the vector)
-     face_count = faces.size();
+     if (kCompactVertices) {
+       VertexSource source;
+       source.position = &vertices[0].vertex.x;
+       source.normal = &vertices[0].normal.x;
+       source.texcoord = &vertices[0].s;
+       source.tangent = &vertices[0].tangent.x;
+       source.bitangent = &vertices[0].bitangent.x;
+       source.stride = sizeof(PNTVertex);
+       source.count = static_cast<uint32_t>(vertices.size());
+       layout = ChooseVertexLayout(source);
+       std::vector<unsigned char> packed;
+       PackVertices(source, layout, packed);
+       glBufferData(GL_ARRAY_BUFFER, packed.size(), (void*)&packed[0], GL_STATIC_DRAW);
+     }
+     else
+       glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PNTVertex), (void*)&vertices[0], GL_STATIC_DRAW);
+
+     // Create the face list buffer (16 or 32 bit indexes depending on the
+     // number of vertices)
+     bool ok = index_buffer.Create(faces, static_cast<uint32_t>(vertices.size()));
+     if (!ok) {
+       printf("TexturedTriSurface: could not create the index buffer, faces dropped\n");
+       faces.clear();
+     }
 
      // We could clear any local memory as it is now in the VBO. However there may be
      // cases where we want to keep it (e.g. collision detection, picking) so I am not
@@ -245,42 +269,112 @@ public:
 
      // Bind the vertex buffer, set the vertex position attribute and the vertex normal attribute
      glBindBuffer(GL_ARRAY_BUFFER, vbo);
-     glVertexAttribPointer(position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(PNTVertex), 
-                           (void*)0);
-     glVertexAttribPointer(normal_loc, 3, GL_FLOAT, GL_FALSE, sizeof(PNTVertex), 
-                           (void*)(sizeof(Point3)));
-     glVertexAttribPointer(texture_loc, 2, GL_FLOAT, GL_FALSE, sizeof(PNTVertex), 
-                           (void*)(sizeof(Point3) + sizeof(Vector3)));
-     glVertexAttribPointer(tangent_loc, 3, GL_FLOAT, GL_FALSE, sizeof(PNTVertex), 
-                           (void*)(sizeof(Point3) + sizeof(Vector3) + sizeof(Vector2)));
-     glVertexAttribPointer(bitangent_loc, 3, GL_FLOAT, GL_FALSE, sizeof(PNTVertex), 
-                           (void*)(sizeof(Point3) + sizeof(Vector3) + sizeof(Vector2) + sizeof(Vector3)));
-     
-     glEnableVertexAttribArray(position_loc);
-     glEnableVertexAttribArray(normal_loc);
-     glEnableVertexAttribArray(texture_loc);
-     glEnableVertexAttribArray(tangent_loc);
-     glEnableVertexAttribArray(bitangent_loc);
+     if (kCompactVertices) {
+       SetVertexAttributes(layout, position_loc, normal_loc, texture_loc);
+     }
+     else {
+       glVertexAttribPointer(position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(PNTVertex), 
+                             (void*)0);
+       glVertexAttribPointer(normal_loc, 3, GL_FLOAT, GL_FALSE, sizeof(PNTVertex), 
+                             (void*)(sizeof(Point3)));
+       glVertexAttribPointer(texture_loc, 2, GL_FLOAT, GL_FALSE, sizeof(PNTVertex), 
+                             (void*)(sizeof(Point3) + sizeof(Vector3)));
+       glVertexAttribPointer(tangent_loc, 3, GL_FLOAT, GL_FALSE, sizeof(PNTVertex), 
+                             (void*)(sizeof(Point3) + sizeof(Vector3) + sizeof(Vector2)));
+       glVertexAttribPointer(bitangent_loc, 3, GL_FLOAT, GL_FALSE, sizeof(PNTVertex), 
+                             (void*)(sizeof(Point3) + sizeof(Vector3) + sizeof(Vector2) + sizeof(Vector3)));
+       
+       glEnableVertexAttribArray(position_loc);
+       glEnableVertexAttribArray(normal_loc);
+       glEnableVertexAttribArray(texture_loc);
+       glEnableVertexAttribArray(tangent_loc);
+       glEnableVertexAttribArray(bitangent_loc);
+     }
 
      // Bind the face list buffer and draw. Note the use of 0 offset in glDrawElements
-     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, facebuffer);
+     index_buffer.Bind();
 
      // Make sure changes to this VAO are local
      glBindVertexArray(0);
+
+     // Bounds from the (float) vertex positions
+     SetBounds(&vertices[0].vertex.x, sizeof(PNTVertex), static_cast<uint32_t>(vertices.size()));
+
+     // The triangle BVH (if any) is rebuilt from the new lists on next use
+     triangle_bvh.Clear();
+
+     // Render lists that include this surface need the new VAO
+     InvalidateGraph();
+     return ok;
    }
 	
+  /**
+   * Get the BVH over the faces (object coordinates). Built on first use
+   * from the vertex and face lists kept after the buffers are created.
+   * Strips are converted to triangle lists, so triangle numbers refer to
+   * the non-degenerate triangles of the strip.
+   * @return  Returns the triangle BVH.
+   */
+  virtual const TriangleBVH* GetTriangleBVH() {
+    if (triangle_bvh.IsEmpty() && !faces.empty()) {
+      if (triangle_list) {
+        triangle_bvh.Build(&vertices[0].vertex.x, sizeof(PNTVertex), &faces[0],
+                           static_cast<uint32_t>(faces.size()));
+      }
+      else {
+        std::vector<uint32_t> triangles;
+        StripToTriangles(faces, triangles);
+        if (!triangles.empty()) {
+          triangle_bvh.Build(&vertices[0].vertex.x, sizeof(PNTVertex), &triangles[0],
+                             static_cast<uint32_t>(triangles.size()));
+        }
+      }
+    }
+    return &triangle_bvh;
+  }
+
 protected:
   // Vertex buffer support
-  uint32_t face_count;
-  GLuint   vao;
-  GLuint   vbo;
-  GLuint   facebuffer;
+  GLuint      vao;
+  GLuint      vbo;
+  IndexBuffer index_buffer;
+
+  // Layout of the vertex buffer (if kCompactVertices)
+  CompactVertexLayout layout;
 
   // Vertex and normal list
   std::vector<PNTVertex> vertices;
 	
-  // Use uint16_t for face list indexes (OpenGL ES compatible)
-  std::vector<uint16_t> faces;
+  // Face list indexes. Uploaded as 16 bit indexes when possible
+  std::vector<uint32_t> faces;
+
+  // Faces are an independent triangle list (subclasses drawing strips
+  // clear this so their faces are not reordered)
+  bool triangle_list;
+
+  // BVH over the faces for ray queries (built on first use)
+  TriangleBVH triangle_bvh;
+
+  /**
+   * Reorder the face list for the vertex cache and overdraw and the
+   * vertex list to match (see mesh_optimize.h).
+   */
+  void OptimizeFaces() {
+    if (faces.size() < 3)
+      return;
+
+    // Out of range indexes are left for IndexBuffer::Create to report
+    for (auto index : faces) {
+      if (index >= vertices.size())
+        return;
+    }
+    std::vector<uint32_t> remap;
+    MeshOptimizeStats stats = OptimizeMesh(faces, &vertices[0].vertex.x, sizeof(PNTVertex),
+                                           static_cast<uint32_t>(vertices.size()), remap);
+    RemapVertices(vertices, remap);
+    printf("TexturedTriSurface: %u triangles, ACMR %.3f -> %.3f\n", stats.triangles,
+           stats.acmr_before, stats.acmr_after);
+  }
 };
 
 
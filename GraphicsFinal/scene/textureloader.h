@@ -0,0 +1,520 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    textureloader.h
+//	Purpose: Asynchronous texture loading. Images are decoded on worker
+//           threads and uploaded on the OpenGL thread.
+//
+//============================================================================
+
+#ifndef __TEXTURELOADER_H
+#define __TEXTURELOADER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "scene/imagedecode.h"
+#include "scene/ddsfile.h"
+#include "scene/mipbuilder.h"
+
+// S3TC formats (EXT_texture_compression_s3tc - not in the core headers)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Images uploaded per UploadCompleted call (bounds the time spent on the
+// OpenGL thread per frame)
+const uint32_t kMaxUploadsPerCall = 8;
+
+// Filter used for the mipmaps built on the worker threads
+const MipFilter kTextureMipFilter = MIP_FILTER_KAISER;
+
+// What a texture is used for. Selects the internal format and the
+// placeholder shown until the image is loaded.
+enum TextureUsage { TEXTURE_COLOR, TEXTURE_NORMAL_MAP };
+
+/**
+ * Texture loader. Load creates the texture object right away holding a 1x1
+ * placeholder (grey for color textures, a flat normal for normal maps) and
+ * queues the file for decoding on a pool of worker threads. Decoded images
+ * are passed back to the OpenGL thread through a lock free queue and
+ * UploadCompleted replaces the placeholder with the image (same texture
+ * object, so users of the texture need not be told). Workers also build
+ * the mipmap chain (BuildMipChain: filtered in linear space for color,
+ * renormalized for normal maps) so the OpenGL thread only uploads it.
+ * LoadLayer loads into a layer of a TextureArray instead.
+ *
+ * Images are decoded with DecodeTextureFile: in parallel on Windows (WIC),
+ * serialized elsewhere (DevIL is not thread safe). If a baked texture
+ * (same name with a .dds extension, written by the texbake tool) exists
+ * it is loaded instead: it is block compressed (BC1/BC3 color, BC5 normal
+ * maps) and holds its mipmap chain, so it is uploaded with
+ * glCompressedTexImage2D and no mipmaps are generated.
+ *
+ * Each load is a request with its own id. A texture deleted before its
+ * loads finish must be passed to Cancel first: its requests are dropped,
+ * so a decode that completes later is never uploaded into a new texture
+ * that reuses the deleted texture's name.
+ *
+ * All methods other than the decoding itself must be called from the
+ * OpenGL thread.
+ */
+class TextureLoader {
+public:
+  /**
+   * Get the texture loader. The first call must be made from the main
+   * thread after ilInit. Like the ThreadPool the loader is never destroyed;
+   * worker threads are ended by the process exiting.
+   * @return  Returns the texture loader.
+   */
+  static TextureLoader& Get() {
+    static TextureLoader* loader = new TextureLoader;
+    return *loader;
+  }
+
+  /**
+   * Load a texture from the textures directory. Tries ../textures, then
+   * ../../textures. Returns right away: the texture holds a placeholder
+   * until UploadCompleted uploads the image. If the file cannot be loaded
+   * an error is printed and the placeholder is kept. The texture may be
+   * deleted before it is loaded if Cancel is called first.
+   * @param  fname       Texture image filename (relative to textures)
+   * @param  usage       Color texture or normal map
+   * @param  wrap_s      OpenGL wrap option (s)
+   * @param  wrap_t      OpenGL wrap option (t)
+   * @param  min_filter  OpenGL filter to use for minification
+   * @param  mag_filter  OpenGL filter to use for magnification
+   * @return  Returns the texture object.
+   */
+  GLuint Load(const std::string& fname, const TextureUsage usage, GLuint wrap_s,
+              GLuint wrap_t, GLuint min_filter, GLuint mag_filter) {
+    return Queue(fname, true, usage, wrap_s, wrap_t, min_filter, mag_filter);
+  }
+
+  /**
+   * Load a texture from a file path (e.g. a model's texture). Otherwise the
+   * same as Load.
+   * @param  path        Texture image file path
+   * @param  usage       Color texture or normal map
+   * @param  wrap_s      OpenGL wrap option (s)
+   * @param  wrap_t      OpenGL wrap option (t)
+   * @param  min_filter  OpenGL filter to use for minification
+   * @param  mag_filter  OpenGL filter to use for magnification
+   * @return  Returns the texture object.
+   */
+  GLuint LoadFile(const std::string& path, const TextureUsage usage, GLuint wrap_s,
+                  GLuint wrap_t, GLuint min_filter, GLuint mag_filter) {
+    return Queue(path, false, usage, wrap_s, wrap_t, min_filter, mag_filter);
+  }
+
+  /**
+   * Load an image from the textures directory into a layer of a texture
+   * array (see TextureArray). The image is resampled to the layer size if
+   * it differs. Baked textures are not used for layers.
+   * @param  fname    Texture image filename (relative to textures)
+   * @param  usage    Color texture or normal map
+   * @param  texture  GL_TEXTURE_2D_ARRAY texture (all levels allocated)
+   * @param  layer    Layer to load into
+   * @param  width    Layer width
+   * @param  height   Layer height
+   */
+  void LoadLayer(const std::string& fname, const TextureUsage usage, const GLuint texture,
+                 const int layer, const int width, const int height) {
+    Job job;
+    job.fname = fname;
+    job.in_textures = true;
+    job.texture = texture;
+    job.usage = usage;
+    job.layer = layer;
+    job.width = width;
+    job.height = height;
+    Push(job);
+  }
+
+  /**
+   * Cancel the loads into a texture. Call before deleting a texture (or
+   * texture array) that may still be loading. Loads not yet started are
+   * removed from the queue and decodes in progress are dropped when they
+   * complete.
+   * @param  texture  Texture object.
+   */
+  void Cancel(const GLuint texture) {
+    // Remove queued jobs (no need to decode them)
+    {
+      std::unique_lock<std::mutex> lock(job_mutex);
+      for (auto job = jobs.begin(); job != jobs.end(); ) {
+        if (job->texture == texture) {
+          requests.erase(job->request);
+          job = jobs.erase(job);
+          pending--;
+        }
+        else
+          ++job;
+      }
+    }
+
+    // Decodes in progress are no longer uploaded
+    for (auto request = requests.begin(); request != requests.end(); ) {
+      if (request->second == texture)
+        request = requests.erase(request);
+      else
+        ++request;
+    }
+  }
+
+  /**
+   * Get the internal format used for textures of a usage.
+   * @param  usage  Color texture or normal map
+   * @return  Returns the OpenGL internal format.
+   */
+  static GLint InternalFormat(const TextureUsage usage) {
+    return (usage == TEXTURE_NORMAL_MAP) ? GL_RGB : GL_RGBA;
+  }
+
+  /**
+   * Upload decoded images into their textures. Call from the OpenGL thread
+   * (once per frame or on a timer). Changes the texture binding of the
+   * active unit.
+   * @param  max_uploads  Maximum number of images to upload.
+   * @return  Returns the number of textures uploaded.
+   */
+  uint32_t UploadCompleted(const uint32_t max_uploads = kMaxUploadsPerCall) {
+    // Take everything the workers have finished. The queue is a stack so
+    // reverse it to upload in completion order.
+    Decoded* list = completed.exchange(nullptr, std::memory_order_acquire);
+    Decoded* in_order = nullptr;
+    while (list != nullptr) {
+      Decoded* next = list->next;
+      list->next = in_order;
+      in_order = list;
+      list = next;
+    }
+    if (in_order != nullptr) {
+      if (ready_tail == nullptr)
+        ready_head = in_order;
+      else
+        ready_tail->next = in_order;
+      ready_tail = in_order;
+      while (ready_tail->next != nullptr)
+        ready_tail = ready_tail->next;
+    }
+
+    uint32_t uploaded = 0;
+    while (ready_head != nullptr && uploaded < max_uploads) {
+      Decoded* d = ready_head;
+      ready_head = d->next;
+      if (ready_head == nullptr)
+        ready_tail = nullptr;
+
+      auto request = requests.find(d->request);
+      if (request == requests.end()) {
+        // Cancelled (the texture was deleted while it was loading)
+      }
+      else if (d->ok && d->layer >= 0) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, d->texture);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, d->layer, d->image.width, d->image.height,
+                        1, GL_RGBA, GL_UNSIGNED_BYTE, &d->image.pixels[0]);
+        for (uint32_t i = 0; i < d->mips.size(); i++) {
+          const TextureImage& mip = d->mips[i];
+          glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i + 1, 0, 0, d->layer, mip.width, mip.height, 1,
+                          GL_RGBA, GL_UNSIGNED_BYTE, &mip.pixels[0]);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+      }
+      else if (d->ok && d->compressed) {
+        glBindTexture(GL_TEXTURE_2D, d->texture);
+        const CompressedImage& baked = d->baked;
+        for (uint32_t i = 0; i < baked.levels.size(); i++) {
+          const CompressedLevel& level = baked.levels[i];
+          glCompressedTexImage2D(GL_TEXTURE_2D, i, CompressedFormat(baked.format), level.width,
+                                 level.height, 0, level.size, &baked.data[level.offset]);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                        static_cast<GLint>(baked.levels.size()) - 1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        batch_compressed++;
+      }
+      else if (d->ok) {
+        glBindTexture(GL_TEXTURE_2D, d->texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat(d->usage), d->image.width,
+                     d->image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &d->image.pixels[0]);
+        for (uint32_t i = 0; i < d->mips.size(); i++) {
+          const TextureImage& mip = d->mips[i];
+          glTexImage2D(GL_TEXTURE_2D, i + 1, InternalFormat(d->usage), mip.width, mip.height,
+                       0, GL_RGBA, GL_UNSIGNED_BYTE, &mip.pixels[0]);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+      }
+      else {
+        printf("Error loading texture. %s\n", d->fname.c_str());
+      }
+      if (request != requests.end())
+        requests.erase(request);
+      delete d;
+      uploaded++;
+      pending--;
+    }
+
+    if (uploaded > 0 && pending == 0) {
+      double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - batch_start).count();
+      printf("TextureLoader: %u textures loaded in %.0f ms (%u baked, %u threads)\n",
+             batch_count, ms, batch_compressed, static_cast<uint32_t>(workers.size()));
+    }
+    return uploaded;
+  }
+
+  /**
+   * Get the number of textures that are not uploaded yet.
+   * @return  Returns the number of textures still showing a placeholder.
+   */
+  uint32_t GetPendingCount() const {
+    return pending;
+  }
+
+  /**
+   * Wait for all queued textures to be decoded and upload them.
+   */
+  void Finish() {
+    while (pending > 0) {
+      if (UploadCompleted(pending) == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+protected:
+  // Queued load
+  struct Job {
+    uint32_t     request;       // Request id (see requests)
+    std::string  fname;
+    bool         in_textures;   // fname is relative to the textures directory
+    GLuint       texture;
+    TextureUsage usage;
+    int          layer;         // Texture array layer (-1 for a 2D texture)
+    int          width;         // Layer size (texture arrays)
+    int          height;
+  };
+
+  // Decoded image waiting for upload (node of the completed queue)
+  struct Decoded {
+    uint32_t        request;
+    std::string     fname;
+    GLuint          texture;
+    TextureUsage    usage;
+    int             layer;        // Texture array layer (-1 for a 2D texture)
+    bool            ok;
+    bool            compressed;   // Baked texture loaded (baked is used)
+    TextureImage    image;
+    std::vector<TextureImage> mips;   // Levels 1 to n of image
+    CompressedImage baked;
+    Decoded*        next;
+  };
+
+  std::vector<std::thread> workers;
+
+  // Jobs (filled by the OpenGL thread, taken by workers)
+  std::mutex              job_mutex;
+  std::condition_variable job_ready;
+  std::deque<Job>         jobs;
+
+  // Decoded images: workers push, the OpenGL thread takes all at once
+  std::atomic<Decoded*> completed;
+
+  // Decoded images taken from the completed queue but not yet uploaded
+  // (OpenGL thread only)
+  Decoded* ready_head;
+  Decoded* ready_tail;
+
+  // Requests that are neither uploaded nor cancelled: request id to the
+  // texture it loads into (OpenGL thread only)
+  std::unordered_map<uint32_t, GLuint> requests;
+  uint32_t next_request;
+
+  // Load counts and timing (OpenGL thread only)
+  uint32_t pending;
+  uint32_t batch_count;
+  uint32_t batch_compressed;
+  std::chrono::steady_clock::time_point batch_start;
+
+  // BC1/BC3 textures can be used (set before the workers start)
+  bool s3tc_supported;
+
+  /**
+   * Constructor. Starts one worker per hardware thread.
+   */
+  TextureLoader()
+      : ready_head(nullptr),
+        ready_tail(nullptr),
+        next_request(0),
+        pending(0),
+        batch_count(0),
+        batch_compressed(0),
+        s3tc_supported(false) {
+    completed = nullptr;
+    DevILMutex();
+    MipInitTables();
+
+    // BC5 (RGTC) is core in OpenGL 3.0, BC1 and BC3 need S3TC
+    GLint extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+    for (GLint i = 0; i < extensions; i++) {
+      const GLubyte* name = glGetStringi(GL_EXTENSIONS, i);
+      if (name != nullptr &&
+          strcmp(reinterpret_cast<const char*>(name), "GL_EXT_texture_compression_s3tc") == 0)
+        s3tc_supported = true;
+    }
+
+    uint32_t n = std::thread::hardware_concurrency();
+    if (n == 0)
+      n = 1;
+    for (uint32_t i = 0; i < n; i++) {
+      workers.push_back(std::thread(&TextureLoader::Worker, this));
+    }
+  }
+
+  // Create a texture holding the placeholder and queue its file
+  GLuint Queue(const std::string& fname, const bool in_textures, const TextureUsage usage,
+               GLuint wrap_s, GLuint wrap_t, GLuint min_filter, GLuint mag_filter) {
+    static const unsigned char grey[4] = { 128, 128, 128, 255 };
+    static const unsigned char flat_normal[4] = { 128, 128, 255, 255 };
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat(usage), 1, 1, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, (usage == TEXTURE_NORMAL_MAP) ? flat_normal : grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_s);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_t);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    Job job;
+    job.fname = fname;
+    job.in_textures = in_textures;
+    job.texture = texture;
+    job.usage = usage;
+    job.layer = -1;
+    job.width = 0;
+    job.height = 0;
+    Push(job);
+    return texture;
+  }
+
+  // Count a load (starting a new batch if none are pending)
+  void StartLoad() {
+    if (pending == 0) {
+      batch_start = std::chrono::steady_clock::now();
+      batch_count = 0;
+      batch_compressed = 0;
+    }
+    pending++;
+    batch_count++;
+  }
+
+  // Count a load, assign its request id and queue it for the workers
+  void Push(Job& job) {
+    StartLoad();
+    job.request = next_request++;
+    requests[job.request] = job.texture;
+    {
+      std::unique_lock<std::mutex> lock(job_mutex);
+      jobs.push_back(job);
+    }
+    job_ready.notify_one();
+  }
+
+  // OpenGL format of a block compressed format
+  static GLenum CompressedFormat(const BCFormat format) {
+    switch (format) {
+    case BC_FORMAT_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BC_FORMAT_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default:            return GL_COMPRESSED_RG_RGTC2;
+    }
+  }
+
+  // Load the baked texture for an image if there is one the hardware
+  // supports in the format expected for the usage. Thread safe.
+  bool LoadBaked(const Job& job, CompressedImage& baked) const {
+    std::string name = BakedTextureName(job.fname);
+    if (job.in_textures) {
+      if (!ReadDDS("../textures/" + name, baked) && !ReadDDS("../../textures/" + name, baked))
+        return false;
+    }
+    else if (!ReadDDS(name, baked))
+      return false;
+    if (job.usage == TEXTURE_NORMAL_MAP)
+      return baked.format == BC_FORMAT_BC5;
+    return baked.format != BC_FORMAT_BC5 && s3tc_supported;
+  }
+
+  // Worker thread. Decodes queued files and pushes the results.
+  void Worker() {
+#ifdef _WIN32
+    // WIC is a COM API - each thread using it initializes COM
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+    for (;;) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(job_mutex);
+        while (jobs.empty())
+          job_ready.wait(lock);
+        job = jobs.front();
+        jobs.pop_front();
+      }
+
+      Decoded* d = new Decoded;
+      d->request = job.request;
+      d->fname = job.fname;
+      d->texture = job.texture;
+      d->usage = job.usage;
+      d->layer = job.layer;
+      d->compressed = (job.layer < 0) && LoadBaked(job, d->baked);
+      if (d->compressed)
+        d->ok = true;
+      else {
+        MipContent content = (job.usage == TEXTURE_NORMAL_MAP) ? MIP_NORMAL_MAP : MIP_COLOR_SRGB;
+        d->ok = job.in_textures ? DecodeTextureFile(job.fname, d->image) :
+                                  DecodeImageFile(job.fname, d->image);
+        if (d->ok && job.layer >= 0 &&
+            (d->image.width != job.width || d->image.height != job.height)) {
+          TextureImage resampled;
+          ResampleImage(d->image, job.width, job.height, kTextureMipFilter, content, resampled);
+          d->image.width = resampled.width;
+          d->image.height = resampled.height;
+          d->image.pixels.swap(resampled.pixels);
+        }
+        if (d->ok) {
+          BuildMipChain(d->image, kTextureMipFilter, content, d->mips);
+        }
+      }
+
+      // Push onto the completed stack
+      d->next = completed.load(std::memory_order_relaxed);
+      while (!completed.compare_exchange_weak(d->next, d, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+      }
+    }
+  }
+
+private:
+  // Threads are owned - no copies
+  TextureLoader(const TextureLoader&);
+  TextureLoader& operator=(const TextureLoader&);
+};
+
+#endif
@@ -14,6 +14,10 @@
 
 #include "geometry/geometry.h"
 
+// Number of parent matrices a transform node caches results for. Two covers
+// the normal and mirrored passes.
+const uint32_t kTransformCacheSlots = 2;
+
 /**
  * Transform node. Applies a transformation. This class allows OpenGL style 
  * transforms applied to the scene graph.
@@ -26,6 +30,7 @@ public:
   TransformNode() {
     node_type = SCENE_TRANSFORM;
     reference_count = 0;
+    next_slot = 0;
     LoadIdentity();
   }
 
@@ -39,6 +44,7 @@ public:
    */
   void LoadIdentity() {
     model_matrix.SetIdentity();
+    Invalidate();
   }
 
   /**
@@ -49,6 +55,7 @@ public:
    */
   void Translate(const float x, const float y, const float z) {
     model_matrix.Translate(x, y, z);
+    Invalidate();
   }
 
   /**
@@ -58,6 +65,7 @@ public:
   */
   void Rotate(const float deg, Vector3& v) {
     model_matrix.Rotate(deg, v.x, v.y, v.z);
+    Invalidate();
   }
 
   /**
@@ -66,6 +74,7 @@ public:
    */
   void RotateX(const float deg) {
     model_matrix.RotateX(deg);
+    Invalidate();
   }
 
   /**
@@ -74,6 +83,7 @@ public:
    */
   void RotateY(const float deg) {
     model_matrix.RotateY(deg);
+    Invalidate();
   }
 
   /**
@@ -82,6 +92,7 @@ public:
    */
   void RotateZ(const float deg) {
     model_matrix.RotateZ(deg);
+    Invalidate();
   }
 
   /**
@@ -92,30 +103,35 @@ public:
    */
   void Scale(const float x, const float y, const float z) {
     model_matrix.Scale(x, y, z);
+    Invalidate();
   }
 
 	/**
-	 * Draw this transformation node and its children
+	 * Draw this transformation node and its children. The world, normal and
+   * composite matrices are cached per parent matrix (identified by the
+   * scene state stamps) and only recomputed when this transform, a parent
+   * transform, or the camera changes. Recomputing gives this node a new
+   * stamp, which in turn marks the caches of all descendants out of date.
    * @param  scene_state   Current scene state
 	 */
   virtual void Draw(SceneState& scene_state) {
     // Copy current transforms onto stack
     scene_state.PushTransforms();
 
-    // Apply this modeling transform to the current modeling matrix. 
-    // Note the postmultiply - this allows hierarchical transformations
-    // in the scene
-    scene_state.model_matrix *= model_matrix;
-    glUniformMatrix4fv(scene_state.modelmatrix_loc, 1, GL_FALSE, scene_state.model_matrix.Get());
-
-    // Set the normal transform matrix (transpose of the inverse of the model matrix).
-    // This transforms normals into view coordinates
-    Matrix4x4 normal_matrix = scene_state.model_matrix.GetInverse().Transpose();
-    glUniformMatrix4fv(scene_state.normalmatrix_loc, 1, GL_FALSE, normal_matrix.Get());
-
-    // Set the composite projection, view, modeling matrix
-    Matrix4x4 pvm = scene_state.pv * scene_state.model_matrix;
-    glUniformMatrix4fv(scene_state.pvm_loc, 1, GL_FALSE, pvm.Get());
+    // Find (or compute) the cached matrices for the current parent matrix.
+    // Update the composite projection, view, modeling matrix if the camera changed
+    CacheSlot& slot = GetCacheSlot(scene_state);
+    if (slot.pv_stamp != scene_state.pv_stamp) {
+      slot.pvm = scene_state.pv * slot.world_matrix;
+      slot.pv_stamp = scene_state.pv_stamp;
+    }
+
+    scene_state.model_matrix = slot.world_matrix;
+    scene_state.normal_matrix = slot.normal_matrix;
+    scene_state.model_stamp = slot.stamp;
+    scene_state.gl_state.UniformMatrix4fv(scene_state.modelmatrix_loc, slot.world_matrix.Get());
+    scene_state.gl_state.UniformMatrix4fv(scene_state.normalmatrix_loc, slot.normal_matrix.Get());
+    scene_state.gl_state.UniformMatrix4fv(scene_state.pvm_loc, slot.pvm.Get());
 
     // Draw all children
     SceneNode::Draw(scene_state);
@@ -124,6 +140,27 @@ public:
     scene_state.PopTransforms();
 	}
 
+  /**
+   * Compile this transformation node and its children. Children are added
+   * with this transform applied to the current world matrix.
+   * @param  list  Render list being built.
+   */
+  virtual void Compile(RenderList& list) {
+    list.PushTransform(model_matrix);
+    SceneNode::Compile(list);
+    list.PopTransform();
+  }
+
+  /**
+   * Collect the triangles of the children with this transform applied.
+   * @param  bvh  Scene BVH being collected.
+   */
+  virtual void CollectBVH(SceneBVH& bvh) {
+    bvh.PushTransform(model_matrix);
+    SceneNode::CollectBVH(bvh);
+    bvh.PopTransform();
+  }
+
   /**
 	 * Update the scene node and its children
    * @param  sceneState   Current scene state
@@ -132,7 +169,64 @@ public:
   }
 
 protected:
-  Matrix4x4 model_matrix;   // Local modeling transformation
+  // Matrices cached for one parent matrix
+  struct CacheSlot {
+    uint32_t  parent_stamp;   // Stamp of the parent matrix (0 if empty)
+    uint32_t  stamp;          // Stamp of world_matrix
+    uint32_t  pv_stamp;       // Stamp of the projection/view used for pvm
+    Matrix4x4 world_matrix;   // Parent matrix * local modeling matrix
+    Matrix4x4 normal_matrix;  // Transpose of the inverse of world_matrix
+    Matrix4x4 pvm;            // Composite projection, view, modeling matrix
+  };
+
+  Matrix4x4 model_matrix;        // Local modeling transformation
+  Matrix4x4 local_normal_matrix; // Transpose of the inverse of model_matrix
+  bool      local_normal_dirty;  // local_normal_matrix must be recomputed
+  CacheSlot cache[kTransformCacheSlots];
+  uint32_t  next_slot;           // Slot to replace on the next cache miss
+
+  // Bound of the children in the parent's coordinates
+  virtual AABB ComputeBound() {
+    return SceneNode::ComputeBound().Transform(model_matrix);
+  }
+
+  // Called when the local modeling transformation changes
+  void Invalidate() {
+    local_normal_dirty = true;
+    for (uint32_t i = 0; i < kTransformCacheSlots; i++) {
+      cache[i].parent_stamp = 0;
+    }
+    InvalidateGraph();
+  }
+
+  // Get the cache slot for the current parent matrix, computing the world
+  // and normal matrices if not cached.
+  CacheSlot& GetCacheSlot(const SceneState& scene_state) {
+    for (uint32_t i = 0; i < kTransformCacheSlots; i++) {
+      if (cache[i].parent_stamp == scene_state.model_stamp)
+        return cache[i];
+    }
+
+    // Transpose of the inverse of the local transform only changes when 
+    // the local transform changes. (A*B)^-T = A^-T * B^-T so the parent 
+    // normal matrix can be applied without another inverse.
+    if (local_normal_dirty) {
+      local_normal_matrix = model_matrix.GetAffineInverse().Transpose();
+      local_normal_dirty = false;
+    }
+
+    // Note the postmultiply - this allows hierarchical transformations
+    // in the scene
+    CacheSlot& slot = cache[next_slot];
+    next_slot = (next_slot + 1) % kTransformCacheSlots;
+    slot.parent_stamp = scene_state.model_stamp;
+    slot.stamp = SceneState::NewStamp();
+    slot.world_matrix = scene_state.model_matrix * model_matrix;
+    slot.normal_matrix = scene_state.normal_matrix * local_normal_matrix;
+    slot.pvm = scene_state.pv * slot.world_matrix;
+    slot.pv_stamp = scene_state.pv_stamp;
+    return slot;
+  }
 };
 
 #endif
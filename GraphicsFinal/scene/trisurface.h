@@ -26,7 +26,7 @@ public:
       : GeometryNode() {
     vao = 0;
     vbo = 0;
-    facebuffer = 0;
+    triangle_list = true;
   }
 	
   /**
@@ -35,7 +35,6 @@ public:
   ~TriSurface()  {
     // Delete vertex buffer objects
     glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &facebuffer);
     glDeleteVertexArrays(1, &vao);
   }
 	
@@ -43,30 +42,39 @@ public:
    * Draw this geometry node.
    */
   virtual void Draw(SceneState& scene_state) {
-    glBindVertexArray(vao);
-		glClearStencil(0);
-		glClear(GL_STENCIL_BUFFER_BIT);
-
-		// Render the mesh into the stencil buffer.
-#define USE_OUTLINE 1
-#if USE_OUTLINE
-		glEnable(GL_STENCIL_TEST);
-
-		glStencilFunc(GL_ALWAYS, 1, -1);
-		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-#endif
-		glDrawElements(GL_TRIANGLES, (GLsizei)face_count, GL_UNSIGNED_SHORT, (void*)0);
-
-		// Render the thick wireframe version.
-#if USE_OUTLINE
-		glStencilFunc(GL_NOTEQUAL, 1, -1);
-		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-
-		glLineWidth(5);
-		glPolygonMode(GL_FRONT, GL_LINE);
-		glDrawElements(GL_LINE_STRIP, (GLsizei)face_count, GL_UNSIGNED_SHORT, (void*)0);
-#endif
-    glBindVertexArray(0);
+    bool quantized = IsQuantized(GetVertexLayout());
+    if (quantized)
+      SetDequantizeMatrices(scene_state, GetVertexLayout());
+    scene_state.gl_state.BindVertexArray(vao);
+    if (meshlets.IsEmpty())
+      glDrawElements(GL_TRIANGLES, index_buffer.GetCount(), index_buffer.GetType(), (void*)0);
+    else
+      meshlets.Draw(scene_state, index_buffer.GetType());
+    if (quantized)
+      SetDequantizeMatrices(scene_state, nullptr);
+  }
+
+  /**
+   * Get the draw call used to draw this surface.
+   * @param  call  Filled in with the draw call.
+   * @return  Returns true once the vertex buffers have been created. Large
+   *          surfaces cull their meshlets so they are drawn by traversal.
+   */
+  virtual bool GetDrawCall(DrawElementsCall& call) const {
+    call.mode = GL_TRIANGLES;
+    call.vao = vao;
+    call.index_count = index_buffer.GetCount();
+    call.index_type = index_buffer.GetType();
+    call.layout = GetVertexLayout();
+    return vao != 0 && meshlets.IsEmpty();
+  }
+
+  /**
+   * Get the vertex layout.
+   * @return  Returns the compact layout or NULL if the vertices are float.
+   */
+  const CompactVertexLayout* GetVertexLayout() const {
+    return kCompactVertices ? &layout : nullptr;
   }
 	
   /**
@@ -74,9 +82,20 @@ public:
    * @param  v  List of vertices (position and normal)
    * @param  f    Index list for triangles
    */
-  void Construct(std::vector<VertexAndNormal>& v, std::vector<uint16_t>& f) {
+  void Construct(std::vector<VertexAndNormal>& v, std::vector<uint32_t>& f) {
     vertices = v;
     faces    = f;
+    weld_index.Clear();
+  }
+
+  /**
+   * Set the tolerance used to weld vertices passed to Add. Vertices whose
+   * coordinates each differ by at most epsilon share one vertex. The
+   * default (0) welds only exactly equal vertices.
+   * @param  epsilon  Weld tolerance.
+   */
+  void SetWeldEpsilon(const float epsilon) {
+    weld_index.SetEpsilon(epsilon);
   }
 
   /**
@@ -127,8 +146,10 @@ public:
 
   /**
    * Marks the end of a triangle mesh. Calculates the vertex normals.
+   * @return  Returns false if the buffers could not be created (see
+   *          CreateVertexBuffers).
    */
-  void End(const int position_loc, const int normal_loc) {
+  bool End(const int position_loc, const int normal_loc) {
     // Iterate through the face list and calculate the normals for each 
     // face and add the normal to each vertex in the face list. This 
     // assumes the vertex normals are initilaized to 0 (in constructor
@@ -162,29 +183,51 @@ public:
     }
 		
     // Create the vertex and face buffers
-    CreateVertexBuffers(position_loc, normal_loc);
+    return CreateVertexBuffers(position_loc, normal_loc);
   }
 
   /**
   * Creates vertex buffers for this object.
+  * @return  Returns false if the face list indexes vertices that are not
+  *          in the vertex list. The faces are dropped (nothing is drawn).
   */
-  void CreateVertexBuffers(const int position_loc, const int normal_loc) {
-    // Generate vertex buffers for the vertex list and the face list
+  bool CreateVertexBuffers(const int position_loc, const int normal_loc) {
+    // Reorder the triangles and vertices for the vertex cache
+    if (triangle_list)
+      OptimizeFaces();
+
+    // Generate a vertex buffer for the vertex list
     glGenBuffers(1, &vbo);
-    glGenBuffers(1, &facebuffer);
 
-    // Bind the vertex list to the vertex buffer object
+    // Bind the vertex list to the vertex buffer object. Compact vertices
+    // are packed from the float vertices (which are kept).
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(VertexAndNormal),
-      (void*)&vertices[0], GL_STATIC_DRAW);
-
-    // Bind the face list to the vertex buffer object
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, facebuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, faces.size() * sizeof(uint16_t),
-      (void*)&faces[0], GL_STATIC_DRAW);
+    if (kCompactVertices) {
+      VertexSource source;
+      source.position = &vertices[0].vertex.x;
+      source.normal = &vertices[0].normal.x;
+      source.texcoord = nullptr;
+      source.tangent = nullptr;
+      source.bitangent = nullptr;
+      source.stride = sizeof(VertexAndNormal);
+      source.count = static_cast<uint32_t>(vertices.size());
+      layout = ChooseVertexLayout(source);
+      std::vector<unsigned char> packed;
+      PackVertices(source, layout, packed);
+      glBufferData(GL_ARRAY_BUFFER, packed.size(), (void*)&packed[0], GL_STATIC_DRAW);
+    }
+    else {
+      glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(VertexAndNormal),
+        (void*)&vertices[0], GL_STATIC_DRAW);
+    }
 
-    // Copy the face list count for use in Draw
-    face_count = faces.size();
+    // Create the face list buffer (16 or 32 bit indexes depending on the
+    // number of vertices)
+    bool ok = index_buffer.Create(faces, static_cast<uint32_t>(vertices.size()));
+    if (!ok) {
+      printf("TriSurface: could not create the index buffer, faces dropped\n");
+      faces.clear();
+    }
 
     // Allocate a VAO, enable it and set the vertex attribute arrays and pointers
     glGenVertexArrays(1, &vao);
@@ -192,34 +235,120 @@ public:
 
     // Bind the vertex buffer, set the vertex position attribute and the vertex normal attribute
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glVertexAttribPointer(position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(VertexAndNormal), (void*)0);
-    glVertexAttribPointer(normal_loc, 3, GL_FLOAT, GL_FALSE, sizeof(VertexAndNormal), (void*)(sizeof(Point3)));
-    glEnableVertexAttribArray(position_loc);
-    glEnableVertexAttribArray(normal_loc);
+    if (kCompactVertices) {
+      SetVertexAttributes(layout, position_loc, normal_loc, -1);
+    }
+    else {
+      glVertexAttribPointer(position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(VertexAndNormal), (void*)0);
+      glVertexAttribPointer(normal_loc, 3, GL_FLOAT, GL_FALSE, sizeof(VertexAndNormal), (void*)(sizeof(Point3)));
+      glEnableVertexAttribArray(position_loc);
+      glEnableVertexAttribArray(normal_loc);
+    }
 
     // Bind the face list buffer and draw.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, facebuffer);
+    index_buffer.Bind();
 
     // Make sure changes to this VAO are local
     glBindVertexArray(0);
 
+    // Bounds from the (float) vertex positions
+    SetBounds(&vertices[0].vertex.x, sizeof(VertexAndNormal),
+              static_cast<uint32_t>(vertices.size()));
+
+    // Split large triangle lists into meshlets for culling
+    if (triangle_list && !faces.empty()) {
+      meshlets.Build(&faces[0], static_cast<uint32_t>(faces.size()), &vertices[0].vertex.x,
+                     sizeof(VertexAndNormal), static_cast<uint32_t>(vertices.size()));
+    }
+
+    // The triangle BVH (if any) is rebuilt from the new lists on next use
+    triangle_bvh.Clear();
+
+    // Render lists that include this surface need the new VAO
+    InvalidateGraph();
+
     // We could clear any local memory as it is now in the VBO. However there may be
     // cases where we want to keep it (e.g. collision detection, picking) so I am not
     // going to do that here.
+    return ok;
   }
 	
+  /**
+   * Get the BVH over the faces (object coordinates). Built on first use
+   * from the vertex and face lists kept after the buffers are created.
+   * Strips are converted to triangle lists, so triangle numbers refer to
+   * the non-degenerate triangles of the strip.
+   * @return  Returns the triangle BVH.
+   */
+  virtual const TriangleBVH* GetTriangleBVH() {
+    if (triangle_bvh.IsEmpty() && !faces.empty()) {
+      if (triangle_list) {
+        triangle_bvh.Build(&vertices[0].vertex.x, sizeof(VertexAndNormal), &faces[0],
+                           static_cast<uint32_t>(faces.size()));
+      }
+      else {
+        std::vector<uint32_t> triangles;
+        StripToTriangles(faces, triangles);
+        if (!triangles.empty()) {
+          triangle_bvh.Build(&vertices[0].vertex.x, sizeof(VertexAndNormal), &triangles[0],
+                             static_cast<uint32_t>(triangles.size()));
+        }
+      }
+    }
+    return &triangle_bvh;
+  }
+
 protected:
   // Vertex buffer support
-  uint32_t face_count;
-  GLuint vao;
-  GLuint vbo;
-  GLuint facebuffer;
+  GLuint      vao;
+  GLuint      vbo;
+  IndexBuffer index_buffer;
+
+  // Layout of the vertex buffer (if kCompactVertices)
+  CompactVertexLayout layout;
+
+  // Meshlets culled each draw (none for small surfaces)
+  MeshletList meshlets;
 
   // Vertex and normal list
   std::vector<VertexAndNormal> vertices;
 	
-  // Use uint16_t for face list indexes (OpenGL ES compatible)
-  std::vector<uint16_t> faces;
+  // Face list indexes. Uploaded as 16 bit indexes when possible
+  std::vector<uint32_t> faces;
+
+  // Positions of the vertex list, used to find shared vertices in Add
+  VertexWeldIndex weld_index;
+
+  // Faces are an independent triangle list (subclasses drawing strips
+  // clear this so their faces are not reordered)
+  bool triangle_list;
+
+  // BVH over the faces for ray queries (built on first use)
+  TriangleBVH triangle_bvh;
+
+  /**
+   * Reorder the face list for the vertex cache and overdraw and the
+   * vertex list to match (see mesh_optimize.h).
+   */
+  void OptimizeFaces() {
+    if (faces.size() < 3)
+      return;
+
+    // Out of range indexes are left for IndexBuffer::Create to report
+    for (auto index : faces) {
+      if (index >= vertices.size())
+        return;
+    }
+    std::vector<uint32_t> remap;
+    MeshOptimizeStats stats = OptimizeMesh(faces, &vertices[0].vertex.x, sizeof(VertexAndNormal),
+                                           static_cast<uint32_t>(vertices.size()), remap);
+    RemapVertices(vertices, remap);
+
+    // Welded positions are indexed by vertex so rebuild them on the next Add
+    weld_index.Clear();
+    printf("TriSurface: %u triangles, ACMR %.3f -> %.3f\n", stats.triangles,
+           stats.acmr_before, stats.acmr_after);
+  }
 
   /**
    * Form triangle face indexes for a surface constructed using a double loop -
@@ -247,33 +376,38 @@ protected:
 
   // Convenience method to get the index into the vertex list given the
   // "row" and "column" of the subdivision/grid
-  uint16_t GetIndex(uint32_t row, uint32_t col, uint32_t ncols) const {
-    return static_cast<uint16_t>((row*ncols) + col);
+  uint32_t GetIndex(uint32_t row, uint32_t col, uint32_t ncols) const {
+    return (row*ncols) + col;
   }
 
   /**
    * Adds a vertex to the surface vertex list.  Returns the index into the
-	 * vertex list.  If the vertex is already in the list it does not
-	 * replicate it.
+   * vertex list.  If the vertex is already in the list (within the weld
+   * tolerance) it does not replicate it and the index of the first
+   * matching vertex is returned.
    * @param  v_in  Vertex
    */
-	uint32_t AddVertex(const Point3& v_in) {
-    // Check if vertex is in the list. This is just a brute force method.
-    // Efficiency can be improved but we only use this at startup
-    uint32_t index = 0;
-    for (auto v : vertices) {
-      if (v_in == v.vertex) {
-        return index;
-      }
-      index++;
+  uint32_t AddVertex(const Point3& v_in) {
+    // Bring the weld index up to date with vertices added directly to the
+    // list (AddPolygon, derived classes)
+    if (weld_index.Size() > vertices.size()) {
+      weld_index.Clear();
     }
-		
-		// Not in the list, add it. Make sure the vertex normal is initialized 
-		// to (0,0,0)
-		VertexAndNormal vertex(v_in);
-		vertices.push_back(vertex);
-		return (uint32_t)vertices.size() - 1;
-	}
+    for (uint32_t i = weld_index.Size(); i < vertices.size(); i++) {
+      weld_index.Insert(vertices[i].vertex);
+    }
+
+    uint32_t index;
+    if (weld_index.Find(v_in, index)) {
+      return index;
+    }
+
+    // Not in the list, add it. Make sure the vertex normal is initialized
+    // to (0,0,0)
+    VertexAndNormal vertex(v_in);
+    vertices.push_back(vertex);
+    return weld_index.Insert(v_in);
+  }
 };
 
 
@@ -22,10 +22,6 @@ public:
    * @param  n   Number of subdivisions in x and y
 	 */
 	UnitSquareSurface(uint32_t n, const int position_loc, const int normal_loc) {
-    // Only allow 250 subdivision (so it creates less that 65K vertices)
-    if (n > 250)
-      n = 250;
-		
     // Normal is 0,0,1. z = 0 so all vertices lie in x,y plane.
     // Having issues with roundoff when n = 40,50 - so compare with some tolerance
     VertexAndNormal vtx;
@@ -66,10 +62,6 @@ public:
                             const int tangent_loc, 
                             const int bitangent_loc)
   {
-    // Only allow 250 subdivision (so it creates less that 65K vertices)
-    if (n > 250)
-      n = 250;
-
     // Normal is 0,0,1. z = 0 so all vertices lie in x,y plane.
     // Having issues with roundoff when n = 40,50 - so compare with some tolerance
     // Store in column order.
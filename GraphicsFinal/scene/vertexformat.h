@@ -0,0 +1,421 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    vertexformat.h
+//	Purpose: Compact interleaved vertex layouts: octahedral normal and
+//           tangent frames, 16 bit or half float texture coordinates and
+//           optionally 16 bit positions with a per-mesh scale and offset.
+//
+//============================================================================
+
+#ifndef __VERTEXFORMAT_H
+#define __VERTEXFORMAT_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// Set false to upload meshes as float vertices (for comparison). The
+// lighting shader decodes either all compact or all float vertices.
+const bool kCompactVertices = true;
+
+// Largest position error (object units) allowed for 16 bit positions. The
+// error is half a step of the mesh extent / 65535, so meshes up to about
+// 130 units across are quantized.
+const float kPositionQuantizeError = 0.001f;
+
+// Largest texture coordinate stored as half float (the half float step is
+// 1/1024 between 1 and 2). Coordinates in [0,1] use 16 bit unsigned
+// normalized values; larger ones stay float.
+const float kHalfTexCoordRange = 2.0f;
+
+// Position encodings
+enum VertexPositionFormat {
+  VERTEX_POSITION_FLOAT,      // 3 floats
+  VERTEX_POSITION_UNORM16     // 4 unsigned shorts (w unused), scale and offset per mesh
+};
+
+// Texture coordinate encodings
+enum VertexTexCoordFormat {
+  VERTEX_TEXCOORD_NONE,
+  VERTEX_TEXCOORD_UNORM16,    // 2 unsigned shorts, [0,1]
+  VERTEX_TEXCOORD_HALF,       // 2 half floats
+  VERTEX_TEXCOORD_FLOAT       // 2 floats
+};
+
+/**
+ * Compact vertex layout of one mesh. Each vertex holds the position, the
+ * frame (4 signed shorts: octahedral normal, then octahedral tangent with
+ * the bitangent sign folded into the tangent x) and the texture coordinate.
+ * The frame goes to the vertex normal attribute; the shader rebuilds the
+ * bitangent as sign * cross(normal, tangent).
+ */
+struct CompactVertexLayout {
+  VertexPositionFormat position;
+  VertexTexCoordFormat texcoord;
+  uint32_t             stride;
+  uint32_t             frame_offset;
+  uint32_t             texcoord_offset;
+  float                position_scale[3];   // Object position = stored * scale + offset
+  float                position_offset[3];
+};
+
+/**
+ * Float vertex attributes to pack. Each pointer addresses the attribute of
+ * the first vertex; vertices are stride bytes apart. Normal, texcoord and
+ * tangent may be NULL (a missing normal is +z, a missing tangent is any
+ * vector perpendicular to the normal). Bitangent is only used for its sign.
+ */
+struct VertexSource {
+  const float* position;
+  const float* normal;
+  const float* texcoord;
+  const float* tangent;
+  const float* bitangent;
+  uint32_t     stride;
+  uint32_t     count;
+};
+
+/**
+ * Convert a float to a half float (round to nearest even; overflow becomes
+ * infinity and small values become denormals or zero).
+ * @param  f  Value to convert.
+ * @return  Returns the half float bits.
+ */
+inline uint16_t FloatToHalf(const float f) {
+  uint32_t x;
+  memcpy(&x, &f, 4);
+  uint32_t sign = (x >> 16) & 0x8000;
+  uint32_t abs_x = x & 0x7fffffff;
+  if (abs_x >= 0x7f800000)                          // Inf or NaN
+    return static_cast<uint16_t>(sign | 0x7c00 | ((abs_x > 0x7f800000) ? 0x200 : 0));
+  if (abs_x >= 0x477ff000)                          // Rounds past the largest half
+    return static_cast<uint16_t>(sign | 0x7c00);
+  if (abs_x < 0x38800000) {                         // Denormal half (or zero)
+    uint32_t shift = 126 - (abs_x >> 23);
+    if (shift > 24)
+      return static_cast<uint16_t>(sign);
+    uint32_t mantissa = (abs_x & 0x7fffff) | 0x800000;
+    uint32_t half = mantissa >> shift;
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1)))
+      half++;
+    return static_cast<uint16_t>(sign | half);
+  }
+  uint32_t half = (abs_x - 0x38000000) >> 13;
+  uint32_t rest = abs_x & 0x1fff;
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    half++;
+  return static_cast<uint16_t>(sign | half);
+}
+
+/**
+ * Convert a value in [-1,1] to a signed normalized short.
+ */
+inline int16_t ToSnorm16(const float v) {
+  float c = floorf(((v < -1.0f) ? -1.0f : ((v > 1.0f) ? 1.0f : v)) * 32767.0f + 0.5f);
+  return static_cast<int16_t>(c);
+}
+
+/**
+ * Convert a value in [0,1] to an unsigned normalized short.
+ */
+inline uint16_t ToUnorm16(const float v) {
+  float c = floorf(((v < 0.0f) ? 0.0f : ((v > 1.0f) ? 1.0f : v)) * 65535.0f + 0.5f);
+  return static_cast<uint16_t>(c);
+}
+
+/**
+ * Octahedral encoding of a unit vector: the vector is projected onto the
+ * octahedron |x|+|y|+|z| = 1 and the lower half is folded over the
+ * diagonals, giving a point in [-1,1]^2. Decoded by the shader (OctDecode).
+ * @param  v    Unit vector.
+ * @param  out  Encoded x, y.
+ */
+inline void OctEncode(const float* v, float* out) {
+  float l1 = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+  float x = v[0] / l1;
+  float y = v[1] / l1;
+  if (v[2] < 0.0f) {
+    float fx = (1.0f - fabsf(y)) * ((x >= 0.0f) ? 1.0f : -1.0f);
+    float fy = (1.0f - fabsf(x)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+    x = fx;
+    y = fy;
+  }
+  out[0] = x;
+  out[1] = y;
+}
+
+/**
+ * Decode an octahedral encoding (CPU version of the shader OctDecode).
+ * @param  e    Encoded x, y.
+ * @param  out  Unit vector.
+ */
+inline void OctDecode(const float* e, float* out) {
+  float x = e[0];
+  float y = e[1];
+  float z = 1.0f - fabsf(x) - fabsf(y);
+  if (z < 0.0f) {
+    float fx = (1.0f - fabsf(y)) * ((x >= 0.0f) ? 1.0f : -1.0f);
+    float fy = (1.0f - fabsf(x)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+    x = fx;
+    y = fy;
+  }
+  float len = sqrtf(x * x + y * y + z * z);
+  out[0] = x / len;
+  out[1] = y / len;
+  out[2] = z / len;
+}
+
+/**
+ * Pack a tangent frame into 4 signed shorts. The tangent is made
+ * perpendicular to the normal. The bitangent sign is folded into the
+ * tangent x: its magnitude is stored in [1,32767] and the sign of the short
+ * is the bitangent sign (so it survives either signed normalized
+ * conversion rule).
+ * @param  normal     Normal (NULL for +z). Need not be unit length.
+ * @param  tangent    Tangent (NULL to pick one).
+ * @param  bitangent  Bitangent (NULL for a positive sign).
+ * @param  out        Packed frame.
+ */
+inline void PackVertexFrame(const float* normal, const float* tangent, const float* bitangent,
+                            int16_t* out) {
+  float n[3] = { 0.0f, 0.0f, 1.0f };
+  if (normal != nullptr) {
+    float len = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (len > 1.0e-12f) {
+      n[0] = normal[0] / len;
+      n[1] = normal[1] / len;
+      n[2] = normal[2] / len;
+    }
+  }
+
+  // Gram-Schmidt the tangent against the normal. Missing or degenerate
+  // tangents (e.g. infinite or NaN from degenerate texture coordinates)
+  // use an axis.
+  float t[3] = { 0.0f, 0.0f, 0.0f };
+  float len = 0.0f;
+  if (tangent != nullptr) {
+    float d = n[0] * tangent[0] + n[1] * tangent[1] + n[2] * tangent[2];
+    for (int i = 0; i < 3; i++)
+      t[i] = tangent[i] - n[i] * d;
+    len = sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+  }
+  if (!(len > 1.0e-6f && len < 1.0e30f)) {
+    float axis[3] = { 0.0f, 0.0f, 0.0f };
+    axis[(fabsf(n[0]) < 0.9f) ? 0 : 1] = 1.0f;
+    float d = n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2];
+    for (int i = 0; i < 3; i++)
+      t[i] = axis[i] - n[i] * d;
+    len = sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+  }
+  for (int i = 0; i < 3; i++)
+    t[i] /= len;
+
+  float sign = 1.0f;
+  if (bitangent != nullptr) {
+    float c[3] = { n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0] };
+    if (c[0] * bitangent[0] + c[1] * bitangent[1] + c[2] * bitangent[2] < 0.0f)
+      sign = -1.0f;
+  }
+
+  float en[2];
+  float et[2];
+  OctEncode(n, en);
+  OctEncode(t, et);
+  out[0] = ToSnorm16(en[0]);
+  out[1] = ToSnorm16(en[1]);
+  int16_t magnitude = static_cast<int16_t>(1 + floorf((et[0] + 1.0f) * 0.5f * 32766.0f + 0.5f));
+  out[2] = (sign < 0.0f) ? -magnitude : magnitude;
+  out[3] = ToSnorm16(et[1]);
+}
+
+/**
+ * Choose the compact layout for a mesh: 16 bit positions when the mesh is
+ * small enough for kPositionQuantizeError and the smallest texture
+ * coordinate encoding that covers the mesh's range.
+ * @param  source  Vertices of the mesh.
+ * @return  Returns the layout.
+ */
+inline CompactVertexLayout ChooseVertexLayout(const VertexSource& source) {
+  CompactVertexLayout layout;
+  float pmin[3] = { 0.0f, 0.0f, 0.0f };
+  float pmax[3] = { 0.0f, 0.0f, 0.0f };
+  float tmin = 0.0f;
+  float tmax = 0.0f;
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(source.position);
+  const unsigned char* tc = reinterpret_cast<const unsigned char*>(source.texcoord);
+  for (uint32_t i = 0; i < source.count; i++) {
+    const float* v = reinterpret_cast<const float*>(p + i * source.stride);
+    for (int k = 0; k < 3; k++) {
+      pmin[k] = (i == 0 || v[k] < pmin[k]) ? v[k] : pmin[k];
+      pmax[k] = (i == 0 || v[k] > pmax[k]) ? v[k] : pmax[k];
+    }
+    if (tc != nullptr) {
+      const float* uv = reinterpret_cast<const float*>(tc + i * source.stride);
+      for (int k = 0; k < 2; k++) {
+        tmin = (i == 0 && k == 0) || uv[k] < tmin ? uv[k] : tmin;
+        tmax = (i == 0 && k == 0) || uv[k] > tmax ? uv[k] : tmax;
+      }
+    }
+  }
+
+  float extent = 0.0f;
+  for (int k = 0; k < 3; k++) {
+    extent = (pmax[k] - pmin[k] > extent) ? pmax[k] - pmin[k] : extent;
+  }
+  layout.position = (extent * (0.5f / 65535.0f) <= kPositionQuantizeError) ?
+                    VERTEX_POSITION_UNORM16 : VERTEX_POSITION_FLOAT;
+  for (int k = 0; k < 3; k++) {
+    bool quantized = layout.position == VERTEX_POSITION_UNORM16;
+    layout.position_scale[k] = quantized ? pmax[k] - pmin[k] : 1.0f;
+    layout.position_offset[k] = quantized ? pmin[k] : 0.0f;
+  }
+
+  if (tc == nullptr)
+    layout.texcoord = VERTEX_TEXCOORD_NONE;
+  else if (tmin >= 0.0f && tmax <= 1.0f)
+    layout.texcoord = VERTEX_TEXCOORD_UNORM16;
+  else if (tmin >= -kHalfTexCoordRange && tmax <= kHalfTexCoordRange)
+    layout.texcoord = VERTEX_TEXCOORD_HALF;
+  else
+    layout.texcoord = VERTEX_TEXCOORD_FLOAT;
+
+  layout.frame_offset = (layout.position == VERTEX_POSITION_UNORM16) ? 8 : 12;
+  layout.texcoord_offset = layout.frame_offset + 8;
+  static const uint32_t texcoord_size[] = { 0, 4, 4, 8 };
+  layout.stride = layout.texcoord_offset + texcoord_size[layout.texcoord];
+  return layout;
+}
+
+/**
+ * Pack vertices into a layout.
+ * @param  source  Vertices to pack.
+ * @param  layout  Layout (from ChooseVertexLayout).
+ * @param  out     Packed vertices (count * stride bytes).
+ */
+inline void PackVertices(const VertexSource& source, const CompactVertexLayout& layout,
+                         std::vector<unsigned char>& out) {
+  out.assign(static_cast<size_t>(source.count) * layout.stride, 0);
+  for (uint32_t i = 0; i < source.count; i++) {
+    size_t offset = static_cast<size_t>(i) * source.stride;
+    const float* position = reinterpret_cast<const float*>(
+      reinterpret_cast<const unsigned char*>(source.position) + offset);
+    unsigned char* v = &out[static_cast<size_t>(i) * layout.stride];
+    if (layout.position == VERTEX_POSITION_UNORM16) {
+      uint16_t q[4] = { 0, 0, 0, 0 };
+      for (int k = 0; k < 3; k++) {
+        float scale = layout.position_scale[k];
+        q[k] = (scale > 0.0f) ? ToUnorm16((position[k] - layout.position_offset[k]) / scale) : 0;
+      }
+      memcpy(v, q, sizeof(q));
+    }
+    else
+      memcpy(v, position, 3 * sizeof(float));
+
+    const float* normal = (source.normal == nullptr) ? nullptr : reinterpret_cast<const float*>(
+      reinterpret_cast<const unsigned char*>(source.normal) + offset);
+    const float* tangent = (source.tangent == nullptr) ? nullptr : reinterpret_cast<const float*>(
+      reinterpret_cast<const unsigned char*>(source.tangent) + offset);
+    const float* bitangent = (source.bitangent == nullptr) ? nullptr : reinterpret_cast<const float*>(
+      reinterpret_cast<const unsigned char*>(source.bitangent) + offset);
+    int16_t frame[4];
+    PackVertexFrame(normal, tangent, bitangent, frame);
+    memcpy(v + layout.frame_offset, frame, sizeof(frame));
+
+    if (layout.texcoord == VERTEX_TEXCOORD_NONE)
+      continue;
+    const float* uv = reinterpret_cast<const float*>(
+      reinterpret_cast<const unsigned char*>(source.texcoord) + offset);
+    if (layout.texcoord == VERTEX_TEXCOORD_UNORM16) {
+      uint16_t q[2] = { ToUnorm16(uv[0]), ToUnorm16(uv[1]) };
+      memcpy(v + layout.texcoord_offset, q, sizeof(q));
+    }
+    else if (layout.texcoord == VERTEX_TEXCOORD_HALF) {
+      uint16_t h[2] = { FloatToHalf(uv[0]), FloatToHalf(uv[1]) };
+      memcpy(v + layout.texcoord_offset, h, sizeof(h));
+    }
+    else
+      memcpy(v + layout.texcoord_offset, uv, 2 * sizeof(float));
+  }
+}
+
+/**
+ * Set the vertex attribute pointers of a compact layout in the bound VAO
+ * (the vertex buffer must be bound to GL_ARRAY_BUFFER). The frame goes to
+ * the normal attribute; tangent and bitangent attributes are not used.
+ * @param  layout        Vertex layout.
+ * @param  position_loc  Location of the vertex position attribute
+ * @param  normal_loc    Location of the vertex normal attribute
+ * @param  texture_loc   Location of the vertex texture attribute
+ */
+inline void SetVertexAttributes(const CompactVertexLayout& layout, const int position_loc,
+                                const int normal_loc, const int texture_loc) {
+  if (layout.position == VERTEX_POSITION_UNORM16)
+    glVertexAttribPointer(position_loc, 3, GL_UNSIGNED_SHORT, GL_TRUE, layout.stride, (void*)0);
+  else
+    glVertexAttribPointer(position_loc, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)0);
+  glEnableVertexAttribArray(position_loc);
+
+  glVertexAttribPointer(normal_loc, 4, GL_SHORT, GL_TRUE, layout.stride,
+                        (void*)static_cast<uintptr_t>(layout.frame_offset));
+  glEnableVertexAttribArray(normal_loc);
+
+  if (layout.texcoord == VERTEX_TEXCOORD_NONE)
+    return;
+  void* texcoord = (void*)static_cast<uintptr_t>(layout.texcoord_offset);
+  if (layout.texcoord == VERTEX_TEXCOORD_UNORM16)
+    glVertexAttribPointer(texture_loc, 2, GL_UNSIGNED_SHORT, GL_TRUE, layout.stride, texcoord);
+  else if (layout.texcoord == VERTEX_TEXCOORD_HALF)
+    glVertexAttribPointer(texture_loc, 2, GL_HALF_FLOAT, GL_FALSE, layout.stride, texcoord);
+  else
+    glVertexAttribPointer(texture_loc, 2, GL_FLOAT, GL_FALSE, layout.stride, texcoord);
+  glEnableVertexAttribArray(texture_loc);
+}
+
+/**
+ * Check if a layout has 16 bit positions.
+ * @param  layout  Layout of the mesh (NULL for float vertices).
+ * @return  Returns true if positions must be dequantized.
+ */
+inline bool IsQuantized(const CompactVertexLayout* layout) {
+  return layout != nullptr && layout->position == VERTEX_POSITION_UNORM16;
+}
+
+/**
+ * Get the matrix that maps stored (16 bit normalized) positions to object
+ * positions. Quantized meshes are drawn with it appended to the model
+ * matrix; the normal matrix is not changed (normals are not quantized).
+ * @param  layout  Layout of the mesh.
+ * @return  Returns the dequantization matrix.
+ */
+inline Matrix4x4 GetDequantizeMatrix(const CompactVertexLayout& layout) {
+  Matrix4x4 m;
+  m.Translate(layout.position_offset[0], layout.position_offset[1], layout.position_offset[2]);
+  m.Scale(layout.position_scale[0], layout.position_scale[1], layout.position_scale[2]);
+  return m;
+}
+
+/**
+ * Set the model and composite matrix uniforms for drawing a quantized
+ * mesh by traversal (the dequantization appended to the current model
+ * matrix), or with NULL restore them to the current model matrix after
+ * the draw.
+ * @param  scene_state  Current scene state.
+ * @param  layout       Quantized layout of the mesh or NULL to restore.
+ */
+inline void SetDequantizeMatrices(SceneState& scene_state, const CompactVertexLayout* layout) {
+  Matrix4x4 model = scene_state.model_matrix;
+  if (layout != nullptr)
+    model *= GetDequantizeMatrix(*layout);
+  Matrix4x4 pvm = scene_state.pv * model;
+  scene_state.gl_state.UniformMatrix4fv(scene_state.modelmatrix_loc, model.Get());
+  scene_state.gl_state.UniformMatrix4fv(scene_state.pvm_loc, pvm.Get());
+}
+
+#endif
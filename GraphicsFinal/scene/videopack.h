@@ -0,0 +1,184 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    videopack.h
+//	Purpose: Packed video container: a frame sequence stored upload ready
+//           in one memory mapped file.
+//
+//============================================================================
+
+#ifndef __VIDEOPACK_H
+#define __VIDEOPACK_H
+
+#include <string.h>
+#include <sstream>
+#include <string>
+#include "scene/mappedfile.h"
+
+// File layout (little endian):
+//   VideoPackHeader
+//   VideoPackFrame[frame_count]     frame index
+//   frame data, each frame starting on a kVideoPackAlignment boundary
+// Frames are stored with a lower left origin, rows tightly packed, in the
+// format named in the header.
+const char     kVideoPackMagic[4] = { 'V', 'P', 'A', 'K' };
+const uint32_t kVideoPackVersion = 1;
+const uint32_t kVideoPackAlignment = 4096;
+
+// Extension of packed video files
+const char* const kVideoPackExtension = ".vpak";
+
+// Frame formats
+enum VideoPackFormat { VIDEOPACK_RGBA8 = 0 };
+
+struct VideoPackHeader {
+  char     magic[4];
+  uint32_t version;
+  uint32_t format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t frame_count;
+  uint32_t reserved[2];
+};
+
+struct VideoPackFrame {
+  uint64_t offset;    // From the start of the file
+  uint64_t size;      // Bytes
+};
+
+/**
+ * Get the filename of a frame in a numbered sequence. Files are numbered
+ * from 1 and zero padded to 3 digits after the base name.
+ * @param  base   Filename base (e.g. Video/futurama00).
+ * @param  frame  Frame index (0 based).
+ * @param  ext    Filename extension (including the '.').
+ * @return  Returns the filename.
+ */
+inline std::string VideoFrameName(const std::string& base, const int frame,
+                                  const std::string& ext) {
+  std::stringstream ss;
+  ss << (frame + 1);
+  std::string number = ss.str();
+  while (number.size() < 3)
+    number = "0" + number;
+  return base + number + ext;
+}
+
+/**
+ * Get the size of a frame in a given format.
+ * @param  format  Frame format.
+ * @param  width   Frame width.
+ * @param  height  Frame height.
+ * @return  Returns the size in bytes.
+ */
+inline uint64_t VideoPackFrameSize(const uint32_t format, const uint32_t width,
+                                   const uint32_t height) {
+  switch (format) {
+  case VIDEOPACK_RGBA8: return static_cast<uint64_t>(width) * height * 4;
+  default:              return 0;
+  }
+}
+
+/**
+ * Packed video reader. Maps the file and validates the header and frame
+ * index; frames are then slices of the mapping (read from disk on first
+ * touch). Frames can be read from any thread.
+ */
+class VideoPackReader {
+public:
+  /**
+   * Constructor.
+   */
+  VideoPackReader()
+      : header(nullptr),
+        frames(nullptr) {
+  }
+
+  /**
+   * Open a packed video.
+   * @param  path  File path.
+   * @return  Returns false if the file does not exist or is not valid.
+   */
+  bool Open(const std::string& path) {
+    Close();
+    if (!file.Open(path))
+      return false;
+
+    const unsigned char* data = file.GetData();
+    uint64_t size = file.GetSize();
+    if (size < sizeof(VideoPackHeader)) {
+      printf("VideoPackReader: %s is too small\n", path.c_str());
+      Close();
+      return false;
+    }
+    const VideoPackHeader* h = reinterpret_cast<const VideoPackHeader*>(data);
+    uint64_t frame_size = VideoPackFrameSize(h->format, h->width, h->height);
+    if (memcmp(h->magic, kVideoPackMagic, 4) != 0 || h->version != kVideoPackVersion ||
+        frame_size == 0 || h->frame_count == 0 ||
+        sizeof(VideoPackHeader) + h->frame_count * sizeof(VideoPackFrame) > size) {
+      printf("VideoPackReader: %s is not a valid packed video\n", path.c_str());
+      Close();
+      return false;
+    }
+    const VideoPackFrame* f = reinterpret_cast<const VideoPackFrame*>(data + sizeof(VideoPackHeader));
+    for (uint32_t i = 0; i < h->frame_count; i++) {
+      if (f[i].size != frame_size || f[i].offset > size || f[i].size > size - f[i].offset) {
+        printf("VideoPackReader: %s frame %u is out of range\n", path.c_str(), i);
+        Close();
+        return false;
+      }
+    }
+    header = h;
+    frames = f;
+    return true;
+  }
+
+  /**
+   * Close the file.
+   */
+  void Close() {
+    file.Close();
+    header = nullptr;
+    frames = nullptr;
+  }
+
+  /**
+   * Check if a packed video is open.
+   * @return  Returns true if open.
+   */
+  bool IsOpen() const {
+    return header != nullptr;
+  }
+
+  uint32_t GetFormat() const { return header->format; }
+  uint32_t GetWidth() const { return header->width; }
+  uint32_t GetHeight() const { return header->height; }
+  uint32_t GetFrameCount() const { return header->frame_count; }
+
+  /**
+   * Get a frame.
+   * @param  frame  Frame index.
+   * @return  Returns the frame data (GetFrameSize bytes).
+   */
+  const unsigned char* GetFrame(const uint32_t frame) const {
+    return file.GetData() + frames[frame].offset;
+  }
+
+  /**
+   * Get the size of each frame.
+   * @return  Returns the frame size in bytes.
+   */
+  uint64_t GetFrameSize() const {
+    return frames[0].size;
+  }
+
+protected:
+  MappedFile             file;
+  const VideoPackHeader* header;
+  const VideoPackFrame*  frames;
+};
+
+#endif
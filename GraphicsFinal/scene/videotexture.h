@@ -0,0 +1,371 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    videotexture.h
+//	Purpose: Texture streamed from a numbered sequence of image files (or
+//           a packed video) through a ring of pixel buffer objects.
+//
+//============================================================================
+
+#ifndef __VIDEOTEXTURE_H
+#define __VIDEOTEXTURE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Pixel buffer objects in the ring (frames decoded ahead of the one shown)
+const uint32_t kVideoRingSize = 4;
+
+/**
+ * Video texture. Plays a sequence of image files (basename001.ext,
+ * basename002.ext, ...) through one texture object. A decode thread stays
+ * up to kVideoRingSize frames ahead, writing each frame into a mapped
+ * pixel buffer object. Advance (OpenGL thread) unmaps the next filled
+ * buffer and updates the texture from it, so the copy to the texture is
+ * done by the driver without stalling; the buffer is then orphaned and
+ * mapped again for the decoder. Memory use is one texture plus the ring,
+ * independent of the number of frames.
+ *
+ * If a packed video of the sequence exists (basename.vpak, written by the
+ * videopack tool) it is used instead of the image files: frames are
+ * already upload ready, so the decode thread just copies each frame from
+ * the file mapping into the buffer.
+ *
+ * All methods must be called from the OpenGL thread.
+ */
+class VideoTexture {
+public:
+  /**
+   * Constructor.
+   */
+  VideoTexture()
+      : texture(0),
+        frame_count(0),
+        width(0),
+        height(0),
+        mipmaps(false),
+        read_slot(0),
+        write_slot(0),
+        next_decode(0),
+        stop(false) {
+    for (uint32_t i = 0; i < kVideoRingSize; i++) {
+      slots[i].pbo = 0;
+      slots[i].data = nullptr;
+      slots[i].state = SLOT_UNMAPPED;
+      slots[i].ok = false;
+    }
+  }
+
+  /**
+   * Destructor. Stops the decode thread and deletes the OpenGL objects.
+   */
+  ~VideoTexture() {
+    Close();
+  }
+
+  /**
+   * Open a frame sequence. Tries the packed video in ../textures, then
+   * ../../textures, then the image files. The first frame is decoded and
+   * uploaded before returning; later frames are decoded in the background.
+   * @param  basefname   Frame filename base (relative to textures)
+   * @param  frames      Number of frames
+   * @param  ext         Filename extension (including the '.')
+   * @param  wrap_s      OpenGL wrap option (s)
+   * @param  wrap_t      OpenGL wrap option (t)
+   * @param  min_filter  OpenGL filter to use for minification
+   * @param  mag_filter  OpenGL filter to use for magnification
+   * @return  Returns true if the first frame was loaded.
+   */
+  bool Open(const std::string& basefname, const int frames, const std::string& ext,
+            GLuint wrap_s, GLuint wrap_t, GLuint min_filter, GLuint mag_filter) {
+    Close();
+    base = basefname;
+    extension = ext;
+    frame_count = frames;
+
+    // Use the packed video if it holds the whole sequence
+    if (frames > 0 && !OpenPack("../textures/" + base + kVideoPackExtension))
+      OpenPack("../../textures/" + base + kVideoPackExtension);
+
+    TextureImage image;
+    const unsigned char* first;
+    if (pack.IsOpen()) {
+      width = pack.GetWidth();
+      height = pack.GetHeight();
+      first = pack.GetFrame(0);
+    }
+    else {
+      DevILMutex();
+      if (frames <= 0 || !DecodeFrame(0, image)) {
+        printf("Error loading video frame. %s\n", GetFrameName(0).c_str());
+        return false;
+      }
+      width = image.width;
+      height = image.height;
+      first = &image.pixels[0];
+    }
+    mipmaps = (min_filter != GL_NEAREST && min_filter != GL_LINEAR);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, first);
+    if (mipmaps)
+      glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_s);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_t);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Map the ring for the decoder, starting with the second frame
+    for (uint32_t i = 0; i < kVideoRingSize; i++) {
+      glGenBuffers(1, &slots[i].pbo);
+      slots[i].state = SLOT_UNMAPPED;
+      MapSlot(slots[i], true);
+    }
+    read_slot = 0;
+    write_slot = 0;
+    next_decode = 1 % frame_count;
+    stop = false;
+    decoder = std::thread(&VideoTexture::Decoder, this);
+    return true;
+  }
+
+  /**
+   * Stop decoding and delete the texture and buffers.
+   */
+  void Close() {
+    if (decoder.joinable()) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        stop = true;
+      }
+      slot_changed.notify_all();
+      decoder.join();
+    }
+    for (uint32_t i = 0; i < kVideoRingSize; i++) {
+      if (slots[i].data != nullptr) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slots[i].pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        slots[i].data = nullptr;
+      }
+      if (slots[i].pbo != 0)
+        glDeleteBuffers(1, &slots[i].pbo);
+      slots[i].pbo = 0;
+      slots[i].state = SLOT_UNMAPPED;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (texture != 0)
+      glDeleteTextures(1, &texture);
+    texture = 0;
+    pack.Close();
+  }
+
+  /**
+   * Show the next frame if it has been decoded. If the decoder has fallen
+   * behind the current frame stays up (no stall).
+   * @return  Returns true if the texture changed.
+   */
+  bool Advance() {
+    if (texture == 0)
+      return false;
+
+    Slot& slot = slots[read_slot];
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (slot.state != SLOT_FILLED)
+        return false;
+    }
+
+    // Unmap and update the texture from the buffer (the source is the
+    // buffer, so glTexSubImage2D returns without waiting for the copy)
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    slot.data = nullptr;
+    bool ok = slot.ok;
+    if (ok) {
+      glBindTexture(GL_TEXTURE_2D, texture);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                      (void*)0);
+      if (mipmaps)
+        glGenerateMipmap(GL_TEXTURE_2D);
+      glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // Orphan the buffer and give it back to the decoder
+    MapSlot(slot, false);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    read_slot = (read_slot + 1) % kVideoRingSize;
+    return ok;
+  }
+
+  /**
+   * Get the texture the frames are shown in.
+   * @return  Returns the texture object (0 if not open).
+   */
+  GLuint GetTexture() const {
+    return texture;
+  }
+
+  /**
+   * Get the filename of a frame.
+   * @param  frame  Frame index (0 based; files are numbered from 1).
+   * @return  Returns the filename (relative to textures).
+   */
+  std::string GetFrameName(const int frame) const {
+    return VideoFrameName(base, frame, extension);
+  }
+
+  /**
+   * Check if frames are streamed from a packed video.
+   * @return  Returns true if a packed video is open.
+   */
+  bool IsPacked() const {
+    return pack.IsOpen();
+  }
+
+  /**
+   * Get the number of frames decoded and waiting to be shown.
+   * @return  Returns the number of frames ready.
+   */
+  uint32_t GetReadyCount() {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < kVideoRingSize; i++) {
+      if (slots[i].state == SLOT_FILLED)
+        n++;
+    }
+    return n;
+  }
+
+protected:
+  // Ring slot states. Unmapped slots belong to the OpenGL thread, mapped
+  // ones to the decoder and filled ones wait for Advance.
+  enum SlotState { SLOT_UNMAPPED, SLOT_MAPPED, SLOT_FILLED };
+
+  struct Slot {
+    GLuint         pbo;
+    unsigned char* data;      // Mapped pointer (NULL if unmapped)
+    SlotState      state;
+    bool           ok;        // Frame decoded with the expected size
+  };
+
+  GLuint      texture;
+  std::string base;
+  std::string extension;
+  int         frame_count;
+  int         width;
+  int         height;
+  bool        mipmaps;
+  VideoPackReader pack;       // Open if streaming from a packed video
+
+  Slot        slots[kVideoRingSize];
+  uint32_t    read_slot;      // Next slot Advance shows (OpenGL thread)
+  uint32_t    write_slot;     // Next slot the decoder fills (decoder)
+  int         next_decode;    // Next frame to decode (decoder)
+
+  std::thread             decoder;
+  std::mutex              mutex;
+  std::condition_variable slot_changed;
+  bool                    stop;
+
+  // Open a packed video. Keeps it open only if it holds at least
+  // frame_count RGBA frames.
+  bool OpenPack(const std::string& path) {
+    if (!pack.Open(path))
+      return false;
+    if (pack.GetFormat() != VIDEOPACK_RGBA8 ||
+        pack.GetFrameCount() < static_cast<uint32_t>(frame_count)) {
+      printf("VideoTexture: %s does not match the sequence - using image files\n",
+             path.c_str());
+      pack.Close();
+      return false;
+    }
+    return true;
+  }
+
+  // Decode a frame image file. Thread safe.
+  bool DecodeFrame(const int frame, TextureImage& image) const {
+    return DecodeTextureFile(GetFrameName(frame), image);
+  }
+
+  // Map a slot's buffer for writing, discarding its contents, and hand it
+  // to the decoder. Allocates the buffer store if new. Not unsynchronized:
+  // the last upload from the buffer may still be reading it, and
+  // invalidating orphans the store so the map does not wait for it.
+  void MapSlot(Slot& slot, const bool allocate) {
+    GLsizeiptr size = static_cast<GLsizeiptr>(width) * height * 4;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+    if (allocate)
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    slot.data = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      slot.state = (slot.data != nullptr) ? SLOT_MAPPED : SLOT_UNMAPPED;
+    }
+    slot_changed.notify_all();
+  }
+
+  // Decode thread. Fills mapped slots in ring order with consecutive
+  // frames, looping at the end of the sequence.
+  void Decoder() {
+#ifdef _WIN32
+    // WIC is a COM API - each thread using it initializes COM
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+    TextureImage image;
+    for (;;) {
+      Slot* slot;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stop && slots[write_slot].state != SLOT_MAPPED)
+          slot_changed.wait(lock);
+        if (stop)
+          break;
+        slot = &slots[write_slot];
+      }
+
+      // The slot is owned by this thread until it is marked filled
+      bool ok;
+      if (pack.IsOpen()) {
+        memcpy(slot->data, pack.GetFrame(next_decode), pack.GetFrameSize());
+        ok = true;
+      }
+      else {
+        ok = DecodeFrame(next_decode, image) &&
+             image.width == width && image.height == height;
+        if (ok)
+          memcpy(slot->data, &image.pixels[0], image.pixels.size());
+      }
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        slot->ok = ok;
+        slot->state = SLOT_FILLED;
+      }
+      write_slot = (write_slot + 1) % kVideoRingSize;
+      next_decode = (next_decode + 1) % frame_count;
+    }
+#ifdef _WIN32
+    CoUninitialize();
+#endif
+  }
+
+private:
+  // Thread and OpenGL objects are owned - no copies
+  VideoTexture(const VideoTexture&);
+  VideoTexture& operator=(const VideoTexture&);
+};
+
+#endif
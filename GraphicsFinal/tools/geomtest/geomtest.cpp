@@ -0,0 +1,383 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    geomtest.cpp
+//	Purpose: Checks and benchmarks for the geometry library. Exits with a
+//           non-zero code if a check fails.
+//
+//           geomtest matrix [count]
+//           geomtest weld   [size]
+//
+//           matrix runs random and singular matrices through the selected
+//           Matrix4x4 kernels (SSE, AVX or scalar, see matrix_simd.h) and
+//           compares them against the *Scalar reference kernels.
+//
+//           The project builds SSE2 (Debug, Release), AVX (ReleaseAVX) and
+//           scalar (ReleaseScalar, GEOMETRY_NO_SIMD) configurations and runs
+//           the checks after each build. The ReleaseAVX and ReleaseScalar
+//           solution configurations build only geomtest, e.g.
+//           msbuild ComputerGraphics.sln /p:Configuration=ReleaseAVX
+//
+//           weld builds a size x size sphere patch (default 224, about
+//           100k triangles) the way TriSurface::Add does, welding vertices
+//           with a linear scan and with VertexWeldIndex. It prints both
+//           times and checks that the face lists are identical.
+//
+//============================================================================
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+#include <string>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <chrono>
+#endif
+
+#include "geometry/geometry.h"
+
+// Matrix4x4 logs singular matrices. Count them so the singular cases can
+// check that GetInverse reported them.
+static int log_count = 0;
+void logmsg(const char *message, ...) {
+  (void)message;
+  log_count++;
+}
+
+// Tolerances (relative, or absolute near 0). Products and transforms may
+// only differ in the order of the sums. Inverses use a different method.
+const float kProductTolerance = 1.0e-5f;
+const float kInverseTolerance = 1.0e-3f;
+
+static int failures = 0;
+
+// Current time in ticks
+static uint64_t Now() {
+#ifdef _WIN32
+  LARGE_INTEGER t;
+  QueryPerformanceCounter(&t);
+  return static_cast<uint64_t>(t.QuadPart);
+#else
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Convert ticks to milliseconds
+static double TicksToMs(const uint64_t ticks) {
+#ifdef _WIN32
+  LARGE_INTEGER f;
+  QueryPerformanceFrequency(&f);
+  return ticks * 1000.0 / static_cast<double>(f.QuadPart);
+#else
+  return ticks * 1.0e-6;
+#endif
+}
+
+// Name of the kernels being tested
+static const char* KernelName() {
+#if defined(GEOMETRY_USE_AVX)
+  return "AVX";
+#elif defined(GEOMETRY_USE_SSE)
+  return "SSE";
+#else
+  return "scalar";
+#endif
+}
+
+// Compare n floats and report the first mismatch
+static bool Compare(const char* test, const int index, const float* a, const float* b,
+                    const int n, const float tolerance) {
+  for (int i = 0; i < n; i++) {
+    float scale = fabs(a[i]) > fabs(b[i]) ? fabs(a[i]) : fabs(b[i]);
+    if (scale < 1.0f)
+      scale = 1.0f;
+    if (!(fabs(a[i] - b[i]) <= tolerance * scale)) {
+      printf("FAIL %s (matrix %d, element %d): %g != %g\n", test, index, i, a[i], b[i]);
+      failures++;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Random value in [lo, hi)
+static float Random(std::mt19937& rng, const float lo, const float hi) {
+  return std::uniform_real_distribution<float>(lo, hi)(rng);
+}
+
+// Random general matrix. The diagonal is boosted so it is well conditioned.
+static Matrix4x4 RandomMatrix(std::mt19937& rng) {
+  float m[16];
+  for (int i = 0; i < 16; i++)
+    m[i] = Random(rng, -1.0f, 1.0f) + ((i % 5 == 0) ? 4.0f : 0.0f);
+  Matrix4x4 a;
+  a.Set(m);
+  return a;
+}
+
+// Random affine matrix composed the way TransformNode composes them
+static Matrix4x4 RandomAffine(std::mt19937& rng) {
+  Matrix4x4 a;
+  a.Translate(Random(rng, -100.0f, 100.0f), Random(rng, -100.0f, 100.0f),
+              Random(rng, -100.0f, 100.0f));
+  a.RotateZ(Random(rng, -180.0f, 180.0f));
+  a.RotateY(Random(rng, -180.0f, 180.0f));
+  a.RotateX(Random(rng, -180.0f, 180.0f));
+  a.Scale(Random(rng, 0.1f, 10.0f), Random(rng, 0.1f, 10.0f), Random(rng, 0.1f, 10.0f));
+  return a;
+}
+
+// Singular matrices. Entries are small integers so the determinant is
+// exactly 0 in every kernel.
+static Matrix4x4 SingularMatrix(std::mt19937& rng, const int kind) {
+  float m[16];
+  for (int i = 0; i < 16; i++)
+    m[i] = static_cast<float>(static_cast<int>(Random(rng, -4.0f, 5.0f)));
+  switch (kind % 4) {
+    case 0:  // Zero column
+      for (int r = 0; r < 4; r++)
+        m[(kind / 4 % 4) * 4 + r] = 0.0f;
+      break;
+    case 1:  // Zero row
+      for (int c = 0; c < 4; c++)
+        m[c * 4 + kind / 4 % 4] = 0.0f;
+      break;
+    case 2:  // Affine with a zero scale
+      for (int c = 0; c < 3; c++)
+        m[c * 4 + 3] = 0.0f;
+      m[15] = 1.0f;
+      for (int r = 0; r < 3; r++)
+        m[(kind / 4 % 3) * 4 + r] = 0.0f;
+      break;
+    default:  // Affine flattened onto a plane (z = 0)
+      for (int c = 0; c < 3; c++)
+        m[c * 4 + 3] = 0.0f;
+      m[15] = 1.0f;
+      for (int c = 0; c < 4; c++)
+        m[c * 4 + 2] = 0.0f;
+      break;
+  }
+  Matrix4x4 a;
+  a.Set(m);
+  return a;
+}
+
+// Multiply, transpose and transform through Matrix4x4 and the kernels
+static void TestProducts(const int index, const Matrix4x4& a, const Matrix4x4& b,
+                         std::mt19937& rng) {
+  float expected[16];
+  Mat4MultiplyScalar(a.Get(), b.Get(), expected);
+  Compare("multiply", index, (a * b).Get(), expected, 16, kProductTolerance);
+  Matrix4x4 c = a;
+  c *= b;
+  Compare("multiply in place", index, c.Get(), expected, 16, kProductTolerance);
+
+  Mat4TransposeScalar(a.Get(), expected);
+  Compare("transpose", index, a.GetTranspose().Get(), expected, 16, 0.0f);
+  c = a;
+  c.Transpose();
+  Compare("transpose in place", index, c.Get(), expected, 16, 0.0f);
+
+  Point3 p(Random(rng, -10.0f, 10.0f), Random(rng, -10.0f, 10.0f), Random(rng, -10.0f, 10.0f));
+  float in[4] = { p.x, p.y, p.z, 1.0f };
+  Mat4TransformScalar(a.Get(), in, expected);
+  HPoint3 hp = a * p;
+  Compare("point transform", index, &hp.x, expected, 4, kProductTolerance);
+
+  Vector3 v(Random(rng, -10.0f, 10.0f), Random(rng, -10.0f, 10.0f), Random(rng, -10.0f, 10.0f));
+  in[0] = v.x;
+  in[1] = v.y;
+  in[2] = v.z;
+  in[3] = 0.0f;
+  Mat4TransformScalar(a.Get(), in, expected);
+  Vector3 tv = a * v;
+  Compare("vector transform", index, &tv.x, expected, 3, kProductTolerance);
+}
+
+// GetInverse (and GetAffineInverse if the matrix is affine) against the
+// scalar kernels. Also checks a a^-1 = I.
+static void TestInverse(const int index, const Matrix4x4& a, const bool affine) {
+  static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+  float expected[16];
+  int logged = log_count;
+  if (!Mat4InverseScalar(a.Get(), expected)) {
+    printf("FAIL inverse (matrix %d): scalar kernel reports singular\n", index);
+    failures++;
+    return;
+  }
+  Matrix4x4 inv = a.GetInverse();
+  if (log_count != logged) {
+    printf("FAIL inverse (matrix %d): reported singular\n", index);
+    failures++;
+  }
+  Compare("inverse", index, inv.Get(), expected, 16, kInverseTolerance);
+  Compare("inverse product", index, (a * inv).Get(), identity, 16, kInverseTolerance);
+
+  if (affine) {
+    if (!Mat4AffineInverseScalar(a.Get(), expected)) {
+      printf("FAIL affine inverse (matrix %d): scalar kernel reports singular\n", index);
+      failures++;
+      return;
+    }
+    logged = log_count;
+    inv = a.GetAffineInverse();
+    if (log_count != logged) {
+      printf("FAIL affine inverse (matrix %d): reported singular\n", index);
+      failures++;
+    }
+    Compare("affine inverse", index, inv.Get(), expected, 16, kInverseTolerance);
+    Compare("affine inverse product", index, (a * inv).Get(), identity, 16,
+            kInverseTolerance);
+  }
+}
+
+// Singular matrices must be reported by both the kernels and Matrix4x4,
+// and invert to the identity
+static void TestSingular(const int index, const Matrix4x4& a, const bool affine) {
+  static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+  float out[16];
+  if (Mat4InverseScalar(a.Get(), out) || Mat4Inverse(a.Get(), out)) {
+    printf("FAIL singular inverse (matrix %d): not reported singular\n", index);
+    failures++;
+  }
+  int logged = log_count;
+  Compare("singular inverse", index, a.GetInverse().Get(), identity, 16, 0.0f);
+  if (log_count != logged + 1) {
+    printf("FAIL singular inverse (matrix %d): not logged\n", index);
+    failures++;
+  }
+
+  if (affine) {
+    if (Mat4AffineInverseScalar(a.Get(), out) || Mat4AffineInverse(a.Get(), out)) {
+      printf("FAIL singular affine inverse (matrix %d): not reported singular\n", index);
+      failures++;
+    }
+    logged = log_count;
+    Compare("singular affine inverse", index, a.GetAffineInverse().Get(), identity, 16, 0.0f);
+    if (log_count != logged + 1) {
+      printf("FAIL singular affine inverse (matrix %d): not logged\n", index);
+      failures++;
+    }
+  }
+}
+
+// Run the matrix checks
+static bool TestMatrix(const int count) {
+  std::mt19937 rng(467);
+  for (int i = 0; i < count; i++) {
+    Matrix4x4 a = RandomMatrix(rng);
+    Matrix4x4 b = RandomAffine(rng);
+    TestProducts(i, a, b, rng);
+    TestProducts(i, b, a, rng);
+    TestInverse(i, a, false);
+    TestInverse(i, b, true);
+  }
+  for (int i = 0; i < 64; i++) {
+    Matrix4x4 a = SingularMatrix(rng, i);
+    TestProducts(count + i, a, a, rng);
+    TestSingular(count + i, a, i % 4 >= 2);
+  }
+  printf("matrix (%s kernels): %d random and 64 singular matrices, %d failures\n",
+         KernelName(), count, failures);
+  return failures == 0;
+}
+
+// Vertex on a sphere patch. Column size wraps to column 0 so the seam
+// shares positions.
+static Point3 SpherePoint(const uint32_t row, const uint32_t col, const uint32_t size) {
+  float theta = kPi * static_cast<float>(row) / static_cast<float>(size);
+  float phi = 2.0f * kPi * static_cast<float>(col % size) / static_cast<float>(size);
+  return Point3(sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta));
+}
+
+// Weld the sphere patch triangles as TriSurface::Add does. The linear
+// scan is the method AddVertex used before VertexWeldIndex.
+static void WeldSphere(const uint32_t size, const bool linear, std::vector<Point3>& vertices,
+                       std::vector<uint32_t>& faces) {
+  VertexWeldIndex weld_index;
+  auto add_vertex = [&](const Point3& v_in) -> uint32_t {
+    uint32_t index;
+    if (linear) {
+      for (index = 0; index < vertices.size(); index++) {
+        if (v_in == vertices[index])
+          return index;
+      }
+    }
+    else if (weld_index.Find(v_in, index)) {
+      return index;
+    }
+    vertices.push_back(v_in);
+    return weld_index.Insert(v_in);
+  };
+  for (uint32_t row = 0; row < size; row++) {
+    for (uint32_t col = 0; col < size; col++) {
+      Point3 p00 = SpherePoint(row, col, size);
+      Point3 p01 = SpherePoint(row, col + 1, size);
+      Point3 p10 = SpherePoint(row + 1, col, size);
+      Point3 p11 = SpherePoint(row + 1, col + 1, size);
+      faces.push_back(add_vertex(p10));
+      faces.push_back(add_vertex(p00));
+      faces.push_back(add_vertex(p01));
+      faces.push_back(add_vertex(p10));
+      faces.push_back(add_vertex(p01));
+      faces.push_back(add_vertex(p11));
+    }
+  }
+}
+
+// Time welding with a linear scan and with the weld index
+static bool BenchWeld(const uint32_t size) {
+  std::vector<Point3> linear_vertices, index_vertices;
+  std::vector<uint32_t> linear_faces, index_faces;
+  uint64_t t0 = Now();
+  WeldSphere(size, true, linear_vertices, linear_faces);
+  uint64_t t1 = Now();
+  WeldSphere(size, false, index_vertices, index_faces);
+  uint64_t t2 = Now();
+
+  printf("weld: %ux%u sphere patch, %u triangles, %u unique vertices\n", size, size,
+         static_cast<uint32_t>(index_faces.size() / 3),
+         static_cast<uint32_t>(index_vertices.size()));
+  printf("  linear scan  %10.3f ms\n", TicksToMs(t1 - t0));
+  printf("  weld index   %10.3f ms\n", TicksToMs(t2 - t1));
+  if (linear_faces != index_faces || linear_vertices.size() != index_vertices.size()) {
+    printf("FAIL weld: face lists differ\n");
+    return false;
+  }
+  printf("  face lists are identical\n");
+  return true;
+}
+
+static void Usage() {
+  printf("Usage: geomtest matrix [count]\n");
+  printf("       geomtest weld   [size]\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    Usage();
+    return 1;
+  }
+
+  std::string mode = argv[1];
+  bool ok;
+  if (mode == "matrix" && argc <= 3)
+    ok = TestMatrix(argc == 3 ? atoi(argv[2]) : 10000);
+  else if (mode == "weld" && argc <= 3 && (argc == 2 || atoi(argv[2]) > 0))
+    ok = BenchWeld(argc == 3 ? atoi(argv[2]) : 224);
+  else {
+    Usage();
+    return 1;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,264 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    texbake.cpp
+//	Purpose: Offline tool that bakes the texture images in a directory to
+//           block compressed, mipmapped DDS files loaded by TextureLoader.
+//           Normal maps (names containing "normal") become BC5, images
+//           with alpha BC3 and all others BC1. Mipmaps are built with
+//           the Kaiser filter of BuildMipChain.
+//
+//           texbake [textures directory]         (default ../../textures)
+//           texbake -bench [textures directory]  mipmap filter throughput
+//
+//============================================================================
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+#include "geometry/parallel.h"
+#include "scene/imagedecode.h"
+#include "scene/ddsfile.h"
+#include "scene/mipbuilder.h"
+
+// Lower case copy of a string
+static std::string Lower(std::string s) {
+  for (size_t i = 0; i < s.size(); i++)
+    s[i] = static_cast<char>(tolower(s[i]));
+  return s;
+}
+
+// Check if a filename has an image extension the decoders read
+static bool IsImageFile(const std::string& name) {
+  static const char* extensions[] = { ".jpg", ".jpeg", ".png", ".bmp", ".tga" };
+  std::string lower = Lower(name);
+  for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+    size_t n = strlen(extensions[i]);
+    if (lower.size() > n && lower.compare(lower.size() - n, n, extensions[i]) == 0)
+      return true;
+  }
+  return false;
+}
+
+// List the image files in a directory (not its subdirectories)
+static std::vector<std::string> ListImages(const std::string& dir) {
+  std::vector<std::string> names;
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE find = FindFirstFileA((dir + "/*").c_str(), &data);
+  if (find != INVALID_HANDLE_VALUE) {
+    do {
+      if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 && IsImageFile(data.cFileName))
+        names.push_back(data.cFileName);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+  }
+#else
+  DIR* d = opendir(dir.c_str());
+  if (d != nullptr) {
+    while (dirent* e = readdir(d)) {
+      if (e->d_type != DT_DIR && IsImageFile(e->d_name))
+        names.push_back(e->d_name);
+    }
+    closedir(d);
+  }
+#endif
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+// Peak signal to noise ratio of the compressed top level against the
+// image (the channels the format stores)
+static double PSNR(const TextureImage& image, const CompressedImage& baked) {
+  std::vector<unsigned char> decoded;
+  DecodeBCImage(baked.format, &baked.data[0], image.width, image.height, decoded);
+  int channels = (baked.format == BC_FORMAT_BC5) ? 2 : ((baked.format == BC_FORMAT_BC3) ? 4 : 3);
+  double sum = 0.0;
+  for (size_t i = 0; i < decoded.size(); i += 4) {
+    for (int k = 0; k < channels; k++) {
+      double d = static_cast<double>(decoded[i + k]) - image.pixels[i + k];
+      sum += d * d;
+    }
+  }
+  double mse = sum / (static_cast<double>(image.width) * image.height * channels);
+  return (mse > 0.0) ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+// Bake one image. Returns the uncompressed and compressed sizes (with
+// mipmaps).
+static bool Bake(const std::string& dir, const std::string& name, uint64_t& raw_bytes,
+                 uint64_t& baked_bytes) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  TextureImage image;
+  if (!DecodeImageFile(dir + "/" + name, image)) {
+    printf("  %-28s error loading image\n", name.c_str());
+    return false;
+  }
+
+  CompressedImage baked;
+  bool normal_map = Lower(name).find("normal") != std::string::npos;
+  bool alpha = false;
+  for (size_t i = 3; i < image.pixels.size() && !alpha; i += 4)
+    alpha = image.pixels[i] != 255;
+  baked.format = normal_map ? BC_FORMAT_BC5 : (alpha ? BC_FORMAT_BC3 : BC_FORMAT_BC1);
+
+  std::vector<TextureImage> mips;
+  BuildMipChain(image, MIP_FILTER_KAISER, normal_map ? MIP_NORMAL_MAP : MIP_COLOR_SRGB, mips);
+
+  // Compress each level of the mipmap chain, block rows in parallel
+  raw_bytes = 0;
+  for (size_t i = 0; i <= mips.size(); i++) {
+    const TextureImage& level = (i == 0) ? image : mips[i - 1];
+    CompressedLevel l;
+    l.width = level.width;
+    l.height = level.height;
+    l.offset = static_cast<uint32_t>(baked.data.size());
+    l.size = BCImageBytes(baked.format, level.width, level.height);
+    baked.levels.push_back(l);
+    baked.data.resize(l.offset + l.size);
+    unsigned char* out = &baked.data[l.offset];
+    ThreadPool::Get().ParallelFor((level.height + 3) / 4, 4, [&](size_t row0, size_t row1) {
+      EncodeBCRows(baked.format, &level.pixels[0], level.width, level.height,
+                   static_cast<int>(row0), static_cast<int>(row1), out);
+    });
+    raw_bytes += level.pixels.size();
+  }
+  baked_bytes = baked.data.size();
+
+  std::string out_name = BakedTextureName(name);
+  if (!WriteDDS(dir + "/" + out_name, baked)) {
+    printf("  %-28s error writing %s\n", name.c_str(), out_name.c_str());
+    return false;
+  }
+  double ms = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start).count();
+  static const char* format_names[] = { "BC1", "BC3", "BC5" };
+  printf("  %-28s %4d x %-4d %s %2u levels %7.2f MB -> %6.2f MB  %5.2f dB %6.0f ms\n",
+         name.c_str(), image.width, image.height, format_names[baked.format],
+         static_cast<uint32_t>(baked.levels.size()), raw_bytes / (1024.0 * 1024.0),
+         baked_bytes / (1024.0 * 1024.0), PSNR(image, baked), ms);
+  return true;
+}
+
+// Mipmap chain throughput (base megapixels per second) of each filter on
+// the images 2048 texels or larger: one chain at a time on one thread, then
+// all images at once across the pool
+static bool Bench(const std::string& dir, const std::vector<std::string>& names) {
+  std::vector<TextureImage> images;
+  for (size_t i = 0; i < names.size(); i++) {
+    TextureImage image;
+    if (DecodeImageFile(dir + "/" + names[i], image) &&
+        (image.width >= 2048 || image.height >= 2048)) {
+      printf("  %-28s %4d x %d\n", names[i].c_str(), image.width, image.height);
+      images.push_back(image);
+    }
+  }
+  if (images.empty()) {
+    printf("No images 2048 texels or larger in %s\n", dir.c_str());
+    return false;
+  }
+  double mpix = 0.0;
+  for (size_t i = 0; i < images.size(); i++)
+    mpix += images[i].width * static_cast<double>(images[i].height) * 1.0e-6;
+
+#if defined(GEOMETRY_USE_AVX)
+  const char* simd = "AVX";
+#elif defined(GEOMETRY_USE_SSE)
+  const char* simd = "SSE";
+#else
+  const char* simd = "scalar";
+#endif
+  printf("Mipmap chains (%s)\n  %-19s %15s %11u threads\n", simd, "", "1 thread",
+         ThreadPool::Get().GetThreadCount());
+  static const char* filter_names[] = { "box", "Kaiser" };
+  static const char* content_names[] = { "sRGB color", "linear color", "normal map" };
+  const int kRepeat = 3;
+  for (int f = MIP_FILTER_BOX; f <= MIP_FILTER_KAISER; f++) {
+    for (int c = MIP_COLOR_SRGB; c <= MIP_NORMAL_MAP; c++) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for (int r = 0; r < kRepeat; r++) {
+        for (size_t i = 0; i < images.size(); i++) {
+          std::vector<TextureImage> mips;
+          BuildMipChain(images[i], static_cast<MipFilter>(f), static_cast<MipContent>(c), mips);
+        }
+      }
+      double serial = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      start = std::chrono::steady_clock::now();
+      for (int r = 0; r < kRepeat; r++) {
+        ThreadPool::Get().ParallelFor(images.size(), 1, [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++) {
+            std::vector<TextureImage> mips;
+            BuildMipChain(images[i], static_cast<MipFilter>(f), static_cast<MipContent>(c), mips);
+          }
+        });
+      }
+      double parallel = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("  %-6s %-12s %8.1f MPix/s %8.1f MPix/s\n", filter_names[f], content_names[c],
+             mpix * kRepeat / serial, mpix * kRepeat / parallel);
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  bool bench = argc > 1 && strcmp(argv[1], "-bench") == 0;
+  int arg = bench ? 2 : 1;
+  std::string dir = (argc > arg) ? argv[arg] : "../../textures";
+  if (argc > arg + 1 || dir == "-h" || dir == "--help") {
+    printf("Usage: texbake [-bench] [textures directory]\n");
+    return 1;
+  }
+
+  // Initialize DevIL and COM (WIC). The pool and DevIL lock are created
+  // before any work runs on the pool.
+  ilInit();
+  DevILMutex();
+  MipInitTables();
+  ThreadPool::Get();
+#ifdef _WIN32
+  CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+
+  std::vector<std::string> names = ListImages(dir);
+  if (names.empty()) {
+    printf("No images found in %s\n", dir.c_str());
+    return 1;
+  }
+  if (bench)
+    return Bench(dir, names) ? 0 : 1;
+  printf("Baking %u images in %s (%u threads)\n", static_cast<uint32_t>(names.size()),
+         dir.c_str(), ThreadPool::Get().GetThreadCount());
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  uint64_t raw_total = 0;
+  uint64_t baked_total = 0;
+  int failed = 0;
+  for (size_t i = 0; i < names.size(); i++) {
+    uint64_t raw_bytes = 0;
+    uint64_t baked_bytes = 0;
+    if (Bake(dir, names[i], raw_bytes, baked_bytes)) {
+      raw_total += raw_bytes;
+      baked_total += baked_bytes;
+    }
+    else
+      failed++;
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("%.2f MB RGBA -> %.2f MB baked (%.1fx smaller) in %.1f s, %d failed\n",
+         raw_total / (1024.0 * 1024.0), baked_total / (1024.0 * 1024.0),
+         (baked_total > 0) ? static_cast<double>(raw_total) / baked_total : 0.0, s, failed);
+  return (failed == 0) ? 0 : 1;
+}
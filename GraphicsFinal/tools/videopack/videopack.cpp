@@ -0,0 +1,250 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.467 Computer Graphics and 605.767 Applied Computer Graphics
+//	Instructor:	David W. Nesbitt
+//
+//	Author:  Sam Du, Miles Gapcynski, and Chad Pournaras
+//	File:    videopack.cpp
+//	Purpose: Offline tool that packs a numbered image sequence into a
+//           packed video (.vpak) for VideoTexture, and compares playback
+//           cost against decoding the image files.
+//
+//           videopack pack  <basefname> <frames> <ext> <out.vpak>
+//           videopack bench <basefname> <frames> <ext> <in.vpak>
+//
+//           basefname is relative to the textures directory, e.g.
+//           videopack pack Video/futurama00 336 .jpg ../../textures/Video/futurama00.vpak
+//
+//============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <chrono>
+#endif
+
+#include "geometry/parallel.h"
+#include "scene/imagedecode.h"
+#include "scene/videopack.h"
+
+// Current time in ticks
+static uint64_t Now() {
+#ifdef _WIN32
+  LARGE_INTEGER t;
+  QueryPerformanceCounter(&t);
+  return static_cast<uint64_t>(t.QuadPart);
+#else
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Convert ticks to milliseconds
+static double TicksToMs(const uint64_t ticks) {
+#ifdef _WIN32
+  LARGE_INTEGER f;
+  QueryPerformanceFrequency(&f);
+  return ticks * 1000.0 / static_cast<double>(f.QuadPart);
+#else
+  return ticks * 1.0e-6;
+#endif
+}
+
+// Round up to the frame alignment
+static uint64_t Align(const uint64_t n) {
+  return (n + kVideoPackAlignment - 1) / kVideoPackAlignment * kVideoPackAlignment;
+}
+
+// Decode frames [first, first + images.size()) in parallel
+static void DecodeFrames(const std::string& base, const int first, const std::string& ext,
+                         std::vector<TextureImage>& images, std::vector<char>& ok) {
+  ThreadPool::Get().ParallelFor(images.size(), 1, [&](size_t begin, size_t end) {
+#ifdef _WIN32
+    // WIC is a COM API - each thread using it initializes COM
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+    for (size_t i = begin; i < end; i++) {
+      ok[i] = DecodeTextureFile(VideoFrameName(base, first + static_cast<int>(i), ext),
+                                images[i]);
+    }
+#ifdef _WIN32
+    CoUninitialize();
+#endif
+  });
+}
+
+// Pack frames into a packed video file
+static bool Pack(const std::string& base, const int frames, const std::string& ext,
+                 const std::string& out) {
+  uint64_t start = Now();
+
+  // The first frame sets the size of all frames
+  TextureImage image;
+  if (!DecodeTextureFile(VideoFrameName(base, 0, ext), image)) {
+    printf("Error loading video frame. %s\n", VideoFrameName(base, 0, ext).c_str());
+    return false;
+  }
+
+  VideoPackHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kVideoPackMagic, 4);
+  header.version = kVideoPackVersion;
+  header.format = VIDEOPACK_RGBA8;
+  header.width = image.width;
+  header.height = image.height;
+  header.frame_count = frames;
+
+  uint64_t frame_size = VideoPackFrameSize(header.format, header.width, header.height);
+  uint64_t data_start = Align(sizeof(VideoPackHeader) + frames * sizeof(VideoPackFrame));
+  std::vector<VideoPackFrame> index(frames);
+  for (int i = 0; i < frames; i++) {
+    index[i].offset = data_start + i * Align(frame_size);
+    index[i].size = frame_size;
+  }
+
+  FILE* f = fopen(out.c_str(), "wb");
+  if (f == nullptr) {
+    printf("Cannot open %s for writing\n", out.c_str());
+    return false;
+  }
+  std::vector<unsigned char> padding(kVideoPackAlignment, 0);
+  uint64_t written = sizeof(header) + index.size() * sizeof(VideoPackFrame);
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(&index[0], sizeof(VideoPackFrame), index.size(), f) == index.size() &&
+            fwrite(&padding[0], 1, data_start - written, f) == data_start - written;
+
+  // Decode a few frames per thread at a time and write them in order
+  int chunk = static_cast<int>(ThreadPool::Get().GetThreadCount()) * 4;
+  for (int first = 0; ok && first < frames; first += chunk) {
+    int n = (frames - first < chunk) ? frames - first : chunk;
+    std::vector<TextureImage> images(n);
+    std::vector<char> decoded(n);
+    DecodeFrames(base, first, ext, images, decoded);
+    for (int i = 0; ok && i < n; i++) {
+      if (!decoded[i] || images[i].width != image.width || images[i].height != image.height) {
+        printf("Error loading video frame (or size differs from the first frame). %s\n",
+               VideoFrameName(base, first + i, ext).c_str());
+        ok = false;
+        break;
+      }
+      uint64_t pad = Align(frame_size) - frame_size;
+      ok = fwrite(&images[i].pixels[0], 1, frame_size, f) == frame_size &&
+           fwrite(&padding[0], 1, pad, f) == pad;
+    }
+    printf("\r%d / %d frames", first + n, frames);
+    fflush(stdout);
+  }
+  printf("\n");
+  if (fclose(f) != 0 || !ok) {
+    printf("Error writing %s\n", out.c_str());
+    remove(out.c_str());
+    return false;
+  }
+
+  printf("Packed %d frames (%u x %u RGBA) into %s: %.1f MB in %.1f s (%u threads)\n",
+         frames, header.width, header.height, out.c_str(),
+         (data_start + frames * Align(frame_size)) / (1024.0 * 1024.0),
+         TicksToMs(Now() - start) / 1000.0, ThreadPool::Get().GetThreadCount());
+  return true;
+}
+
+// Compare startup and per frame cost of decoding image files against
+// copying frames from the packed video. Per frame work is what the
+// VideoTexture decode thread does for each pixel buffer.
+static bool Bench(const std::string& base, const int frames, const std::string& ext,
+                  const std::string& path) {
+  // Startup: time until the first frame is ready to upload
+  uint64_t t0 = Now();
+  TextureImage image;
+  if (!DecodeTextureFile(VideoFrameName(base, 0, ext), image)) {
+    printf("Error loading video frame. %s\n", VideoFrameName(base, 0, ext).c_str());
+    return false;
+  }
+  double image_startup = TicksToMs(Now() - t0);
+
+  t0 = Now();
+  VideoPackReader pack;
+  if (!pack.Open(path)) {
+    printf("Cannot open %s\n", path.c_str());
+    return false;
+  }
+  std::vector<unsigned char> buffer(static_cast<size_t>(pack.GetFrameSize()));
+  memcpy(&buffer[0], pack.GetFrame(0), buffer.size());
+  double pack_startup = TicksToMs(Now() - t0);
+
+  int n = (frames < static_cast<int>(pack.GetFrameCount())) ?
+    frames : static_cast<int>(pack.GetFrameCount());
+  if (pack.GetWidth() != static_cast<uint32_t>(image.width) ||
+      pack.GetHeight() != static_cast<uint32_t>(image.height) ||
+      memcmp(&buffer[0], &image.pixels[0], buffer.size()) != 0) {
+    printf("%s does not match the image files\n", path.c_str());
+    return false;
+  }
+
+  // Per frame: decode each image file (one thread, like the decode thread)
+  t0 = Now();
+  for (int i = 0; i < n; i++) {
+    if (!DecodeTextureFile(VideoFrameName(base, i, ext), image)) {
+      printf("Error loading video frame. %s\n", VideoFrameName(base, i, ext).c_str());
+      return false;
+    }
+  }
+  double image_frame = TicksToMs(Now() - t0) / n;
+
+  // Per frame: copy from the mapping. The first pass reads pages from disk
+  // unless the file is already in the OS file cache.
+  double pack_frame[2];
+  for (int pass = 0; pass < 2; pass++) {
+    t0 = Now();
+    for (int i = 0; i < n; i++)
+      memcpy(&buffer[0], pack.GetFrame(i), buffer.size());
+    pack_frame[pass] = TicksToMs(Now() - t0) / n;
+  }
+
+  double frame_mb = buffer.size() / (1024.0 * 1024.0);
+  printf("%d frames, %u x %u (%.2f MB per frame)\n", n, pack.GetWidth(), pack.GetHeight(),
+         frame_mb);
+  printf("                        image files    packed\n");
+  printf("  startup (first frame) %8.2f ms  %8.2f ms\n", image_startup, pack_startup);
+  printf("  per frame (first)     %8.2f ms  %8.2f ms\n", image_frame, pack_frame[0]);
+  printf("  per frame (again)     %8s     %8.2f ms  (%.0f MB/s)\n", "", pack_frame[1],
+         frame_mb * 1000.0 / pack_frame[1]);
+  return true;
+}
+
+static void Usage() {
+  printf("Usage: videopack pack  <basefname> <frames> <ext> <out.vpak>\n");
+  printf("       videopack bench <basefname> <frames> <ext> <in.vpak>\n");
+  printf("basefname is relative to the textures directory\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc != 6 || atoi(argv[3]) <= 0) {
+    Usage();
+    return 1;
+  }
+
+  // Initialize DevIL. The pool and DevIL lock are created before any
+  // frames are decoded in parallel.
+  ilInit();
+  DevILMutex();
+  ThreadPool::Get();
+#ifdef _WIN32
+  CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+
+  std::string mode = argv[1];
+  bool ok;
+  if (mode == "pack")
+    ok = Pack(argv[2], atoi(argv[3]), argv[4], argv[5]);
+  else if (mode == "bench")
+    ok = Bench(argv[2], atoi(argv[3]), argv[4], argv[5]);
+  else {
+    Usage();
+    return 1;
+  }
+  return ok ? 0 : 1;
+}